@@ -5,7 +5,7 @@
     LzmaUtil.c -- Test application for LZMA compression
     2016-10-04 : Igor Pavlov : Public domain
 
-  Copyright (c) 2006 - 2016, Intel Corporation. All rights reserved.<BR>
+  Copyright (c) 2006 - 2017, Intel Corporation. All rights reserved.<BR>
   This program and the accompanying materials
   are licensed and made available under the terms and conditions of the BSD License
   which accompanies this distribution.  The full text of the license may be found at
@@ -32,6 +32,15 @@
 
 #define LZMA_HEADER_SIZE (LZMA_PROPS_SIZE + 8)
 
+//
+// Layout of the LZMA block format. It must match LZMA_BLOCK_HEADER and
+// LZMA_BLOCK_ENTRY in MdeModulePkg/Include/Guid/LzmaDecompress.h.
+//
+#define LZMA_BLOCK_SIGNATURE          0x4B425A4C  // 'L', 'Z', 'B', 'K'
+#define LZMA_BLOCK_HEADER_SIZE        16
+#define LZMA_BLOCK_ENTRY_SIZE         8
+#define LZMA_BLOCK_DEFAULT_BLOCK_SIZE 0x100000
+
 typedef enum {
   NoConverter, 
   X86Converter,
@@ -45,12 +54,13 @@ const char *kDataErrorMessage = "Data error";
 
 static Bool mQuietMode = False;
 static CONVERTER_TYPE mConType = NoConverter;
+static UInt32 mBlockSize = 0;
 
 #define UTILITY_NAME "LzmaCompress"
 #define UTILITY_MAJOR_VERSION 0
-#define UTILITY_MINOR_VERSION 2
+#define UTILITY_MINOR_VERSION 3
 #define INTEL_COPYRIGHT \
-  "Copyright (c) 2009-2016, Intel Corporation. All rights reserved."
+  "Copyright (c) 2009-2017, Intel Corporation. All rights reserved."
 void PrintHelp(char *buffer)
 {
   strcat(buffer,
@@ -61,6 +71,10 @@ void PrintHelp(char *buffer)
              "  -d: decode file\n"
              "  -o FileName, --output FileName: specify the output filename\n"
              "  --f86: enable converter for x86 code\n"
+             "  --block: split the data into blocks that are compressed independently,\n"
+             "           so they can be decompressed in parallel\n"
+             "  --block-size Size: set the uncompressed size of the blocks\n"
+             "                     (default 0x100000), implies --block\n"
              "  -v, --verbose: increase output messages\n"
              "  -q, --quiet: reduce output messages\n"
              "  --debug [0-9]: set debug level\n"
@@ -177,6 +191,178 @@ Done:
   return res;
 }
 
+static void WriteUInt32(Byte *buffer, UInt32 value)
+{
+  int i;
+  for (i = 0; i < 4; i++)
+    buffer[i] = (Byte)(value >> (8 * i));
+}
+
+static UInt32 ReadUInt32(const Byte *buffer)
+{
+  return (UInt32)buffer[0] | ((UInt32)buffer[1] << 8) |
+         ((UInt32)buffer[2] << 16) | ((UInt32)buffer[3] << 24);
+}
+
+static SRes EncodeBlocks(ISeqOutStream *outStream, ISeqInStream *inStream, UInt64 fileSize)
+{
+  SRes res;
+  size_t inSize = (size_t)fileSize;
+  Byte *inBuffer = 0;
+  Byte *outBuffer = 0;
+  size_t outSize;
+  size_t outPos;
+  UInt32 numBlocks;
+  UInt32 block;
+  CLzmaEncProps props;
+
+  if (inSize == 0)
+    return SZ_ERROR_INPUT_EOF;
+  if (fileSize > 0xFFFFFFFF)
+    return SZ_ERROR_UNSUPPORTED;
+
+  numBlocks = (UInt32)((fileSize + mBlockSize - 1) / mBlockSize);
+
+  inBuffer = (Byte *)MyAlloc(inSize);
+  if (inBuffer == 0)
+    return SZ_ERROR_MEM;
+
+  if (SeqInStream_Read(inStream, inBuffer, inSize) != SZ_OK) {
+    res = SZ_ERROR_READ;
+    goto Done;
+  }
+
+  // we allocate 105% of original size + 64KB for every block, after the index
+  outSize = LZMA_BLOCK_HEADER_SIZE + (size_t)numBlocks * LZMA_BLOCK_ENTRY_SIZE +
+            (size_t)fileSize / 20 * 21 + (size_t)numBlocks * (LZMA_HEADER_SIZE + (1 << 16));
+  outBuffer = (Byte *)MyAlloc(outSize);
+  if (outBuffer == 0) {
+    res = SZ_ERROR_MEM;
+    goto Done;
+  }
+
+  WriteUInt32(outBuffer, LZMA_BLOCK_SIGNATURE);
+  WriteUInt32(outBuffer + 4, numBlocks);
+  WriteUInt32(outBuffer + 8, mBlockSize);
+  WriteUInt32(outBuffer + 12, (UInt32)fileSize);
+  outPos = LZMA_BLOCK_HEADER_SIZE + (size_t)numBlocks * LZMA_BLOCK_ENTRY_SIZE;
+
+  for (block = 0; block < numBlocks; block++) {
+    size_t blockStart = (size_t)block * mBlockSize;
+    size_t blockSize = inSize - blockStart < mBlockSize ? inSize - blockStart : mBlockSize;
+    size_t outSizeProcessed = outSize - outPos - LZMA_HEADER_SIZE;
+    size_t outPropsSize = LZMA_PROPS_SIZE;
+    Byte *entry = outBuffer + LZMA_BLOCK_HEADER_SIZE + (size_t)block * LZMA_BLOCK_ENTRY_SIZE;
+    int i;
+
+    LzmaEncProps_Init(&props);
+    props.reduceSize = blockSize;
+    LzmaEncProps_Normalize(&props);
+
+    for (i = 0; i < 8; i++)
+      outBuffer[outPos + LZMA_PROPS_SIZE + i] = (Byte)((UInt64)blockSize >> (8 * i));
+
+    res = LzmaEncode(outBuffer + outPos + LZMA_HEADER_SIZE, &outSizeProcessed,
+        inBuffer + blockStart, blockSize,
+        &props, outBuffer + outPos, &outPropsSize, 0,
+        NULL, &g_Alloc, &g_Alloc);
+    if (res != SZ_OK)
+      goto Done;
+
+    WriteUInt32(entry, (UInt32)outPos);
+    WriteUInt32(entry + 4, (UInt32)(LZMA_HEADER_SIZE + outSizeProcessed));
+    outPos += LZMA_HEADER_SIZE + outSizeProcessed;
+  }
+
+  if (outStream->Write(outStream, outBuffer, outPos) != outPos)
+    res = SZ_ERROR_WRITE;
+
+Done:
+  MyFree(outBuffer);
+  MyFree(inBuffer);
+
+  return res;
+}
+
+static SRes DecodeBlocks(ISeqOutStream *outStream, ISeqInStream *inStream, UInt64 fileSize)
+{
+  SRes res;
+  size_t inSize = (size_t)fileSize;
+  Byte *inBuffer = 0;
+  Byte *outBuffer = 0;
+  UInt32 numBlocks;
+  UInt32 blockSize;
+  UInt32 decodedSize;
+  UInt32 block;
+  size_t indexSize;
+  ELzmaStatus status;
+
+  if (inSize < LZMA_BLOCK_HEADER_SIZE)
+    return SZ_ERROR_INPUT_EOF;
+
+  inBuffer = (Byte *)MyAlloc(inSize);
+  if (inBuffer == 0)
+    return SZ_ERROR_MEM;
+
+  if (SeqInStream_Read(inStream, inBuffer, inSize) != SZ_OK) {
+    res = SZ_ERROR_READ;
+    goto Done;
+  }
+
+  numBlocks = ReadUInt32(inBuffer + 4);
+  blockSize = ReadUInt32(inBuffer + 8);
+  decodedSize = ReadUInt32(inBuffer + 12);
+  if (ReadUInt32(inBuffer) != LZMA_BLOCK_SIGNATURE || blockSize == 0 || numBlocks == 0 ||
+      numBlocks > (inSize - LZMA_BLOCK_HEADER_SIZE) / LZMA_BLOCK_ENTRY_SIZE ||
+      numBlocks != decodedSize / blockSize + (decodedSize % blockSize != 0)) {
+    res = SZ_ERROR_DATA;
+    goto Done;
+  }
+  indexSize = LZMA_BLOCK_HEADER_SIZE + (size_t)numBlocks * LZMA_BLOCK_ENTRY_SIZE;
+
+  outBuffer = (Byte *)MyAlloc(decodedSize);
+  if (outBuffer == 0) {
+    res = SZ_ERROR_MEM;
+    goto Done;
+  }
+
+  for (block = 0; block < numBlocks; block++) {
+    const Byte *entry = inBuffer + LZMA_BLOCK_HEADER_SIZE + (size_t)block * LZMA_BLOCK_ENTRY_SIZE;
+    size_t offset = ReadUInt32(entry);
+    size_t size = ReadUInt32(entry + 4);
+    size_t expected = block == numBlocks - 1 ? decodedSize - (size_t)block * blockSize : blockSize;
+    size_t outSize = expected;
+    size_t inSizePure;
+
+    if (offset < indexSize || offset > inSize || size > inSize - offset || size < LZMA_HEADER_SIZE ||
+        ReadUInt32(inBuffer + offset + LZMA_PROPS_SIZE) != expected ||
+        ReadUInt32(inBuffer + offset + LZMA_PROPS_SIZE + 4) != 0) {
+      res = SZ_ERROR_DATA;
+      goto Done;
+    }
+
+    inSizePure = size - LZMA_HEADER_SIZE;
+    res = LzmaDecode(outBuffer + (size_t)block * blockSize, &outSize,
+        inBuffer + offset + LZMA_HEADER_SIZE, &inSizePure,
+        inBuffer + offset, LZMA_PROPS_SIZE, LZMA_FINISH_END, &status, &g_Alloc);
+    if (res != SZ_OK)
+      goto Done;
+    if (outSize != expected) {
+      res = SZ_ERROR_DATA;
+      goto Done;
+    }
+  }
+
+  if (outStream->Write(outStream, outBuffer, decodedSize) != decodedSize)
+    res = SZ_ERROR_WRITE;
+
+Done:
+  MyFree(outBuffer);
+  MyFree(inBuffer);
+
+  return res;
+}
+
 static SRes Decode(ISeqOutStream *outStream, ISeqInStream *inStream, UInt64 fileSize)
 {
   SRes res;
@@ -271,6 +457,19 @@ int main2(int numArgs, const char *args[], char *rs)
       modeWasSet = True;
     } else if (strcmp(args[param], "--f86") == 0) {
       mConType = X86Converter;
+    } else if (strcmp(args[param], "--block") == 0) {
+      if (mBlockSize == 0) {
+        mBlockSize = LZMA_BLOCK_DEFAULT_BLOCK_SIZE;
+      }
+    } else if (strcmp(args[param], "--block-size") == 0) {
+      char *end;
+      if (numArgs < (param + 2)) {
+        return PrintUserError(rs);
+      }
+      mBlockSize = (UInt32)strtoul(args[++param], &end, 0);
+      if (*end != '\0' || mBlockSize == 0) {
+        return PrintUserError(rs);
+      }
     } else if (strcmp(args[param], "-o") == 0 ||
                strcmp(args[param], "--output") == 0) {
       if (numArgs < (param + 2)) {
@@ -319,6 +518,14 @@ int main2(int numArgs, const char *args[], char *rs)
     return PrintUserError(rs);
   }
 
+  //
+  // The blocks are decompressed separately, which the x86 converter does not
+  // support.
+  //
+  if (mBlockSize != 0 && mConType != NoConverter) {
+    return PrintUserError(rs);
+  }
+
   {
     size_t t4 = sizeof(UInt32);
     size_t t8 = sizeof(UInt64);
@@ -341,14 +548,22 @@ int main2(int numArgs, const char *args[], char *rs)
     if (!mQuietMode) {
       printf("Encoding\n");
     }
-    res = Encode(&outStream.s, &inStream.s, fileSize);
+    if (mBlockSize != 0) {
+      res = EncodeBlocks(&outStream.s, &inStream.s, fileSize);
+    } else {
+      res = Encode(&outStream.s, &inStream.s, fileSize);
+    }
   }
   else
   {
     if (!mQuietMode) {
       printf("Decoding\n");
     }
-    res = Decode(&outStream.s, &inStream.s, fileSize);
+    if (mBlockSize != 0) {
+      res = DecodeBlocks(&outStream.s, &inStream.s, fileSize);
+    } else {
+      res = Decode(&outStream.s, &inStream.s, fileSize);
+    }
   }
 
   File_Close(&outStream.file);
@@ -0,0 +1,534 @@
+/** @file
+  Host fuzz and throughput test for the firmware decompression libraries.
+
+  MdePkg BaseUefiDecompressLib and IntelFrameworkModulePkg
+  BaseUefiTianoCustomDecompressLib are built for the host and compared with
+  the BaseTools decompressor in Common/Decompress.c:
+
+  - Generated inputs are compressed with the BaseTools EFI and Tiano
+    compressors. Every decoder must give back the input.
+  - The compressed data is then corrupted. The libraries must give the same
+    status and output as each other, and must not write past the destination.
+  - With -b, the libraries and the BaseTools decoder decode 1MB of text,
+    binary and random data, and their throughput is printed.
+
+  Copyright (c) 2017, Intel Corporation. All rights reserved.<BR>
+  This program and the accompanying materials
+  are licensed and made available under the terms and conditions of the BSD License
+  which accompanies this distribution.  The full text of the license may be found at
+  http://opensource.org/licenses/bsd-license.php
+
+  THE PROGRAM IS DISTRIBUTED UNDER THE BSD LICENSE ON AN "AS IS" BASIS,
+  WITHOUT WARRANTIES OR REPRESENTATIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED.
+
+**/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <sys/mman.h>
+
+#include "Compress.h"
+#include "Decompress.h"
+
+//
+// The library functions, renamed by UefiDecompressLibHost.c and
+// UefiTianoCustomDecompressLibHost.c.
+//
+RETURN_STATUS
+EfiLibUefiDecompressGetInfo (
+  IN  CONST VOID  *Source,
+  IN  UINT32      SourceSize,
+  OUT UINT32      *DestinationSize,
+  OUT UINT32      *ScratchSize
+  );
+
+RETURN_STATUS
+EfiLibUefiDecompress (
+  IN CONST VOID  *Source,
+  IN OUT VOID    *Destination,
+  IN OUT VOID    *Scratch
+  );
+
+RETURN_STATUS
+TianoLibUefiTianoDecompress (
+  IN CONST VOID  *Source,
+  IN OUT VOID    *Destination,
+  IN OUT VOID    *Scratch,
+  IN UINT32      Version
+  );
+
+#define ARRAY_SIZE(Array)   (sizeof (Array) / sizeof ((Array)[0]))
+
+#define MAX_INPUT_SIZE      0x100000
+#define MAX_OUTPUT_SIZE     0x800000
+#define MAX_COMPRESSED_SIZE 0x200000
+#define MAX_BINARY_SIZE     0x400000
+#define BENCHMARK_SIZE      0x100000
+
+//
+// MakeTable () can write past its table on corrupt input, so the scratch
+// buffers are much larger than the libraries ask for.
+//
+#define SCRATCH_SIZE        0x40000
+
+//
+// A corrupt string distance can make the libraries read up to 4GB past the
+// destination, as the position wraps around in 32 bits. The destination is
+// at the start of a 5GB reservation, so those reads land in zero pages.
+//
+#define ARENA_SIZE          0x140000000ULL
+#define GUARD_BYTE          0xA5
+
+typedef enum {
+  FormatEfi,
+  FormatTiano
+} COMPRESS_FORMAT;
+
+STATIC UINT64  mSeed = 88172645463325252ULL;
+STATIC UINT8   *mBinary;
+STATIC UINT32  mBinarySize;
+STATIC UINT8   *mArena;
+STATIC UINT8   *mReference;
+STATIC UINT8   mScratch[SCRATCH_SIZE];
+STATIC UINT8   mScratch2[SCRATCH_SIZE];
+
+STATIC CONST CHAR8 *mWords[] = {
+  "the ", "EFI_STATUS ", "Status ", "return ", "0x0000", "\n  ", "{", "}",
+  "Decompress", " = ", "; "
+};
+
+STATIC
+UINT32
+Random (
+  VOID
+  )
+{
+  mSeed ^= mSeed << 13;
+  mSeed ^= mSeed >> 7;
+  mSeed ^= mSeed << 17;
+  return (UINT32) mSeed;
+}
+
+STATIC
+UINT32
+RandomLength (
+  VOID
+  )
+{
+  switch (Random () % 8) {
+  case 0:
+    return Random () % 16;
+  case 1:
+    return Random () % 300;
+  case 7:
+    return Random () % MAX_INPUT_SIZE;
+  default:
+    return Random () % 0x10000;
+  }
+}
+
+/**
+  Fills a buffer with random data, a small alphabet, words, runs, zeros or
+  a slice of the binary file.
+**/
+STATIC
+VOID
+GenerateInput (
+  OUT UINT8   *Buffer,
+  IN  UINT32  Length
+  )
+{
+  UINT32       Index;
+  UINT32       Run;
+  UINT32       Offset;
+  UINT8        Value;
+  CONST CHAR8  *Word;
+
+  switch (Random () % 6) {
+  case 0:
+    for (Index = 0; Index < Length; Index++) {
+      Buffer[Index] = (UINT8) Random ();
+    }
+    break;
+
+  case 1:
+    for (Index = 0; Index < Length; Index++) {
+      Buffer[Index] = "abcd"[Random () & 3];
+    }
+    break;
+
+  case 2:
+    for (Index = 0; Index < Length;) {
+      for (Word = mWords[Random () % ARRAY_SIZE (mWords)]; *Word != '\0' && Index < Length; Word++) {
+        Buffer[Index++] = *Word;
+      }
+    }
+    break;
+
+  case 3:
+    for (Index = 0; Index < Length;) {
+      Value = (UINT8) Random ();
+      for (Run = Random () % 600; Run > 0 && Index < Length; Run--) {
+        Buffer[Index++] = Value;
+      }
+    }
+    break;
+
+  case 4:
+    memset (Buffer, 0, Length);
+    break;
+
+  default:
+    Offset = mBinarySize > Length ? Random () % (mBinarySize - Length) : 0;
+    for (Index = 0; Index < Length; Index++) {
+      Buffer[Index] = mBinary[(Offset + Index) % mBinarySize];
+    }
+    break;
+  }
+}
+
+/**
+  Decodes with one of the libraries into the arena, and checks that nothing
+  was written past the destination.
+
+  @param  Library   0 for BaseUefiDecompressLib, otherwise the Tiano library
+                    with Library as the version.
+**/
+STATIC
+RETURN_STATUS
+LibraryDecompress (
+  IN  UINT8   *Compressed,
+  IN  UINT32  DestinationSize,
+  IN  UINT32  Library,
+  OUT BOOLEAN *Overrun
+  )
+{
+  RETURN_STATUS  Status;
+
+  memset (mArena, GUARD_BYTE, DestinationSize + 1);
+  memset (mScratch, 0x5A, sizeof (mScratch));
+  if (Library == 0) {
+    Status = EfiLibUefiDecompress (Compressed, mArena, mScratch);
+  } else {
+    Status = TianoLibUefiTianoDecompress (Compressed, mArena, mScratch, Library);
+  }
+  *Overrun = (BOOLEAN) (mArena[DestinationSize] != GUARD_BYTE);
+  return Status;
+}
+
+/**
+  Round trips one input through a BaseTools compressor and every decoder
+  of that format.
+
+  @return  The number of failures.
+**/
+STATIC
+UINT32
+TestRoundTrip (
+  IN  UINT8            *Input,
+  IN  UINT32           InputSize,
+  IN  COMPRESS_FORMAT  Format,
+  OUT UINT8            *Compressed,
+  OUT UINT32           *CompressedSize
+  )
+{
+  UINT32         Failures;
+  UINT32         Library;
+  UINT32         DestinationSize;
+  UINT32         ScratchSize;
+  BOOLEAN        Overrun;
+  RETURN_STATUS  Status;
+
+  *CompressedSize = MAX_COMPRESSED_SIZE;
+  if (Format == FormatEfi) {
+    Status = EfiCompress (Input, InputSize, Compressed, CompressedSize);
+  } else {
+    Status = TianoCompress (Input, InputSize, Compressed, CompressedSize);
+  }
+  if (Status != EFI_SUCCESS) {
+    printf ("%s compression of %u bytes failed\n", Format == FormatEfi ? "EFI" : "Tiano", InputSize);
+    return 1;
+  }
+
+  Failures = 0;
+  memset (mArena, 0, InputSize);
+  if (Format == FormatEfi) {
+    Status = EfiDecompress (Compressed, *CompressedSize, mArena, InputSize, mScratch2, sizeof (mScratch2));
+  } else {
+    Status = TianoDecompress (Compressed, *CompressedSize, mArena, InputSize, mScratch2, sizeof (mScratch2));
+  }
+  if (Status != EFI_SUCCESS || memcmp (mArena, Input, InputSize) != 0) {
+    printf ("BaseTools round trip of %u bytes failed, format %d\n", InputSize, Format);
+    Failures++;
+  }
+
+  Status = EfiLibUefiDecompressGetInfo (Compressed, *CompressedSize, &DestinationSize, &ScratchSize);
+  if (Status != RETURN_SUCCESS || DestinationSize != InputSize || ScratchSize > SCRATCH_SIZE) {
+    printf ("GetInfo failed for %u bytes, format %d\n", InputSize, Format);
+    return Failures + 1;
+  }
+
+  for (Library = (Format == FormatEfi) ? 0 : 2; Library <= (UINT32) ((Format == FormatEfi) ? 1 : 2); Library++) {
+    Status = LibraryDecompress (Compressed, DestinationSize, Library, &Overrun);
+    if (Status != RETURN_SUCCESS || Overrun || memcmp (mArena, Input, InputSize) != 0) {
+      printf ("Library %u round trip of %u bytes failed, format %d\n", Library, InputSize, Format);
+      Failures++;
+    }
+  }
+  return Failures;
+}
+
+/**
+  Decodes corrupt data with both libraries.
+
+  @return  The number of failures.
+**/
+STATIC
+UINT32
+TestCorrupt (
+  IN UINT8            *Compressed,
+  IN UINT32           CompressedSize,
+  IN COMPRESS_FORMAT  Format
+  )
+{
+  UINT32         DestinationSize;
+  UINT32         ScratchSize;
+  UINT32         Library;
+  BOOLEAN        Overrun;
+  RETURN_STATUS  Status;
+  RETURN_STATUS  ReferenceStatus;
+
+  if (EfiLibUefiDecompressGetInfo (Compressed, CompressedSize, &DestinationSize, &ScratchSize) != RETURN_SUCCESS ||
+      DestinationSize > MAX_OUTPUT_SIZE) {
+    return 0;
+  }
+
+  //
+  // The EFI data is decoded by both libraries, and Tiano data by the Tiano
+  // library as EFI and as Tiano data.
+  //
+  Library         = (Format == FormatEfi) ? 0 : 1;
+  ReferenceStatus = LibraryDecompress (Compressed, DestinationSize, Library, &Overrun);
+  if (Overrun) {
+    printf ("Library %u wrote past %u bytes\n", Library, DestinationSize);
+    return 1;
+  }
+  memcpy (mReference, mArena, DestinationSize);
+
+  Library = (Format == FormatEfi) ? 1 : 2;
+  Status  = LibraryDecompress (Compressed, DestinationSize, Library, &Overrun);
+  if (Overrun) {
+    printf ("Library %u wrote past %u bytes\n", Library, DestinationSize);
+    return 1;
+  }
+  if (Format == FormatEfi && (Status != ReferenceStatus || memcmp (mReference, mArena, DestinationSize) != 0)) {
+    printf ("The libraries disagree on corrupt data: status %x and %x\n", (UINT32) ReferenceStatus, (UINT32) Status);
+    return 1;
+  }
+  return 0;
+}
+
+STATIC
+double
+Now (
+  VOID
+  )
+{
+  struct timespec  Time;
+
+  clock_gettime (CLOCK_MONOTONIC, &Time);
+  return (double) Time.tv_sec + (double) Time.tv_nsec / 1e9;
+}
+
+/**
+  Prints the decoding throughput of the libraries and of BaseTools.
+**/
+STATIC
+VOID
+Benchmark (
+  IN UINT8  *Input,
+  IN UINT8  *Compressed
+  )
+{
+  CONST CHAR8  *Names[] = { "text", "binary", "random" };
+  CONST CHAR8  *Line;
+  UINT32       Kind;
+  UINT32       Index;
+  UINT32       Round;
+  UINT32       Decoder;
+  UINT32       CompressedSize;
+  double       Start;
+  double       Seconds;
+  double       Best[3];
+
+  printf ("%-8s %8s %14s %14s %14s\n", "Data", "Ratio", "EfiLib MB/s", "TianoLib MB/s", "BaseTools MB/s");
+  for (Kind = 0; Kind < ARRAY_SIZE (Names); Kind++) {
+    if (Kind == 0) {
+      for (Index = 0; Index < BENCHMARK_SIZE;) {
+        Line = "  Status = gBS->LocateProtocol (&gEfiPciIoProtocolGuid, NULL, (VOID **) &PciIo);\n";
+        for (Line += Random () % 30; *Line != '\0' && Index < BENCHMARK_SIZE; Line++) {
+          Input[Index++] = *Line;
+        }
+      }
+    } else if (Kind == 1) {
+      for (Index = 0; Index < BENCHMARK_SIZE; Index++) {
+        Input[Index] = mBinary[Index % mBinarySize];
+      }
+    } else {
+      for (Index = 0; Index < BENCHMARK_SIZE; Index++) {
+        Input[Index] = (UINT8) Random ();
+      }
+    }
+
+    CompressedSize = MAX_COMPRESSED_SIZE;
+    EfiCompress (Input, BENCHMARK_SIZE, Compressed, &CompressedSize);
+
+    for (Decoder = 0; Decoder < ARRAY_SIZE (Best); Decoder++) {
+      Best[Decoder] = 1e9;
+      for (Round = 0; Round < 7; Round++) {
+        Start = Now ();
+        for (Index = 0; Index < 10; Index++) {
+          if (Decoder == 0) {
+            EfiLibUefiDecompress (Compressed, mArena, mScratch);
+          } else if (Decoder == 1) {
+            TianoLibUefiTianoDecompress (Compressed, mArena, mScratch, 1);
+          } else {
+            EfiDecompress (Compressed, CompressedSize, mArena, BENCHMARK_SIZE, mScratch2, sizeof (mScratch2));
+          }
+        }
+        Seconds = (Now () - Start) / 10;
+        if (Seconds < Best[Decoder]) {
+          Best[Decoder] = Seconds;
+        }
+      }
+    }
+    printf (
+      "%-8s %8.2f %14.1f %14.1f %14.1f\n",
+      Names[Kind],
+      (double) CompressedSize / BENCHMARK_SIZE,
+      1 / Best[0],
+      1 / Best[1],
+      1 / Best[2]
+      );
+  }
+}
+
+STATIC
+VOID
+Usage (
+  VOID
+  )
+{
+  printf ("Usage: DecompressLibTest [-n Iterations] [-s Seed] [-b] [BinaryFile]\n");
+  printf ("  -n  Number of generated inputs to test, 2000 by default\n");
+  printf ("  -s  Random seed\n");
+  printf ("  -b  Print the decoding throughput instead of testing\n");
+  printf ("  BinaryFile is sampled for binary inputs, this program by default\n");
+}
+
+int
+main (
+  int   argc,
+  char  *argv[]
+  )
+{
+  UINT32           Iterations;
+  UINT32           Iteration;
+  UINT32           InputSize;
+  UINT32           CompressedSize;
+  UINT32           Mutation;
+  UINT32           Flips;
+  UINT32           Position;
+  UINT32           Failures;
+  UINT32           Corrupted;
+  BOOLEAN          RunBenchmark;
+  COMPRESS_FORMAT  Format;
+  CONST CHAR8      *BinaryFile;
+  FILE             *File;
+  UINT8            *Input;
+  UINT8            *Compressed;
+  UINT8            *Mutated;
+  int              Index;
+
+  Iterations   = 2000;
+  RunBenchmark = FALSE;
+  BinaryFile   = argv[0];
+  for (Index = 1; Index < argc; Index++) {
+    if (strcmp (argv[Index], "-n") == 0 && Index + 1 < argc) {
+      Iterations = (UINT32) strtoul (argv[++Index], NULL, 0);
+    } else if (strcmp (argv[Index], "-s") == 0 && Index + 1 < argc) {
+      mSeed = strtoull (argv[++Index], NULL, 0) | 1;
+    } else if (strcmp (argv[Index], "-b") == 0) {
+      RunBenchmark = TRUE;
+    } else if (argv[Index][0] != '-') {
+      BinaryFile = argv[Index];
+    } else {
+      Usage ();
+      return 1;
+    }
+  }
+
+  Input      = malloc (MAX_INPUT_SIZE);
+  Compressed = malloc (MAX_COMPRESSED_SIZE);
+  Mutated    = malloc (MAX_COMPRESSED_SIZE);
+  mReference = malloc (MAX_OUTPUT_SIZE);
+  mBinary    = malloc (MAX_BINARY_SIZE);
+  mArena     = mmap (NULL, ARENA_SIZE, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+  if (Input == NULL || Compressed == NULL || Mutated == NULL || mReference == NULL || mBinary == NULL ||
+      mArena == MAP_FAILED) {
+    printf ("Out of memory\n");
+    return 1;
+  }
+
+  File = fopen (BinaryFile, "rb");
+  if (File == NULL) {
+    printf ("Cannot open %s\n", BinaryFile);
+    return 1;
+  }
+  mBinarySize = (UINT32) fread (mBinary, 1, MAX_BINARY_SIZE, File);
+  fclose (File);
+  if (mBinarySize == 0) {
+    printf ("%s is empty\n", BinaryFile);
+    return 1;
+  }
+
+  if (RunBenchmark) {
+    Benchmark (Input, Compressed);
+    return 0;
+  }
+
+  Failures  = 0;
+  Corrupted = 0;
+  for (Iteration = 0; Iteration < Iterations && Failures < 10; Iteration++) {
+    InputSize = RandomLength ();
+    GenerateInput (Input, InputSize);
+    for (Format = FormatEfi; Format <= FormatTiano; Format++) {
+      Failures += TestRoundTrip (Input, InputSize, Format, Compressed, &CompressedSize);
+
+      //
+      // Flip a few bits after the sizes, and sometimes make the compressed
+      // size in the header wrong.
+      //
+      for (Mutation = 0; Mutation < 4; Mutation++) {
+        memcpy (Mutated, Compressed, CompressedSize);
+        for (Flips = 1 + Random () % 8; Flips > 0; Flips--) {
+          Position = 8 + (CompressedSize > 8 ? Random () % (CompressedSize - 8) : 0);
+          if (Position < CompressedSize) {
+            Mutated[Position] ^= (UINT8) (1 << (Random () & 7));
+          }
+        }
+        if ((Random () & 7) == 0 && CompressedSize > 8) {
+          Position = Random () % (CompressedSize - 8);
+          memcpy (Mutated, &Position, sizeof (Position));
+        }
+        Failures += TestCorrupt (Mutated, CompressedSize, Format);
+        Corrupted++;
+      }
+    }
+  }
+
+  printf ("%u inputs, %u corrupted streams, %u failures\n", Iteration, Corrupted, Failures);
+  return Failures != 0;
+}
@@ -0,0 +1,119 @@
+/** @file
+  Host versions of the BaseLib, BaseMemoryLib, DebugLib and
+  ExtractGuidedSectionLib functions used by the decompression libraries.
+
+  Copyright (c) 2017, Intel Corporation. All rights reserved.<BR>
+  This program and the accompanying materials
+  are licensed and made available under the terms and conditions of the BSD License
+  which accompanies this distribution.  The full text of the license may be found at
+  http://opensource.org/licenses/bsd-license.php
+
+  THE PROGRAM IS DISTRIBUTED UNDER THE BSD LICENSE ON AN "AS IS" BASIS,
+  WITHOUT WARRANTIES OR REPRESENTATIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED.
+
+**/
+
+#include <PiPei.h>
+#include <Library/BaseLib.h>
+#include <Library/BaseMemoryLib.h>
+#include <Library/DebugLib.h>
+#include <Library/ExtractGuidedSectionLib.h>
+
+//
+// The C library is reached through the compiler builtins, as its headers
+// conflict with the MdePkg ones.
+//
+
+GUID  gTianoCustomDecompressGuid;
+
+UINT32
+EFIAPI
+ReadUnaligned32 (
+  IN      CONST UINT32              *Buffer
+  )
+{
+  UINT32  Value;
+
+  __builtin_memcpy (&Value, Buffer, sizeof (Value));
+  return Value;
+}
+
+VOID *
+EFIAPI
+CopyMem (
+  OUT VOID       *DestinationBuffer,
+  IN CONST VOID  *SourceBuffer,
+  IN UINTN       Length
+  )
+{
+  return __builtin_memmove (DestinationBuffer, SourceBuffer, Length);
+}
+
+VOID *
+EFIAPI
+SetMem (
+  OUT VOID  *Buffer,
+  IN UINTN  Length,
+  IN UINT8  Value
+  )
+{
+  return __builtin_memset (Buffer, Value, Length);
+}
+
+VOID *
+EFIAPI
+SetMem16 (
+  OUT VOID   *Buffer,
+  IN UINTN   Length,
+  IN UINT16  Value
+  )
+{
+  UINT16  *Pointer;
+
+  for (Pointer = Buffer, Length /= sizeof (UINT16); Length > 0; Length--) {
+    *Pointer++ = Value;
+  }
+  return Buffer;
+}
+
+BOOLEAN
+EFIAPI
+CompareGuid (
+  IN CONST GUID  *Guid1,
+  IN CONST GUID  *Guid2
+  )
+{
+  return (BOOLEAN) (__builtin_memcmp (Guid1, Guid2, sizeof (GUID)) == 0);
+}
+
+VOID
+EFIAPI
+DebugAssert (
+  IN CONST CHAR8  *FileName,
+  IN UINTN        LineNumber,
+  IN CONST CHAR8  *Description
+  )
+{
+  __builtin_printf ("ASSERT %s(%u): %s\n", FileName, (UINT32) LineNumber, Description);
+  __builtin_abort ();
+}
+
+BOOLEAN
+EFIAPI
+DebugAssertEnabled (
+  VOID
+  )
+{
+  return TRUE;
+}
+
+RETURN_STATUS
+EFIAPI
+ExtractGuidedSectionRegisterHandlers (
+  IN CONST  GUID                                     *SectionGuid,
+  IN        EXTRACT_GUIDED_SECTION_GET_INFO_HANDLER  GetInfoHandler,
+  IN        EXTRACT_GUIDED_SECTION_DECODE_HANDLER    DecodeHandler
+  )
+{
+  return RETURN_SUCCESS;
+}
@@ -0,0 +1,28 @@
+/** @file
+  Builds MdePkg BaseUefiDecompressLib for the host, with its global names
+  prefixed so that it links next to the Tiano copy and BaseTools Common.
+
+  Copyright (c) 2017, Intel Corporation. All rights reserved.<BR>
+  This program and the accompanying materials
+  are licensed and made available under the terms and conditions of the BSD License
+  which accompanies this distribution.  The full text of the license may be found at
+  http://opensource.org/licenses/bsd-license.php
+
+  THE PROGRAM IS DISTRIBUTED UNDER THE BSD LICENSE ON AN "AS IS" BASIS,
+  WITHOUT WARRANTIES OR REPRESENTATIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED.
+
+**/
+
+#define FillBuf                 EfiLibFillBuf
+#define GetBits                 EfiLibGetBits
+#define MakeTable               EfiLibMakeTable
+#define DecodeP                 EfiLibDecodeP
+#define ReadPTLen               EfiLibReadPTLen
+#define ReadCLen                EfiLibReadCLen
+#define DecodeC                 EfiLibDecodeC
+#define Decode                  EfiLibDecode
+#define DecodeFast              EfiLibDecodeFast
+#define UefiDecompressGetInfo   EfiLibUefiDecompressGetInfo
+#define UefiDecompress          EfiLibUefiDecompress
+
+#include <BaseUefiDecompressLib.c>
@@ -0,0 +1,33 @@
+/** @file
+  Builds IntelFrameworkModulePkg BaseUefiTianoCustomDecompressLib for the
+  host, with its global names prefixed so that it links next to the MdePkg
+  copy and BaseTools Common.
+
+  Copyright (c) 2017, Intel Corporation. All rights reserved.<BR>
+  This program and the accompanying materials
+  are licensed and made available under the terms and conditions of the BSD License
+  which accompanies this distribution.  The full text of the license may be found at
+  http://opensource.org/licenses/bsd-license.php
+
+  THE PROGRAM IS DISTRIBUTED UNDER THE BSD LICENSE ON AN "AS IS" BASIS,
+  WITHOUT WARRANTIES OR REPRESENTATIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED.
+
+**/
+
+#define FillBuf                         TianoLibFillBuf
+#define GetBits                         TianoLibGetBits
+#define MakeTable                       TianoLibMakeTable
+#define DecodeP                         TianoLibDecodeP
+#define ReadPTLen                       TianoLibReadPTLen
+#define ReadCLen                        TianoLibReadCLen
+#define DecodeC                         TianoLibDecodeC
+#define Decode                          TianoLibDecode
+#define DecodeFast                      TianoLibDecodeFast
+#define UefiDecompressGetInfo           TianoLibUefiDecompressGetInfo
+#define UefiDecompress                  TianoLibUefiDecompress
+#define UefiTianoDecompress             TianoLibUefiTianoDecompress
+#define TianoDecompressGetInfo          TianoLibTianoDecompressGetInfo
+#define TianoDecompress                 TianoLibTianoDecompress
+#define TianoDecompressLibConstructor   TianoLibTianoDecompressLibConstructor
+
+#include <BaseUefiTianoCustomDecompressLib.c>
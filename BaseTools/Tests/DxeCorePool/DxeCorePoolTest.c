@@ -0,0 +1,707 @@
+/** @file
+  Host test and trace-driven benchmark for the DxeCore pool.
+
+  MdeModulePkg/Core/Dxe/Mem/Pool.c is built for the host, on top of a page
+  allocator that checks and counts the pages the pool takes and returns:
+
+  - Every size up to three pages is allocated and freed for boot time,
+    runtime, ACPI and OEM memory types, and invalid requests must fail.
+  - A trace of allocations and frees is replayed. Every buffer is filled on
+    allocation and checked when it is freed, and the pool must give back all
+    of its pages once the trace is over.
+  - With -b, the trace is replayed several times, and the time per operation,
+    the calls to the page allocator and the pages held by the pool are
+    printed.
+
+  The trace is generated, with the mix of sizes, memory types and lifetimes
+  of a DXE boot, or read with -t from a boot log printed with DEBUG_POOL
+  enabled.
+
+  Copyright (c) 2017, Intel Corporation. All rights reserved.<BR>
+  This program and the accompanying materials
+  are licensed and made available under the terms and conditions of the BSD License
+  which accompanies this distribution.  The full text of the license may be found at
+  http://opensource.org/licenses/bsd-license.php
+
+  THE PROGRAM IS DISTRIBUTED UNDER THE BSD LICENSE ON AN "AS IS" BASIS,
+  WITHOUT WARRANTIES OR REPRESENTATIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED.
+
+**/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include <Common/UefiBaseTypes.h>
+#include <Common/UefiMultiPhase.h>
+
+//
+// The pool functions, from Mem/Pool.c.
+//
+VOID
+CoreInitializePool (
+  VOID
+  );
+
+EFI_STATUS
+EFIAPI
+CoreAllocatePool (
+  IN EFI_MEMORY_TYPE  PoolType,
+  IN UINTN            Size,
+  OUT VOID            **Buffer
+  );
+
+EFI_STATUS
+EFIAPI
+CoreFreePool (
+  IN VOID  *Buffer
+  );
+
+//
+// From HostLibStubs.c.
+//
+extern BOOLEAN  gHostClearMemory;
+
+#define ARRAY_SIZE(Array)   (sizeof (Array) / sizeof ((Array)[0]))
+
+#define MAX_OPERATIONS      0x400000
+#define MAX_SLOTS           0x10000
+#define ADDRESS_MAP_SIZE    0x40000
+#define MAX_TEST_SIZE       (3 * EFI_PAGE_SIZE)
+
+//
+// The pages given to the pool are preceded by a HOST_PAGES, so that
+// CoreFreePoolPages () can check that they are returned whole.
+//
+#define HOST_PAGES_SIGNATURE  0x5345474150545348ULL
+typedef struct {
+  UINT64  Signature;
+  VOID    *Allocation;
+  UINTN   NoPages;
+  UINTN   Reserved;
+} HOST_PAGES;
+
+//
+// An allocation or a free of the trace. Slot numbers the allocations that
+// are live at the same time.
+//
+typedef struct {
+  BOOLEAN          Free;
+  UINT32           Slot;
+  UINT32           Size;
+  EFI_MEMORY_TYPE  Type;
+} TRACE_OPERATION;
+
+typedef struct {
+  VOID    *Buffer;
+  UINT32  Size;
+} TRACE_SLOT;
+
+STATIC UINT64           mSeed = 0x2545F4914F6CDD1DULL;
+STATIC TRACE_OPERATION  *mTrace;
+STATIC UINT32           mTraceCount;
+STATIC TRACE_SLOT       mSlots[MAX_SLOTS];
+STATIC UINT32           mFreeSlots[MAX_SLOTS];
+STATIC UINT32           mFreeSlotCount;
+STATIC UINT32           mSlotCount;
+
+//
+// Addresses of the live allocations of a boot log, and their slot.
+//
+STATIC UINT64           mAddressKey[ADDRESS_MAP_SIZE];
+STATIC UINT32           mAddressSlot[ADDRESS_MAP_SIZE];
+
+STATIC UINTN            mPages;
+STATIC UINTN            mPeakPages;
+STATIC UINTN            mPageCalls;
+
+VOID *
+CoreAllocatePoolPages (
+  IN EFI_MEMORY_TYPE    PoolType,
+  IN UINTN              NumberOfPages,
+  IN UINTN              Alignment
+  )
+{
+  VOID        *Allocation;
+  HOST_PAGES  *Pages;
+
+  if (posix_memalign (&Allocation, Alignment, Alignment + NumberOfPages * EFI_PAGE_SIZE) != 0) {
+    return NULL;
+  }
+  Pages = (HOST_PAGES *) ((UINT8 *) Allocation + Alignment) - 1;
+  Pages->Signature  = HOST_PAGES_SIGNATURE;
+  Pages->Allocation = Allocation;
+  Pages->NoPages    = NumberOfPages;
+
+  mPageCalls++;
+  mPages += NumberOfPages;
+  if (mPages > mPeakPages) {
+    mPeakPages = mPages;
+  }
+  return Pages + 1;
+}
+
+VOID
+CoreFreePoolPages (
+  IN EFI_PHYSICAL_ADDRESS   Memory,
+  IN UINTN                  NumberOfPages
+  )
+{
+  HOST_PAGES  *Pages;
+
+  Pages = (HOST_PAGES *) (UINTN) Memory - 1;
+  if (Pages->Signature != HOST_PAGES_SIGNATURE || Pages->NoPages != NumberOfPages) {
+    printf ("CoreFreePoolPages: %u pages at 0x%llx were not allocated\n", (UINT32) NumberOfPages, (unsigned long long) Memory);
+    abort ();
+  }
+  Pages->Signature = 0;
+
+  mPageCalls++;
+  mPages -= NumberOfPages;
+  free (Pages->Allocation);
+}
+
+STATIC
+UINT32
+Random (
+  VOID
+  )
+{
+  mSeed ^= mSeed << 13;
+  mSeed ^= mSeed >> 7;
+  mSeed ^= mSeed << 17;
+  return (UINT32) mSeed;
+}
+
+/**
+  Returns the size of a generated allocation: mostly small structures,
+  device paths and strings, some buffers, and a few allocations of pages.
+**/
+STATIC
+UINT32
+RandomSize (
+  VOID
+  )
+{
+  UINT32  Kind;
+
+  Kind = Random () % 100;
+  if (Kind < 55) {
+    return 8 + Random () % 120;
+  } else if (Kind < 80) {
+    return 128 + Random () % 384;
+  } else if (Kind < 92) {
+    return 512 + Random () % 1536;
+  } else if (Kind < 98) {
+    return 2048 + Random () % 2048;
+  }
+  return 4096 + Random () % 0x8000;
+}
+
+STATIC
+EFI_MEMORY_TYPE
+RandomType (
+  VOID
+  )
+{
+  UINT32  Kind;
+
+  Kind = Random () % 100;
+  if (Kind < 85) {
+    return EfiBootServicesData;
+  } else if (Kind < 91) {
+    return EfiRuntimeServicesData;
+  } else if (Kind < 94) {
+    return EfiACPIReclaimMemory;
+  } else if (Kind < 97) {
+    return EfiLoaderData;
+  } else if (Kind < 99) {
+    return EfiBootServicesCode;
+  }
+  return (EFI_MEMORY_TYPE) 0x80000001;
+}
+
+STATIC
+UINT32
+NewSlot (
+  VOID
+  )
+{
+  if (mFreeSlotCount > 0) {
+    return mFreeSlots[--mFreeSlotCount];
+  }
+  return mSlotCount++;
+}
+
+STATIC
+VOID
+AddOperation (
+  IN BOOLEAN          Free,
+  IN UINT32           Slot,
+  IN UINT32           Size,
+  IN EFI_MEMORY_TYPE  Type
+  )
+{
+  mTrace[mTraceCount].Free = Free;
+  mTrace[mTraceCount].Slot = Slot;
+  mTrace[mTraceCount].Size = Size;
+  mTrace[mTraceCount].Type = Type;
+  mTraceCount++;
+  if (Free) {
+    mFreeSlots[mFreeSlotCount++] = Slot;
+  }
+}
+
+/**
+  Generates a trace of Count operations. A little more than half of them
+  are allocations. Most frees release the latest live allocation, as
+  temporary buffers do, and the others one of the older allocations.
+**/
+STATIC
+VOID
+GenerateTrace (
+  IN UINT32  Count
+  )
+{
+  UINT32  Live[MAX_SLOTS];
+  UINT32  LiveCount;
+  UINT32  Victim;
+  UINT32  Slot;
+
+  LiveCount = 0;
+  while (mTraceCount < Count) {
+    if (LiveCount > 0 && (LiveCount == MAX_SLOTS || Random () % 100 < 48)) {
+      Victim = (Random () % 10 < 7) ? LiveCount - 1 : Random () % LiveCount;
+      AddOperation (TRUE, Live[Victim], 0, EfiBootServicesData);
+      Live[Victim] = Live[--LiveCount];
+    } else {
+      Slot = NewSlot ();
+      Live[LiveCount++] = Slot;
+      AddOperation (FALSE, Slot, RandomSize (), RandomType ());
+    }
+  }
+}
+
+STATIC
+UINT32
+AddressHash (
+  IN UINT64  Address
+  )
+{
+  return (UINT32) ((Address >> 3) * 0x9E3779B1U) & (ADDRESS_MAP_SIZE - 1);
+}
+
+/**
+  Finds the position of Address in the address map, or the free position
+  where it belongs.
+**/
+STATIC
+UINT32
+FindAddress (
+  IN UINT64  Address
+  )
+{
+  UINT32  Index;
+
+  for (Index = AddressHash (Address); mAddressKey[Index] != 0 && mAddressKey[Index] != Address;) {
+    Index = (Index + 1) & (ADDRESS_MAP_SIZE - 1);
+  }
+  return Index;
+}
+
+/**
+  Removes the entry at Index from the address map, moving back the entries
+  that would no longer be found past it.
+**/
+STATIC
+VOID
+RemoveAddress (
+  IN UINT32  Index
+  )
+{
+  UINT32  Next;
+  UINT32  Home;
+
+  for (Next = (Index + 1) & (ADDRESS_MAP_SIZE - 1); mAddressKey[Next] != 0; Next = (Next + 1) & (ADDRESS_MAP_SIZE - 1)) {
+    Home = AddressHash (mAddressKey[Next]);
+    if (((Next - Home) & (ADDRESS_MAP_SIZE - 1)) >= ((Next - Index) & (ADDRESS_MAP_SIZE - 1))) {
+      mAddressKey[Index]  = mAddressKey[Next];
+      mAddressSlot[Index] = mAddressSlot[Next];
+      Index = Next;
+    }
+  }
+  mAddressKey[Index] = 0;
+}
+
+/**
+  Reads the trace from the "AllocatePoolI" and "FreePool" messages of a
+  DEBUG_POOL boot log. Frees of buffers allocated before the log starts are
+  left out.
+**/
+STATIC
+BOOLEAN
+ReadTrace (
+  IN CONST CHAR8  *FileName
+  )
+{
+  FILE           *File;
+  CHAR8          Line[512];
+  CHAR8          *Text;
+  UINT32         Type;
+  VOID           *Address;
+  unsigned long  Length;
+  UINT32         Index;
+  UINT32         Slot;
+
+  File = fopen (FileName, "r");
+  if (File == NULL) {
+    printf ("Cannot open %s\n", FileName);
+    return FALSE;
+  }
+
+  while (fgets (Line, sizeof (Line), File) != NULL && mTraceCount < MAX_OPERATIONS) {
+    if ((Text = strstr (Line, "AllocatePoolI: ")) != NULL &&
+        sscanf (Text, "AllocatePoolI: Type %x, Addr %p (len %lx)", &Type, &Address, &Length) == 3) {
+      Index = FindAddress ((UINT64) (UINTN) Address);
+      if (mAddressKey[Index] != 0 || mSlotCount - mFreeSlotCount == MAX_SLOTS) {
+        printf ("%s: %p is allocated twice, or too many allocations\n", FileName, Address);
+        fclose (File);
+        return FALSE;
+      }
+      Slot = NewSlot ();
+      mAddressKey[Index]  = (UINT64) (UINTN) Address;
+      mAddressSlot[Index] = Slot;
+      AddOperation (FALSE, Slot, (UINT32) Length, (EFI_MEMORY_TYPE) Type);
+    } else if ((Text = strstr (Line, "FreePool: ")) != NULL &&
+               sscanf (Text, "FreePool: %p (len %lx)", &Address, &Length) == 2) {
+      Index = FindAddress ((UINT64) (UINTN) Address);
+      if (mAddressKey[Index] != 0) {
+        AddOperation (TRUE, mAddressSlot[Index], 0, EfiBootServicesData);
+        RemoveAddress (Index);
+      }
+    }
+  }
+
+  fclose (File);
+  if (mTraceCount == 0) {
+    printf ("%s has no DEBUG_POOL messages\n", FileName);
+    return FALSE;
+  }
+  return TRUE;
+}
+
+STATIC
+UINT8
+SlotPattern (
+  IN UINT32  Slot
+  )
+{
+  return (UINT8) (Slot * 31 + 1);
+}
+
+/**
+  Checks that a buffer returned by the pool is aligned, and fills it.
+**/
+STATIC
+UINT32
+FillBuffer (
+  IN VOID    *Buffer,
+  IN UINT32  Size,
+  IN UINT8   Pattern
+  )
+{
+  if (((UINTN) Buffer & (sizeof (UINT64) - 1)) != 0) {
+    printf ("%u bytes at %p are not aligned\n", Size, Buffer);
+    return 1;
+  }
+  memset (Buffer, Pattern, Size);
+  return 0;
+}
+
+/**
+  Checks that nothing else was written to a buffer since it was filled.
+**/
+STATIC
+UINT32
+CheckBuffer (
+  IN VOID    *Buffer,
+  IN UINT32  Size,
+  IN UINT8   Pattern
+  )
+{
+  UINT32  Index;
+
+  for (Index = 0; Index < Size; Index++) {
+    if (((UINT8 *) Buffer)[Index] != Pattern) {
+      printf ("Byte %u of the %u bytes at %p was overwritten\n", Index, Size, Buffer);
+      return 1;
+    }
+  }
+  return 0;
+}
+
+/**
+  Allocates and frees every size up to MAX_TEST_SIZE, with a second buffer
+  live, and checks that invalid requests fail.
+**/
+STATIC
+UINT32
+TestSizes (
+  VOID
+  )
+{
+  CONST EFI_MEMORY_TYPE  Types[] = {
+    EfiBootServicesData, EfiRuntimeServicesData, EfiACPIMemoryNVS, (EFI_MEMORY_TYPE) 0x70000000
+  };
+  CONST EFI_MEMORY_TYPE  InvalidTypes[] = {
+    EfiConventionalMemory, EfiPersistentMemory, EfiMaxMemoryType, (EFI_MEMORY_TYPE) 0x6FFFFFFF
+  };
+  UINT32      Failures;
+  UINT32      Index;
+  UINT32      Size;
+  VOID        *Buffer;
+  VOID        *Other;
+  EFI_STATUS  Status;
+
+  Failures = 0;
+  for (Index = 0; Index < ARRAY_SIZE (Types); Index++) {
+    for (Size = 0; Size <= MAX_TEST_SIZE && Failures < 10; Size++) {
+      if (EFI_ERROR (CoreAllocatePool (Types[Index], Size, &Buffer)) ||
+          EFI_ERROR (CoreAllocatePool (Types[Index], Size / 2, &Other))) {
+        printf ("Cannot allocate %u bytes of type 0x%x\n", Size, Types[Index]);
+        return Failures + 1;
+      }
+      Failures += FillBuffer (Buffer, Size, 0x5A);
+      Failures += FillBuffer (Other, Size / 2, 0xA5);
+      Failures += CheckBuffer (Buffer, Size, 0x5A);
+      Failures += EFI_ERROR (CoreFreePool (Buffer)) ? 1 : 0;
+      Failures += CheckBuffer (Other, Size / 2, 0xA5);
+      Failures += EFI_ERROR (CoreFreePool (Other)) ? 1 : 0;
+    }
+  }
+
+  for (Index = 0; Index < ARRAY_SIZE (InvalidTypes); Index++) {
+    Status = CoreAllocatePool (InvalidTypes[Index], 16, &Buffer);
+    if (Status != EFI_INVALID_PARAMETER) {
+      printf ("Allocating type 0x%x returned 0x%llx\n", InvalidTypes[Index], (unsigned long long) Status);
+      Failures++;
+    }
+  }
+  if (CoreAllocatePool (EfiBootServicesData, 16, NULL) != EFI_INVALID_PARAMETER ||
+      CoreAllocatePool (EfiBootServicesData, (UINTN) -1, &Buffer) != EFI_OUT_OF_RESOURCES ||
+      CoreFreePool (NULL) != EFI_INVALID_PARAMETER) {
+    printf ("A NULL buffer or a huge size is not rejected\n");
+    Failures++;
+  }
+
+  if (mPages != 0) {
+    printf ("The pool holds %u pages after the size tests\n", (UINT32) mPages);
+    Failures++;
+  }
+  return Failures;
+}
+
+/**
+  Replays the trace. With Check, the buffers are filled and checked.
+**/
+STATIC
+UINT32
+Replay (
+  IN BOOLEAN  Check
+  )
+{
+  TRACE_OPERATION  *Operation;
+  TRACE_SLOT       *Slot;
+  UINT32           Failures;
+
+  Failures = 0;
+  for (Operation = mTrace; Operation < mTrace + mTraceCount && Failures < 10; Operation++) {
+    Slot = &mSlots[Operation->Slot];
+    if (!Operation->Free) {
+      if (EFI_ERROR (CoreAllocatePool (Operation->Type, Operation->Size, &Slot->Buffer))) {
+        printf ("Cannot allocate %u bytes of type 0x%x\n", Operation->Size, Operation->Type);
+        Slot->Buffer = NULL;
+        Failures++;
+        continue;
+      }
+      Slot->Size = Operation->Size;
+      if (Check) {
+        Failures += FillBuffer (Slot->Buffer, Slot->Size, SlotPattern (Operation->Slot));
+      }
+    } else if (Slot->Buffer != NULL) {
+      if (Check) {
+        Failures += CheckBuffer (Slot->Buffer, Slot->Size, SlotPattern (Operation->Slot));
+      }
+      if (EFI_ERROR (CoreFreePool (Slot->Buffer))) {
+        printf ("Cannot free %u bytes at %p\n", Slot->Size, Slot->Buffer);
+        Failures++;
+      }
+      Slot->Buffer = NULL;
+    }
+  }
+  return Failures;
+}
+
+/**
+  Frees the allocations still live at the end of the trace, and returns
+  their size in bytes.
+**/
+STATIC
+UINTN
+FreeLive (
+  VOID
+  )
+{
+  UINT32  Slot;
+  UINTN   Size;
+
+  Size = 0;
+  for (Slot = 0; Slot < mSlotCount; Slot++) {
+    if (mSlots[Slot].Buffer != NULL) {
+      Size += mSlots[Slot].Size;
+      CoreFreePool (mSlots[Slot].Buffer);
+      mSlots[Slot].Buffer = NULL;
+    }
+  }
+  return Size;
+}
+
+STATIC
+double
+Now (
+  VOID
+  )
+{
+  struct timespec  Time;
+
+  clock_gettime (CLOCK_MONOTONIC, &Time);
+  return (double) Time.tv_sec + (double) Time.tv_nsec / 1e9;
+}
+
+/**
+  Prints the best time per operation of several replays of the trace, with
+  the page allocator calls and the pages held by the pool during a replay.
+**/
+STATIC
+VOID
+Benchmark (
+  VOID
+  )
+{
+  UINT32  Round;
+  UINTN   EndPages;
+  UINTN   LiveSize;
+  double  Start;
+  double  Seconds;
+  double  Best;
+
+  Best = 1e9;
+  for (Round = 0; Round < 7; Round++) {
+    mPageCalls = 0;
+    mPeakPages = mPages;
+    Start = Now ();
+    Replay (FALSE);
+    Seconds = Now () - Start;
+    if (Seconds < Best) {
+      Best = Seconds;
+    }
+    EndPages = mPages;
+    LiveSize = FreeLive ();
+  }
+
+  printf ("%10s %8s %11s %11s %11s %11s\n", "Operations", "ns/op", "Page calls", "Peak pages", "End pages", "End live KB");
+  printf (
+    "%10u %8.1f %11u %11u %11u %11u\n",
+    mTraceCount,
+    Best * 1e9 / mTraceCount,
+    (UINT32) mPageCalls,
+    (UINT32) mPeakPages,
+    (UINT32) EndPages,
+    (UINT32) (LiveSize / 1024)
+    );
+}
+
+STATIC
+VOID
+Usage (
+  VOID
+  )
+{
+  printf ("Usage: DxeCorePoolTest [-n Operations] [-s Seed] [-t LogFile] [-b]\n");
+  printf ("  -n  Number of operations of the generated trace, 200000 by default\n");
+  printf ("  -s  Random seed\n");
+  printf ("  -t  Replay the pool allocations of a DEBUG_POOL boot log instead\n");
+  printf ("  -b  Print the time per operation and the pages used instead of testing\n");
+}
+
+int
+main (
+  int   argc,
+  char  *argv[]
+  )
+{
+  UINT32       Operations;
+  UINT32       Failures;
+  BOOLEAN      RunBenchmark;
+  CONST CHAR8  *LogFile;
+  int          Index;
+
+  //
+  // Keep the messages printed before an ASSERT aborts the test
+  //
+  setvbuf (stdout, NULL, _IONBF, 0);
+
+  Operations   = 200000;
+  RunBenchmark = FALSE;
+  LogFile      = NULL;
+  for (Index = 1; Index < argc; Index++) {
+    if (strcmp (argv[Index], "-n") == 0 && Index + 1 < argc) {
+      Operations = (UINT32) strtoul (argv[++Index], NULL, 0);
+    } else if (strcmp (argv[Index], "-s") == 0 && Index + 1 < argc) {
+      mSeed = strtoull (argv[++Index], NULL, 0) | 1;
+    } else if (strcmp (argv[Index], "-t") == 0 && Index + 1 < argc) {
+      LogFile = argv[++Index];
+    } else if (strcmp (argv[Index], "-b") == 0) {
+      RunBenchmark = TRUE;
+    } else {
+      Usage ();
+      return 1;
+    }
+  }
+  if (Operations > MAX_OPERATIONS) {
+    Operations = MAX_OPERATIONS;
+  }
+
+  mTrace = malloc (MAX_OPERATIONS * sizeof (TRACE_OPERATION));
+  if (mTrace == NULL) {
+    printf ("Out of memory\n");
+    return 1;
+  }
+  if (LogFile != NULL) {
+    if (!ReadTrace (LogFile)) {
+      return 1;
+    }
+  } else {
+    GenerateTrace (Operations);
+  }
+
+  CoreInitializePool ();
+
+  if (RunBenchmark) {
+    Benchmark ();
+    return 0;
+  }
+
+  gHostClearMemory = TRUE;
+  Failures  = TestSizes ();
+  Failures += Replay (TRUE);
+  FreeLive ();
+  if (mPages != 0) {
+    printf ("The pool holds %u pages after the trace\n", (UINT32) mPages);
+    Failures++;
+  }
+
+  printf ("%u operations, %u pages at the peak, %u failures\n", mTraceCount, (UINT32) mPeakPages, Failures);
+  return Failures != 0;
+}
@@ -0,0 +1,335 @@
+/** @file
+  Host versions of the library functions used by the Mtftp4Dxe and Mtftp6Dxe
+  download code and by the net buffers. UdpIoSendDatagram() hands the packets
+  to the server of MtftpTest.c.
+
+  Copyright (c) 2017, Intel Corporation. All rights reserved.<BR>
+  This program and the accompanying materials
+  are licensed and made available under the terms and conditions of the BSD License
+  which accompanies this distribution.  The full text of the license may be found at
+  http://opensource.org/licenses/bsd-license.php
+
+  THE PROGRAM IS DISTRIBUTED UNDER THE BSD LICENSE ON AN "AS IS" BASIS,
+  WITHOUT WARRANTIES OR REPRESENTATIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED.
+
+**/
+
+#include <Uefi.h>
+#include <Library/BaseLib.h>
+#include <Library/BaseMemoryLib.h>
+#include <Library/DebugLib.h>
+#include <Library/MemoryAllocationLib.h>
+#include <Library/NetLib.h>
+#include <Library/UdpIoLib.h>
+#include <Library/UefiBootServicesTableLib.h>
+
+#include "HostMtftp.h"
+
+//
+// The C library is reached through the compiler builtins, as its headers
+// conflict with the MdePkg ones.
+//
+
+VOID *
+EFIAPI
+AllocatePool (
+  IN UINTN  AllocationSize
+  )
+{
+  return __builtin_malloc (AllocationSize);
+}
+
+VOID *
+EFIAPI
+AllocateZeroPool (
+  IN UINTN  AllocationSize
+  )
+{
+  return __builtin_calloc (1, AllocationSize);
+}
+
+VOID
+EFIAPI
+FreePool (
+  IN VOID   *Buffer
+  )
+{
+  __builtin_free (Buffer);
+}
+
+EFI_STATUS
+EFIAPI
+HostFreePool (
+  IN VOID   *Buffer
+  )
+{
+  __builtin_free (Buffer);
+  return EFI_SUCCESS;
+}
+
+EFI_TPL
+EFIAPI
+HostRaiseTpl (
+  IN EFI_TPL      NewTpl
+  )
+{
+  return TPL_APPLICATION;
+}
+
+VOID
+EFIAPI
+HostRestoreTpl (
+  IN EFI_TPL      OldTpl
+  )
+{
+}
+
+//
+// The net buffers give their blocks back through the boot services, and
+// Mtftp6Dxe changes the TPL around its transmissions. The other services
+// aren't used.
+//
+EFI_BOOT_SERVICES   mHostBootServices = {
+  .RaiseTPL   = HostRaiseTpl,
+  .RestoreTPL = HostRestoreTpl,
+  .FreePool   = HostFreePool
+};
+EFI_BOOT_SERVICES   *gBS = &mHostBootServices;
+
+VOID *
+EFIAPI
+CopyMem (
+  OUT VOID       *DestinationBuffer,
+  IN CONST VOID  *SourceBuffer,
+  IN UINTN       Length
+  )
+{
+  return __builtin_memmove (DestinationBuffer, SourceBuffer, Length);
+}
+
+VOID *
+EFIAPI
+SetMem (
+  OUT VOID  *Buffer,
+  IN UINTN  Length,
+  IN UINT8  Value
+  )
+{
+  return __builtin_memset (Buffer, Value, Length);
+}
+
+VOID *
+EFIAPI
+ZeroMem (
+  OUT VOID  *Buffer,
+  IN UINTN  Length
+  )
+{
+  return __builtin_memset (Buffer, 0, Length);
+}
+
+INTN
+EFIAPI
+CompareMem (
+  IN CONST VOID  *DestinationBuffer,
+  IN CONST VOID  *SourceBuffer,
+  IN UINTN       Length
+  )
+{
+  return __builtin_memcmp (DestinationBuffer, SourceBuffer, Length);
+}
+
+UINT16
+EFIAPI
+SwapBytes16 (
+  IN      UINT16                    Value
+  )
+{
+  return __builtin_bswap16 (Value);
+}
+
+UINT64
+EFIAPI
+MultU64x32 (
+  IN      UINT64                    Multiplicand,
+  IN      UINT32                    Multiplier
+  )
+{
+  return Multiplicand * Multiplier;
+}
+
+UINTN
+EFIAPI
+AsciiStrLen (
+  IN      CONST CHAR8               *String
+  )
+{
+  return __builtin_strlen (String);
+}
+
+RETURN_STATUS
+EFIAPI
+AsciiStrCpyS (
+  OUT CHAR8        *Destination,
+  IN  UINTN        DestMax,
+  IN  CONST CHAR8  *Source
+  )
+{
+  ASSERT (__builtin_strlen (Source) < DestMax);
+  __builtin_strcpy (Destination, Source);
+  return RETURN_SUCCESS;
+}
+
+LIST_ENTRY *
+EFIAPI
+InitializeListHead (
+  IN OUT  LIST_ENTRY                *ListHead
+  )
+{
+  ListHead->ForwardLink = ListHead;
+  ListHead->BackLink    = ListHead;
+  return ListHead;
+}
+
+LIST_ENTRY *
+EFIAPI
+InsertTailList (
+  IN OUT  LIST_ENTRY                *ListHead,
+  IN OUT  LIST_ENTRY                *Entry
+  )
+{
+  Entry->ForwardLink = ListHead;
+  Entry->BackLink    = ListHead->BackLink;
+  Entry->BackLink->ForwardLink = Entry;
+  ListHead->BackLink           = Entry;
+  return ListHead;
+}
+
+BOOLEAN
+EFIAPI
+IsListEmpty (
+  IN      CONST LIST_ENTRY          *ListHead
+  )
+{
+  return (BOOLEAN) (ListHead->ForwardLink == ListHead);
+}
+
+LIST_ENTRY *
+EFIAPI
+RemoveEntryList (
+  IN      CONST LIST_ENTRY          *Entry
+  )
+{
+  ASSERT (Entry->ForwardLink->BackLink == Entry && Entry->BackLink->ForwardLink == Entry);
+  Entry->ForwardLink->BackLink = Entry->BackLink;
+  Entry->BackLink->ForwardLink = Entry->ForwardLink;
+  return Entry->ForwardLink;
+}
+
+VOID
+EFIAPI
+NetListInsertAfter (
+  IN OUT LIST_ENTRY         *PrevEntry,
+  IN OUT LIST_ENTRY         *NewEntry
+  )
+{
+  NewEntry->BackLink                = PrevEntry;
+  NewEntry->ForwardLink             = PrevEntry->ForwardLink;
+  PrevEntry->ForwardLink->BackLink  = NewEntry;
+  PrevEntry->ForwardLink            = NewEntry;
+}
+
+VOID
+EFIAPI
+DebugPrint (
+  IN  UINTN        ErrorLevel,
+  IN  CONST CHAR8  *Format,
+  ...
+  )
+{
+}
+
+VOID
+EFIAPI
+DebugAssert (
+  IN CONST CHAR8  *FileName,
+  IN UINTN        LineNumber,
+  IN CONST CHAR8  *Description
+  )
+{
+  __builtin_printf ("ASSERT %s(%u): %s\n", FileName, (UINT32) LineNumber, Description);
+  __builtin_abort ();
+}
+
+BOOLEAN
+EFIAPI
+DebugAssertEnabled (
+  VOID
+  )
+{
+  return TRUE;
+}
+
+BOOLEAN
+EFIAPI
+DebugPrintEnabled (
+  VOID
+  )
+{
+  return FALSE;
+}
+
+BOOLEAN
+EFIAPI
+DebugPrintLevelEnabled (
+  IN  CONST UINTN        ErrorLevel
+  )
+{
+  return FALSE;
+}
+
+/**
+  Send the packet to the server of the test, and complete the transmission
+  at once.
+
+  @return EFI_SUCCESS, the packet is always sent.
+
+**/
+EFI_STATUS
+EFIAPI
+UdpIoSendDatagram (
+  IN  UDP_IO                *UdpIo,
+  IN  NET_BUF               *Packet,
+  IN  UDP_END_POINT         *EndPoint OPTIONAL,
+  IN  EFI_IP_ADDRESS        *Gateway  OPTIONAL,
+  IN  UDP_IO_CALLBACK       CallBack,
+  IN  VOID                  *Context
+  )
+{
+  UINT8  Buffer[64];
+
+  ASSERT (Packet->TotalSize <= sizeof (Buffer));
+
+  NetbufCopy (Packet, 0, Packet->TotalSize, Buffer);
+  HostServerInput (Buffer, Packet->TotalSize);
+
+  CallBack (Packet, EndPoint, EFI_SUCCESS, Context);
+  return EFI_SUCCESS;
+}
+
+VOID
+EFIAPI
+UdpIoCleanIo (
+  IN  UDP_IO                *UdpIo
+  )
+{
+}
+
+EFI_STATUS
+EFIAPI
+UdpIoFreeIo (
+  IN  UDP_IO                *UdpIo
+  )
+{
+  return EFI_SUCCESS;
+}
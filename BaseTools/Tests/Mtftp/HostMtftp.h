@@ -0,0 +1,121 @@
+/** @file
+  Interface between the MTFTP download test and the host builds of the
+  Mtftp4Dxe and Mtftp6Dxe clients.
+
+  Copyright (c) 2017, Intel Corporation. All rights reserved.<BR>
+  This program and the accompanying materials
+  are licensed and made available under the terms and conditions of the BSD License
+  which accompanies this distribution.  The full text of the license may be found at
+  http://opensource.org/licenses/bsd-license.php
+
+  THE PROGRAM IS DISTRIBUTED UNDER THE BSD LICENSE ON AN "AS IS" BASIS,
+  WITHOUT WARRANTIES OR REPRESENTATIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED.
+
+**/
+
+#ifndef _HOST_MTFTP_H_
+#define _HOST_MTFTP_H_
+
+#include <Uefi.h>
+
+/**
+  Start a unicast download, as if the server had acknowledged the options,
+  which sends the ACK of block 0.
+
+  @param[out]  Buffer       The buffer to download the file to.
+  @param[in]   BufferSize   The size of Buffer.
+  @param[in]   BlkSize      The blksize option.
+  @param[in]   WindowSize   The windowsize option.
+  @param[in]   Timeout      The timeout in ticks of the client.
+
+**/
+typedef
+VOID
+(*HOST_MTFTP_START) (
+  OUT VOID    *Buffer,
+  IN  UINTN   BufferSize,
+  IN  UINT16  BlkSize,
+  IN  UINT16  WindowSize,
+  IN  UINT32  Timeout
+  );
+
+/**
+  Give a DATA packet from the server to the client, as its receive
+  callback does.
+
+  @param[in]  Packet       The packet.
+  @param[in]  Len          The length of the packet.
+
+**/
+typedef
+VOID
+(*HOST_MTFTP_RECEIVE) (
+  IN VOID    *Packet,
+  IN UINT32  Len
+  );
+
+/**
+  Run the timer of the client for one tick.
+
+**/
+typedef
+VOID
+(*HOST_MTFTP_TICK) (
+  VOID
+  );
+
+/**
+  Check whether the download is still running.
+
+  @retval TRUE              The download is running.
+  @retval FALSE             The download has completed or failed.
+
+**/
+typedef
+BOOLEAN
+(*HOST_MTFTP_RUNNING) (
+  VOID
+  );
+
+/**
+  Stop the download if it is still running.
+
+  @param[out]  FileSize     The size of the file downloaded.
+
+  @retval EFI_NOT_READY     The download was still running, it is aborted.
+  @return                   The result of the download.
+
+**/
+typedef
+EFI_STATUS
+(*HOST_MTFTP_STOP) (
+  OUT UINT64  *FileSize
+  );
+
+typedef struct {
+  CONST CHAR8         *Name;
+  HOST_MTFTP_START    Start;
+  HOST_MTFTP_RECEIVE  Receive;
+  HOST_MTFTP_TICK     Tick;
+  HOST_MTFTP_RUNNING  Running;
+  HOST_MTFTP_STOP     Stop;
+} HOST_MTFTP_CLIENT;
+
+extern HOST_MTFTP_CLIENT  gHostMtftp4Client;
+extern HOST_MTFTP_CLIENT  gHostMtftp6Client;
+
+/**
+  Hand a packet sent by the client to the server. It is only queued, the
+  server answers once the client returns.
+
+  @param[in]  Packet       The packet.
+  @param[in]  Len          The length of the packet.
+
+**/
+VOID
+HostServerInput (
+  IN VOID    *Packet,
+  IN UINT32  Len
+  );
+
+#endif
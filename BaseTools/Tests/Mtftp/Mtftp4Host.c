@@ -0,0 +1,145 @@
+/** @file
+  Host client of the MTFTP download test on top of the download code of
+  MdeModulePkg Mtftp4Dxe: Mtftp4RrqHandleData(), Mtftp4OnTimerTick() and the
+  routines they call.
+
+  Copyright (c) 2017, Intel Corporation. All rights reserved.<BR>
+  This program and the accompanying materials
+  are licensed and made available under the terms and conditions of the BSD License
+  which accompanies this distribution.  The full text of the license may be found at
+  http://opensource.org/licenses/bsd-license.php
+
+  THE PROGRAM IS DISTRIBUTED UNDER THE BSD LICENSE ON AN "AS IS" BASIS,
+  WITHOUT WARRANTIES OR REPRESENTATIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED.
+
+**/
+
+#include "Mtftp4Impl.h"
+#include "HostMtftp.h"
+
+//
+// From Mtftp4Rrq.c, where it isn't declared in a header.
+//
+EFI_STATUS
+Mtftp4RrqHandleData (
+  IN     MTFTP4_PROTOCOL       *Instance,
+  IN     EFI_MTFTP4_PACKET     *Packet,
+  IN     UINT32                Len,
+  IN     BOOLEAN               Multicast,
+     OUT BOOLEAN               *Completed
+  );
+
+//
+// Referenced by Mtftp4CleanOperation(), and generated by the build for the
+// driver.
+//
+EFI_GUID                     gEfiUdp4ProtocolGuid = EFI_UDP4_PROTOCOL_GUID;
+EFI_DRIVER_BINDING_PROTOCOL  gMtftp4DriverBinding;
+
+STATIC MTFTP4_SERVICE        mService;
+STATIC MTFTP4_PROTOCOL       mInstance;
+STATIC EFI_MTFTP4_TOKEN      mToken;
+STATIC UDP_IO                mUdpIo;
+
+VOID
+Mtftp4HostStart (
+  OUT VOID    *Buffer,
+  IN  UINTN   BufferSize,
+  IN  UINT16  BlkSize,
+  IN  UINT16  WindowSize,
+  IN  UINT32  Timeout
+  )
+{
+  ZeroMem (&mInstance, sizeof (mInstance));
+  ZeroMem (&mToken, sizeof (mToken));
+
+  InitializeListHead (&mService.Children);
+  InsertTailList (&mService.Children, &mInstance.Link);
+
+  mToken.Buffer          = Buffer;
+  mToken.BufferSize      = BufferSize;
+  mToken.Status          = EFI_NOT_READY;
+
+  mInstance.Signature    = MTFTP4_PROTOCOL_SIGNATURE;
+  mInstance.Service      = &mService;
+  mInstance.Token        = &mToken;
+  mInstance.Operation    = EFI_MTFTP4_OPCODE_RRQ;
+  mInstance.BlkSize      = BlkSize;
+  mInstance.WindowSize   = WindowSize;
+  mInstance.UnicastPort  = &mUdpIo;
+  mInstance.Master       = TRUE;
+  mInstance.MaxRetry     = 6;
+  mInstance.Timeout      = Timeout;
+
+  InitializeListHead (&mInstance.Blocks);
+  Mtftp4InitBlockRange (&mInstance.Blocks, 1, 0xffff);
+
+  Mtftp4RrqSendAck (&mInstance, 0);
+}
+
+VOID
+Mtftp4HostReceive (
+  IN VOID    *Packet,
+  IN UINT32  Len
+  )
+{
+  EFI_STATUS  Status;
+  BOOLEAN     Completed;
+
+  if (mInstance.Token == NULL) {
+    return;
+  }
+
+  //
+  // As Mtftp4RrqInput() does for a DATA packet.
+  //
+  if ((Len > (UINT32) (MTFTP4_DATA_HEAD_LEN + mInstance.BlkSize)) ||
+      (Len < (UINT32) MTFTP4_DATA_HEAD_LEN)) {
+    return;
+  }
+
+  Completed = FALSE;
+  Status    = Mtftp4RrqHandleData (&mInstance, Packet, Len, FALSE, &Completed);
+
+  if (EFI_ERROR (Status) || Completed) {
+    Mtftp4CleanOperation (&mInstance, Status);
+  }
+}
+
+VOID
+Mtftp4HostTick (
+  VOID
+  )
+{
+  Mtftp4OnTimerTick (NULL, &mService);
+}
+
+BOOLEAN
+Mtftp4HostRunning (
+  VOID
+  )
+{
+  return (BOOLEAN) (mInstance.Token != NULL);
+}
+
+EFI_STATUS
+Mtftp4HostStop (
+  OUT UINT64  *FileSize
+  )
+{
+  if (mInstance.Token != NULL) {
+    Mtftp4CleanOperation (&mInstance, EFI_NOT_READY);
+  }
+
+  *FileSize = mToken.BufferSize;
+  return mToken.Status;
+}
+
+HOST_MTFTP_CLIENT  gHostMtftp4Client = {
+  "Mtftp4Dxe",
+  Mtftp4HostStart,
+  Mtftp4HostReceive,
+  Mtftp4HostTick,
+  Mtftp4HostRunning,
+  Mtftp4HostStop
+};
@@ -0,0 +1,187 @@
+/** @file
+  Host client of the MTFTP download test on top of the download code of
+  NetworkPkg Mtftp6Dxe: Mtftp6RrqHandleData(), Mtftp6OnTimerTick() and the
+  routines they call.
+
+  Copyright (c) 2017, Intel Corporation. All rights reserved.<BR>
+  This program and the accompanying materials
+  are licensed and made available under the terms and conditions of the BSD License
+  which accompanies this distribution.  The full text of the license may be found at
+  http://opensource.org/licenses/bsd-license.php
+
+  THE PROGRAM IS DISTRIBUTED UNDER THE BSD LICENSE ON AN "AS IS" BASIS,
+  WITHOUT WARRANTIES OR REPRESENTATIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED.
+
+**/
+
+#include "Mtftp6Impl.h"
+#include "HostMtftp.h"
+
+#define HOST_SERVER_DATA_PORT  1069
+
+//
+// From Mtftp6Rrq.c, where it isn't declared in a header.
+//
+EFI_STATUS
+Mtftp6RrqHandleData (
+  IN  MTFTP6_INSTANCE       *Instance,
+  IN  EFI_MTFTP6_PACKET     *Packet,
+  IN  UINT32                Len,
+  OUT NET_BUF               **UdpPacket,
+  OUT BOOLEAN               *IsCompleted
+  );
+
+//
+// Referenced by Mtftp6OperationClean(), and generated by the build for the
+// driver.
+//
+EFI_GUID                     gEfiUdp6ProtocolGuid = EFI_UDP6_PROTOCOL_GUID;
+
+STATIC MTFTP6_SERVICE        mService;
+STATIC MTFTP6_INSTANCE       mInstance;
+STATIC EFI_MTFTP6_TOKEN      mToken;
+STATIC UDP_IO                mUdpIo;
+
+/**
+  Report the UDP instance as connected to the data port of the server, so
+  that Mtftp6TransmitPacket() doesn't configure it again.
+
+**/
+EFI_STATUS
+EFIAPI
+HostUdp6GetModeData (
+  IN EFI_UDP6_PROTOCOL                 *This,
+  OUT EFI_UDP6_CONFIG_DATA             *Udp6ConfigData OPTIONAL,
+  OUT EFI_IP6_MODE_DATA                *Ip6ModeData    OPTIONAL,
+  OUT EFI_MANAGED_NETWORK_CONFIG_DATA  *MnpConfigData  OPTIONAL,
+  OUT EFI_SIMPLE_NETWORK_MODE          *SnpModeData    OPTIONAL
+  )
+{
+  ASSERT (Udp6ConfigData != NULL);
+
+  ZeroMem (Udp6ConfigData, sizeof (EFI_UDP6_CONFIG_DATA));
+  Udp6ConfigData->RemotePort = HOST_SERVER_DATA_PORT;
+  return EFI_SUCCESS;
+}
+
+STATIC EFI_UDP6_PROTOCOL     mUdp6 = { .GetModeData = HostUdp6GetModeData };
+
+VOID
+Mtftp6HostStart (
+  OUT VOID    *Buffer,
+  IN  UINTN   BufferSize,
+  IN  UINT16  BlkSize,
+  IN  UINT16  WindowSize,
+  IN  UINT32  Timeout
+  )
+{
+  ZeroMem (&mInstance, sizeof (mInstance));
+  ZeroMem (&mToken, sizeof (mToken));
+
+  InitializeListHead (&mService.Children);
+  InsertTailList (&mService.Children, &mInstance.Link);
+
+  mUdpIo.Protocol.Udp6      = &mUdp6;
+
+  mToken.Buffer             = Buffer;
+  mToken.BufferSize         = BufferSize;
+  mToken.Status             = EFI_NOT_READY;
+
+  mInstance.Signature       = MTFTP6_INSTANCE_SIGNATURE;
+  mInstance.Service         = &mService;
+  mInstance.Token           = &mToken;
+  mInstance.BlkSize         = BlkSize;
+  mInstance.WindowSize      = WindowSize;
+  mInstance.ServerDataPort  = HOST_SERVER_DATA_PORT;
+  mInstance.UdpIo           = &mUdpIo;
+  mInstance.IsMaster        = TRUE;
+  mInstance.MaxRetry        = 6;
+  mInstance.Timeout         = Timeout;
+
+  InitializeListHead (&mInstance.BlkList);
+  Mtftp6InitBlockRange (&mInstance.BlkList, 1, 0xffff);
+
+  Mtftp6RrqSendAck (&mInstance, 0);
+}
+
+VOID
+Mtftp6HostReceive (
+  IN VOID    *Packet,
+  IN UINT32  Len
+  )
+{
+  NET_BUF     *UdpPacket;
+  EFI_STATUS  Status;
+  BOOLEAN     IsCompleted;
+
+  if (mInstance.Token == NULL) {
+    return;
+  }
+
+  //
+  // As Mtftp6RrqInput() does for a DATA packet, which owns the received
+  // buffer unless Mtftp6RrqHandleData() frees it.
+  //
+  if ((Len > (UINT32) (MTFTP6_DATA_HEAD_LEN + mInstance.BlkSize)) || (Len < (UINT32) MTFTP6_DATA_HEAD_LEN)) {
+    return;
+  }
+
+  UdpPacket = NetbufAlloc (Len);
+  ASSERT (UdpPacket != NULL);
+  CopyMem (NetbufAllocSpace (UdpPacket, Len, NET_BUF_TAIL), Packet, Len);
+
+  IsCompleted = FALSE;
+  Status      = Mtftp6RrqHandleData (
+                  &mInstance,
+                  (EFI_MTFTP6_PACKET *) NetbufGetByte (UdpPacket, 0, NULL),
+                  Len,
+                  &UdpPacket,
+                  &IsCompleted
+                  );
+
+  if (UdpPacket != NULL) {
+    NetbufFree (UdpPacket);
+  }
+
+  if (EFI_ERROR (Status) || IsCompleted) {
+    Mtftp6OperationClean (&mInstance, Status);
+  }
+}
+
+VOID
+Mtftp6HostTick (
+  VOID
+  )
+{
+  Mtftp6OnTimerTick (NULL, &mService);
+}
+
+BOOLEAN
+Mtftp6HostRunning (
+  VOID
+  )
+{
+  return (BOOLEAN) (mInstance.Token != NULL);
+}
+
+EFI_STATUS
+Mtftp6HostStop (
+  OUT UINT64  *FileSize
+  )
+{
+  if (mInstance.Token != NULL) {
+    Mtftp6OperationClean (&mInstance, EFI_NOT_READY);
+  }
+
+  *FileSize = mToken.BufferSize;
+  return mToken.Status;
+}
+
+HOST_MTFTP_CLIENT  gHostMtftp6Client = {
+  "Mtftp6Dxe",
+  Mtftp6HostStart,
+  Mtftp6HostReceive,
+  Mtftp6HostTick,
+  Mtftp6HostRunning,
+  Mtftp6HostStop
+};
@@ -0,0 +1,431 @@
+/** @file
+  Host test of the windowed download of Mtftp4Dxe and Mtftp6Dxe.
+
+  The download code of both drivers runs against a server of this file that
+  follows RFC 7440: on the ACK of block K, it sends the window of blocks
+  K + 1 to K + WindowSize, and it sends the window again when no ACK comes
+  in time. The packets of both sides go through one queue in order, and the
+  test can drop the first transmission of a given DATA or ACK packet, or a
+  random share of all of them:
+
+  - With no loss, the file is sent once and ACKed once per window.
+  - A lost first block of a window is noticed on the next block, the client
+    ACKs the blocks before it and the server sends the window again, with no
+    timeout.
+  - A lost last block of a window is noticed by the timer of the client,
+    which ACKs the blocks it has, so that only the lost block is sent again.
+  - A lost ACK is sent again by the timer of the client, or the server sends
+    the window again and the client ACKs it again on its last block, but not
+    both: when the timers expire together, the window is sent again once.
+  - With random loss, any window size and a server timeout shorter, equal or
+    longer than the one of the client, the download completes with the content and the size of the file.
+
+  Copyright (c) 2017, Intel Corporation. All rights reserved.<BR>
+  This program and the accompanying materials
+  are licensed and made available under the terms and conditions of the BSD License
+  which accompanies this distribution.  The full text of the license may be found at
+  http://opensource.org/licenses/bsd-license.php
+
+  THE PROGRAM IS DISTRIBUTED UNDER THE BSD LICENSE ON AN "AS IS" BASIS,
+  WITHOUT WARRANTIES OR REPRESENTATIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED.
+
+**/
+
+#include <Uefi.h>
+#include <Library/BaseMemoryLib.h>
+#include <Library/DebugLib.h>
+
+#include "HostMtftp.h"
+
+#define CHECK(Expression)  Check ((BOOLEAN) (Expression), #Expression, __LINE__)
+
+#define OPCODE_DATA        3
+#define OPCODE_ACK         4
+
+#define BLK_SIZE           512
+#define FILE_SIZE          (20 * BLK_SIZE + 100)
+#define BLOCK_COUNT        (FILE_SIZE / BLK_SIZE + 1)
+
+#define CLIENT_TIMEOUT     3
+#define MAX_TICKS          10000
+#define MAX_QUEUED         256
+
+//
+// A packet in flight, to the server if it is an ACK, to the client if it
+// is a DATA packet.
+//
+typedef struct {
+  UINT8   OpCode;
+  UINT16  Block;
+} HOST_PACKET;
+
+typedef struct {
+  UINT16  WindowSize;
+  UINT32  ServerTimeout;    ///< Ticks without an ACK before the window is sent again
+  UINT16  DropData;         ///< The DATA block of which the first transmission is lost
+  UINT16  DropAck;          ///< The ACK of which the first transmission is lost
+  UINT32  LossPercent;      ///< The share of any packet that is lost
+  UINT32  Seed;
+} HOST_NETWORK;
+
+typedef struct {
+  UINT32  DataSent;
+  UINT32  AcksSent;
+  UINT32  ServerTimeouts;
+  UINT32  Ticks;
+} HOST_RESULT;
+
+UINT8         mFile[FILE_SIZE];
+UINT8         mBuffer[FILE_SIZE + BLK_SIZE];
+
+HOST_NETWORK  mNetwork;
+HOST_RESULT   mResult;
+HOST_PACKET   mQueue[MAX_QUEUED];
+UINT32        mQueueHead;
+UINT32        mQueueTail;
+
+UINT16        mAcked;
+UINT32        mIdleTicks;
+
+UINT32        mFailures;
+
+VOID
+Check (
+  IN BOOLEAN      Passed,
+  IN CONST CHAR8  *Expression,
+  IN UINT32       Line
+  )
+{
+  if (!Passed) {
+    __builtin_printf ("MtftpTest.c(%u): %s failed\n", Line, Expression);
+    mFailures++;
+  }
+}
+
+/**
+  Decide whether a packet is lost, either as the first transmission of the
+  scripted packet or at random.
+
+  @param[in, out]  Drop    The block of the scripted packet, cleared once
+                           it is lost.
+  @param[in]       Block   The block of the packet.
+
+  @retval TRUE             The packet is lost.
+  @retval FALSE            The packet arrives.
+
+**/
+BOOLEAN
+Lose (
+  IN OUT UINT16  *Drop,
+  IN     UINT16  Block
+  )
+{
+  if ((*Drop != 0) && (*Drop == Block)) {
+    *Drop = 0;
+    return TRUE;
+  }
+
+  if (mNetwork.LossPercent == 0) {
+    return FALSE;
+  }
+
+  mNetwork.Seed = mNetwork.Seed * 1103515245 + 12345;
+  return (BOOLEAN) (((mNetwork.Seed >> 16) % 100) < mNetwork.LossPercent);
+}
+
+VOID
+Enqueue (
+  IN UINT8   OpCode,
+  IN UINT16  Block
+  )
+{
+  ASSERT (mQueueTail - mQueueHead < MAX_QUEUED);
+
+  mQueue[mQueueTail % MAX_QUEUED].OpCode = OpCode;
+  mQueue[mQueueTail % MAX_QUEUED].Block  = Block;
+  mQueueTail++;
+}
+
+/**
+  Send the window after the last block ACKed.
+
+**/
+VOID
+ServerSendWindow (
+  VOID
+  )
+{
+  UINT32  Block;
+
+  for (Block = mAcked + 1U; (Block <= mAcked + mNetwork.WindowSize) && (Block <= BLOCK_COUNT); Block++) {
+    mResult.DataSent++;
+    if (!Lose (&mNetwork.DropData, (UINT16) Block)) {
+      Enqueue (OPCODE_DATA, (UINT16) Block);
+    }
+  }
+
+  mIdleTicks = 0;
+}
+
+VOID
+HostServerInput (
+  IN VOID    *Packet,
+  IN UINT32  Len
+  )
+{
+  UINT8   *Bytes;
+  UINT16  Block;
+
+  Bytes = Packet;
+  CHECK (Len == 4 && Bytes[0] == 0 && Bytes[1] == OPCODE_ACK);
+
+  Block = (UINT16) ((Bytes[2] << 8) | Bytes[3]);
+
+  mResult.AcksSent++;
+  if (!Lose (&mNetwork.DropAck, Block)) {
+    Enqueue (OPCODE_ACK, Block);
+  }
+}
+
+/**
+  Handle an ACK as the server. An ACK of the last block ACKed asks for its
+  window again, an older one is stale.
+
+**/
+VOID
+ServerReceiveAck (
+  IN UINT16  Block
+  )
+{
+  CHECK (Block <= BLOCK_COUNT);
+
+  if (Block < mAcked) {
+    return;
+  }
+
+  mAcked = Block;
+  if (mAcked < BLOCK_COUNT) {
+    ServerSendWindow ();
+  }
+}
+
+VOID
+ServerTick (
+  VOID
+  )
+{
+  if ((mAcked < BLOCK_COUNT) && (++mIdleTicks > mNetwork.ServerTimeout)) {
+    mResult.ServerTimeouts++;
+    ServerSendWindow ();
+  }
+}
+
+VOID
+ClientReceiveData (
+  IN HOST_MTFTP_CLIENT  *Client,
+  IN UINT16             Block
+  )
+{
+  UINT8   Packet[4 + BLK_SIZE];
+  UINT32  Start;
+  UINT32  Size;
+
+  Start = (Block - 1U) * BLK_SIZE;
+  Size  = (Block == BLOCK_COUNT) ? (FILE_SIZE - Start) : BLK_SIZE;
+
+  Packet[0] = 0;
+  Packet[1] = OPCODE_DATA;
+  Packet[2] = (UINT8) (Block >> 8);
+  Packet[3] = (UINT8) Block;
+  CopyMem (Packet + 4, mFile + Start, Size);
+
+  Client->Receive (Packet, 4 + Size);
+}
+
+/**
+  Download the file with a client over the network described.
+
+  @param[in]  Client       The client.
+  @param[in]  Network      The window size and the losses.
+
+  @retval TRUE             The file was downloaded.
+  @retval FALSE            The download failed, or the content or the size
+                           are wrong.
+
+**/
+BOOLEAN
+Download (
+  IN HOST_MTFTP_CLIENT  *Client,
+  IN HOST_NETWORK       *Network
+  )
+{
+  HOST_PACKET  *Packet;
+  EFI_STATUS   Status;
+  UINT64       FileSize;
+
+  CopyMem (&mNetwork, Network, sizeof (mNetwork));
+  ZeroMem (&mResult, sizeof (mResult));
+  SetMem (mBuffer, sizeof (mBuffer), 0xAA);
+  mQueueHead = 0;
+  mQueueTail = 0;
+  mAcked     = 0;
+  mIdleTicks = 0;
+
+  Client->Start (mBuffer, sizeof (mBuffer), BLK_SIZE, Network->WindowSize, CLIENT_TIMEOUT);
+
+  for (;;) {
+    while (mQueueHead != mQueueTail) {
+      Packet = &mQueue[mQueueHead % MAX_QUEUED];
+      mQueueHead++;
+
+      if (Packet->OpCode == OPCODE_ACK) {
+        ServerReceiveAck (Packet->Block);
+      } else {
+        ClientReceiveData (Client, Packet->Block);
+      }
+    }
+
+    if (!Client->Running () || (mResult.Ticks == MAX_TICKS)) {
+      break;
+    }
+
+    mResult.Ticks++;
+    Client->Tick ();
+    ServerTick ();
+  }
+
+  Status = Client->Stop (&FileSize);
+  if (EFI_ERROR (Status) || (FileSize != FILE_SIZE) || (CompareMem (mBuffer, mFile, FILE_SIZE) != 0)) {
+    __builtin_printf (
+      "%s: window %u, server timeout %u, loss %u%%, seed %u: status 0x%x, size %u\n",
+      Client->Name,
+      Network->WindowSize,
+      Network->ServerTimeout,
+      Network->LossPercent,
+      Network->Seed,
+      (UINT32) Status,
+      (UINT32) FileSize
+      );
+    return FALSE;
+  }
+
+  return TRUE;
+}
+
+/**
+  Test the download with no loss, and with the loss of the first and the
+  last block of the second window and of the ACK of the first one.
+
+**/
+VOID
+TestWindowLoss (
+  IN HOST_MTFTP_CLIENT  *Client,
+  IN UINT16             WindowSize
+  )
+{
+  HOST_NETWORK  Network;
+  UINT32        ServerTimeout;
+
+  ZeroMem (&Network, sizeof (Network));
+  Network.WindowSize    = WindowSize;
+  Network.ServerTimeout = 2 * CLIENT_TIMEOUT;
+
+  CHECK (Download (Client, &Network));
+  CHECK (mResult.DataSent == BLOCK_COUNT);
+  CHECK (mResult.AcksSent == 1 + (BLOCK_COUNT + WindowSize - 1) / WindowSize);
+  CHECK (mResult.Ticks == 0);
+
+  //
+  // The lost first block of a window only costs the window sent again.
+  //
+  Network.DropData = WindowSize + 1;
+  CHECK (Download (Client, &Network));
+  CHECK (mResult.DataSent == BLOCK_COUNT + WindowSize);
+  CHECK (mResult.Ticks == 0);
+
+  //
+  // The lost last block of a window is sent again alone, after the timeout
+  // of the client. If the server times out first, the download completes.
+  //
+  Network.DropData = 2 * WindowSize;
+  CHECK (Download (Client, &Network));
+  CHECK (mResult.DataSent == BLOCK_COUNT + 1);
+  CHECK (mResult.ServerTimeouts == 0);
+  CHECK (mResult.Ticks > 0);
+
+  Network.DropData      = 2 * WindowSize;
+  Network.ServerTimeout = CLIENT_TIMEOUT - 2;
+  CHECK (Download (Client, &Network));
+  CHECK (mResult.ServerTimeouts == 1);
+
+  //
+  // A lost ACK is sent again after the timeout of the client, or the whole
+  // window is sent again after the timeout of the server. If both time out
+  // on the same tick, the window is still sent again only once.
+  //
+  Network.DropData = 0;
+  for (ServerTimeout = 1; ServerTimeout <= 2 * CLIENT_TIMEOUT; ServerTimeout++) {
+    Network.DropAck       = WindowSize;
+    Network.ServerTimeout = ServerTimeout;
+    CHECK (Download (Client, &Network));
+    CHECK (mResult.ServerTimeouts <= 1);
+    CHECK (mResult.DataSent == BLOCK_COUNT + mResult.ServerTimeouts * WindowSize);
+    CHECK (mResult.Ticks > 0);
+  }
+}
+
+/**
+  Test the download with 10% of the packets lost at random.
+
+**/
+VOID
+TestRandomLoss (
+  IN HOST_MTFTP_CLIENT  *Client
+  )
+{
+  HOST_NETWORK  Network;
+  UINT16        WindowSize;
+  UINT32        ServerTimeout;
+  UINT32        Seed;
+
+  ZeroMem (&Network, sizeof (Network));
+  Network.LossPercent = 10;
+
+  for (WindowSize = 1; WindowSize <= 16; WindowSize++) {
+    for (ServerTimeout = CLIENT_TIMEOUT - 2; ServerTimeout <= 2 * CLIENT_TIMEOUT; ServerTimeout += 2) {
+      for (Seed = 1; Seed <= 50; Seed++) {
+        Network.WindowSize    = WindowSize;
+        Network.ServerTimeout = ServerTimeout;
+        Network.Seed          = Seed;
+        CHECK (Download (Client, &Network));
+      }
+    }
+  }
+}
+
+int
+main (
+  void
+  )
+{
+  HOST_MTFTP_CLIENT  *Clients[2];
+  UINT32             Index;
+  UINT32             Offset;
+
+  for (Offset = 0; Offset < FILE_SIZE; Offset++) {
+    mFile[Offset] = (UINT8) (Offset * 7 + Offset / 251);
+  }
+
+  Clients[0] = &gHostMtftp4Client;
+  Clients[1] = &gHostMtftp6Client;
+
+  for (Index = 0; Index < 2; Index++) {
+    TestWindowLoss (Clients[Index], 2);
+    TestWindowLoss (Clients[Index], 4);
+    TestWindowLoss (Clients[Index], 8);
+    TestRandomLoss (Clients[Index]);
+  }
+
+  __builtin_printf ("%u failures\n", mFailures);
+  return mFailures != 0;
+}
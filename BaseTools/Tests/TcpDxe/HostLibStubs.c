@@ -0,0 +1,248 @@
+/** @file
+  Host versions of the library functions used by the TcpDxe option, input
+  and output code and by the net buffers, and of the socket and checksum
+  functions of TcpDxe that they call. TcpSendIpPacket() is in TcpDxeTest.c.
+
+  Copyright (c) 2017, Intel Corporation. All rights reserved.<BR>
+  This program and the accompanying materials
+  are licensed and made available under the terms and conditions of the BSD License
+  which accompanies this distribution.  The full text of the license may be found at
+  http://opensource.org/licenses/bsd-license.php
+
+  THE PROGRAM IS DISTRIBUTED UNDER THE BSD LICENSE ON AN "AS IS" BASIS,
+  WITHOUT WARRANTIES OR REPRESENTATIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED.
+
+**/
+
+#include "TcpMain.h"
+
+//
+// The C library is reached through the compiler builtins, as its headers
+// conflict with the MdePkg ones.
+//
+
+UINT32              mTcpTick = 1000;
+
+VOID *
+EFIAPI
+AllocatePool (
+  IN UINTN  AllocationSize
+  )
+{
+  return __builtin_malloc (AllocationSize);
+}
+
+VOID *
+EFIAPI
+AllocateZeroPool (
+  IN UINTN  AllocationSize
+  )
+{
+  return __builtin_calloc (1, AllocationSize);
+}
+
+VOID
+EFIAPI
+FreePool (
+  IN VOID   *Buffer
+  )
+{
+  __builtin_free (Buffer);
+}
+
+EFI_STATUS
+EFIAPI
+HostFreePool (
+  IN VOID   *Buffer
+  )
+{
+  __builtin_free (Buffer);
+  return EFI_SUCCESS;
+}
+
+//
+// The net buffers give their blocks back through the boot services, the
+// other services aren't used.
+//
+EFI_BOOT_SERVICES   mHostBootServices = { .FreePool = HostFreePool };
+EFI_BOOT_SERVICES   *gBS = &mHostBootServices;
+
+VOID *
+EFIAPI
+CopyMem (
+  OUT VOID       *DestinationBuffer,
+  IN CONST VOID  *SourceBuffer,
+  IN UINTN       Length
+  )
+{
+  return __builtin_memmove (DestinationBuffer, SourceBuffer, Length);
+}
+
+VOID *
+EFIAPI
+SetMem (
+  OUT VOID  *Buffer,
+  IN UINTN  Length,
+  IN UINT8  Value
+  )
+{
+  return __builtin_memset (Buffer, Value, Length);
+}
+
+VOID *
+EFIAPI
+ZeroMem (
+  OUT VOID  *Buffer,
+  IN UINTN  Length
+  )
+{
+  return __builtin_memset (Buffer, 0, Length);
+}
+
+UINT16
+EFIAPI
+SwapBytes16 (
+  IN      UINT16                    Value
+  )
+{
+  return __builtin_bswap16 (Value);
+}
+
+UINT32
+EFIAPI
+SwapBytes32 (
+  IN      UINT32                    Value
+  )
+{
+  return __builtin_bswap32 (Value);
+}
+
+LIST_ENTRY *
+EFIAPI
+InitializeListHead (
+  IN OUT  LIST_ENTRY                *ListHead
+  )
+{
+  ListHead->ForwardLink = ListHead;
+  ListHead->BackLink    = ListHead;
+  return ListHead;
+}
+
+LIST_ENTRY *
+EFIAPI
+InsertTailList (
+  IN OUT  LIST_ENTRY                *ListHead,
+  IN OUT  LIST_ENTRY                *Entry
+  )
+{
+  Entry->ForwardLink = ListHead;
+  Entry->BackLink    = ListHead->BackLink;
+  Entry->BackLink->ForwardLink = Entry;
+  ListHead->BackLink           = Entry;
+  return ListHead;
+}
+
+BOOLEAN
+EFIAPI
+IsListEmpty (
+  IN      CONST LIST_ENTRY          *ListHead
+  )
+{
+  return (BOOLEAN) (ListHead->ForwardLink == ListHead);
+}
+
+LIST_ENTRY *
+EFIAPI
+RemoveEntryList (
+  IN      CONST LIST_ENTRY          *Entry
+  )
+{
+  ASSERT (Entry->ForwardLink->BackLink == Entry && Entry->BackLink->ForwardLink == Entry);
+  Entry->ForwardLink->BackLink = Entry->BackLink;
+  Entry->BackLink->ForwardLink = Entry->ForwardLink;
+  return Entry->ForwardLink;
+}
+
+VOID
+EFIAPI
+DebugPrint (
+  IN  UINTN        ErrorLevel,
+  IN  CONST CHAR8  *Format,
+  ...
+  )
+{
+}
+
+VOID
+EFIAPI
+DebugAssert (
+  IN CONST CHAR8  *FileName,
+  IN UINTN        LineNumber,
+  IN CONST CHAR8  *Description
+  )
+{
+  __builtin_printf ("ASSERT %s(%u): %s\n", FileName, (UINT32) LineNumber, Description);
+  __builtin_abort ();
+}
+
+BOOLEAN
+EFIAPI
+DebugAssertEnabled (
+  VOID
+  )
+{
+  return TRUE;
+}
+
+BOOLEAN
+EFIAPI
+DebugPrintEnabled (
+  VOID
+  )
+{
+  return FALSE;
+}
+
+BOOLEAN
+EFIAPI
+DebugPrintLevelEnabled (
+  IN  CONST UINTN        ErrorLevel
+  )
+{
+  return FALSE;
+}
+
+/**
+  Get the free space of the receive or send buffer of the socket.
+
+  @param[in]  Sock    Pointer to the socket.
+  @param[in]  Which   SOCK_SND_BUF or SOCK_RCV_BUF.
+
+  @return The free space of the buffer, in bytes.
+
+**/
+UINT32
+SockGetFreeSpace (
+  IN SOCKET  *Sock,
+  IN UINT32  Which
+  )
+{
+  SOCK_BUFFER  *Buffer;
+
+  Buffer = (Which == SOCK_SND_BUF) ? &Sock->SndBuffer : &Sock->RcvBuffer;
+
+  if (Buffer->HighWater <= Buffer->DataQueue->BufSize) {
+    return 0;
+  }
+
+  return Buffer->HighWater - Buffer->DataQueue->BufSize;
+}
+
+UINT16
+TcpChecksum (
+  IN NET_BUF *Nbuf,
+  IN UINT16  HeadSum
+  )
+{
+  return 0;
+}
@@ -0,0 +1,627 @@
+/** @file
+  Host test of the SACK and receive buffer autotuning code of TcpDxe.
+
+  TcpOption.c, TcpInput.c and TcpOutput.c of NetworkPkg/TcpDxe are built for
+  the host with the DxeNetLib net buffers. The segments TcpDxe sends are
+  recorded by TcpSendIpPacket() of this file instead of going to IP:
+
+  - The SACK blocks of an ACK are built from the reassembly queue, with the
+    block of the latest segment first, and as many blocks as fit next to the
+    timestamp. They parse back, and data segments carry no SACK option.
+  - The SYN carries SACK-permitted unless it is disabled, and a window scale
+    that covers the largest autotuned receive buffer.
+  - Malformed SACK options are rejected.
+  - In fast recovery, the SACK blocks mark the segments of the retransmit
+    queue, and TcpSackRetransmit() resends each hole below a SACKed segment
+    once.
+  - An autotuned receive buffer doubles while the peer fills the window and
+    the application keeps up, up to TCP_RCV_BUF_SIZE, and a buffer size given
+    by the caller is kept.
+
+  Copyright (c) 2017, Intel Corporation. All rights reserved.<BR>
+  This program and the accompanying materials
+  are licensed and made available under the terms and conditions of the BSD License
+  which accompanies this distribution.  The full text of the license may be found at
+  http://opensource.org/licenses/bsd-license.php
+
+  THE PROGRAM IS DISTRIBUTED UNDER THE BSD LICENSE ON AN "AS IS" BASIS,
+  WITHOUT WARRANTIES OR REPRESENTATIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED.
+
+**/
+
+#include "TcpMain.h"
+
+//
+// The C library is reached through the compiler builtins, as its headers
+// conflict with the MdePkg ones.
+//
+#define CHECK(Expression)  Check ((BOOLEAN) (Expression), #Expression, __LINE__)
+
+#define MAX_SENT           16
+
+//
+// From TcpInput.c, where they aren't declared in a header.
+//
+VOID
+TcpMarkSacked (
+  IN TCP_CB     *Tcb,
+  IN TCP_OPTION *Option
+  );
+
+VOID
+TcpRcvAutotune (
+  IN OUT TCP_CB  *Tcb,
+  IN     TCP_SEG *Seg
+  );
+
+//
+// The segments sent by TcpDxe, and the header of the last one.
+//
+UINT8       mSentHead[sizeof (TCP_HEAD) + TCP_OPTION_MAX_LEN];
+TCP_SEQNO   mSentSeq[MAX_SENT];
+UINT32      mSentLen[MAX_SENT];
+UINT32      mSentCount;
+
+UINT32      mFailures;
+
+/**
+  Record the segment instead of sending it to IP.
+
+  @return 0, the segment is always sent.
+
+**/
+INTN
+TcpSendIpPacket (
+  IN TCP_CB          *Tcb,
+  IN NET_BUF         *Nbuf,
+  IN EFI_IP_ADDRESS  *Src,
+  IN EFI_IP_ADDRESS  *Dest,
+  IN UINT8           Version
+  )
+{
+  UINT32  HeadLen;
+
+  ASSERT ((Nbuf->Tcp != NULL) && (mSentCount < MAX_SENT));
+
+  HeadLen = Nbuf->Tcp->HeadLen << 2;
+  NetbufCopy (Nbuf, 0, HeadLen, mSentHead);
+
+  mSentSeq[mSentCount] = NTOHL (Nbuf->Tcp->Seq);
+  mSentLen[mSentCount] = Nbuf->TotalSize - HeadLen;
+  mSentCount++;
+  return 0;
+}
+
+VOID
+Check (
+  IN BOOLEAN      Passed,
+  IN CONST CHAR8  *Expression,
+  IN UINT32       Line
+  )
+{
+  if (!Passed) {
+    __builtin_printf ("TcpDxeTest.c(%u): %s failed\n", Line, Expression);
+    mFailures++;
+  }
+}
+
+/**
+  Set up an established connection with empty queues and buffers.
+
+  @param[out]  Tcb     The TCB to set up.
+  @param[out]  Sk      The socket of the TCB.
+
+**/
+VOID
+InitTcb (
+  OUT TCP_CB  *Tcb,
+  OUT SOCKET  *Sk
+  )
+{
+  ZeroMem (Tcb, sizeof (TCP_CB));
+  ZeroMem (Sk, sizeof (SOCKET));
+
+  Sk->IpVersion           = IP_VERSION_4;
+  Sk->RcvBuffer.DataQueue = NetbufQueAlloc ();
+  Sk->SndBuffer.DataQueue = NetbufQueAlloc ();
+  ASSERT ((Sk->RcvBuffer.DataQueue != NULL) && (Sk->SndBuffer.DataQueue != NULL));
+  SET_RCV_BUFFSIZE (Sk, SOCK_RCV_BUFF_SIZE);
+  SET_SND_BUFFSIZE (Sk, SOCK_SND_BUFF_SIZE);
+
+  Tcb->Sk       = Sk;
+  Tcb->State    = TCP_ESTABLISHED;
+  Tcb->SndMss   = 1460;
+  Tcb->RcvMss   = 1460;
+  Tcb->SndWnd   = TCP_MAX_WIN;
+  Tcb->TsRecent = 77;
+  InitializeListHead (&Tcb->SndQue);
+  InitializeListHead (&Tcb->RcvQue);
+}
+
+/**
+  Free the segments queued on the TCB and its socket buffers.
+
+  @param[in]  Tcb     The TCB to clean up.
+
+**/
+VOID
+FreeTcb (
+  IN TCP_CB  *Tcb
+  )
+{
+  NetbufFreeList (&Tcb->SndQue);
+  NetbufFreeList (&Tcb->RcvQue);
+  NetbufQueFree (Tcb->Sk->RcvBuffer.DataQueue);
+  NetbufQueFree (Tcb->Sk->SndBuffer.DataQueue);
+}
+
+/**
+  Queue a data segment, with head room for the TCP header as TcpDxe leaves.
+
+  @param[in, out]  Queue   The SndQue or RcvQue to append the segment to.
+  @param[in]       Seq     The sequence number of the segment.
+  @param[in]       End     The sequence number after the segment.
+
+**/
+VOID
+QueueSegment (
+  IN OUT LIST_ENTRY  *Queue,
+  IN     TCP_SEQNO   Seq,
+  IN     TCP_SEQNO   End
+  )
+{
+  NET_BUF  *Nbuf;
+  UINT8    *Data;
+
+  Nbuf = NetbufAlloc (TCP_MAX_HEAD + End - Seq);
+  ASSERT (Nbuf != NULL);
+
+  NetbufReserve (Nbuf, TCP_MAX_HEAD);
+  Data = NetbufAllocSpace (Nbuf, End - Seq, NET_BUF_TAIL);
+  ASSERT (Data != NULL);
+  SetMem (Data, End - Seq, (UINT8) Seq);
+
+  TCPSEG_NETBUF (Nbuf)->Seq  = Seq;
+  TCPSEG_NETBUF (Nbuf)->End  = End;
+  TCPSEG_NETBUF (Nbuf)->Flag = TCP_FLG_ACK;
+  InsertTailList (Queue, &Nbuf->List);
+}
+
+/**
+  Parse the options of the last segment sent.
+
+  @param[out]  Option  The options parsed.
+
+  @return The length of the options, or -1 if they don't parse.
+
+**/
+INTN
+ParseSentOptions (
+  OUT TCP_OPTION  *Option
+  )
+{
+  ZeroMem (Option, sizeof (TCP_OPTION));
+
+  if (TcpParseOption ((TCP_HEAD *) mSentHead, Option) != 0) {
+    return -1;
+  }
+
+  return (((TCP_HEAD *) mSentHead)->HeadLen << 2) - sizeof (TCP_HEAD);
+}
+
+/**
+  Check the SACK blocks parsed from a segment.
+
+  @param[in]  Option   The options parsed.
+  @param[in]  Count    The number of blocks expected.
+  @param[in]  Edges    The left and right edges of the blocks expected.
+
+**/
+VOID
+CheckSackBlocks (
+  IN TCP_OPTION       *Option,
+  IN UINT8            Count,
+  IN CONST TCP_SEQNO  *Edges
+  )
+{
+  UINT8  Index;
+
+  CHECK (TCP_FLG_ON (Option->Flag, TCP_OPTION_RCVD_SACK));
+  CHECK (Option->SackCount == Count);
+
+  for (Index = 0; Index < Count && Index < Option->SackCount; Index++) {
+    CHECK (Option->Sack[Index].Left == Edges[2 * Index]);
+    CHECK (Option->Sack[Index].Right == Edges[2 * Index + 1]);
+  }
+}
+
+/**
+  Test the SACK option of the ACKs and of data segments.
+
+**/
+VOID
+TestSackOption (
+  VOID
+  )
+{
+  TCP_CB                  Tcb;
+  SOCKET                  Sk;
+  TCP_OPTION              Option;
+  NET_BUF                 *Nbuf;
+  STATIC CONST TCP_SEQNO  WithTs[]    = { 9000, 9100, 2000, 3500, 5000, 6000 };
+  STATIC CONST TCP_SEQNO  WithoutTs[] = { 5000, 6000, 2000, 3500, 7000, 7100, 9000, 9100 };
+
+  InitTcb (&Tcb, &Sk);
+  Tcb.RcvNxt   = 1000;
+  Tcb.SndNxt   = 500;
+  Tcb.CtrlFlag = TCP_CTRL_RCVD_SACK | TCP_CTRL_SND_TS;
+
+  //
+  // Five out-of-order blocks, the first two segments are contiguous.
+  //
+  QueueSegment (&Tcb.RcvQue, 2000, 3000);
+  QueueSegment (&Tcb.RcvQue, 3000, 3500);
+  QueueSegment (&Tcb.RcvQue, 5000, 6000);
+  QueueSegment (&Tcb.RcvQue, 7000, 7100);
+  QueueSegment (&Tcb.RcvQue, 9000, 9100);
+
+  //
+  // The timestamp leaves room for three blocks, the latest goes first.
+  //
+  Tcb.SackLatest = 9000;
+  mSentCount     = 0;
+  TcpSendAck (&Tcb);
+  CHECK (mSentCount == 1 && mSentSeq[0] == 500 && mSentLen[0] == 0);
+  CHECK (ParseSentOptions (&Option) == TCP_OPTION_MAX_LEN);
+  CHECK (TCP_FLG_ON (Option.Flag, TCP_OPTION_RCVD_TS));
+  CHECK (Option.TSVal == mTcpTick && Option.TSEcr == Tcb.TsRecent);
+  CheckSackBlocks (&Option, 3, WithTs);
+
+  //
+  // Without the timestamp, four blocks fit.
+  //
+  TCP_CLEAR_FLG (Tcb.CtrlFlag, TCP_CTRL_SND_TS);
+  Tcb.SackLatest = 5500;
+  mSentCount     = 0;
+  TcpSendAck (&Tcb);
+  CHECK (ParseSentOptions (&Option) == TCP_OPTION_SACK_ALIGNED_LEN + 4 * TCP_OPTION_SACK_BLOCK_LEN);
+  CHECK (!TCP_FLG_ON (Option.Flag, TCP_OPTION_RCVD_TS));
+  CheckSackBlocks (&Option, 4, WithoutTs);
+
+  //
+  // A segment with data never carries SACK blocks.
+  //
+  Nbuf = NetbufAlloc (TCP_MAX_HEAD + 100);
+  ASSERT (Nbuf != NULL);
+  NetbufReserve (Nbuf, TCP_MAX_HEAD);
+  NetbufAllocSpace (Nbuf, 100, NET_BUF_TAIL);
+  TCPSEG_NETBUF (Nbuf)->Flag = TCP_FLG_ACK;
+  CHECK (TcpBuildOption (&Tcb, Nbuf) == 0);
+  NetbufFree (Nbuf);
+
+  //
+  // Nor do the ACKs to a peer that didn't permit SACK.
+  //
+  TCP_CLEAR_FLG (Tcb.CtrlFlag, TCP_CTRL_RCVD_SACK);
+  mSentCount = 0;
+  TcpSendAck (&Tcb);
+  CHECK (ParseSentOptions (&Option) == 0);
+
+  FreeTcb (&Tcb);
+}
+
+/**
+  Build the options of a SYN or a SYN-ACK and parse them.
+
+  @param[in]   Tcb     The TCB sending the segment.
+  @param[in]   Flag    TCP_FLG_SYN, with TCP_FLG_ACK for a SYN-ACK.
+  @param[out]  Option  The options parsed.
+
+  @return The length of the options, or -1 if they don't parse.
+
+**/
+INTN
+SynOptions (
+  IN  TCP_CB      *Tcb,
+  IN  UINT8       Flag,
+  OUT TCP_OPTION  *Option
+  )
+{
+  NET_BUF  *Nbuf;
+  UINT16   Len;
+
+  Nbuf = NetbufAlloc (TCP_MAX_HEAD);
+  ASSERT (Nbuf != NULL);
+  NetbufReserve (Nbuf, TCP_MAX_HEAD);
+  TCPSEG_NETBUF (Nbuf)->Flag = Flag;
+
+  Len = TcpSynBuildOption (Tcb, Nbuf);
+
+  ZeroMem (mSentHead, sizeof (mSentHead));
+  ((TCP_HEAD *) mSentHead)->HeadLen = (UINT8) ((sizeof (TCP_HEAD) + Len) >> 2);
+  NetbufCopy (Nbuf, 0, Len, mSentHead + sizeof (TCP_HEAD));
+  NetbufFree (Nbuf);
+
+  return ParseSentOptions (Option);
+}
+
+/**
+  Test the SACK-permitted and window scale options of the handshake.
+
+**/
+VOID
+TestSynOption (
+  VOID
+  )
+{
+  TCP_CB      Tcb;
+  SOCKET      Sk;
+  TCP_OPTION  Option;
+
+  InitTcb (&Tcb, &Sk);
+  Tcb.State = TCP_SYN_SENT;
+
+  //
+  // The scale of an autotuned buffer covers TCP_RCV_BUF_SIZE.
+  //
+  Tcb.CtrlFlag = TCP_CTRL_RCV_AUTOTUNE;
+  CHECK (SynOptions (&Tcb, TCP_FLG_SYN, &Option) == 24);
+  CHECK (TCP_FLG_ON (Option.Flag, TCP_OPTION_RCVD_SACK_PERM));
+  CHECK (TCP_FLG_ON (Option.Flag, TCP_OPTION_RCVD_MSS) && Option.Mss == 1460);
+  CHECK (TCP_FLG_ON (Option.Flag, TCP_OPTION_RCVD_WS) && Option.WndScale == 6);
+  CHECK ((TCP_MAX_WIN << Option.WndScale) >= TCP_RCV_BUF_SIZE);
+
+  //
+  // The scale of a buffer given by the caller covers that buffer.
+  //
+  Tcb.CtrlFlag = 0;
+  CHECK (SynOptions (&Tcb, TCP_FLG_SYN, &Option) == 24);
+  CHECK (Option.WndScale == 1);
+
+  //
+  // The SYN-ACK only permits SACK if the SYN of the peer did.
+  //
+  CHECK (SynOptions (&Tcb, TCP_FLG_SYN | TCP_FLG_ACK, &Option) == TCP_OPTION_MSS_LEN);
+  CHECK (!TCP_FLG_ON (Option.Flag, TCP_OPTION_RCVD_SACK_PERM));
+
+  Tcb.CtrlFlag = TCP_CTRL_RCVD_SACK | TCP_CTRL_RCVD_WS;
+  CHECK (SynOptions (&Tcb, TCP_FLG_SYN | TCP_FLG_ACK, &Option) == 12);
+  CHECK (TCP_FLG_ON (Option.Flag, TCP_OPTION_RCVD_SACK_PERM));
+
+  Tcb.CtrlFlag = TCP_CTRL_NO_SACK;
+  CHECK (SynOptions (&Tcb, TCP_FLG_SYN, &Option) == 20);
+  CHECK (!TCP_FLG_ON (Option.Flag, TCP_OPTION_RCVD_SACK_PERM));
+
+  FreeTcb (&Tcb);
+}
+
+/**
+  Parse a SACK option of the given length, padded with NOPs.
+
+  @param[in]  Len      The length field of the option.
+  @param[in]  Size     The length of the options in the header.
+
+  @return The result of TcpParseOption().
+
+**/
+INTN
+ParseSack (
+  IN UINT8  Len,
+  IN UINT8  Size
+  )
+{
+  TCP_OPTION  Option;
+  UINT8       *Head;
+
+  SetMem (mSentHead, sizeof (mSentHead), TCP_OPTION_NOP);
+  ((TCP_HEAD *) mSentHead)->HeadLen = (UINT8) ((sizeof (TCP_HEAD) + Size) >> 2);
+
+  Head    = mSentHead + sizeof (TCP_HEAD);
+  Head[2] = TCP_OPTION_SACK;
+  Head[3] = Len;
+  return TcpParseOption ((TCP_HEAD *) mSentHead, &Option);
+}
+
+/**
+  Test the rejection of malformed SACK options.
+
+**/
+VOID
+TestSackParse (
+  VOID
+  )
+{
+  CHECK (ParseSack (2 + TCP_OPTION_SACK_BLOCK_LEN, 12) == 0);
+  CHECK (ParseSack (2 + 4 * TCP_OPTION_SACK_BLOCK_LEN, 36) == 0);
+  CHECK (ParseSack (2, 12) == -1);
+  CHECK (ParseSack (9, 12) == -1);
+  CHECK (ParseSack (2 + 2 * TCP_OPTION_SACK_BLOCK_LEN, 12) == -1);
+}
+
+/**
+  Test the SACK recovery of the sender.
+
+**/
+VOID
+TestSackRecovery (
+  VOID
+  )
+{
+  TCP_CB      Tcb;
+  SOCKET      Sk;
+  TCP_OPTION  Option;
+  UINT32      Index;
+
+  InitTcb (&Tcb, &Sk);
+
+  //
+  // Ten segments of 100 bytes are in flight. The receiver also has
+  // out-of-order data, which the retransmissions must not report.
+  //
+  for (Index = 0; Index < 10; Index++) {
+    QueueSegment (&Tcb.SndQue, Index * 100, Index * 100 + 100);
+  }
+
+  QueueSegment (&Tcb.RcvQue, 2000, 3000);
+  Tcb.RcvNxt   = 1000;
+  Tcb.SndUna   = 0;
+  Tcb.SndNxt   = 1000;
+  Tcb.CtrlFlag = TCP_CTRL_RCVD_SACK;
+
+  //
+  // The fast retransmit resent the segment at SndUna.
+  //
+  Tcb.SackRexmit = Tcb.SndUna;
+
+  //
+  // Only whole segments within the data in flight are marked.
+  //
+  ZeroMem (&Option, sizeof (Option));
+  Option.SackCount     = 3;
+  Option.Sack[0].Left  = 300;
+  Option.Sack[0].Right = 500;
+  Option.Sack[1].Left  = 700;
+  Option.Sack[1].Right = 750;
+  Option.Sack[2].Left  = 800;
+  Option.Sack[2].Right = 1100;
+  TcpMarkSacked (&Tcb, &Option);
+
+  mSentCount = 0;
+  CHECK (TcpSackRetransmit (&Tcb) == 1);
+  CHECK (TcpSackRetransmit (&Tcb) == 1);
+  CHECK (TcpSackRetransmit (&Tcb) == 0);
+  CHECK (mSentCount == 2);
+  CHECK (mSentSeq[0] == 100 && mSentLen[0] == 100);
+  CHECK (mSentSeq[1] == 200 && mSentLen[1] == 100);
+  CHECK (ParseSentOptions (&Option) == 0);
+
+  //
+  // A later SACK reveals the hole at 500, 600 to 700 is SACKed
+  // by it and 700 to 800 wasn't marked by the partial block.
+  //
+  Option.SackCount     = 1;
+  Option.Sack[0].Left  = 600;
+  Option.Sack[0].Right = 1000;
+  TcpMarkSacked (&Tcb, &Option);
+
+  CHECK (TcpSackRetransmit (&Tcb) == 1);
+  CHECK (TcpSackRetransmit (&Tcb) == 0);
+  CHECK (mSentCount == 3 && mSentSeq[2] == 500);
+
+  //
+  // A D-SACK block below SndUna marks nothing.
+  //
+  Tcb.SndUna           = 100;
+  Tcb.SackRexmit       = 0;
+  Option.Sack[0].Left  = 0;
+  Option.Sack[0].Right = 100;
+  TcpMarkSacked (&Tcb, &Option);
+  CHECK (!TCPSEG_NETBUF (NET_LIST_HEAD (&Tcb.SndQue, NET_BUF, List))->Sacked);
+
+  FreeTcb (&Tcb);
+}
+
+/**
+  Receive a window of data from a peer that fills it.
+
+  @param[in, out]  Tcb     The TCB receiving the data.
+  @param[in]       Slack   The bytes of the window the peer leaves unused.
+
+**/
+VOID
+ReceiveWindow (
+  IN OUT TCP_CB  *Tcb,
+  IN     UINT32  Slack
+  )
+{
+  TCP_SEG  Seg;
+
+  Tcb->RcvWl2 = Tcb->RcvNxt;
+  Tcb->RcvWnd = GET_RCV_BUFFSIZE (Tcb->Sk);
+
+  ZeroMem (&Seg, sizeof (Seg));
+  Seg.End     = Tcb->RcvNxt + Tcb->RcvWnd - Slack;
+  Seg.Seq     = Seg.End - Tcb->RcvMss;
+  Tcb->RcvNxt = Seg.End;
+
+  TcpRcvAutotune (Tcb, &Seg);
+}
+
+/**
+  Test the autotuning of the receive buffer.
+
+**/
+VOID
+TestRcvAutotune (
+  VOID
+  )
+{
+  TCP_CB  Tcb;
+  SOCKET  Sk;
+  UINT32  BufSize;
+  UINT32  Round;
+
+  InitTcb (&Tcb, &Sk);
+  Tcb.CtrlFlag    = TCP_CTRL_RCV_AUTOTUNE;
+  Tcb.RcvWndScale = 6;
+  Tcb.RcvNxt      = 0xFFFF0000;
+  Tcb.RcvAutoSeq  = Tcb.RcvNxt;
+
+  //
+  // The buffer doubles for each window the peer fills,
+  // from SOCK_RCV_BUFF_SIZE up to TCP_RCV_BUF_SIZE.
+  //
+  for (Round = 0; Round < 8; Round++) {
+    BufSize = GET_RCV_BUFFSIZE (&Sk);
+    ReceiveWindow (&Tcb, 0);
+    CHECK (GET_RCV_BUFFSIZE (&Sk) == MIN (BufSize * 2, TCP_RCV_BUF_SIZE));
+  }
+
+  CHECK (GET_RCV_BUFFSIZE (&Sk) == TCP_RCV_BUF_SIZE);
+
+  //
+  // It doesn't grow when the peer leaves more than a segment of the window
+  // unused, or when the application leaves half of the buffer unread.
+  //
+  SET_RCV_BUFFSIZE (&Sk, SOCK_RCV_BUFF_SIZE);
+  Tcb.RcvAutoSeq = Tcb.RcvNxt;
+  ReceiveWindow (&Tcb, 2 * Tcb.RcvMss);
+  CHECK (GET_RCV_BUFFSIZE (&Sk) == SOCK_RCV_BUFF_SIZE);
+
+  Sk.RcvBuffer.DataQueue->BufSize = SOCK_RCV_BUFF_SIZE / 2;
+  ReceiveWindow (&Tcb, 0);
+  CHECK (GET_RCV_BUFFSIZE (&Sk) == SOCK_RCV_BUFF_SIZE);
+  Sk.RcvBuffer.DataQueue->BufSize = 0;
+
+  //
+  // It doesn't grow past the window the scale can advertise.
+  //
+  Tcb.RcvWndScale = 0;
+  ReceiveWindow (&Tcb, 0);
+  CHECK (GET_RCV_BUFFSIZE (&Sk) == SOCK_RCV_BUFF_SIZE);
+
+  //
+  // The size of a buffer given by the caller is kept.
+  //
+  Tcb.RcvWndScale = 6;
+  TCP_CLEAR_FLG (Tcb.CtrlFlag, TCP_CTRL_RCV_AUTOTUNE);
+  ReceiveWindow (&Tcb, 0);
+  CHECK (GET_RCV_BUFFSIZE (&Sk) == SOCK_RCV_BUFF_SIZE);
+
+  FreeTcb (&Tcb);
+}
+
+int
+main (
+  void
+  )
+{
+  TestSackOption ();
+  TestSynOption ();
+  TestSackParse ();
+  TestSackRecovery ();
+  TestRcvAutotune ();
+
+  __builtin_printf ("%u failures\n", mFailures);
+  return mFailures != 0;
+}
@@ -1,7 +1,7 @@
 /** @file  
   Application for Block Cipher Primitives Validation.
 
-Copyright (c) 2010, Intel Corporation. All rights reserved.<BR>
+Copyright (c) 2010 - 2017, Intel Corporation. All rights reserved.<BR>
 This program and the accompanying materials
 are licensed and made available under the terms and conditions of the BSD License
 which accompanies this distribution.  The full text of the license may be found at
@@ -115,6 +115,41 @@ GLOBAL_REMOVE_IF_UNREFERENCED CONST UINT8 Aes128CbcCipher[] = {
   0x75, 0x86, 0x60, 0x2d, 0x25, 0x3c, 0xff, 0xf9, 0x1b, 0x82, 0x66, 0xbe, 0xa6, 0xd6, 0x1a, 0xb1
   };
 
+//
+// AES-GCM test vector is Test Case 4 of "The Galois/Counter Mode of Operation
+// (GCM)" by D. McGrew and J. Viega.
+//
+GLOBAL_REMOVE_IF_UNREFERENCED CONST UINT8 Aes128GcmKey[] = {
+  0xfe, 0xff, 0xe9, 0x92, 0x86, 0x65, 0x73, 0x1c, 0x6d, 0x6a, 0x8f, 0x94, 0x67, 0x30, 0x83, 0x08
+  };
+
+GLOBAL_REMOVE_IF_UNREFERENCED CONST UINT8 Aes128GcmIv[] = {
+  0xca, 0xfe, 0xba, 0xbe, 0xfa, 0xce, 0xdb, 0xad, 0xde, 0xca, 0xf8, 0x88
+  };
+
+GLOBAL_REMOVE_IF_UNREFERENCED CONST UINT8 Aes128GcmAData[] = {
+  0xfe, 0xed, 0xfa, 0xce, 0xde, 0xad, 0xbe, 0xef, 0xfe, 0xed, 0xfa, 0xce, 0xde, 0xad, 0xbe, 0xef,
+  0xab, 0xad, 0xda, 0xd2
+  };
+
+GLOBAL_REMOVE_IF_UNREFERENCED CONST UINT8 Aes128GcmData[] = {
+  0xd9, 0x31, 0x32, 0x25, 0xf8, 0x84, 0x06, 0xe5, 0xa5, 0x59, 0x09, 0xc5, 0xaf, 0xf5, 0x26, 0x9a,
+  0x86, 0xa7, 0xa9, 0x53, 0x15, 0x34, 0xf7, 0xda, 0x2e, 0x4c, 0x30, 0x3d, 0x8a, 0x31, 0x8a, 0x72,
+  0x1c, 0x3c, 0x0c, 0x95, 0x95, 0x68, 0x09, 0x53, 0x2f, 0xcf, 0x0e, 0x24, 0x49, 0xa6, 0xb5, 0x25,
+  0xb1, 0x6a, 0xed, 0xf5, 0xaa, 0x0d, 0xe6, 0x57, 0xba, 0x63, 0x7b, 0x39
+  };
+
+GLOBAL_REMOVE_IF_UNREFERENCED CONST UINT8 Aes128GcmCipher[] = {
+  0x42, 0x83, 0x1e, 0xc2, 0x21, 0x77, 0x74, 0x24, 0x4b, 0x72, 0x21, 0xb7, 0x84, 0xd0, 0xd4, 0x9c,
+  0xe3, 0xaa, 0x21, 0x2f, 0x2c, 0x02, 0xa4, 0xe0, 0x35, 0xc1, 0x7e, 0x23, 0x29, 0xac, 0xa1, 0x2e,
+  0x21, 0xd5, 0x14, 0xb2, 0x54, 0x66, 0x93, 0x1c, 0x7d, 0x8f, 0x6a, 0x5a, 0xac, 0x84, 0xaa, 0x05,
+  0x1b, 0xa3, 0x0b, 0x39, 0x6a, 0x0a, 0xac, 0x97, 0x3d, 0x58, 0xe0, 0x91
+  };
+
+GLOBAL_REMOVE_IF_UNREFERENCED CONST UINT8 Aes128GcmTag[] = {
+  0x5b, 0xc9, 0x4f, 0xbc, 0x32, 0x21, 0xa5, 0xdb, 0x94, 0xfa, 0xe9, 0x5a, 0xe7, 0x12, 0x1a, 0x47
+  };
+
 //
 // ARC4 Test Vector defined in "Appendix A.1 Test Vectors from [CRYPTLIB]" of
 // IETF Draft draft-kaukonen-cipher-arcfour-03 ("A Stream Cipher Encryption Algorithm 'Arcfour'").
@@ -147,6 +182,8 @@ ValidateCryptBlockCipher (
   VOID     *CipherCtx;
   UINT8    Encrypt[256];
   UINT8    Decrypt[256];
+  UINT8    Tag[16];
+  UINTN    OutSize;
   BOOLEAN  Status;
 
   Print (L"\nUEFI-OpenSSL Block Cipher Engine Testing: ");
@@ -420,6 +457,82 @@ ValidateCryptBlockCipher (
 
   Print (L"[Pass]");
 
+  Print (L"\n- AES-GCM Validation: ");
+
+  Print (L"Encrypt... ");
+
+  //
+  // AES-128 GCM Validation
+  //
+  ZeroMem (Encrypt, sizeof (Encrypt));
+  ZeroMem (Decrypt, sizeof (Decrypt));
+
+  OutSize = sizeof (Encrypt);
+  Status  = AeadAesGcmEncrypt (
+              Aes128GcmKey, sizeof (Aes128GcmKey),
+              Aes128GcmIv, sizeof (Aes128GcmIv),
+              Aes128GcmAData, sizeof (Aes128GcmAData),
+              Aes128GcmData, sizeof (Aes128GcmData),
+              Tag, sizeof (Tag),
+              Encrypt, &OutSize
+              );
+  if (!Status || OutSize != sizeof (Aes128GcmData)) {
+    Print (L"[Fail]");
+    return EFI_ABORTED;
+  }
+
+  if (CompareMem (Encrypt, Aes128GcmCipher, sizeof (Aes128GcmCipher)) != 0) {
+    Print (L"[Fail]");
+    return EFI_ABORTED;
+  }
+
+  if (CompareMem (Tag, Aes128GcmTag, sizeof (Aes128GcmTag)) != 0) {
+    Print (L"[Fail]");
+    return EFI_ABORTED;
+  }
+
+  Print (L"Decrypt... ");
+
+  OutSize = sizeof (Decrypt);
+  Status  = AeadAesGcmDecrypt (
+              Aes128GcmKey, sizeof (Aes128GcmKey),
+              Aes128GcmIv, sizeof (Aes128GcmIv),
+              Aes128GcmAData, sizeof (Aes128GcmAData),
+              Encrypt, sizeof (Aes128GcmCipher),
+              Aes128GcmTag, sizeof (Aes128GcmTag),
+              Decrypt, &OutSize
+              );
+  if (!Status || OutSize != sizeof (Aes128GcmData)) {
+    Print (L"[Fail]");
+    return EFI_ABORTED;
+  }
+
+  if (CompareMem (Decrypt, Aes128GcmData, sizeof (Aes128GcmData)) != 0) {
+    Print (L"[Fail]");
+    return EFI_ABORTED;
+  }
+
+  Print (L"Tampered... ");
+
+  //
+  // A modified ciphertext must not authenticate.
+  //
+  Encrypt[0] ^= 1;
+  Status = AeadAesGcmDecrypt (
+             Aes128GcmKey, sizeof (Aes128GcmKey),
+             Aes128GcmIv, sizeof (Aes128GcmIv),
+             Aes128GcmAData, sizeof (Aes128GcmAData),
+             Encrypt, sizeof (Aes128GcmCipher),
+             Aes128GcmTag, sizeof (Aes128GcmTag),
+             Decrypt, NULL
+             );
+  if (Status) {
+    Print (L"[Fail]");
+    return EFI_ABORTED;
+  }
+
+  Print (L"[Pass]");
+
   Print (L"\n- ARC4 Validation: ");
 
   //
@@ -0,0 +1,212 @@
+/** @file
+  Throughput measurement of the AES block cipher and AEAD interfaces.
+
+Copyright (c) 2017, Intel Corporation. All rights reserved.<BR>
+This program and the accompanying materials
+are licensed and made available under the terms and conditions of the BSD License
+which accompanies this distribution.  The full text of the license may be found at
+http://opensource.org/licenses/bsd-license.php
+
+THE PROGRAM IS DISTRIBUTED UNDER THE BSD LICENSE ON AN "AS IS" BASIS,
+WITHOUT WARRANTIES OR REPRESENTATIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED.
+
+**/
+
+#include "Cryptest.h"
+
+//
+// The throughput is measured by processing a 1MB buffer in place this many
+// times.
+//
+#define CIPHER_PERF_BUFFER_SIZE   SIZE_1MB
+#define CIPHER_PERF_ITERATIONS    16
+
+//
+// The measurements use the AES-128 key and IV of the GCM test vector.
+//
+GLOBAL_REMOVE_IF_UNREFERENCED CONST UINT8 mCipherPerfKey[] = {
+  0xfe, 0xff, 0xe9, 0x92, 0x86, 0x65, 0x73, 0x1c, 0x6d, 0x6a, 0x8f, 0x94, 0x67, 0x30, 0x83, 0x08
+  };
+
+GLOBAL_REMOVE_IF_UNREFERENCED CONST UINT8 mCipherPerfIv[] = {
+  0xca, 0xfe, 0xba, 0xbe, 0xfa, 0xce, 0xdb, 0xad, 0xde, 0xca, 0xf8, 0x88, 0x00, 0x00, 0x00, 0x00
+  };
+
+typedef
+BOOLEAN
+(*CIPHER_PERF_OPERATION) (
+  IN      VOID   *AesContext,
+  IN OUT  UINT8  *Buffer
+  );
+
+typedef struct {
+  CONST CHAR16           *Name;
+  CIPHER_PERF_OPERATION  Operation;
+} CIPHER_PERF_ALGORITHM;
+
+/**
+  Encrypt the measurement buffer in place with AES-128 in ECB mode.
+
+  @param[in]       AesContext  The AES context, initialized with mCipherPerfKey.
+  @param[in, out]  Buffer      The measurement buffer.
+
+  @retval TRUE   The operation succeeded.
+  @retval FALSE  The operation failed.
+
+**/
+STATIC
+BOOLEAN
+AesEcbEncryptPerf (
+  IN      VOID   *AesContext,
+  IN OUT  UINT8  *Buffer
+  )
+{
+  return AesEcbEncrypt (AesContext, Buffer, CIPHER_PERF_BUFFER_SIZE, Buffer);
+}
+
+/**
+  Encrypt the measurement buffer in place with AES-128 in CBC mode.
+
+  @param[in]       AesContext  The AES context, initialized with mCipherPerfKey.
+  @param[in, out]  Buffer      The measurement buffer.
+
+  @retval TRUE   The operation succeeded.
+  @retval FALSE  The operation failed.
+
+**/
+STATIC
+BOOLEAN
+AesCbcEncryptPerf (
+  IN      VOID   *AesContext,
+  IN OUT  UINT8  *Buffer
+  )
+{
+  return AesCbcEncrypt (AesContext, Buffer, CIPHER_PERF_BUFFER_SIZE, mCipherPerfIv, Buffer);
+}
+
+/**
+  Decrypt the measurement buffer in place with AES-128 in CBC mode.
+
+  @param[in]       AesContext  The AES context, initialized with mCipherPerfKey.
+  @param[in, out]  Buffer      The measurement buffer.
+
+  @retval TRUE   The operation succeeded.
+  @retval FALSE  The operation failed.
+
+**/
+STATIC
+BOOLEAN
+AesCbcDecryptPerf (
+  IN      VOID   *AesContext,
+  IN OUT  UINT8  *Buffer
+  )
+{
+  return AesCbcDecrypt (AesContext, Buffer, CIPHER_PERF_BUFFER_SIZE, mCipherPerfIv, Buffer);
+}
+
+/**
+  Encrypt and authenticate the measurement buffer in place with AES-128-GCM.
+
+  @param[in]       AesContext  The AES context, initialized with mCipherPerfKey.
+  @param[in, out]  Buffer      The measurement buffer.
+
+  @retval TRUE   The operation succeeded.
+  @retval FALSE  The operation failed.
+
+**/
+STATIC
+BOOLEAN
+AesGcmEncryptPerf (
+  IN      VOID   *AesContext,
+  IN OUT  UINT8  *Buffer
+  )
+{
+  UINT8  Tag[16];
+
+  return AeadAesGcmEncrypt (
+           mCipherPerfKey, sizeof (mCipherPerfKey),
+           mCipherPerfIv, 12,
+           NULL, 0,
+           Buffer, CIPHER_PERF_BUFFER_SIZE,
+           Tag, sizeof (Tag),
+           Buffer, NULL
+           );
+}
+
+GLOBAL_REMOVE_IF_UNREFERENCED CONST CIPHER_PERF_ALGORITHM mCipherPerfAlgorithms[] = {
+  { L"AES-128 ECB Encrypt:", AesEcbEncryptPerf },
+  { L"AES-128 CBC Encrypt:", AesCbcEncryptPerf },
+  { L"AES-128 CBC Decrypt:", AesCbcDecryptPerf },
+  { L"AES-128 GCM Encrypt:", AesGcmEncryptPerf }
+};
+
+/**
+  Measure the throughput of the AES interfaces in processor cycles per byte.
+
+  @retval  EFI_SUCCESS           The measurement succeeded.
+  @retval  EFI_ABORTED           An interface failed.
+  @retval  EFI_OUT_OF_RESOURCES  The test buffer could not be allocated.
+
+**/
+EFI_STATUS
+MeasureCryptBlockCipher (
+  VOID
+  )
+{
+  UINT8       *Buffer;
+  VOID        *AesContext;
+  UINTN       Index;
+  UINTN       Iteration;
+  UINT64      Start;
+  UINT64      Cycles;
+  UINT64      CentiCyclesPerByte;
+  EFI_STATUS  Status;
+
+  Print (L"\n UEFI-OpenSSL Block Cipher Engine Throughput:\n");
+
+  Buffer     = AllocateZeroPool (CIPHER_PERF_BUFFER_SIZE);
+  AesContext = AllocatePool (AesGetContextSize ());
+  if (Buffer == NULL || AesContext == NULL) {
+    Status = EFI_OUT_OF_RESOURCES;
+    goto Exit;
+  }
+
+  if (!AesInit (AesContext, mCipherPerfKey, 128)) {
+    Status = EFI_ABORTED;
+    goto Exit;
+  }
+
+  Status = EFI_SUCCESS;
+  for (Index = 0; Index < ARRAY_SIZE (mCipherPerfAlgorithms); Index++) {
+    Print (L"- %s 1MB x %d... ", mCipherPerfAlgorithms[Index].Name, CIPHER_PERF_ITERATIONS);
+
+    Start = ReadCycleCounter ();
+    for (Iteration = 0; Iteration < CIPHER_PERF_ITERATIONS; Iteration++) {
+      if (!mCipherPerfAlgorithms[Index].Operation (AesContext, Buffer)) {
+        Print (L"[Fail]");
+        Status = EFI_ABORTED;
+        goto Exit;
+      }
+    }
+    Cycles = ReadCycleCounter () - Start;
+
+    CentiCyclesPerByte = DivU64x32 (
+                           MultU64x32 (Cycles, 100),
+                           CIPHER_PERF_BUFFER_SIZE * CIPHER_PERF_ITERATIONS
+                           );
+    Print (
+      L"%Ld.%02Ld cycles/byte\n",
+      DivU64x32 (CentiCyclesPerByte, 100),
+      ModU64x32 (CentiCyclesPerByte, 100)
+      );
+  }
+
+Exit:
+  if (AesContext != NULL) {
+    FreePool (AesContext);
+  }
+  if (Buffer != NULL) {
+    FreePool (Buffer);
+  }
+  return Status;
+}
@@ -1,7 +1,7 @@
 /** @file
   Application for Cryptographic Primitives Validation.
 
-Copyright (c) 2009 - 2016, Intel Corporation. All rights reserved.<BR>
+Copyright (c) 2009 - 2017, Intel Corporation. All rights reserved.<BR>
 This program and the accompanying materials
 are licensed and made available under the terms and conditions of the BSD License
 which accompanies this distribution.  The full text of the license may be found at
@@ -43,6 +43,11 @@ CryptestMain (
     return Status;
   }
 
+  Status = MeasureCryptDigest ();
+  if (EFI_ERROR (Status)) {
+    return Status;
+  }
+
   Status = ValidateCryptHmac ();
   if (EFI_ERROR (Status)) {
     return Status;
@@ -53,6 +58,11 @@ CryptestMain (
     return Status;
   }
 
+  Status = MeasureCryptBlockCipher ();
+  if (EFI_ERROR (Status)) {
+    return Status;
+  }
+
   Status = ValidateCryptRsa ();
   if (EFI_ERROR (Status)) {
     return Status;
@@ -1,7 +1,7 @@
 /** @file
   Application for Cryptographic Primitives Validation.
 
-Copyright (c) 2009 - 2016, Intel Corporation. All rights reserved.<BR>
+Copyright (c) 2009 - 2017, Intel Corporation. All rights reserved.<BR>
 This program and the accompanying materials
 are licensed and made available under the terms and conditions of the BSD License
 which accompanies this distribution.  The full text of the license may be found at
@@ -36,6 +36,31 @@ ValidateCryptDigest (
   VOID
   );
 
+/**
+  Validate the digest interfaces on a long message, and measure their
+  throughput in processor cycles per byte.
+
+  @retval  EFI_SUCCESS           Validation succeeded.
+  @retval  EFI_ABORTED           Validation failed.
+  @retval  EFI_OUT_OF_RESOURCES  The test buffer could not be allocated.
+
+**/
+EFI_STATUS
+MeasureCryptDigest (
+  VOID
+  );
+
+/**
+  Read a counter that advances with the processor clock.
+
+  @return  The current counter value.
+
+**/
+UINT64
+ReadCycleCounter (
+  VOID
+  );
+
 /**
   Validate UEFI-OpenSSL Message Authentication Codes Interfaces.
 
@@ -60,6 +85,19 @@ ValidateCryptBlockCipher (
   VOID
   );
 
+/**
+  Measure the throughput of the AES interfaces in processor cycles per byte.
+
+  @retval  EFI_SUCCESS           The measurement succeeded.
+  @retval  EFI_ABORTED           An interface failed.
+  @retval  EFI_OUT_OF_RESOURCES  The test buffer could not be allocated.
+
+**/
+EFI_STATUS
+MeasureCryptBlockCipher (
+  VOID
+  );
+
 /**
   Validate UEFI-OpenSSL RSA Interfaces.
 
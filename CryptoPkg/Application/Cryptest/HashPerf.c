@@ -0,0 +1,245 @@
+/** @file
+  Long message validation and throughput measurement of the digest interfaces.
+
+Copyright (c) 2017, Intel Corporation. All rights reserved.<BR>
+This program and the accompanying materials
+are licensed and made available under the terms and conditions of the BSD License
+which accompanies this distribution.  The full text of the license may be found at
+http://opensource.org/licenses/bsd-license.php
+
+THE PROGRAM IS DISTRIBUTED UNDER THE BSD LICENSE ON AN "AS IS" BASIS,
+WITHOUT WARRANTIES OR REPRESENTATIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED.
+
+**/
+
+#include "Cryptest.h"
+
+//
+// The throughput is measured by hashing a 1MB buffer this many times.
+//
+#define HASH_PERF_BUFFER_SIZE   SIZE_1MB
+#define HASH_PERF_ITERATIONS    16
+
+//
+// Length of the "one million a" message, which is hashed in pieces of varying
+// size, up to HASH_PERF_MAX_PIECE bytes.
+//
+#define MILLION_A_LENGTH        1000000
+#define HASH_PERF_MAX_PIECE     131
+
+typedef
+UINTN
+(EFIAPI *HASH_GET_CONTEXT_SIZE) (
+  VOID
+  );
+
+typedef
+BOOLEAN
+(EFIAPI *HASH_INIT) (
+  OUT  VOID  *HashContext
+  );
+
+typedef
+BOOLEAN
+(EFIAPI *HASH_UPDATE) (
+  IN OUT  VOID        *HashContext,
+  IN      CONST VOID  *Data,
+  IN      UINTN       DataSize
+  );
+
+typedef
+BOOLEAN
+(EFIAPI *HASH_FINAL) (
+  IN OUT  VOID   *HashContext,
+  OUT     UINT8  *HashValue
+  );
+
+typedef
+BOOLEAN
+(EFIAPI *HASH_ALL) (
+  IN   CONST VOID  *Data,
+  IN   UINTN       DataSize,
+  OUT  UINT8       *HashValue
+  );
+
+typedef struct {
+  CONST CHAR16           *Name;
+  HASH_GET_CONTEXT_SIZE  GetContextSize;
+  HASH_INIT              Init;
+  HASH_UPDATE            Update;
+  HASH_FINAL             Final;
+  HASH_ALL               HashAll;
+  UINTN                  DigestSize;
+  CONST UINT8            *MillionADigest;
+} HASH_PERF_ALGORITHM;
+
+//
+// Results for one million repetitions of "a". (From NIST FIPS 180-2)
+//
+GLOBAL_REMOVE_IF_UNREFERENCED CONST UINT8 Sha1MillionADigest[SHA1_DIGEST_SIZE] = {
+  0x34, 0xaa, 0x97, 0x3c, 0xd4, 0xc4, 0xda, 0xa4, 0xf6, 0x1e, 0xeb, 0x2b, 0xdb, 0xad, 0x27, 0x31,
+  0x65, 0x34, 0x01, 0x6f
+  };
+
+GLOBAL_REMOVE_IF_UNREFERENCED CONST UINT8 Sha256MillionADigest[SHA256_DIGEST_SIZE] = {
+  0xcd, 0xc7, 0x6e, 0x5c, 0x99, 0x14, 0xfb, 0x92, 0x81, 0xa1, 0xc7, 0xe2, 0x84, 0xd7, 0x3e, 0x67,
+  0xf1, 0x80, 0x9a, 0x48, 0xa4, 0x97, 0x20, 0x0e, 0x04, 0x6d, 0x39, 0xcc, 0xc7, 0x11, 0x2c, 0xd0
+  };
+
+GLOBAL_REMOVE_IF_UNREFERENCED CONST UINT8 Sha384MillionADigest[SHA384_DIGEST_SIZE] = {
+  0x9d, 0x0e, 0x18, 0x09, 0x71, 0x64, 0x74, 0xcb, 0x08, 0x6e, 0x83, 0x4e, 0x31, 0x0a, 0x4a, 0x1c,
+  0xed, 0x14, 0x9e, 0x9c, 0x00, 0xf2, 0x48, 0x52, 0x79, 0x72, 0xce, 0xc5, 0x70, 0x4c, 0x2a, 0x5b,
+  0x07, 0xb8, 0xb3, 0xdc, 0x38, 0xec, 0xc4, 0xeb, 0xae, 0x97, 0xdd, 0xd8, 0x7f, 0x3d, 0x89, 0x85
+  };
+
+GLOBAL_REMOVE_IF_UNREFERENCED CONST UINT8 Sha512MillionADigest[SHA512_DIGEST_SIZE] = {
+  0xe7, 0x18, 0x48, 0x3d, 0x0c, 0xe7, 0x69, 0x64, 0x4e, 0x2e, 0x42, 0xc7, 0xbc, 0x15, 0xb4, 0x63,
+  0x8e, 0x1f, 0x98, 0xb1, 0x3b, 0x20, 0x44, 0x28, 0x56, 0x32, 0xa8, 0x03, 0xaf, 0xa9, 0x73, 0xeb,
+  0xde, 0x0f, 0xf2, 0x44, 0x87, 0x7e, 0xa6, 0x0a, 0x4c, 0xb0, 0x43, 0x2c, 0xe5, 0x77, 0xc3, 0x1b,
+  0xeb, 0x00, 0x9c, 0x5c, 0x2c, 0x49, 0xaa, 0x2e, 0x4e, 0xad, 0xb2, 0x17, 0xad, 0x8c, 0xc0, 0x9b
+  };
+
+GLOBAL_REMOVE_IF_UNREFERENCED CONST HASH_PERF_ALGORITHM mHashPerfAlgorithms[] = {
+  { L"SHA1:  ", Sha1GetContextSize,   Sha1Init,   Sha1Update,   Sha1Final,   Sha1HashAll,   SHA1_DIGEST_SIZE,   Sha1MillionADigest   },
+  { L"SHA256:", Sha256GetContextSize, Sha256Init, Sha256Update, Sha256Final, Sha256HashAll, SHA256_DIGEST_SIZE, Sha256MillionADigest },
+  { L"SHA384:", Sha384GetContextSize, Sha384Init, Sha384Update, Sha384Final, Sha384HashAll, SHA384_DIGEST_SIZE, Sha384MillionADigest },
+  { L"SHA512:", Sha512GetContextSize, Sha512Init, Sha512Update, Sha512Final, Sha512HashAll, SHA512_DIGEST_SIZE, Sha512MillionADigest }
+};
+
+/**
+  Read a counter that advances with the processor clock.
+
+  @return  The current counter value.
+
+**/
+UINT64
+ReadCycleCounter (
+  VOID
+  )
+{
+#if defined (MDE_CPU_IA32) || defined (MDE_CPU_X64)
+  return AsmReadTsc ();
+#elif defined (MDE_CPU_IPF)
+  return AsmReadItc ();
+#else
+  return 0;
+#endif
+}
+
+/**
+  Hash one million repetitions of "a", fed to the Update() interface in pieces
+  of varying size, and compare the result with the known digest.
+
+  @param[in]  Algorithm  The digest algorithm to validate.
+
+  @retval  TRUE   The digest is correct.
+  @retval  FALSE  The digest is wrong, or an interface failed.
+
+**/
+STATIC
+BOOLEAN
+ValidateMillionA (
+  IN CONST HASH_PERF_ALGORITHM  *Algorithm
+  )
+{
+  UINT8    Data[HASH_PERF_MAX_PIECE];
+  UINT8    Digest[SHA512_DIGEST_SIZE];
+  VOID     *HashCtx;
+  UINTN    Remaining;
+  UINTN    Piece;
+  BOOLEAN  Status;
+
+  HashCtx = AllocatePool (Algorithm->GetContextSize ());
+  if (HashCtx == NULL) {
+    return FALSE;
+  }
+
+  SetMem (Data, sizeof (Data), 'a');
+  Status = Algorithm->Init (HashCtx);
+
+  Remaining = MILLION_A_LENGTH;
+  Piece     = 0;
+  while (Status && Remaining > 0) {
+    Piece  = Piece % HASH_PERF_MAX_PIECE + 1;
+    Piece  = MIN (Piece, Remaining);
+    Status = Algorithm->Update (HashCtx, Data, Piece);
+    Remaining -= Piece;
+  }
+
+  if (Status) {
+    Status = Algorithm->Final (HashCtx, Digest);
+  }
+  FreePool (HashCtx);
+
+  return (BOOLEAN) (Status &&
+                    CompareMem (Digest, Algorithm->MillionADigest,
+                      Algorithm->DigestSize) == 0);
+}
+
+/**
+  Validate the digest interfaces on a long message, and measure their
+  throughput in processor cycles per byte.
+
+  @retval  EFI_SUCCESS           Validation succeeded.
+  @retval  EFI_ABORTED           Validation failed.
+  @retval  EFI_OUT_OF_RESOURCES  The test buffer could not be allocated.
+
+**/
+EFI_STATUS
+MeasureCryptDigest (
+  VOID
+  )
+{
+  UINT8    *Buffer;
+  UINT8    Digest[SHA512_DIGEST_SIZE];
+  UINTN    Index;
+  UINTN    Iteration;
+  UINT64   Start;
+  UINT64   Cycles;
+  UINT64   CentiCyclesPerByte;
+
+  Print (L"\n UEFI-OpenSSL Hash Engine Throughput:\n");
+
+  Buffer = AllocatePool (HASH_PERF_BUFFER_SIZE);
+  if (Buffer == NULL) {
+    return EFI_OUT_OF_RESOURCES;
+  }
+  for (Index = 0; Index < HASH_PERF_BUFFER_SIZE; Index++) {
+    Buffer[Index] = (UINT8) (Index * 7 + 3);
+  }
+
+  for (Index = 0; Index < ARRAY_SIZE (mHashPerfAlgorithms); Index++) {
+    Print (L"- %s ", mHashPerfAlgorithms[Index].Name);
+
+    Print (L"Million a... ");
+    if (!ValidateMillionA (&mHashPerfAlgorithms[Index])) {
+      Print (L"[Fail]");
+      FreePool (Buffer);
+      return EFI_ABORTED;
+    }
+
+    Print (L"HashAll 1MB x %d... ", HASH_PERF_ITERATIONS);
+    Start = ReadCycleCounter ();
+    for (Iteration = 0; Iteration < HASH_PERF_ITERATIONS; Iteration++) {
+      if (!mHashPerfAlgorithms[Index].HashAll (Buffer, HASH_PERF_BUFFER_SIZE, Digest)) {
+        Print (L"[Fail]");
+        FreePool (Buffer);
+        return EFI_ABORTED;
+      }
+    }
+    Cycles = ReadCycleCounter () - Start;
+
+    CentiCyclesPerByte = DivU64x32 (
+                           MultU64x32 (Cycles, 100),
+                           HASH_PERF_BUFFER_SIZE * HASH_PERF_ITERATIONS
+                           );
+    Print (
+      L"%Ld.%02Ld cycles/byte\n",
+      DivU64x32 (CentiCyclesPerByte, 100),
+      ModU64x32 (CentiCyclesPerByte, 100)
+      );
+  }
+
+  FreePool (Buffer);
+  return EFI_SUCCESS;
+}
@@ -4,7 +4,7 @@
   primitives (Hash Serials, HMAC, RSA, Diffie-Hellman, etc) for UEFI security
   functionality enabling.
 
-Copyright (c) 2009 - 2016, Intel Corporation. All rights reserved.<BR>
+Copyright (c) 2009 - 2017, Intel Corporation. All rights reserved.<BR>
 This program and the accompanying materials
 are licensed and made available under the terms and conditions of the BSD License
 which accompanies this distribution.  The full text of the license may be found at
@@ -1642,6 +1642,110 @@ AesCbcDecrypt (
   OUT  UINT8        *Output
   );
 
+/**
+  Performs AEAD AES-GCM authenticated encryption on a data buffer and additional
+  authenticated data (AAD).
+
+  IvSize must be 12, otherwise FALSE is returned.
+  KeySize must be 16, 24 or 32, otherwise FALSE is returned.
+  TagSize must be 12, 13, 14, 15 or 16, otherwise FALSE is returned.
+  If Key, Iv or TagOut is NULL, then return FALSE.
+  If AData is NULL and ADataSize is not zero, then return FALSE.
+  If DataIn or DataOut is NULL and DataInSize is not zero, then return FALSE.
+  If DataOutSize is not NULL and *DataOutSize is smaller than DataInSize, then
+  return FALSE.
+  If this interface is not supported, then return FALSE.
+
+  @param[in]       Key          Pointer to the encryption key.
+  @param[in]       KeySize      Size of the encryption key in bytes.
+  @param[in]       Iv           Pointer to the IV value.
+  @param[in]       IvSize       Size of the IV value in bytes.
+  @param[in]       AData        Pointer to the additional authenticated data (AAD).
+  @param[in]       ADataSize    Size of the additional authenticated data (AAD) in bytes.
+  @param[in]       DataIn       Pointer to the input data buffer to be encrypted.
+  @param[in]       DataInSize   Size of the input data buffer in bytes.
+  @param[out]      TagOut       Pointer to a buffer that receives the authentication tag output.
+  @param[in]       TagSize      Size of the authentication tag in bytes.
+  @param[out]      DataOut      Pointer to a buffer that receives the encryption output.
+                                May equal DataIn.
+  @param[in, out]  DataOutSize  On input, size of the DataOut buffer in bytes. On
+                                output, size of the encryption output. Optional.
+
+  @retval TRUE   AEAD AES-GCM authenticated encryption succeeded.
+  @retval FALSE  AEAD AES-GCM authenticated encryption failed.
+  @retval FALSE  This interface is not supported.
+
+**/
+BOOLEAN
+EFIAPI
+AeadAesGcmEncrypt (
+  IN      CONST UINT8  *Key,
+  IN      UINTN        KeySize,
+  IN      CONST UINT8  *Iv,
+  IN      UINTN        IvSize,
+  IN      CONST UINT8  *AData,
+  IN      UINTN        ADataSize,
+  IN      CONST UINT8  *DataIn,
+  IN      UINTN        DataInSize,
+  OUT     UINT8        *TagOut,
+  IN      UINTN        TagSize,
+  OUT     UINT8        *DataOut,
+  IN OUT  UINTN        *DataOutSize  OPTIONAL
+  );
+
+/**
+  Performs AEAD AES-GCM authenticated decryption on a data buffer and additional
+  authenticated data (AAD).
+
+  IvSize must be 12, otherwise FALSE is returned.
+  KeySize must be 16, 24 or 32, otherwise FALSE is returned.
+  TagSize must be 12, 13, 14, 15 or 16, otherwise FALSE is returned.
+  If Key, Iv or Tag is NULL, then return FALSE.
+  If AData is NULL and ADataSize is not zero, then return FALSE.
+  If DataIn or DataOut is NULL and DataInSize is not zero, then return FALSE.
+  If DataOutSize is not NULL and *DataOutSize is smaller than DataInSize, then
+  return FALSE.
+  If the authentication tag does not match, then the output buffer is cleared
+  and FALSE is returned.
+  If this interface is not supported, then return FALSE.
+
+  @param[in]       Key          Pointer to the encryption key.
+  @param[in]       KeySize      Size of the encryption key in bytes.
+  @param[in]       Iv           Pointer to the IV value.
+  @param[in]       IvSize       Size of the IV value in bytes.
+  @param[in]       AData        Pointer to the additional authenticated data (AAD).
+  @param[in]       ADataSize    Size of the additional authenticated data (AAD) in bytes.
+  @param[in]       DataIn       Pointer to the input data buffer to be decrypted.
+  @param[in]       DataInSize   Size of the input data buffer in bytes.
+  @param[in]       Tag          Pointer to a buffer that contains the authentication tag.
+  @param[in]       TagSize      Size of the authentication tag in bytes.
+  @param[out]      DataOut      Pointer to a buffer that receives the decryption output.
+                                May equal DataIn.
+  @param[in, out]  DataOutSize  On input, size of the DataOut buffer in bytes. On
+                                output, size of the decryption output. Optional.
+
+  @retval TRUE   AEAD AES-GCM authenticated decryption succeeded.
+  @retval FALSE  AEAD AES-GCM authenticated decryption failed.
+  @retval FALSE  This interface is not supported.
+
+**/
+BOOLEAN
+EFIAPI
+AeadAesGcmDecrypt (
+  IN      CONST UINT8  *Key,
+  IN      UINTN        KeySize,
+  IN      CONST UINT8  *Iv,
+  IN      UINTN        IvSize,
+  IN      CONST UINT8  *AData,
+  IN      UINTN        ADataSize,
+  IN      CONST UINT8  *DataIn,
+  IN      UINTN        DataInSize,
+  IN      CONST UINT8  *Tag,
+  IN      UINTN        TagSize,
+  OUT     UINT8        *DataOut,
+  IN OUT  UINTN        *DataOutSize  OPTIONAL
+  );
+
 /**
   Retrieves the size, in bytes, of the context buffer required for ARC4 operations.
 
@@ -0,0 +1,479 @@
+/** @file
+  AEAD AES-GCM Wrapper Implementation over OpenSSL.
+
+  When the processor supports AES-NI and PCLMULQDQ, GCM is computed with these
+  instructions; otherwise the OpenSSL EVP interface is used.
+
+Copyright (c) 2017, Intel Corporation. All rights reserved.<BR>
+This program and the accompanying materials
+are licensed and made available under the terms and conditions of the BSD License
+which accompanies this distribution.  The full text of the license may be found at
+http://opensource.org/licenses/bsd-license.php
+
+THE PROGRAM IS DISTRIBUTED UNDER THE BSD LICENSE ON AN "AS IS" BASIS,
+WITHOUT WARRANTIES OR REPRESENTATIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED.
+
+**/
+
+#include "InternalCryptLib.h"
+#include <openssl/aes.h>
+#include <openssl/evp.h>
+
+//
+// Only 96-bit IVs are supported; the pre-counter block is then IV || 1.
+//
+#define GCM_IV_SIZE   12
+#define GCM_TAG_SIZE  16
+
+/**
+  Checks the parameters common to AeadAesGcmEncrypt() and AeadAesGcmDecrypt().
+
+  @param[in]  Key          Pointer to the encryption key.
+  @param[in]  KeySize      Size of the encryption key in bytes.
+  @param[in]  Iv           Pointer to the IV value.
+  @param[in]  IvSize       Size of the IV value in bytes.
+  @param[in]  AData        Pointer to the additional authenticated data (AAD).
+  @param[in]  ADataSize    Size of the additional authenticated data (AAD) in bytes.
+  @param[in]  DataIn       Pointer to the input data buffer.
+  @param[in]  DataInSize   Size of the input data buffer in bytes.
+  @param[in]  Tag          Pointer to the authentication tag buffer.
+  @param[in]  TagSize      Size of the authentication tag in bytes.
+  @param[in]  DataOut      Pointer to the output data buffer.
+  @param[in]  DataOutSize  Pointer to the size of the output data buffer. Optional.
+
+  @retval TRUE   The parameters are valid.
+  @retval FALSE  A parameter is invalid.
+
+**/
+STATIC
+BOOLEAN
+AesGcmCheckParameters (
+  IN  CONST UINT8  *Key,
+  IN  UINTN        KeySize,
+  IN  CONST UINT8  *Iv,
+  IN  UINTN        IvSize,
+  IN  CONST UINT8  *AData,
+  IN  UINTN        ADataSize,
+  IN  CONST UINT8  *DataIn,
+  IN  UINTN        DataInSize,
+  IN  CONST UINT8  *Tag,
+  IN  UINTN        TagSize,
+  IN  CONST UINT8  *DataOut,
+  IN  CONST UINTN  *DataOutSize
+  )
+{
+  if (Key == NULL || Iv == NULL || Tag == NULL) {
+    return FALSE;
+  }
+  if (KeySize != 16 && KeySize != 24 && KeySize != 32) {
+    return FALSE;
+  }
+  if (IvSize != GCM_IV_SIZE) {
+    return FALSE;
+  }
+  if (TagSize < 12 || TagSize > GCM_TAG_SIZE) {
+    return FALSE;
+  }
+  if ((AData == NULL && ADataSize != 0) || ADataSize > INT_MAX) {
+    return FALSE;
+  }
+  if ((DataIn == NULL || DataOut == NULL) && DataInSize != 0) {
+    return FALSE;
+  }
+  if (DataInSize > INT_MAX) {
+    return FALSE;
+  }
+  if (DataOutSize != NULL && *DataOutSize < DataInSize) {
+    return FALSE;
+  }
+  return TRUE;
+}
+
+/**
+  Folds a buffer into a GHASH value, padding its last block with zeros.
+
+  @param[in, out]  Xi        The 16-byte GHASH value.
+  @param[in]       H         The 16-byte hash key.
+  @param[in]       Data      The buffer to fold in.
+  @param[in]       DataSize  Size of Data in bytes.
+
+**/
+STATIC
+VOID
+AesGcmGhash (
+  IN OUT  UINT8        *Xi,
+  IN      CONST UINT8  *H,
+  IN      CONST UINT8  *Data,
+  IN      UINTN        DataSize
+  )
+{
+  UINT8  Block[AES_BLOCK_SIZE];
+
+  if (DataSize >= AES_BLOCK_SIZE) {
+    GhashClmul (Xi, H, Data, DataSize / AES_BLOCK_SIZE);
+    Data     += DataSize - DataSize % AES_BLOCK_SIZE;
+    DataSize %= AES_BLOCK_SIZE;
+  }
+  if (DataSize != 0) {
+    ZeroMem (Block, sizeof (Block));
+    CopyMem (Block, Data, DataSize);
+    GhashClmul (Xi, H, Block, 1);
+  }
+}
+
+/**
+  Encrypts or decrypts a buffer in GCM counter mode. The last block may be
+  partial.
+
+  @param[in]       Key       The AES encryption key schedule.
+  @param[in, out]  Counter   The 16-byte counter block.
+  @param[in]       Input     The buffer to encrypt or decrypt.
+  @param[in]       Size      Size of Input in bytes.
+  @param[out]      Output    Receives the result. May equal Input.
+
+**/
+STATIC
+VOID
+AesGcmCtr (
+  IN      CONST AES_KEY  *Key,
+  IN OUT  UINT8          *Counter,
+  IN      CONST UINT8    *Input,
+  IN      UINTN          Size,
+  OUT     UINT8          *Output
+  )
+{
+  UINT8  Block[AES_BLOCK_SIZE];
+  UINTN  Whole;
+
+  Whole = Size - Size % AES_BLOCK_SIZE;
+  if (Whole != 0) {
+    AesNiCtr32Encrypt (Key, Input, Output, Whole / AES_BLOCK_SIZE, Counter);
+  }
+  if (Size != Whole) {
+    ZeroMem (Block, sizeof (Block));
+    CopyMem (Block, Input + Whole, Size - Whole);
+    AesNiCtr32Encrypt (Key, Block, Block, 1, Counter);
+    CopyMem (Output + Whole, Block, Size - Whole);
+    ZeroMem (Block, sizeof (Block));
+  }
+}
+
+/**
+  Computes AES-GCM with the AES-NI and PCLMULQDQ instructions.
+
+  For decryption, the ciphertext is authenticated before it is decrypted, so
+  DataIn may equal DataOut in both directions.
+
+  @param[in]   Encrypt     TRUE to encrypt DataIn, FALSE to decrypt it.
+  @param[in]   Key         Pointer to the encryption key.
+  @param[in]   KeySize     Size of the encryption key in bytes.
+  @param[in]   Iv          Pointer to the 12-byte IV value.
+  @param[in]   AData       Pointer to the additional authenticated data (AAD).
+  @param[in]   ADataSize   Size of the additional authenticated data (AAD) in bytes.
+  @param[in]   DataIn      Pointer to the input data buffer.
+  @param[in]   DataInSize  Size of the input data buffer in bytes.
+  @param[out]  Tag         Receives the full 16-byte authentication tag.
+  @param[out]  DataOut     Receives the output data.
+
+**/
+STATIC
+VOID
+AesGcmNi (
+  IN   BOOLEAN      Encrypt,
+  IN   CONST UINT8  *Key,
+  IN   UINTN        KeySize,
+  IN   CONST UINT8  *Iv,
+  IN   CONST UINT8  *AData,
+  IN   UINTN        ADataSize,
+  IN   CONST UINT8  *DataIn,
+  IN   UINTN        DataInSize,
+  OUT  UINT8        *Tag,
+  OUT  UINT8        *DataOut
+  )
+{
+  AES_KEY  AesKey;
+  UINT8    H[AES_BLOCK_SIZE];
+  UINT8    Counter[AES_BLOCK_SIZE];
+  UINT8    EncryptedJ0[AES_BLOCK_SIZE];
+  UINT8    Xi[AES_BLOCK_SIZE];
+  UINT8    Lengths[AES_BLOCK_SIZE];
+  UINTN    Index;
+
+  AES_set_encrypt_key (Key, (UINT32) (KeySize * 8), &AesKey);
+
+  //
+  // H = E(K, 0^128); the pre-counter block J0 = IV || 0^31 || 1.
+  //
+  ZeroMem (H, sizeof (H));
+  AesNiEcbEncrypt (&AesKey, H, H, 1);
+
+  CopyMem (Counter, Iv, GCM_IV_SIZE);
+  Counter[12] = 0;
+  Counter[13] = 0;
+  Counter[14] = 0;
+  Counter[15] = 1;
+  AesNiEcbEncrypt (&AesKey, Counter, EncryptedJ0, 1);
+  Counter[15] = 2;
+
+  ZeroMem (Xi, sizeof (Xi));
+  AesGcmGhash (Xi, H, AData, ADataSize);
+  if (Encrypt) {
+    AesGcmCtr (&AesKey, Counter, DataIn, DataInSize, DataOut);
+    AesGcmGhash (Xi, H, DataOut, DataInSize);
+  } else {
+    AesGcmGhash (Xi, H, DataIn, DataInSize);
+    AesGcmCtr (&AesKey, Counter, DataIn, DataInSize, DataOut);
+  }
+
+  //
+  // Fold in the bit lengths of the AAD and of the ciphertext, big endian.
+  //
+  WriteUnaligned64 ((UINT64 *) Lengths, SwapBytes64 (MultU64x32 (ADataSize, 8)));
+  WriteUnaligned64 ((UINT64 *) (Lengths + 8), SwapBytes64 (MultU64x32 (DataInSize, 8)));
+  GhashClmul (Xi, H, Lengths, 1);
+
+  for (Index = 0; Index < GCM_TAG_SIZE; Index++) {
+    Tag[Index] = (UINT8) (Xi[Index] ^ EncryptedJ0[Index]);
+  }
+
+  ZeroMem (&AesKey, sizeof (AesKey));
+  ZeroMem (H, sizeof (H));
+  ZeroMem (EncryptedJ0, sizeof (EncryptedJ0));
+}
+
+/**
+  Returns the OpenSSL GCM cipher for a key size.
+
+  @param[in]  KeySize  Size of the key in bytes: 16, 24 or 32.
+
+  @return  The OpenSSL cipher.
+
+**/
+STATIC
+CONST EVP_CIPHER *
+AesGcmCipher (
+  IN  UINTN  KeySize
+  )
+{
+  switch (KeySize) {
+  case 16:
+    return EVP_aes_128_gcm ();
+  case 24:
+    return EVP_aes_192_gcm ();
+  default:
+    return EVP_aes_256_gcm ();
+  }
+}
+
+/**
+  Performs AEAD AES-GCM authenticated encryption on a data buffer and additional
+  authenticated data (AAD).
+
+  IvSize must be 12, otherwise FALSE is returned.
+  KeySize must be 16, 24 or 32, otherwise FALSE is returned.
+  TagSize must be 12, 13, 14, 15 or 16, otherwise FALSE is returned.
+  If Key, Iv or TagOut is NULL, then return FALSE.
+  If AData is NULL and ADataSize is not zero, then return FALSE.
+  If DataIn or DataOut is NULL and DataInSize is not zero, then return FALSE.
+  If DataOutSize is not NULL and *DataOutSize is smaller than DataInSize, then
+  return FALSE.
+  If this interface is not supported, then return FALSE.
+
+  @param[in]       Key          Pointer to the encryption key.
+  @param[in]       KeySize      Size of the encryption key in bytes.
+  @param[in]       Iv           Pointer to the IV value.
+  @param[in]       IvSize       Size of the IV value in bytes.
+  @param[in]       AData        Pointer to the additional authenticated data (AAD).
+  @param[in]       ADataSize    Size of the additional authenticated data (AAD) in bytes.
+  @param[in]       DataIn       Pointer to the input data buffer to be encrypted.
+  @param[in]       DataInSize   Size of the input data buffer in bytes.
+  @param[out]      TagOut       Pointer to a buffer that receives the authentication tag output.
+  @param[in]       TagSize      Size of the authentication tag in bytes.
+  @param[out]      DataOut      Pointer to a buffer that receives the encryption output.
+                                May equal DataIn.
+  @param[in, out]  DataOutSize  On input, size of the DataOut buffer in bytes. On
+                                output, size of the encryption output. Optional.
+
+  @retval TRUE   AEAD AES-GCM authenticated encryption succeeded.
+  @retval FALSE  AEAD AES-GCM authenticated encryption failed.
+  @retval FALSE  This interface is not supported.
+
+**/
+BOOLEAN
+EFIAPI
+AeadAesGcmEncrypt (
+  IN      CONST UINT8  *Key,
+  IN      UINTN        KeySize,
+  IN      CONST UINT8  *Iv,
+  IN      UINTN        IvSize,
+  IN      CONST UINT8  *AData,
+  IN      UINTN        ADataSize,
+  IN      CONST UINT8  *DataIn,
+  IN      UINTN        DataInSize,
+  OUT     UINT8        *TagOut,
+  IN      UINTN        TagSize,
+  OUT     UINT8        *DataOut,
+  IN OUT  UINTN        *DataOutSize  OPTIONAL
+  )
+{
+  EVP_CIPHER_CTX  *Ctx;
+  UINT8           FullTag[GCM_TAG_SIZE];
+  INT32           OutLength;
+  BOOLEAN         RetValue;
+
+  if (!AesGcmCheckParameters (Key, KeySize, Iv, IvSize, AData, ADataSize,
+         DataIn, DataInSize, TagOut, TagSize, DataOut, DataOutSize)) {
+    return FALSE;
+  }
+
+  if (IsAesNiSupported ()) {
+    AesGcmNi (TRUE, Key, KeySize, Iv, AData, ADataSize, DataIn, DataInSize,
+      FullTag, DataOut);
+    CopyMem (TagOut, FullTag, TagSize);
+    ZeroMem (FullTag, sizeof (FullTag));
+    if (DataOutSize != NULL) {
+      *DataOutSize = DataInSize;
+    }
+    return TRUE;
+  }
+
+  Ctx = EVP_CIPHER_CTX_new ();
+  if (Ctx == NULL) {
+    return FALSE;
+  }
+
+  RetValue = (BOOLEAN) (
+               EVP_EncryptInit_ex (Ctx, AesGcmCipher (KeySize), NULL, NULL, NULL) == 1 &&
+               EVP_CIPHER_CTX_ctrl (Ctx, EVP_CTRL_GCM_SET_IVLEN, (INT32) IvSize, NULL) == 1 &&
+               EVP_EncryptInit_ex (Ctx, NULL, NULL, Key, Iv) == 1 &&
+               (ADataSize == 0 ||
+                EVP_EncryptUpdate (Ctx, NULL, &OutLength, AData, (INT32) ADataSize) == 1) &&
+               (DataInSize == 0 ||
+                EVP_EncryptUpdate (Ctx, DataOut, &OutLength, DataIn, (INT32) DataInSize) == 1) &&
+               EVP_EncryptFinal_ex (Ctx, FullTag, &OutLength) == 1 &&
+               EVP_CIPHER_CTX_ctrl (Ctx, EVP_CTRL_GCM_GET_TAG, (INT32) TagSize, TagOut) == 1
+               );
+
+  EVP_CIPHER_CTX_free (Ctx);
+
+  if (RetValue && DataOutSize != NULL) {
+    *DataOutSize = DataInSize;
+  }
+  return RetValue;
+}
+
+/**
+  Performs AEAD AES-GCM authenticated decryption on a data buffer and additional
+  authenticated data (AAD).
+
+  IvSize must be 12, otherwise FALSE is returned.
+  KeySize must be 16, 24 or 32, otherwise FALSE is returned.
+  TagSize must be 12, 13, 14, 15 or 16, otherwise FALSE is returned.
+  If Key, Iv or Tag is NULL, then return FALSE.
+  If AData is NULL and ADataSize is not zero, then return FALSE.
+  If DataIn or DataOut is NULL and DataInSize is not zero, then return FALSE.
+  If DataOutSize is not NULL and *DataOutSize is smaller than DataInSize, then
+  return FALSE.
+  If the authentication tag does not match, then the output buffer is cleared
+  and FALSE is returned.
+  If this interface is not supported, then return FALSE.
+
+  @param[in]       Key          Pointer to the encryption key.
+  @param[in]       KeySize      Size of the encryption key in bytes.
+  @param[in]       Iv           Pointer to the IV value.
+  @param[in]       IvSize       Size of the IV value in bytes.
+  @param[in]       AData        Pointer to the additional authenticated data (AAD).
+  @param[in]       ADataSize    Size of the additional authenticated data (AAD) in bytes.
+  @param[in]       DataIn       Pointer to the input data buffer to be decrypted.
+  @param[in]       DataInSize   Size of the input data buffer in bytes.
+  @param[in]       Tag          Pointer to a buffer that contains the authentication tag.
+  @param[in]       TagSize      Size of the authentication tag in bytes.
+  @param[out]      DataOut      Pointer to a buffer that receives the decryption output.
+                                May equal DataIn.
+  @param[in, out]  DataOutSize  On input, size of the DataOut buffer in bytes. On
+                                output, size of the decryption output. Optional.
+
+  @retval TRUE   AEAD AES-GCM authenticated decryption succeeded.
+  @retval FALSE  AEAD AES-GCM authenticated decryption failed.
+  @retval FALSE  This interface is not supported.
+
+**/
+BOOLEAN
+EFIAPI
+AeadAesGcmDecrypt (
+  IN      CONST UINT8  *Key,
+  IN      UINTN        KeySize,
+  IN      CONST UINT8  *Iv,
+  IN      UINTN        IvSize,
+  IN      CONST UINT8  *AData,
+  IN      UINTN        ADataSize,
+  IN      CONST UINT8  *DataIn,
+  IN      UINTN        DataInSize,
+  IN      CONST UINT8  *Tag,
+  IN      UINTN        TagSize,
+  OUT     UINT8        *DataOut,
+  IN OUT  UINTN        *DataOutSize  OPTIONAL
+  )
+{
+  EVP_CIPHER_CTX  *Ctx;
+  UINT8           FullTag[GCM_TAG_SIZE];
+  UINT8           Difference;
+  UINTN           Index;
+  INT32           OutLength;
+  BOOLEAN         RetValue;
+
+  if (!AesGcmCheckParameters (Key, KeySize, Iv, IvSize, AData, ADataSize,
+         DataIn, DataInSize, Tag, TagSize, DataOut, DataOutSize)) {
+    return FALSE;
+  }
+
+  if (IsAesNiSupported ()) {
+    AesGcmNi (FALSE, Key, KeySize, Iv, AData, ADataSize, DataIn, DataInSize,
+      FullTag, DataOut);
+
+    //
+    // Compare all bytes of the tag, regardless of where they differ.
+    //
+    Difference = 0;
+    for (Index = 0; Index < TagSize; Index++) {
+      Difference |= (UINT8) (FullTag[Index] ^ Tag[Index]);
+    }
+    ZeroMem (FullTag, sizeof (FullTag));
+    RetValue = (BOOLEAN) (Difference == 0);
+  } else {
+    Ctx = EVP_CIPHER_CTX_new ();
+    if (Ctx == NULL) {
+      return FALSE;
+    }
+
+    //
+    // EVP_CTRL_GCM_SET_TAG takes a non-const buffer, but only reads it.
+    //
+    CopyMem (FullTag, Tag, TagSize);
+    RetValue = (BOOLEAN) (
+                 EVP_DecryptInit_ex (Ctx, AesGcmCipher (KeySize), NULL, NULL, NULL) == 1 &&
+                 EVP_CIPHER_CTX_ctrl (Ctx, EVP_CTRL_GCM_SET_IVLEN, (INT32) IvSize, NULL) == 1 &&
+                 EVP_DecryptInit_ex (Ctx, NULL, NULL, Key, Iv) == 1 &&
+                 (ADataSize == 0 ||
+                  EVP_DecryptUpdate (Ctx, NULL, &OutLength, AData, (INT32) ADataSize) == 1) &&
+                 (DataInSize == 0 ||
+                  EVP_DecryptUpdate (Ctx, DataOut, &OutLength, DataIn, (INT32) DataInSize) == 1) &&
+                 EVP_CIPHER_CTX_ctrl (Ctx, EVP_CTRL_GCM_SET_TAG, (INT32) TagSize, FullTag) == 1 &&
+                 EVP_DecryptFinal_ex (Ctx, FullTag, &OutLength) > 0
+                 );
+
+    EVP_CIPHER_CTX_free (Ctx);
+  }
+
+  if (!RetValue) {
+    if (DataInSize != 0) {
+      ZeroMem (DataOut, DataInSize);
+    }
+    return FALSE;
+  }
+
+  if (DataOutSize != NULL) {
+    *DataOutSize = DataInSize;
+  }
+  return TRUE;
+}
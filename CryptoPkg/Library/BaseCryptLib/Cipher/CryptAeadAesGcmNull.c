@@ -0,0 +1,105 @@
+/** @file
+  AEAD AES-GCM Wrapper Implementation which does not provide real capabilities.
+
+Copyright (c) 2017, Intel Corporation. All rights reserved.<BR>
+This program and the accompanying materials
+are licensed and made available under the terms and conditions of the BSD License
+which accompanies this distribution.  The full text of the license may be found at
+http://opensource.org/licenses/bsd-license.php
+
+THE PROGRAM IS DISTRIBUTED UNDER THE BSD LICENSE ON AN "AS IS" BASIS,
+WITHOUT WARRANTIES OR REPRESENTATIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED.
+
+**/
+
+#include "InternalCryptLib.h"
+
+/**
+  Performs AEAD AES-GCM authenticated encryption on a data buffer and additional
+  authenticated data (AAD).
+
+  Return FALSE to indicate this interface is not supported.
+
+  @param[in]       Key          Pointer to the encryption key.
+  @param[in]       KeySize      Size of the encryption key in bytes.
+  @param[in]       Iv           Pointer to the IV value.
+  @param[in]       IvSize       Size of the IV value in bytes.
+  @param[in]       AData        Pointer to the additional authenticated data (AAD).
+  @param[in]       ADataSize    Size of the additional authenticated data (AAD) in bytes.
+  @param[in]       DataIn       Pointer to the input data buffer to be encrypted.
+  @param[in]       DataInSize   Size of the input data buffer in bytes.
+  @param[out]      TagOut       Pointer to a buffer that receives the authentication tag output.
+  @param[in]       TagSize      Size of the authentication tag in bytes.
+  @param[out]      DataOut      Pointer to a buffer that receives the encryption output.
+                                May equal DataIn.
+  @param[in, out]  DataOutSize  On input, size of the DataOut buffer in bytes. On
+                                output, size of the encryption output. Optional.
+
+  @retval FALSE  This interface is not supported.
+
+**/
+BOOLEAN
+EFIAPI
+AeadAesGcmEncrypt (
+  IN      CONST UINT8  *Key,
+  IN      UINTN        KeySize,
+  IN      CONST UINT8  *Iv,
+  IN      UINTN        IvSize,
+  IN      CONST UINT8  *AData,
+  IN      UINTN        ADataSize,
+  IN      CONST UINT8  *DataIn,
+  IN      UINTN        DataInSize,
+  OUT     UINT8        *TagOut,
+  IN      UINTN        TagSize,
+  OUT     UINT8        *DataOut,
+  IN OUT  UINTN        *DataOutSize  OPTIONAL
+  )
+{
+  ASSERT (FALSE);
+  return FALSE;
+}
+
+/**
+  Performs AEAD AES-GCM authenticated decryption on a data buffer and additional
+  authenticated data (AAD).
+
+  Return FALSE to indicate this interface is not supported.
+
+  @param[in]       Key          Pointer to the encryption key.
+  @param[in]       KeySize      Size of the encryption key in bytes.
+  @param[in]       Iv           Pointer to the IV value.
+  @param[in]       IvSize       Size of the IV value in bytes.
+  @param[in]       AData        Pointer to the additional authenticated data (AAD).
+  @param[in]       ADataSize    Size of the additional authenticated data (AAD) in bytes.
+  @param[in]       DataIn       Pointer to the input data buffer to be decrypted.
+  @param[in]       DataInSize   Size of the input data buffer in bytes.
+  @param[in]       Tag          Pointer to a buffer that contains the authentication tag.
+  @param[in]       TagSize      Size of the authentication tag in bytes.
+  @param[out]      DataOut      Pointer to a buffer that receives the decryption output.
+                                May equal DataIn.
+  @param[in, out]  DataOutSize  On input, size of the DataOut buffer in bytes. On
+                                output, size of the decryption output. Optional.
+
+  @retval FALSE  This interface is not supported.
+
+**/
+BOOLEAN
+EFIAPI
+AeadAesGcmDecrypt (
+  IN      CONST UINT8  *Key,
+  IN      UINTN        KeySize,
+  IN      CONST UINT8  *Iv,
+  IN      UINTN        IvSize,
+  IN      CONST UINT8  *AData,
+  IN      UINTN        ADataSize,
+  IN      CONST UINT8  *DataIn,
+  IN      UINTN        DataInSize,
+  IN      CONST UINT8  *Tag,
+  IN      UINTN        TagSize,
+  OUT     UINT8        *DataOut,
+  IN OUT  UINTN        *DataOutSize  OPTIONAL
+  )
+{
+  ASSERT (FALSE);
+  return FALSE;
+}
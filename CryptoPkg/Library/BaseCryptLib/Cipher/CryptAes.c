@@ -1,7 +1,10 @@
 /** @file
   AES Wrapper Implementation over OpenSSL.
 
-Copyright (c) 2010 - 2012, Intel Corporation. All rights reserved.<BR>
+  The processor's AES-NI instructions are used instead of the portable OpenSSL
+  code when available.
+
+Copyright (c) 2010 - 2017, Intel Corporation. All rights reserved.<BR>
 This program and the accompanying materials
 are licensed and made available under the terms and conditions of the BSD License
 which accompanies this distribution.  The full text of the license may be found at
@@ -128,6 +131,11 @@ AesEcbEncrypt (
   
   AesKey = (AES_KEY *) AesContext;
 
+  if (IsAesNiSupported ()) {
+    AesNiEcbEncrypt (AesKey, Input, Output, InputSize / AES_BLOCK_SIZE);
+    return TRUE;
+  }
+
   //
   // Perform AES data encryption with ECB mode (block-by-block)
   //
@@ -185,6 +193,11 @@ AesEcbDecrypt (
 
   AesKey = (AES_KEY *) AesContext;
 
+  if (IsAesNiSupported ()) {
+    AesNiEcbDecrypt (AesKey + 1, Input, Output, InputSize / AES_BLOCK_SIZE);
+    return TRUE;
+  }
+
   //
   // Perform AES data decryption with ECB mode (block-by-block)
   //
@@ -252,6 +265,11 @@ AesCbcEncrypt (
   AesKey = (AES_KEY *) AesContext;
   CopyMem (IvecBuffer, Ivec, AES_BLOCK_SIZE);
 
+  if (IsAesNiSupported ()) {
+    AesNiCbcEncrypt (AesKey, Input, Output, InputSize / AES_BLOCK_SIZE, IvecBuffer);
+    return TRUE;
+  }
+
   //
   // Perform AES data encryption with CBC mode
   //
@@ -314,6 +332,11 @@ AesCbcDecrypt (
   AesKey = (AES_KEY *) AesContext;
   CopyMem (IvecBuffer, Ivec, AES_BLOCK_SIZE);
 
+  if (IsAesNiSupported ()) {
+    AesNiCbcDecrypt (AesKey + 1, Input, Output, InputSize / AES_BLOCK_SIZE, IvecBuffer);
+    return TRUE;
+  }
+
   //
   // Perform AES data decryption with CBC mode
   //
@@ -0,0 +1,63 @@
+/** @file
+  Detects whether the processor supports the AES-NI and PCLMULQDQ instructions
+  used by the AES modes and by GCM.
+
+Copyright (c) 2017, Intel Corporation. All rights reserved.<BR>
+This program and the accompanying materials
+are licensed and made available under the terms and conditions of the BSD License
+which accompanies this distribution.  The full text of the license may be found at
+http://opensource.org/licenses/bsd-license.php
+
+THE PROGRAM IS DISTRIBUTED UNDER THE BSD LICENSE ON AN "AS IS" BASIS,
+WITHOUT WARRANTIES OR REPRESENTATIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED.
+
+**/
+
+#include "InternalCryptLib.h"
+
+//
+// CPUID.01H:ECX
+//
+#define CPUID_PCLMULQDQ_BIT  BIT1
+#define CPUID_SSSE3_BIT      BIT9
+#define CPUID_SSE41_BIT      BIT19
+#define CPUID_AESNI_BIT      BIT25
+
+#define CPUID_AESNI_REQUIRED  (CPUID_PCLMULQDQ_BIT | CPUID_SSSE3_BIT | \
+                               CPUID_SSE41_BIT | CPUID_AESNI_BIT)
+
+//
+// Whether the processor supports the instructions, zero until checked.
+//
+#define AES_NI_UNKNOWN      0
+#define AES_NI_SUPPORTED    1
+#define AES_NI_UNSUPPORTED  2
+
+STATIC UINT8  mAesNiSupport = AES_NI_UNKNOWN;
+
+/**
+  Checks whether the processor supports the AES-NI and PCLMULQDQ instructions
+  that the AesNi*() and GhashClmul() functions use.
+
+  @retval TRUE   The AesNi*() and GhashClmul() functions can be used.
+  @retval FALSE  The portable OpenSSL code has to be used.
+
+**/
+BOOLEAN
+IsAesNiSupported (
+  VOID
+  )
+{
+  UINT32  Ecx;
+
+  if (mAesNiSupport == AES_NI_UNKNOWN) {
+    AsmCpuid (1, NULL, NULL, &Ecx, NULL);
+    if ((Ecx & CPUID_AESNI_REQUIRED) == CPUID_AESNI_REQUIRED) {
+      mAesNiSupport = AES_NI_SUPPORTED;
+    } else {
+      mAesNiSupport = AES_NI_UNSUPPORTED;
+    }
+  }
+
+  return (BOOLEAN) (mAesNiSupport == AES_NI_SUPPORTED);
+}
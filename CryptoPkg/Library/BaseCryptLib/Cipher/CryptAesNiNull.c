@@ -0,0 +1,129 @@
+/** @file
+  AES-NI and PCLMULQDQ support for processors without these instructions:
+  the portable OpenSSL code is always used.
+
+Copyright (c) 2017, Intel Corporation. All rights reserved.<BR>
+This program and the accompanying materials
+are licensed and made available under the terms and conditions of the BSD License
+which accompanies this distribution.  The full text of the license may be found at
+http://opensource.org/licenses/bsd-license.php
+
+THE PROGRAM IS DISTRIBUTED UNDER THE BSD LICENSE ON AN "AS IS" BASIS,
+WITHOUT WARRANTIES OR REPRESENTATIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED.
+
+**/
+
+#include "InternalCryptLib.h"
+
+/**
+  Checks whether the processor supports the AES-NI and PCLMULQDQ instructions.
+
+  @retval FALSE  The portable OpenSSL code has to be used.
+
+**/
+BOOLEAN
+IsAesNiSupported (
+  VOID
+  )
+{
+  return FALSE;
+}
+
+/**
+  Not supported; IsAesNiSupported() returns FALSE.
+
+**/
+VOID
+EFIAPI
+AesNiEcbEncrypt (
+  IN   CONST VOID   *Key,
+  IN   CONST UINT8  *Input,
+  OUT  UINT8        *Output,
+  IN   UINTN        BlockCount
+  )
+{
+  ASSERT (FALSE);
+}
+
+/**
+  Not supported; IsAesNiSupported() returns FALSE.
+
+**/
+VOID
+EFIAPI
+AesNiEcbDecrypt (
+  IN   CONST VOID   *Key,
+  IN   CONST UINT8  *Input,
+  OUT  UINT8        *Output,
+  IN   UINTN        BlockCount
+  )
+{
+  ASSERT (FALSE);
+}
+
+/**
+  Not supported; IsAesNiSupported() returns FALSE.
+
+**/
+VOID
+EFIAPI
+AesNiCbcEncrypt (
+  IN      CONST VOID   *Key,
+  IN      CONST UINT8  *Input,
+  OUT     UINT8        *Output,
+  IN      UINTN        BlockCount,
+  IN OUT  UINT8        *Ivec
+  )
+{
+  ASSERT (FALSE);
+}
+
+/**
+  Not supported; IsAesNiSupported() returns FALSE.
+
+**/
+VOID
+EFIAPI
+AesNiCbcDecrypt (
+  IN      CONST VOID   *Key,
+  IN      CONST UINT8  *Input,
+  OUT     UINT8        *Output,
+  IN      UINTN        BlockCount,
+  IN OUT  UINT8        *Ivec
+  )
+{
+  ASSERT (FALSE);
+}
+
+/**
+  Not supported; IsAesNiSupported() returns FALSE.
+
+**/
+VOID
+EFIAPI
+AesNiCtr32Encrypt (
+  IN      CONST VOID   *Key,
+  IN      CONST UINT8  *Input,
+  OUT     UINT8        *Output,
+  IN      UINTN        BlockCount,
+  IN OUT  UINT8        *Counter
+  )
+{
+  ASSERT (FALSE);
+}
+
+/**
+  Not supported; IsAesNiSupported() returns FALSE.
+
+**/
+VOID
+EFIAPI
+GhashClmul (
+  IN OUT  UINT8        *Xi,
+  IN      CONST UINT8  *H,
+  IN      CONST UINT8  *Input,
+  IN      UINTN        BlockCount
+  )
+{
+  ASSERT (FALSE);
+}
@@ -1,7 +1,7 @@
 /** @file
   SHA-1 Digest Wrapper Implementation over OpenSSL.
 
-Copyright (c) 2009 - 2016, Intel Corporation. All rights reserved.<BR>
+Copyright (c) 2009 - 2017, Intel Corporation. All rights reserved.<BR>
 This program and the accompanying materials
 are licensed and made available under the terms and conditions of the BSD License
 which accompanies this distribution.  The full text of the license may be found at
@@ -15,6 +15,73 @@ WITHOUT WARRANTIES OR REPRESENTATIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED.
 #include "InternalCryptLib.h"
 #include <openssl/sha.h>
 
+/**
+  Digests the input data with the accelerated SHA-1 block function.
+
+  The context is kept in the layout OpenSSL uses, so it can be duplicated and
+  finalized with the OpenSSL code.
+
+  @param[in, out]  Context        Pointer to the SHA-1 context.
+  @param[in]       Data           Pointer to the buffer containing the data to be hashed.
+  @param[in]       DataSize       Size of Data buffer in bytes.
+  @param[in]       BlockFunction  The SHA-1 block function to use.
+
+**/
+STATIC
+VOID
+Sha1UpdateBlocks (
+  IN OUT SHA_CTX             *Context,
+  IN     CONST UINT8         *Data,
+  IN     UINTN               DataSize,
+  IN     SHA_BLOCK_FUNCTION  BlockFunction
+  )
+{
+  UINT8   *Buffer;
+  UINTN   Fill;
+  UINT32  BitCountLow;
+
+  //
+  // Count the message length in bits, like OpenSSL.
+  //
+  BitCountLow = Context->Nl + (UINT32) (DataSize << 3);
+  if (BitCountLow < Context->Nl) {
+    Context->Nh++;
+  }
+  Context->Nh += (UINT32) (DataSize >> 29);
+  Context->Nl  = BitCountLow;
+
+  //
+  // Complete the partial block left over from the previous update.
+  //
+  Buffer = (UINT8 *) Context->data;
+  if (Context->num != 0) {
+    Fill = SHA_CBLOCK - Context->num;
+    if (DataSize < Fill) {
+      CopyMem (Buffer + Context->num, Data, DataSize);
+      Context->num += (UINT32) DataSize;
+      return;
+    }
+    CopyMem (Buffer + Context->num, Data, Fill);
+    BlockFunction (&Context->h0, Buffer, 1);
+    Data        += Fill;
+    DataSize    -= Fill;
+    Context->num = 0;
+  }
+
+  //
+  // Hash the whole blocks in place, and keep the rest for later.
+  //
+  if (DataSize >= SHA_CBLOCK) {
+    BlockFunction (&Context->h0, Data, DataSize / SHA_CBLOCK);
+    Data     += DataSize - DataSize % SHA_CBLOCK;
+    DataSize %= SHA_CBLOCK;
+  }
+  if (DataSize != 0) {
+    CopyMem (Buffer, Data, DataSize);
+    Context->num = (UINT32) DataSize;
+  }
+}
+
 
 /**
   Retrieves the size, in bytes, of the context buffer required for SHA-1 hash operations.
@@ -123,6 +190,8 @@ Sha1Update (
   IN      UINTN       DataSize
   )
 {
+  SHA_BLOCK_FUNCTION  BlockFunction;
+
   //
   // Check input parameters.
   //
@@ -137,6 +206,15 @@ Sha1Update (
     return FALSE;
   }
 
+  //
+  // Use the processor's SHA instructions if it has them, else OpenSSL.
+  //
+  BlockFunction = GetSha1BlockFunction ();
+  if (BlockFunction != NULL) {
+    Sha1UpdateBlocks ((SHA_CTX *) Sha1Context, Data, DataSize, BlockFunction);
+    return TRUE;
+  }
+
   //
   // OpenSSL SHA-1 Hash Update
   //
@@ -209,6 +287,8 @@ Sha1HashAll (
   OUT  UINT8       *HashValue
   )
 {
+  SHA_CTX  Context;
+
   //
   // Check input parameters.
   //
@@ -220,11 +300,13 @@ Sha1HashAll (
   }
 
   //
-  // OpenSSL SHA-1 Hash Computation.
+  // Go through Sha1Update() rather than SHA1(), so that the processor's SHA
+  // instructions get used.
   //
-  if (SHA1 (Data, DataSize, HashValue) == NULL) {
-    return FALSE;
-  } else {
-    return TRUE;
-  }
+  Sha1Init (&Context);
+  Sha1Update (&Context, Data, DataSize);
+  Sha1Final (&Context, HashValue);
+  ZeroMem (&Context, sizeof (Context));
+
+  return TRUE;
 }
@@ -1,7 +1,7 @@
 /** @file
   SHA-256 Digest Wrapper Implementation over OpenSSL.
 
-Copyright (c) 2009 - 2016, Intel Corporation. All rights reserved.<BR>
+Copyright (c) 2009 - 2017, Intel Corporation. All rights reserved.<BR>
 This program and the accompanying materials
 are licensed and made available under the terms and conditions of the BSD License
 which accompanies this distribution.  The full text of the license may be found at
@@ -15,6 +15,73 @@ WITHOUT WARRANTIES OR REPRESENTATIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED.
 #include "InternalCryptLib.h"
 #include <openssl/sha.h>
 
+/**
+  Digests the input data with the accelerated SHA-256 block function.
+
+  The context is kept in the layout OpenSSL uses, so it can be duplicated and
+  finalized with the OpenSSL code.
+
+  @param[in, out]  Context        Pointer to the SHA-256 context.
+  @param[in]       Data           Pointer to the buffer containing the data to be hashed.
+  @param[in]       DataSize       Size of Data buffer in bytes.
+  @param[in]       BlockFunction  The SHA-256 block function to use.
+
+**/
+STATIC
+VOID
+Sha256UpdateBlocks (
+  IN OUT SHA256_CTX          *Context,
+  IN     CONST UINT8         *Data,
+  IN     UINTN               DataSize,
+  IN     SHA_BLOCK_FUNCTION  BlockFunction
+  )
+{
+  UINT8   *Buffer;
+  UINTN   Fill;
+  UINT32  BitCountLow;
+
+  //
+  // Count the message length in bits, like OpenSSL.
+  //
+  BitCountLow = Context->Nl + (UINT32) (DataSize << 3);
+  if (BitCountLow < Context->Nl) {
+    Context->Nh++;
+  }
+  Context->Nh += (UINT32) (DataSize >> 29);
+  Context->Nl  = BitCountLow;
+
+  //
+  // Complete the partial block left over from the previous update.
+  //
+  Buffer = (UINT8 *) Context->data;
+  if (Context->num != 0) {
+    Fill = SHA256_CBLOCK - Context->num;
+    if (DataSize < Fill) {
+      CopyMem (Buffer + Context->num, Data, DataSize);
+      Context->num += (UINT32) DataSize;
+      return;
+    }
+    CopyMem (Buffer + Context->num, Data, Fill);
+    BlockFunction (Context->h, Buffer, 1);
+    Data        += Fill;
+    DataSize    -= Fill;
+    Context->num = 0;
+  }
+
+  //
+  // Hash the whole blocks in place, and keep the rest for later.
+  //
+  if (DataSize >= SHA256_CBLOCK) {
+    BlockFunction (Context->h, Data, DataSize / SHA256_CBLOCK);
+    Data     += DataSize - DataSize % SHA256_CBLOCK;
+    DataSize %= SHA256_CBLOCK;
+  }
+  if (DataSize != 0) {
+    CopyMem (Buffer, Data, DataSize);
+    Context->num = (UINT32) DataSize;
+  }
+}
+
 /**
   Retrieves the size, in bytes, of the context buffer required for SHA-256 hash operations.
 
@@ -122,6 +189,8 @@ Sha256Update (
   IN      UINTN       DataSize
   )
 {
+  SHA_BLOCK_FUNCTION  BlockFunction;
+
   //
   // Check input parameters.
   //
@@ -136,6 +205,15 @@ Sha256Update (
     return FALSE;
   }
 
+  //
+  // Use the processor's SHA instructions if it has them, else OpenSSL.
+  //
+  BlockFunction = GetSha256BlockFunction ();
+  if (BlockFunction != NULL) {
+    Sha256UpdateBlocks ((SHA256_CTX *) Sha256Context, Data, DataSize, BlockFunction);
+    return TRUE;
+  }
+
   //
   // OpenSSL SHA-256 Hash Update
   //
@@ -208,6 +286,8 @@ Sha256HashAll (
   OUT  UINT8       *HashValue
   )
 {
+  SHA256_CTX  Context;
+
   //
   // Check input parameters.
   //
@@ -219,11 +299,13 @@ Sha256HashAll (
   }
 
   //
-  // OpenSSL SHA-256 Hash Computation.
+  // Go through Sha256Update() rather than SHA256(), so that the processor's SHA
+  // instructions get used.
   //
-  if (SHA256 (Data, DataSize, HashValue) == NULL) {
-    return FALSE;
-  } else {
-    return TRUE;
-  }
+  Sha256Init (&Context);
+  Sha256Update (&Context, Data, DataSize);
+  Sha256Final (&Context, HashValue);
+  ZeroMem (&Context, sizeof (Context));
+
+  return TRUE;
 }
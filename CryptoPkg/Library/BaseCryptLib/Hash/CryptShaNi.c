@@ -0,0 +1,131 @@
+/** @file
+  Selects the SHA-1 and SHA-256 block functions that use the Intel SHA
+  extensions, if the processor supports them.
+
+Copyright (c) 2017, Intel Corporation. All rights reserved.<BR>
+This program and the accompanying materials
+are licensed and made available under the terms and conditions of the BSD License
+which accompanies this distribution.  The full text of the license may be found at
+http://opensource.org/licenses/bsd-license.php
+
+THE PROGRAM IS DISTRIBUTED UNDER THE BSD LICENSE ON AN "AS IS" BASIS,
+WITHOUT WARRANTIES OR REPRESENTATIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED.
+
+**/
+
+#include "InternalCryptLib.h"
+
+//
+// CPUID.01H:ECX, CPUID.(EAX=07H,ECX=0):EBX
+//
+#define CPUID_SSSE3_BIT   BIT9
+#define CPUID_SSE41_BIT   BIT19
+#define CPUID_SHA_BIT     BIT29
+
+/**
+  SHA-1 block function using the Intel SHA extensions.
+
+  @param[in, out]  State       The intermediate hash value, A first.
+  @param[in]       Data        The message blocks.
+  @param[in]       BlockCount  Number of 64-byte blocks at Data.
+
+**/
+VOID
+EFIAPI
+Sha1BlockShaNi (
+  IN OUT UINT32       *State,
+  IN     CONST UINT8  *Data,
+  IN     UINTN        BlockCount
+  );
+
+/**
+  SHA-256 block function using the Intel SHA extensions.
+
+  @param[in, out]  State       The intermediate hash value, A first.
+  @param[in]       Data        The message blocks.
+  @param[in]       BlockCount  Number of 64-byte blocks at Data.
+
+**/
+VOID
+EFIAPI
+Sha256BlockShaNi (
+  IN OUT UINT32       *State,
+  IN     CONST UINT8  *Data,
+  IN     UINTN        BlockCount
+  );
+
+//
+// Whether the processor supports the SHA extensions, along with the SSSE3 and
+// SSE4.1 instructions that the block functions use. Zero until checked.
+//
+#define SHA_NI_UNKNOWN      0
+#define SHA_NI_SUPPORTED    1
+#define SHA_NI_UNSUPPORTED  2
+
+STATIC UINT8  mShaNiSupport = SHA_NI_UNKNOWN;
+
+/**
+  Checks with CPUID whether the processor supports the SHA extensions.
+
+  @retval TRUE   The SHA block functions can be used.
+  @retval FALSE  The portable OpenSSL code has to be used.
+
+**/
+STATIC
+BOOLEAN
+IsShaNiSupported (
+  VOID
+  )
+{
+  UINT32  MaxLeaf;
+  UINT32  Ecx;
+  UINT32  Ebx;
+
+  if (mShaNiSupport == SHA_NI_UNKNOWN) {
+    mShaNiSupport = SHA_NI_UNSUPPORTED;
+
+    AsmCpuid (0, &MaxLeaf, NULL, NULL, NULL);
+    if (MaxLeaf >= 7) {
+      AsmCpuid (1, NULL, NULL, &Ecx, NULL);
+      AsmCpuidEx (7, 0, NULL, &Ebx, NULL, NULL);
+      if ((Ecx & CPUID_SSSE3_BIT) != 0 &&
+          (Ecx & CPUID_SSE41_BIT) != 0 &&
+          (Ebx & CPUID_SHA_BIT) != 0) {
+        mShaNiSupport = SHA_NI_SUPPORTED;
+      }
+    }
+  }
+
+  return (BOOLEAN) (mShaNiSupport == SHA_NI_SUPPORTED);
+}
+
+/**
+  Returns the SHA-1 block function that uses the processor's SHA instructions.
+
+  @return  The block function, or NULL if the processor lacks SHA instructions
+           and the portable OpenSSL code has to be used.
+
+**/
+SHA_BLOCK_FUNCTION
+GetSha1BlockFunction (
+  VOID
+  )
+{
+  return IsShaNiSupported () ? Sha1BlockShaNi : NULL;
+}
+
+/**
+  Returns the SHA-256 block function that uses the processor's SHA
+  instructions.
+
+  @return  The block function, or NULL if the processor lacks SHA instructions
+           and the portable OpenSSL code has to be used.
+
+**/
+SHA_BLOCK_FUNCTION
+GetSha256BlockFunction (
+  VOID
+  )
+{
+  return IsShaNiSupported () ? Sha256BlockShaNi : NULL;
+}
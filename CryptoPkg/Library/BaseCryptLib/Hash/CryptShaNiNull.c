@@ -0,0 +1,45 @@
+/** @file
+  SHA-1 and SHA-256 block function selection for processors and environments
+  where only the portable OpenSSL code is used.
+
+Copyright (c) 2017, Intel Corporation. All rights reserved.<BR>
+This program and the accompanying materials
+are licensed and made available under the terms and conditions of the BSD License
+which accompanies this distribution.  The full text of the license may be found at
+http://opensource.org/licenses/bsd-license.php
+
+THE PROGRAM IS DISTRIBUTED UNDER THE BSD LICENSE ON AN "AS IS" BASIS,
+WITHOUT WARRANTIES OR REPRESENTATIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED.
+
+**/
+
+#include "InternalCryptLib.h"
+
+/**
+  Returns the SHA-1 block function that uses the processor's SHA instructions.
+
+  @return  NULL, the portable OpenSSL code is used.
+
+**/
+SHA_BLOCK_FUNCTION
+GetSha1BlockFunction (
+  VOID
+  )
+{
+  return NULL;
+}
+
+/**
+  Returns the SHA-256 block function that uses the processor's SHA
+  instructions.
+
+  @return  NULL, the portable OpenSSL code is used.
+
+**/
+SHA_BLOCK_FUNCTION
+GetSha256BlockFunction (
+  VOID
+  )
+{
+  return NULL;
+}
@@ -1,7 +1,7 @@
 /** @file  
   Internal include file for BaseCryptLib.
 
-Copyright (c) 2010 - 2015, Intel Corporation. All rights reserved.<BR>
+Copyright (c) 2010 - 2017, Intel Corporation. All rights reserved.<BR>
 This program and the accompanying materials
 are licensed and made available under the terms and conditions of the BSD License
 which accompanies this distribution.  The full text of the license may be found at
@@ -30,5 +30,162 @@ WITHOUT WARRANTIES OR REPRESENTATIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED.
 #define OBJ_length(o) ((o)->length)
 #endif
 
+/**
+  Processes consecutive 64-byte message blocks of a SHA-1 or SHA-256 digest.
+
+  @param[in, out]  State       The intermediate hash value: five (SHA-1) or eight
+                               (SHA-256) 32-bit words, A first.
+  @param[in]       Data        The message blocks.
+  @param[in]       BlockCount  Number of 64-byte blocks at Data.
+
+**/
+typedef
+VOID
+(EFIAPI *SHA_BLOCK_FUNCTION) (
+  IN OUT UINT32       *State,
+  IN     CONST UINT8  *Data,
+  IN     UINTN        BlockCount
+  );
+
+/**
+  Returns the SHA-1 block function that uses the processor's SHA instructions.
+
+  @return  The block function, or NULL if the processor lacks SHA instructions
+           and the portable OpenSSL code has to be used.
+
+**/
+SHA_BLOCK_FUNCTION
+GetSha1BlockFunction (
+  VOID
+  );
+
+/**
+  Returns the SHA-256 block function that uses the processor's SHA
+  instructions.
+
+  @return  The block function, or NULL if the processor lacks SHA instructions
+           and the portable OpenSSL code has to be used.
+
+**/
+SHA_BLOCK_FUNCTION
+GetSha256BlockFunction (
+  VOID
+  );
+
+/**
+  Checks whether the processor supports the AES-NI and PCLMULQDQ instructions
+  that the AesNi*() and GhashClmul() functions below use.
+
+  @retval TRUE   The AesNi*() and GhashClmul() functions can be used.
+  @retval FALSE  The portable OpenSSL code has to be used.
+
+**/
+BOOLEAN
+IsAesNiSupported (
+  VOID
+  );
+
+/**
+  Encrypts or decrypts consecutive 16-byte blocks in ECB mode with AES-NI.
+
+  @param[in]   Key         The OpenSSL AES_KEY built by AES_set_encrypt_key() for
+                           AesNiEcbEncrypt(), or AES_set_decrypt_key() for
+                           AesNiEcbDecrypt().
+  @param[in]   Input       The input blocks.
+  @param[out]  Output      Receives the output blocks. May equal Input.
+  @param[in]   BlockCount  Number of blocks at Input.
+
+**/
+VOID
+EFIAPI
+AesNiEcbEncrypt (
+  IN   CONST VOID   *Key,
+  IN   CONST UINT8  *Input,
+  OUT  UINT8        *Output,
+  IN   UINTN        BlockCount
+  );
+
+VOID
+EFIAPI
+AesNiEcbDecrypt (
+  IN   CONST VOID   *Key,
+  IN   CONST UINT8  *Input,
+  OUT  UINT8        *Output,
+  IN   UINTN        BlockCount
+  );
+
+/**
+  Encrypts or decrypts consecutive 16-byte blocks in CBC mode with AES-NI.
+
+  @param[in]       Key         The OpenSSL AES_KEY built by AES_set_encrypt_key()
+                               for AesNiCbcEncrypt(), or AES_set_decrypt_key()
+                               for AesNiCbcDecrypt().
+  @param[in]       Input       The input blocks.
+  @param[out]      Output      Receives the output blocks. May equal Input.
+  @param[in]       BlockCount  Number of blocks at Input.
+  @param[in, out]  Ivec        The 16-byte initialization vector. Receives the
+                               last ciphertext block.
+
+**/
+VOID
+EFIAPI
+AesNiCbcEncrypt (
+  IN      CONST VOID   *Key,
+  IN      CONST UINT8  *Input,
+  OUT     UINT8        *Output,
+  IN      UINTN        BlockCount,
+  IN OUT  UINT8        *Ivec
+  );
+
+VOID
+EFIAPI
+AesNiCbcDecrypt (
+  IN      CONST VOID   *Key,
+  IN      CONST UINT8  *Input,
+  OUT     UINT8        *Output,
+  IN      UINTN        BlockCount,
+  IN OUT  UINT8        *Ivec
+  );
+
+/**
+  Encrypts or decrypts consecutive 16-byte blocks in CTR mode with AES-NI,
+  incrementing the last 32 bits of the counter block as GCM specifies.
+
+  @param[in]       Key         The OpenSSL AES_KEY built by AES_set_encrypt_key().
+  @param[in]       Input       The input blocks.
+  @param[out]      Output      Receives the output blocks. May equal Input.
+  @param[in]       BlockCount  Number of blocks at Input.
+  @param[in, out]  Counter     The 16-byte big endian counter block. Receives the
+                               counter block for the next block.
+
+**/
+VOID
+EFIAPI
+AesNiCtr32Encrypt (
+  IN      CONST VOID   *Key,
+  IN      CONST UINT8  *Input,
+  OUT     UINT8        *Output,
+  IN      UINTN        BlockCount,
+  IN OUT  UINT8        *Counter
+  );
+
+/**
+  Folds consecutive 16-byte blocks into a GCM GHASH value with PCLMULQDQ.
+
+  @param[in, out]  Xi          The 16-byte GHASH value.
+  @param[in]       H           The 16-byte hash key.
+  @param[in]       Input       The input blocks.
+  @param[in]       BlockCount  Number of blocks at Input.
+
+**/
+VOID
+EFIAPI
+GhashClmul (
+  IN OUT  UINT8        *Xi,
+  IN      CONST UINT8  *H,
+  IN      CONST UINT8  *Input,
+  IN      UINTN        BlockCount
+  );
+
 #endif
 
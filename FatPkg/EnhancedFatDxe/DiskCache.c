@@ -1,7 +1,7 @@
 /** @file
   Cache implementation for EFI FAT File system driver.
 
-Copyright (c) 2005 - 2013, Intel Corporation. All rights reserved.<BR>
+Copyright (c) 2005 - 2017, Intel Corporation. All rights reserved.<BR>
 This program and the accompanying materials are licensed and made available
 under the terms and conditions of the BSD License which accompanies this
 distribution. The full text of the license may be found at
@@ -14,6 +14,77 @@ WITHOUT WARRANTIES OR REPRESENTATIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED.
 
 #include "Fat.h"
 
+/**
+
+  Find the cache page holding the specified PageNo.
+
+  @param  DiskCache             - The disk cache to search.
+  @param  PageNo                - PageNo to match with the cache.
+
+  @return The Cache Tag of the cache page, or NULL if the page is not cached.
+
+**/
+STATIC
+CACHE_TAG *
+FatLookupCachePage (
+  IN DISK_CACHE         *DiskCache,
+  IN UINTN              PageNo
+  )
+{
+  LIST_ENTRY  *ListHead;
+  LIST_ENTRY  *Link;
+  CACHE_TAG   *CacheTag;
+
+  ListHead = &DiskCache->PageHashTable[PageNo & FAT_CACHE_HASH_MASK];
+  for (Link = GetFirstNode (ListHead); !IsNull (ListHead, Link); Link = GetNextNode (ListHead, Link)) {
+    CacheTag = CACHE_TAG_FROM_HASH_LINK (Link);
+    if (CacheTag->PageNo == PageNo) {
+      return CacheTag;
+    }
+  }
+
+  return NULL;
+}
+
+/**
+
+  Make the cache page the most recently used one.
+
+  @param  DiskCache             - The disk cache of the cache page.
+  @param  CacheTag              - The Cache Tag of the cache page.
+
+**/
+STATIC
+VOID
+FatTouchCachePage (
+  IN DISK_CACHE         *DiskCache,
+  IN CACHE_TAG          *CacheTag
+  )
+{
+  RemoveEntryList (&CacheTag->LruLink);
+  InsertHeadList (&DiskCache->LruList, &CacheTag->LruLink);
+}
+
+/**
+
+  Drop the content of the cache page, without writing it back.
+
+  @param  CacheTag              - The Cache Tag of the cache page.
+
+**/
+STATIC
+VOID
+FatInvalidateCachePage (
+  IN CACHE_TAG          *CacheTag
+  )
+{
+  if (CacheTag->RealSize > 0) {
+    RemoveEntryList (&CacheTag->HashLink);
+    CacheTag->RealSize  = 0;
+    CacheTag->Dirty     = FALSE;
+  }
+}
+
 /**
 
   This function is used by the Data Cache.
@@ -43,25 +114,23 @@ FatFlushDataCacheRange (
   OUT UINT8              *Buffer
   )
 {
-  UINTN       PageNo;
-  UINTN       GroupNo;
-  UINTN       GroupMask;
+  UINTN       Index;
   UINTN       PageSize;
   UINT8       PageAlignment;
   DISK_CACHE  *DiskCache;
   CACHE_TAG   *CacheTag;
-  UINT8       *BaseAddress;
 
   DiskCache     = &Volume->DiskCache[CacheData];
-  BaseAddress   = DiskCache->CacheBase;
-  GroupMask     = DiskCache->GroupMask;
   PageAlignment = DiskCache->PageAlignment;
   PageSize      = (UINTN)1 << PageAlignment;
 
-  for (PageNo = StartPageNo; PageNo < EndPageNo; PageNo++) {
-    GroupNo   = PageNo & GroupMask;
-    CacheTag  = &DiskCache->CacheTag[GroupNo];
-    if (CacheTag->RealSize > 0 && CacheTag->PageNo == PageNo) {
+  //
+  // The range may be far larger than the cache, so check the cache pages
+  // rather than the pages of the range.
+  //
+  for (Index = 0; Index < DiskCache->PageCount; Index++) {
+    CacheTag = &DiskCache->CacheTag[Index];
+    if (CacheTag->RealSize > 0 && CacheTag->PageNo >= StartPageNo && CacheTag->PageNo < EndPageNo) {
       //
       // When reading data form disk directly, if some dirty data
       // in cache is in this rang, this data in the Buffer need to
@@ -70,8 +139,8 @@ FatFlushDataCacheRange (
       if (IoMode == ReadDisk) {
         if (CacheTag->Dirty) {
           CopyMem (
-            Buffer + ((PageNo - StartPageNo) << PageAlignment),
-            BaseAddress + (GroupNo << PageAlignment),
+            Buffer + ((CacheTag->PageNo - StartPageNo) << PageAlignment),
+            CacheTag->PageAddress,
             PageSize
             );
         }
@@ -79,7 +148,7 @@ FatFlushDataCacheRange (
         //
         // Make all valid entries in this range invalid.
         //
-        CacheTag->RealSize = 0;
+        FatInvalidateCachePage (CacheTag);
       }
     }
   }
@@ -110,7 +179,6 @@ FatExchangeCachePage (
   )
 {
   EFI_STATUS  Status;
-  UINTN       GroupNo;
   UINTN       PageNo;
   UINTN       WriteCount;
   UINTN       RealSize;
@@ -122,9 +190,8 @@ FatExchangeCachePage (
 
   DiskCache     = &Volume->DiskCache[DataType];
   PageNo        = CacheTag->PageNo;
-  GroupNo       = PageNo & DiskCache->GroupMask;
   PageAlignment = DiskCache->PageAlignment;
-  PageAddress   = DiskCache->CacheBase + (GroupNo << PageAlignment);
+  PageAddress   = CacheTag->PageAddress;
   EntryPos      = DiskCache->BaseAddress + LShiftU64 (PageNo, PageAlignment);
   RealSize      = CacheTag->RealSize;
   if (IoMode == ReadDisk) {
@@ -158,14 +225,243 @@ FatExchangeCachePage (
   return EFI_SUCCESS;
 }
 
+/**
+
+  Write back the dirty cache page of the lowest PageNo, together with the
+  dirty cache pages that follow it on the disk, with one disk write.
+
+  @param  Volume                - FAT file system volume.
+  @param  DataType              - Indicate the cache type.
+  @param  CacheTag              - The Cache Tag of the first cache page to write back.
+  @param  Task                    point to task instance.
+
+  @retval EFI_SUCCESS           - The cache pages were written back successfully.
+  @return Others                - An error occurred when writing the cache pages back.
+
+**/
+STATIC
+EFI_STATUS
+FatWriteBackCachePages (
+  IN FAT_VOLUME         *Volume,
+  IN CACHE_DATA_TYPE    DataType,
+  IN CACHE_TAG          *CacheTag,
+  IN FAT_TASK           *Task
+  )
+{
+  EFI_STATUS  Status;
+  DISK_CACHE  *DiskCache;
+  CACHE_TAG   *RunTag[FAT_CACHE_RUN_PAGE_COUNT];
+  UINTN       RunCount;
+  UINTN       RunSize;
+  UINTN       PageSize;
+  UINTN       Index;
+  UINTN       WriteCount;
+  UINT64      EntryPos;
+  UINT8       *RunBuffer;
+  FAT_SUBTASK *Subtask;
+
+  DiskCache = &Volume->DiskCache[DataType];
+  PageSize  = (UINTN)1 << DiskCache->PageAlignment;
+
+  //
+  // Gather the dirty cache pages that follow each other on the disk. Only
+  // the last page of the cache range can be partial.
+  //
+  RunTag[0] = CacheTag;
+  RunCount  = 1;
+  RunSize   = CacheTag->RealSize;
+  while (RunCount < FAT_CACHE_RUN_PAGE_COUNT && RunTag[RunCount - 1]->RealSize == PageSize) {
+    CacheTag = FatLookupCachePage (DiskCache, RunTag[RunCount - 1]->PageNo + 1);
+    if (CacheTag == NULL || !CacheTag->Dirty) {
+      break;
+    }
+    RunTag[RunCount++] = CacheTag;
+    RunSize += CacheTag->RealSize;
+  }
+
+  if (RunCount == 1) {
+    return FatExchangeCachePage (Volume, DataType, WriteDisk, RunTag[0], Task);
+  }
+
+  EntryPos   = DiskCache->BaseAddress + LShiftU64 (RunTag[0]->PageNo, DiskCache->PageAlignment);
+  WriteCount = (DataType == CacheFat) ? Volume->NumFats : 1;
+  do {
+    //
+    // A non-blocking write completes after the run buffer is reused, so it
+    // writes from a copy of the pages that is freed with its subtask.
+    //
+    RunBuffer = Volume->CacheRunBuffer;
+    if (Task != NULL) {
+      RunBuffer = AllocatePool (RunSize);
+      if (RunBuffer == NULL) {
+        return EFI_OUT_OF_RESOURCES;
+      }
+    }
+    for (Index = 0; Index < RunCount; Index++) {
+      CopyMem (RunBuffer + Index * PageSize, RunTag[Index]->PageAddress, RunTag[Index]->RealSize);
+    }
+
+    Status = FatDiskIo (Volume, WriteDisk, EntryPos, RunSize, RunBuffer, Task);
+    if (EFI_ERROR (Status)) {
+      if (Task != NULL) {
+        FreePool (RunBuffer);
+      }
+      return Status;
+    }
+    if (Task != NULL) {
+      //
+      // FatDiskIo() queued the write as the last subtask of the task.
+      //
+      Subtask = CR (GetPreviousNode (&Task->Subtasks, &Task->Subtasks), FAT_SUBTASK, Link, FAT_SUBTASK_SIGNATURE);
+      Subtask->FreeBuffer = TRUE;
+    }
+
+    EntryPos += Volume->FatSize;
+  } while (--WriteCount > 0);
+
+  for (Index = 0; Index < RunCount; Index++) {
+    RunTag[Index]->Dirty = FALSE;
+  }
+
+  return EFI_SUCCESS;
+}
+
+/**
+
+  Get the least recently used cache page and make it free, writing it
+  back to disk if it is dirty.
+
+  @param  Volume                - FAT file system volume.
+  @param  CacheDataType         - The cache type: CACHE_FAT or CACHE_DATA.
+  @param  CacheTag              - Returns the Cache Tag of the free cache page.
+
+  @retval EFI_SUCCESS           - Get the free cache page successfully.
+  @return other                 - An error occurred when writing the page back.
+
+**/
+STATIC
+EFI_STATUS
+FatGetFreeCachePage (
+  IN  FAT_VOLUME         *Volume,
+  IN  CACHE_DATA_TYPE    CacheDataType,
+  OUT CACHE_TAG          **CacheTag
+  )
+{
+  EFI_STATUS  Status;
+  DISK_CACHE  *DiskCache;
+  CACHE_TAG   *Victim;
+
+  DiskCache = &Volume->DiskCache[CacheDataType];
+  Victim    = CACHE_TAG_FROM_LRU_LINK (GetPreviousNode (&DiskCache->LruList, &DiskCache->LruList));
+
+  //
+  // Write dirty cache page back to disk
+  //
+  if (Victim->RealSize > 0 && Victim->Dirty) {
+    Status = FatWriteBackCachePages (Volume, CacheDataType, Victim, NULL);
+    if (EFI_ERROR (Status)) {
+      return Status;
+    }
+  }
+
+  FatInvalidateCachePage (Victim);
+  FatTouchCachePage (DiskCache, Victim);
+  *CacheTag = Victim;
+  return EFI_SUCCESS;
+}
+
+/**
+
+  Load the data cache pages starting at PageNo with one disk read.
+
+  The pages up to FAT_CACHE_RUN_PAGE_COUNT are read, but no more than half
+  of the cache, and not beyond a page that is already cached or the end of
+  the data region.
+
+  @param  Volume                - FAT file system volume.
+  @param  PageNo                - The first PageNo to load.
+  @param  CacheTag              - Returns the Cache Tag of the cache page of PageNo.
+
+  @retval EFI_SUCCESS           - The cache pages were loaded successfully.
+  @return other                 - An error occurred when accessing data.
+
+**/
+STATIC
+EFI_STATUS
+FatReadAheadCachePages (
+  IN  FAT_VOLUME         *Volume,
+  IN  UINTN              PageNo,
+  OUT CACHE_TAG          **CacheTag
+  )
+{
+  EFI_STATUS  Status;
+  DISK_CACHE  *DiskCache;
+  CACHE_TAG   *PageTag[FAT_CACHE_RUN_PAGE_COUNT];
+  UINTN       PageSize;
+  UINTN       PageCount;
+  UINTN       MaxPageCount;
+  UINTN       ReadSize;
+  UINTN       Index;
+  UINT64      EntryPos;
+  UINT64      MaxSize;
+
+  DiskCache    = &Volume->DiskCache[CacheData];
+  PageSize     = (UINTN)1 << DiskCache->PageAlignment;
+  EntryPos     = DiskCache->BaseAddress + LShiftU64 (PageNo, DiskCache->PageAlignment);
+  MaxSize      = DiskCache->LimitAddress - EntryPos;
+  MaxPageCount = MIN (FAT_CACHE_RUN_PAGE_COUNT, DiskCache->PageCount / 2);
+
+  PageCount = 1;
+  while (PageCount < MaxPageCount &&
+         MaxSize > LShiftU64 (PageCount, DiskCache->PageAlignment) &&
+         FatLookupCachePage (DiskCache, PageNo + PageCount) == NULL) {
+    PageCount++;
+  }
+  ReadSize = PageCount << DiskCache->PageAlignment;
+  if (MaxSize < ReadSize) {
+    ReadSize = (UINTN) MaxSize;
+  }
+
+  //
+  // Free the pages before the read, as writing dirty pages back uses the
+  // run buffer too. Free them from the last one, so that the page of PageNo
+  // ends up the most recently used.
+  //
+  for (Index = PageCount; Index-- > 0;) {
+    Status = FatGetFreeCachePage (Volume, CacheData, &PageTag[Index]);
+    if (EFI_ERROR (Status)) {
+      return Status;
+    }
+  }
+
+  Status = FatDiskIo (Volume, ReadDisk, EntryPos, ReadSize, Volume->CacheRunBuffer, NULL);
+  if (EFI_ERROR (Status)) {
+    return Status;
+  }
+
+  for (Index = 0; Index < PageCount; Index++) {
+    PageTag[Index]->PageNo   = PageNo + Index;
+    PageTag[Index]->RealSize = MIN (PageSize, ReadSize - Index * PageSize);
+    CopyMem (PageTag[Index]->PageAddress, Volume->CacheRunBuffer + Index * PageSize, PageTag[Index]->RealSize);
+    InsertTailList (&DiskCache->PageHashTable[PageTag[Index]->PageNo & FAT_CACHE_HASH_MASK], &PageTag[Index]->HashLink);
+  }
+
+  *CacheTag = PageTag[0];
+  return EFI_SUCCESS;
+}
+
 /**
 
   Get one cache page by specified PageNo.
 
+  A miss of the data cache while reading the page that follows the page
+  read last loads the next pages as well.
+
   @param  Volume                - FAT file system volume.
   @param  CacheDataType         - The cache type: CACHE_FAT or CACHE_DATA.
+  @param  IoMode                - Indicate the type of disk access.
   @param  PageNo                - PageNo to match with the cache.
-  @param  CacheTag              - The Cache Tag for the current cache page.
+  @param  CacheTag              - Returns the Cache Tag for the current cache page.
 
   @retval EFI_SUCCESS           - Get the cache page successfully.
   @return other                 - An error occurred when accessing data.
@@ -174,39 +470,50 @@ FatExchangeCachePage (
 STATIC
 EFI_STATUS
 FatGetCachePage (
-  IN FAT_VOLUME         *Volume,
-  IN CACHE_DATA_TYPE    CacheDataType,
-  IN UINTN              PageNo,
-  IN CACHE_TAG          *CacheTag
+  IN  FAT_VOLUME         *Volume,
+  IN  CACHE_DATA_TYPE    CacheDataType,
+  IN  IO_MODE            IoMode,
+  IN  UINTN              PageNo,
+  OUT CACHE_TAG          **CacheTag
   )
 {
   EFI_STATUS  Status;
-  UINTN       OldPageNo;
+  DISK_CACHE  *DiskCache;
+  CACHE_TAG   *PageTag;
 
-  OldPageNo = CacheTag->PageNo;
-  if (CacheTag->RealSize > 0 && OldPageNo == PageNo) {
+  DiskCache = &Volume->DiskCache[CacheDataType];
+  PageTag   = FatLookupCachePage (DiskCache, PageNo);
+  if (PageTag != NULL) {
     //
     // Cache Hit occurred
     //
+    FatTouchCachePage (DiskCache, PageTag);
+    *CacheTag = PageTag;
     return EFI_SUCCESS;
   }
 
-  //
-  // Write dirty cache page back to disk
-  //
-  if (CacheTag->RealSize > 0 && CacheTag->Dirty) {
-    Status = FatExchangeCachePage (Volume, CacheDataType, WriteDisk, CacheTag, NULL);
-    if (EFI_ERROR (Status)) {
-      return Status;
-    }
+  if (CacheDataType == CacheData && IoMode == ReadDisk && PageNo == DiskCache->LastReadPageNo + 1) {
+    return FatReadAheadCachePages (Volume, PageNo, CacheTag);
   }
+
+  Status = FatGetFreeCachePage (Volume, CacheDataType, &PageTag);
+  if (EFI_ERROR (Status)) {
+    return Status;
+  }
+
   //
   // Load new data from disk;
   //
-  CacheTag->PageNo  = PageNo;
-  Status            = FatExchangeCachePage (Volume, CacheDataType, ReadDisk, CacheTag, NULL);
+  PageTag->PageNo = PageNo;
+  Status          = FatExchangeCachePage (Volume, CacheDataType, ReadDisk, PageTag, NULL);
+  if (EFI_ERROR (Status)) {
+    PageTag->RealSize = 0;
+    return Status;
+  }
 
-  return Status;
+  InsertTailList (&DiskCache->PageHashTable[PageNo & FAT_CACHE_HASH_MASK], &PageTag->HashLink);
+  *CacheTag = PageTag;
+  return EFI_SUCCESS;
 }
 
 /**
@@ -243,14 +550,11 @@ FatAccessUnalignedCachePage (
   VOID        *Destination;
   DISK_CACHE  *DiskCache;
   CACHE_TAG   *CacheTag;
-  UINTN       GroupNo;
 
   DiskCache = &Volume->DiskCache[CacheDataType];
-  GroupNo   = PageNo & DiskCache->GroupMask;
-  CacheTag  = &DiskCache->CacheTag[GroupNo];
-  Status    = FatGetCachePage (Volume, CacheDataType, PageNo, CacheTag);
+  Status    = FatGetCachePage (Volume, CacheDataType, IoMode, PageNo, &CacheTag);
   if (!EFI_ERROR (Status)) {
-    Source      = DiskCache->CacheBase + (GroupNo << DiskCache->PageAlignment) + Offset;
+    Source      = CacheTag->PageAddress + Offset;
     Destination = Buffer;
     if (IoMode != ReadDisk) {
       CacheTag->Dirty   = TRUE;
@@ -265,6 +569,49 @@ FatAccessUnalignedCachePage (
   return Status;
 }
 
+/**
+
+  Write back the dirty pages of the Data cache in the range.
+
+  A non-blocking read from the disk fills the user buffer after the dirty
+  cache data could be copied into it, so the dirty cache pages in its range
+  are written back before the read is issued.
+
+  @param  Volume                - FAT file system volume.
+  @param  StartPageNo           - First PageNo to be checked in the cache.
+  @param  EndPageNo             - Last PageNo to be checked in the cache.
+
+  @retval EFI_SUCCESS           - The dirty cache pages were written back successfully.
+  @return Others                - An error occurred when writing the cache pages back.
+
+**/
+STATIC
+EFI_STATUS
+FatWriteBackDataCacheRange (
+  IN FAT_VOLUME         *Volume,
+  IN UINTN              StartPageNo,
+  IN UINTN              EndPageNo
+  )
+{
+  EFI_STATUS  Status;
+  UINTN       Index;
+  DISK_CACHE  *DiskCache;
+  CACHE_TAG   *CacheTag;
+
+  DiskCache = &Volume->DiskCache[CacheData];
+  for (Index = 0; Index < DiskCache->PageCount; Index++) {
+    CacheTag = &DiskCache->CacheTag[Index];
+    if (CacheTag->Dirty && CacheTag->PageNo >= StartPageNo && CacheTag->PageNo < EndPageNo) {
+      Status = FatWriteBackCachePages (Volume, CacheData, CacheTag, NULL);
+      if (EFI_ERROR (Status)) {
+        return Status;
+      }
+    }
+  }
+
+  return EFI_SUCCESS;
+}
+
 /**
 
   Read BufferSize bytes from the position of Offset into Buffer,
@@ -279,7 +626,9 @@ FatAccessUnalignedCachePage (
   2. Access of Data cache (CACHE_DATA):
      The access data will be divided into UnderRun data, Aligned data and OverRun data;
      The UnderRun data and OverRun data will be accessed by the Data cache,
-     but the Aligned data will be accessed with disk directly.
+     but the Aligned data will be accessed with disk directly. A non-blocking
+     access of the Aligned data is divided into subtasks of at most
+     FAT_SUBTASK_MAX_SIZE bytes, which the disk can serve in parallel.
 
   @param  Volume                - FAT file system volume.
   @param  CacheDataType         - The type of cache: CACHE_DATA or CACHE_FAT.
@@ -311,6 +660,7 @@ FatAccessCache (
   UINTN       OverRun;
   UINTN       AlignedSize;
   UINTN       Length;
+  UINTN       IoSize;
   UINTN       PageNo;
   UINTN       AlignedPageCount;
   UINTN       OverRunPageNo;
@@ -339,6 +689,9 @@ FatAccessCache (
       return Status;
     }
 
+    if (IoMode == ReadDisk) {
+      DiskCache->LastReadPageNo = PageNo;
+    }
     Buffer     += Length;
     BufferSize -= Length;
     PageNo++;
@@ -357,15 +710,32 @@ FatAccessCache (
 
     EntryPos    = Volume->RootPos + LShiftU64 (PageNo, PageAlignment);
     AlignedSize = AlignedPageCount << PageAlignment;
-    Status      = FatDiskIo (Volume, IoMode, EntryPos, AlignedSize, Buffer, Task);
-    if (EFI_ERROR (Status)) {
-      return Status;
+    if (IoMode == ReadDisk && Task != NULL) {
+      Status = FatWriteBackDataCacheRange (Volume, PageNo, OverRunPageNo);
+      if (EFI_ERROR (Status)) {
+        return Status;
+      }
+    }
+
+    for (Length = 0; Length < AlignedSize; Length += IoSize) {
+      IoSize = AlignedSize - Length;
+      if (Task != NULL && IoSize > FAT_SUBTASK_MAX_SIZE) {
+        IoSize = FAT_SUBTASK_MAX_SIZE;
+      }
+
+      Status = FatDiskIo (Volume, IoMode, EntryPos + Length, IoSize, Buffer + Length, Task);
+      if (EFI_ERROR (Status)) {
+        return Status;
+      }
     }
     //
     // If these access data over laps the relative cache range, these cache pages need
     // to be updated.
     //
     FatFlushDataCacheRange (Volume, IoMode, PageNo, OverRunPageNo, Buffer);
+    if (IoMode == ReadDisk) {
+      DiskCache->LastReadPageNo = OverRunPageNo - 1;
+    }
     Buffer      += AlignedSize;
     BufferSize  -= AlignedSize;
   }
@@ -378,6 +748,9 @@ FatAccessCache (
     // Last read is not a complete page
     //
     Status = FatAccessUnalignedCachePage (Volume, CacheDataType, IoMode, OverRunPageNo, 0, OverRun, Buffer);
+    if (!EFI_ERROR (Status) && IoMode == ReadDisk) {
+      DiskCache->LastReadPageNo = OverRunPageNo;
+    }
   }
 
   return Status;
@@ -387,6 +760,10 @@ FatAccessCache (
 
   Flush all the dirty cache back, include the FAT cache and the Data cache.
 
+  The dirty cache pages are written back in the order of their location on
+  the disk, and the dirty cache pages that follow each other on the disk are
+  written back with one disk write.
+
   @param  Volume                - FAT file system volume.
   @param  Task                    point to task instance.
 
@@ -402,10 +779,10 @@ FatVolumeFlushCache (
 {
   EFI_STATUS      Status;
   CACHE_DATA_TYPE CacheDataType;
-  UINTN           GroupIndex;
-  UINTN           GroupMask;
+  UINTN           Index;
   DISK_CACHE      *DiskCache;
   CACHE_TAG       *CacheTag;
+  CACHE_TAG       *FirstTag;
 
   for (CacheDataType = (CACHE_DATA_TYPE) 0; CacheDataType < CacheMaxType; CacheDataType++) {
     DiskCache = &Volume->DiskCache[CacheDataType];
@@ -413,19 +790,26 @@ FatVolumeFlushCache (
       //
       // Data cache or fat cache is dirty, write the dirty data back
       //
-      GroupMask = DiskCache->GroupMask;
-      for (GroupIndex = 0; GroupIndex <= GroupMask; GroupIndex++) {
-        CacheTag = &DiskCache->CacheTag[GroupIndex];
-        if (CacheTag->RealSize > 0 && CacheTag->Dirty) {
+      do {
+        FirstTag = NULL;
+        for (Index = 0; Index < DiskCache->PageCount; Index++) {
+          CacheTag = &DiskCache->CacheTag[Index];
+          if (CacheTag->RealSize > 0 && CacheTag->Dirty &&
+              (FirstTag == NULL || CacheTag->PageNo < FirstTag->PageNo)) {
+            FirstTag = CacheTag;
+          }
+        }
+
+        if (FirstTag != NULL) {
           //
-          // Write back all Dirty Data Cache Page to disk
+          // Write back the Dirty Cache Pages to disk
           //
-          Status = FatExchangeCachePage (Volume, CacheDataType, WriteDisk, CacheTag, Task);
+          Status = FatWriteBackCachePages (Volume, CacheDataType, FirstTag, Task);
           if (EFI_ERROR (Status)) {
             return Status;
           }
         }
-      }
+      } while (FirstTag != NULL);
 
       DiskCache->Dirty = FALSE;
     }
@@ -452,44 +836,63 @@ FatInitializeDiskCache (
   IN FAT_VOLUME         *Volume
   )
 {
-  DISK_CACHE  *DiskCache;
-  UINTN       FatCacheGroupCount;
-  UINTN       DataCacheSize;
-  UINTN       FatCacheSize;
-  UINT8       *CacheBuffer;
+  DISK_CACHE      *DiskCache;
+  CACHE_DATA_TYPE CacheDataType;
+  UINTN           Index;
+  UINTN           DataCacheSize;
+  UINTN           FatCacheSize;
+  UINTN           RunBufferSize;
+  UINT8           *CacheBuffer;
 
   DiskCache = Volume->DiskCache;
   //
   // Configure the parameters of disk cache
   //
   if (Volume->FatType == Fat12) {
-    FatCacheGroupCount                  = FAT_FATCACHE_GROUP_MIN_COUNT;
+    DiskCache[CacheFat].PageCount      = FAT_FATCACHE_PAGE_MIN_COUNT;
     DiskCache[CacheFat].PageAlignment  = FAT_FATCACHE_PAGE_MIN_ALIGNMENT;
     DiskCache[CacheData].PageAlignment = FAT_DATACACHE_PAGE_MIN_ALIGNMENT;
   } else {
-    FatCacheGroupCount                  = FAT_FATCACHE_GROUP_MAX_COUNT;
+    DiskCache[CacheFat].PageCount      = FAT_FATCACHE_PAGE_MAX_COUNT;
     DiskCache[CacheFat].PageAlignment  = FAT_FATCACHE_PAGE_MAX_ALIGNMENT;
     DiskCache[CacheData].PageAlignment = FAT_DATACACHE_PAGE_MAX_ALIGNMENT;
   }
 
-  DiskCache[CacheData].GroupMask     = FAT_DATACACHE_GROUP_COUNT - 1;
+  DiskCache[CacheData].PageCount     = FAT_DATACACHE_PAGE_COUNT;
   DiskCache[CacheData].BaseAddress   = Volume->RootPos;
   DiskCache[CacheData].LimitAddress  = Volume->VolumeSize;
-  DiskCache[CacheFat].GroupMask      = FatCacheGroupCount - 1;
   DiskCache[CacheFat].BaseAddress    = Volume->FatPos;
   DiskCache[CacheFat].LimitAddress   = Volume->FatPos + Volume->FatSize;
-  FatCacheSize                        = FatCacheGroupCount << DiskCache[CacheFat].PageAlignment;
-  DataCacheSize                       = FAT_DATACACHE_GROUP_COUNT << DiskCache[CacheData].PageAlignment;
+  FatCacheSize                        = DiskCache[CacheFat].PageCount << DiskCache[CacheFat].PageAlignment;
+  DataCacheSize                       = DiskCache[CacheData].PageCount << DiskCache[CacheData].PageAlignment;
+  RunBufferSize                       = FAT_CACHE_RUN_PAGE_COUNT << DiskCache[CacheData].PageAlignment;
   //
   // Allocate the Fat Cache buffer
   //
-  CacheBuffer = AllocateZeroPool (FatCacheSize + DataCacheSize);
+  CacheBuffer = AllocateZeroPool (FatCacheSize + DataCacheSize + RunBufferSize);
   if (CacheBuffer == NULL) {
     return EFI_OUT_OF_RESOURCES;
   }
 
   Volume->CacheBuffer             = CacheBuffer;
+  Volume->CacheRunBuffer          = CacheBuffer + FatCacheSize + DataCacheSize;
   DiskCache[CacheFat].CacheBase  = CacheBuffer;
   DiskCache[CacheData].CacheBase = CacheBuffer + FatCacheSize;
+
+  //
+  // All the cache pages start free, in the LRU list but not in the hash table.
+  //
+  for (CacheDataType = (CACHE_DATA_TYPE) 0; CacheDataType < CacheMaxType; CacheDataType++) {
+    InitializeListHead (&DiskCache[CacheDataType].LruList);
+    for (Index = 0; Index < FAT_CACHE_HASH_TABLE_SIZE; Index++) {
+      InitializeListHead (&DiskCache[CacheDataType].PageHashTable[Index]);
+    }
+    for (Index = 0; Index < DiskCache[CacheDataType].PageCount; Index++) {
+      DiskCache[CacheDataType].CacheTag[Index].PageAddress = DiskCache[CacheDataType].CacheBase +
+                                                             (Index << DiskCache[CacheDataType].PageAlignment);
+      InsertTailList (&DiskCache[CacheDataType].LruList, &DiskCache[CacheDataType].CacheTag[Index].LruLink);
+    }
+  }
+
   return EFI_SUCCESS;
 }
@@ -86,9 +86,43 @@ WITHOUT WARRANTIES OR REPRESENTATIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED.
 #define FAT_FATCACHE_PAGE_MAX_ALIGNMENT   15
 #define FAT_DATACACHE_PAGE_MIN_ALIGNMENT  13
 #define FAT_DATACACHE_PAGE_MAX_ALIGNMENT  16
-#define FAT_DATACACHE_GROUP_COUNT         64
-#define FAT_FATCACHE_GROUP_MIN_COUNT      1
-#define FAT_FATCACHE_GROUP_MAX_COUNT      16
+#define FAT_DATACACHE_PAGE_COUNT          64
+#define FAT_FATCACHE_PAGE_MIN_COUNT       1
+#define FAT_FATCACHE_PAGE_MAX_COUNT       16
+
+//
+// Sequential reads of the data cache load up to FAT_CACHE_RUN_PAGE_COUNT
+// pages ahead with one disk read, and dirty pages of consecutive disk
+// locations are written back with one disk write of up to as many pages.
+// The cache pages are looked up through a hash table of
+// FAT_CACHE_HASH_TABLE_SIZE entries.
+//
+#define FAT_CACHE_RUN_PAGE_COUNT          8
+#define FAT_CACHE_HASH_TABLE_SIZE         32
+#define FAT_CACHE_HASH_MASK               (FAT_CACHE_HASH_TABLE_SIZE - 1)
+
+//
+// Non-blocking file data accesses are divided into disk accesses of at most
+// FAT_SUBTASK_MAX_SIZE bytes, so that the disk can serve them in parallel.
+// It is a multiple of the data cache page size.
+//
+#define FAT_SUBTASK_MAX_SIZE              SIZE_1MB
+
+//
+// The free cluster bitmap has one bit per FAT entry, set if the cluster is
+// free. Volumes whose bitmap would be larger than FAT_FREE_BITMAP_MAX_SIZE
+// have none. The bitmap is filled one FAT chunk at a time, when the search
+// for a free cluster first reaches the chunk, and the search for a run of
+// free clusters gives up FAT_FREE_BITMAP_RUN_WINDOW chunks past the first
+// free cluster.
+//
+#define FAT_FREE_BITMAP_MAX_SIZE          SIZE_4MB
+#define FAT_FREE_BITMAP_CHUNK_SIZE        SIZE_4KB
+#define FAT_FREE_BITMAP_RUN_WINDOW        4
+#define FAT_FREE_BITMAP_SIZE(a)           (((a) + 7) >> 3)
+#define FAT_FREE_BITMAP_TEST(b, a)        (((b)[(a) >> 3] & (1 << ((a) & 7))) != 0)
+#define FAT_FREE_BITMAP_SET(b, a)         ((b)[(a) >> 3] |= (UINT8) (1 << ((a) & 7)))
+#define FAT_FREE_BITMAP_CLEAR(b, a)       ((b)[(a) >> 3] &= (UINT8) ~(1 << ((a) & 7)))
 
 //
 // Used in 8.3 generation algorithm
@@ -149,20 +183,29 @@ typedef enum {
 //
 // Disk cache tag
 //
+#define CACHE_TAG_FROM_LRU_LINK(a)   BASE_CR (a, CACHE_TAG, LruLink)
+#define CACHE_TAG_FROM_HASH_LINK(a)  BASE_CR (a, CACHE_TAG, HashLink)
+
 typedef struct {
-  UINTN   PageNo;
-  UINTN   RealSize;
-  BOOLEAN Dirty;
+  LIST_ENTRY  LruLink;        // Linked in DISK_CACHE.LruList, most recently used first
+  LIST_ENTRY  HashLink;       // Linked in DISK_CACHE.PageHashTable when RealSize > 0
+  UINT8       *PageAddress;
+  UINTN       PageNo;
+  UINTN       RealSize;
+  BOOLEAN     Dirty;
 } CACHE_TAG;
 
 typedef struct {
-  UINT64    BaseAddress;
-  UINT64    LimitAddress;
-  UINT8     *CacheBase;
-  BOOLEAN   Dirty;
-  UINT8     PageAlignment;
-  UINTN     GroupMask;
-  CACHE_TAG CacheTag[FAT_DATACACHE_GROUP_COUNT];
+  UINT64      BaseAddress;
+  UINT64      LimitAddress;
+  UINT8       *CacheBase;
+  BOOLEAN     Dirty;
+  UINT8       PageAlignment;
+  UINTN       PageCount;
+  CACHE_TAG   CacheTag[FAT_DATACACHE_PAGE_COUNT];
+  LIST_ENTRY  LruList;
+  LIST_ENTRY  PageHashTable[FAT_CACHE_HASH_TABLE_SIZE];
+  UINTN       LastReadPageNo; // Last page read, to detect sequential reads
 } DISK_CACHE;
 
 //
@@ -232,6 +275,7 @@ typedef struct {
   UINT64              Offset;
   VOID                *Buffer;
   UINTN               BufferSize;
+  BOOLEAN             FreeBuffer;             // Buffer is pool owned by the subtask
   LIST_ENTRY          Link;
 } FAT_SUBTASK;
 
@@ -341,6 +385,10 @@ struct _FAT_VOLUME {
   FAT_INFO_SECTOR                 FatInfoSector;  // Free cluster info
   UINTN                           FreeInfoPos;    // Pos with the free cluster info
   BOOLEAN                         FreeInfoValid;  // If free cluster info is valid
+  UINT8                           *FreeClusterBitmap;       // One bit set per free cluster of the scanned chunks
+  UINT8                           *FreeClusterScanned;      // One bit set per scanned FAT chunk, follows the bitmap
+  UINTN                           FreeClusterChunkEntries;  // The number of FAT entries in a chunk
+  BOOLEAN                         FreeClusterBitmapFailed;  // If the free cluster bitmap cannot be used
   //
   // Unpacked Fat BPB info
   //
@@ -380,6 +428,7 @@ struct _FAT_VOLUME {
   // Disk Cache for this volume
   //
   VOID                            *CacheBuffer;
+  UINT8                           *CacheRunBuffer; // Gathers the pages read ahead or written back together
   DISK_CACHE                      DiskCache[CacheMaxType];
 };
 
@@ -1,7 +1,7 @@
 /** @file
   Routines dealing with disk spaces and FAT table entries.
 
-Copyright (c) 2005 - 2013, Intel Corporation. All rights reserved.<BR>
+Copyright (c) 2005 - 2017, Intel Corporation. All rights reserved.<BR>
 This program and the accompanying materials are licensed and made available
 under the terms and conditions of the BSD License which accompanies this
 distribution. The full text of the license may be found at
@@ -171,6 +171,18 @@ FatSetFatEntry (
       Volume->FatInfoSector.FreeInfo.ClusterCount -= 1;
     }
   }
+
+  //
+  // Chunks not scanned yet pick the change up when they are read.
+  //
+  if (Volume->FreeClusterBitmap != NULL && Index <= Volume->MaxCluster + 1 &&
+      FAT_FREE_BITMAP_TEST (Volume->FreeClusterScanned, Index / Volume->FreeClusterChunkEntries)) {
+    if (Value == FAT_CLUSTER_FREE) {
+      FAT_FREE_BITMAP_SET (Volume->FreeClusterBitmap, Index);
+    } else {
+      FAT_FREE_BITMAP_CLEAR (Volume->FreeClusterBitmap, Index);
+    }
+  }
   //
   // Make sure the entry is in memory
   //
@@ -262,11 +274,261 @@ FatFreeClusters (
   return EFI_SUCCESS;
 }
 
+/**
+
+  Free the free cluster bitmap of the volume after an error, so that
+  clusters are allocated by scanning the FAT again.
+
+  @param  Volume                - FAT file system volume.
+
+**/
+STATIC
+VOID
+FatDropFreeClusterBitmap (
+  IN FAT_VOLUME       *Volume
+  )
+{
+  if (Volume->FreeClusterBitmap != NULL) {
+    FreePool (Volume->FreeClusterBitmap);
+    Volume->FreeClusterBitmap  = NULL;
+    Volume->FreeClusterScanned = NULL;
+  }
+  Volume->FreeClusterBitmapFailed = TRUE;
+}
+
+/**
+
+  Get the free cluster bitmap of the volume, allocating it on first use.
+  The bitmap is filled one FAT chunk at a time, when the chunk is first
+  searched for a free cluster.
+
+  @param  Volume                - FAT file system volume.
+
+  @return The free cluster bitmap, or NULL if the volume has none.
+
+**/
+STATIC
+UINT8 *
+FatGetFreeClusterBitmap (
+  IN FAT_VOLUME       *Volume
+  )
+{
+  UINTN       EntryCount;
+  UINTN       ChunkCount;
+
+  if (Volume->FreeClusterBitmap == NULL && !Volume->FreeClusterBitmapFailed) {
+    EntryCount = Volume->MaxCluster + 2;
+    if (FAT_FREE_BITMAP_SIZE (EntryCount) > FAT_FREE_BITMAP_MAX_SIZE) {
+      Volume->FreeClusterBitmapFailed = TRUE;
+      return NULL;
+    }
+
+    //
+    // FAT12 tables are small and their entries straddle bytes, so they are
+    // scanned as a single chunk.
+    //
+    switch (Volume->FatType) {
+    case Fat12:
+      Volume->FreeClusterChunkEntries = EntryCount;
+      break;
+
+    case Fat16:
+      Volume->FreeClusterChunkEntries = FAT_FREE_BITMAP_CHUNK_SIZE / sizeof (UINT16);
+      break;
+
+    default:
+      Volume->FreeClusterChunkEntries = FAT_FREE_BITMAP_CHUNK_SIZE / sizeof (UINT32);
+    }
+    ChunkCount = (EntryCount + Volume->FreeClusterChunkEntries - 1) / Volume->FreeClusterChunkEntries;
+
+    //
+    // The scanned chunk bitmap follows the free cluster bitmap.
+    //
+    Volume->FreeClusterBitmap = AllocateZeroPool (FAT_FREE_BITMAP_SIZE (EntryCount) + FAT_FREE_BITMAP_SIZE (ChunkCount));
+    if (Volume->FreeClusterBitmap == NULL) {
+      Volume->FreeClusterBitmapFailed = TRUE;
+      return NULL;
+    }
+    Volume->FreeClusterScanned = Volume->FreeClusterBitmap + FAT_FREE_BITMAP_SIZE (EntryCount);
+  }
+
+  return Volume->FreeClusterBitmap;
+}
+
+/**
+
+  Fill the free cluster bitmap for the FAT chunk that holds a cluster, if
+  the chunk has not been scanned yet. FAT16 and FAT32 chunks are read at
+  once through the FAT cache.
+
+  @param  Volume                - FAT file system volume.
+  @param  Cluster               - A cluster of the chunk.
+
+  @retval EFI_SUCCESS           - The bitmap is filled for the chunk.
+  @retval EFI_OUT_OF_RESOURCES  - Out of memory.
+  @return other                 - An error occurred when reading the FAT.
+
+**/
+STATIC
+EFI_STATUS
+FatScanFreeClusterChunk (
+  IN FAT_VOLUME       *Volume,
+  IN UINTN            Cluster
+  )
+{
+  EFI_STATUS  Status;
+  VOID        *Chunk;
+  UINTN       ChunkIndex;
+  UINTN       Start;
+  UINTN       Count;
+  UINTN       Index;
+  UINTN       Value;
+
+  ChunkIndex = Cluster / Volume->FreeClusterChunkEntries;
+  if (FAT_FREE_BITMAP_TEST (Volume->FreeClusterScanned, ChunkIndex)) {
+    return EFI_SUCCESS;
+  }
+
+  Start = ChunkIndex * Volume->FreeClusterChunkEntries;
+  Count = MIN (Volume->FreeClusterChunkEntries, Volume->MaxCluster + 2 - Start);
+  if (Volume->FatType == Fat12) {
+    for (Index = MAX (Start, FAT_MIN_CLUSTER); Index < Start + Count; Index++) {
+      if (FatGetFatEntry (Volume, Index) == FAT_CLUSTER_FREE) {
+        FAT_FREE_BITMAP_SET (Volume->FreeClusterBitmap, Index);
+      }
+    }
+    if (Volume->DiskError) {
+      return EFI_DEVICE_ERROR;
+    }
+  } else {
+    Chunk = AllocatePool (FAT_FREE_BITMAP_CHUNK_SIZE);
+    if (Chunk == NULL) {
+      return EFI_OUT_OF_RESOURCES;
+    }
+
+    if (Volume->FatType == Fat16) {
+      Status = FatDiskIo (Volume, ReadFat, Volume->FatPos + Start * sizeof (UINT16), Count * sizeof (UINT16), Chunk, NULL);
+    } else {
+      Status = FatDiskIo (Volume, ReadFat, Volume->FatPos + Start * sizeof (UINT32), Count * sizeof (UINT32), Chunk, NULL);
+    }
+    if (EFI_ERROR (Status)) {
+      FreePool (Chunk);
+      return Status;
+    }
+
+    for (Index = 0; Index < Count; Index++) {
+      if (Volume->FatType == Fat16) {
+        Value = ((UINT16 *) Chunk)[Index];
+      } else {
+        Value = ((UINT32 *) Chunk)[Index] & FAT_CLUSTER_MASK_FAT32;
+      }
+      if (Value == FAT_CLUSTER_FREE && Start + Index >= FAT_MIN_CLUSTER) {
+        FAT_FREE_BITMAP_SET (Volume->FreeClusterBitmap, Start + Index);
+      }
+    }
+    FreePool (Chunk);
+  }
+
+  FAT_FREE_BITMAP_SET (Volume->FreeClusterScanned, ChunkIndex);
+  return EFI_SUCCESS;
+}
+
+/**
+
+  Search the free cluster bitmap for a run of free clusters, filling the
+  bitmap for the FAT chunks on the way.
+
+  The search for a run stops FAT_FREE_BITMAP_RUN_WINDOW chunks after the
+  first free cluster, so that a fragmented volume is not scanned to the end
+  of the FAT for a run it doesn't have.
+
+  @param  Volume                - FAT file system volume.
+  @param  Start                 - The first cluster to search.
+  @param  End                   - The cluster to stop the search at.
+  @param  RunLength             - The number of free clusters wanted in a row.
+  @param  FirstFree             - Set to the first free cluster found if it is 0.
+  @param  Cluster               - The first cluster of the run, or 0 if there
+                                  is no such run.
+
+  @retval EFI_SUCCESS           - The search is done.
+  @return other                 - An error occurred when reading the FAT.
+
+**/
+STATIC
+EFI_STATUS
+FatFindFreeClusterRun (
+  IN     FAT_VOLUME   *Volume,
+  IN     UINTN        Start,
+  IN     UINTN        End,
+  IN     UINTN        RunLength,
+  IN OUT UINTN        *FirstFree,
+     OUT UINTN        *Cluster
+  )
+{
+  EFI_STATUS  Status;
+  UINT8       *Bitmap;
+  UINTN       Index;
+  UINTN       Run;
+  UINTN       ChunkEnd;
+  UINTN       WindowEnd;
+
+  Bitmap    = Volume->FreeClusterBitmap;
+  Run       = 0;
+  ChunkEnd  = 0;
+  WindowEnd = End;
+  *Cluster  = 0;
+  for (Index = Start; Index < End && Index < WindowEnd;) {
+    if (Index >= ChunkEnd) {
+      Status = FatScanFreeClusterChunk (Volume, Index);
+      if (EFI_ERROR (Status)) {
+        return Status;
+      }
+      ChunkEnd = (Index / Volume->FreeClusterChunkEntries + 1) * Volume->FreeClusterChunkEntries;
+    }
+
+    if ((Index & 7) == 0 && Bitmap[Index >> 3] == 0) {
+      //
+      // Skip eight allocated clusters at once. Chunks hold a multiple of
+      // eight entries, so this never skips a chunk boundary.
+      //
+      Run    = 0;
+      Index += 8;
+      continue;
+    }
+
+    if (FAT_FREE_BITMAP_TEST (Bitmap, Index)) {
+      if (*FirstFree == 0) {
+        *FirstFree = Index;
+        WindowEnd  = Index + FAT_FREE_BITMAP_RUN_WINDOW * Volume->FreeClusterChunkEntries;
+      }
+      Run++;
+      if (Run >= RunLength) {
+        *Cluster = Index + 1 - Run;
+        return EFI_SUCCESS;
+      }
+    } else {
+      Run = 0;
+    }
+    Index++;
+  }
+
+  return EFI_SUCCESS;
+}
+
 /**
 
   Allocate a free cluster and return the cluster index.
 
+  When the volume has a free cluster bitmap, the cluster Hint is taken if it
+  is free, so that a growing file stays contiguous. Otherwise the search
+  starts at the NextCluster hint of the FSInfo sector, and the first free
+  cluster of a run of RunLength free clusters is taken, or the first free
+  cluster if there is no such run nearby. The FAT is read into the bitmap
+  only as far as the search goes.
+
   @param  Volume                - FAT file system volume.
+  @param  Hint                  - The preferred cluster.
+  @param  RunLength             - The number of clusters still to allocate.
 
   @return The index of the free cluster
 
@@ -274,10 +536,17 @@ FatFreeClusters (
 STATIC
 UINTN
 FatAllocateCluster (
-  IN FAT_VOLUME   *Volume
+  IN FAT_VOLUME   *Volume,
+  IN UINTN        Hint,
+  IN UINTN        RunLength
   )
 {
-  UINTN Cluster;
+  EFI_STATUS  Status;
+  UINTN       Cluster;
+  UINTN       FirstFree;
+  UINTN       Start;
+  UINTN       End;
+  UINT8       *Bitmap;
 
   //
   // Start looking at FatFreePos for the next unallocated cluster
@@ -286,6 +555,59 @@ FatAllocateCluster (
     return (UINTN) FAT_CLUSTER_LAST;
   }
 
+  Bitmap = FatGetFreeClusterBitmap (Volume);
+  if (Bitmap != NULL) {
+    End     = Volume->MaxCluster + 2;
+    Cluster = 0;
+    Status  = EFI_SUCCESS;
+    if (Hint >= FAT_MIN_CLUSTER && Hint < End) {
+      Status = FatScanFreeClusterChunk (Volume, Hint);
+      if (!EFI_ERROR (Status) && FAT_FREE_BITMAP_TEST (Bitmap, Hint)) {
+        Cluster = Hint;
+      }
+    }
+
+    if (!EFI_ERROR (Status) && Cluster == 0) {
+      Start = Volume->FatInfoSector.FreeInfo.NextCluster;
+      if (Start < FAT_MIN_CLUSTER || Start > End) {
+        Start = FAT_MIN_CLUSTER;
+      }
+
+      FirstFree = 0;
+      Status    = FatFindFreeClusterRun (Volume, Start, End, RunLength, &FirstFree, &Cluster);
+      if (!EFI_ERROR (Status) && FirstFree == 0) {
+        //
+        // Wrap around only if there is no free cluster past the hint.
+        //
+        Status = FatFindFreeClusterRun (Volume, FAT_MIN_CLUSTER, Start, RunLength, &FirstFree, &Cluster);
+      }
+      if (Cluster == 0) {
+        Cluster = FirstFree;
+      }
+    }
+
+    if (!EFI_ERROR (Status)) {
+      if (Cluster == 0) {
+        return (UINTN) FAT_CLUSTER_LAST;
+      }
+
+      //
+      // The cluster is taken even before its FAT entry is written.
+      //
+      FAT_FREE_BITMAP_CLEAR (Bitmap, Cluster);
+      Volume->FatInfoSector.FreeInfo.NextCluster = (UINT32) (Cluster + 1);
+      return Cluster;
+    }
+
+    //
+    // Fall back to walking the FAT if it can't be read into the bitmap.
+    //
+    FatDropFreeClusterBitmap (Volume);
+    if (Volume->DiskError) {
+      return (UINTN) FAT_CLUSTER_LAST;
+    }
+  }
+
   for (;;) {
     //
     // If the end of the list, return no available cluster
@@ -498,7 +820,7 @@ FatGrowEof (
     LastCluster = OFile->FileLastCluster;
 
     while (CurSize < NewSize) {
-      NewCluster = FatAllocateCluster (Volume);
+      NewCluster = FatAllocateCluster (Volume, LastCluster + 1, NewSize - CurSize);
       if (FAT_END_OF_FAT_CHAIN (NewCluster)) {
         if (LastCluster != FAT_CLUSTER_FREE) {
           FatSetFatEntry (Volume, LastCluster, (UINTN) FAT_CLUSTER_LAST);
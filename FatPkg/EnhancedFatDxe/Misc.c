@@ -108,6 +108,9 @@ FatDestroySubtask (
   gBS->CloseEvent (Subtask->DiskIo2Token.Event);
 
   Link = RemoveEntryList (&Subtask->Link);
+  if (Subtask->FreeBuffer) {
+    FreePool (Subtask->Buffer);
+  }
   FreePool (Subtask);
 
   return Link;
@@ -462,6 +465,12 @@ FatFreeVolume (
     FreePool (Volume->CacheBuffer);
   }
   //
+  // Free the free cluster bitmap
+  //
+  if (Volume->FreeClusterBitmap != NULL) {
+    FreePool (Volume->FreeClusterBitmap);
+  }
+  //
   // Free directory cache
   //
   FatCleanupODirCache (Volume);
@@ -2,7 +2,7 @@
   UEFI and Tiano Custom Decompress Library 
   It will do Tiano or UEFI decompress with different verison parameter.
   
-Copyright (c) 2006 - 2015, Intel Corporation. All rights reserved.<BR>
+Copyright (c) 2006 - 2017, Intel Corporation. All rights reserved.<BR>
 This program and the accompanying materials                          
 are licensed and made available under the terms and conditions of the BSD License         
 which accompanies this distribution.  The full text of the license may be found at        
@@ -27,46 +27,41 @@ FillBuf (
   IN  UINT16        NumOfBits
   )
 {
-  //
-  // Left shift NumOfBits of bits in advance
-  //
-  Sd->mBitBuf = (UINT32) (Sd->mBitBuf << NumOfBits);
+  UINT16  Bits;
+  UINTN   Index;
 
-  //
-  // Copy data needed in bytes into mSbuBitBuf
-  //
-  while (NumOfBits > Sd->mBitCount) {
-
-    Sd->mBitBuf |= (UINT32) (Sd->mSubBitBuf << (NumOfBits = (UINT16) (NumOfBits - Sd->mBitCount)));
-
-    if (Sd->mCompSize > 0) {
+  while (NumOfBits > 0) {
+    if (Sd->mBitCount == 0) {
       //
-      // Get 1 byte into SubBitBuf
+      // Reload mSubBitBuf with the next 32 bits from the source. When the
+      // source runs out, just pad zero bits.
       //
-      Sd->mCompSize--;
-      Sd->mSubBitBuf  = 0;
-      Sd->mSubBitBuf  = Sd->mSrcBase[Sd->mInBuf++];
-      Sd->mBitCount   = 8;
+      Sd->mSubBitBuf = 0;
+      for (Index = 0; Index < sizeof (UINT32); Index++) {
+        Sd->mSubBitBuf <<= 8;
+        if (Sd->mCompSize > 0) {
+          Sd->mCompSize--;
+          Sd->mSubBitBuf |= Sd->mSrcBase[Sd->mInBuf++];
+        }
+      }
+      Sd->mBitCount = BITBUFSIZ;
+    }
 
+    //
+    // Shift as many of the NumOfBits bits as mSubBitBuf holds into mBitBuf
+    //
+    Bits = (UINT16) MIN (NumOfBits, Sd->mBitCount);
+    if (Bits == BITBUFSIZ) {
+      Sd->mBitBuf    = Sd->mSubBitBuf;
+      Sd->mSubBitBuf = 0;
     } else {
-      //
-      // No more bits from the source, just pad zero bit.
-      //
-      Sd->mSubBitBuf  = 0;
-      Sd->mBitCount   = 8;
-
+      Sd->mBitBuf      = (Sd->mBitBuf << Bits) | (Sd->mSubBitBuf >> (BITBUFSIZ - Bits));
+      Sd->mSubBitBuf <<= Bits;
     }
-  }
 
-  //
-  // Calculate additional bit count read to update mBitCount
-  //
-  Sd->mBitCount = (UINT16) (Sd->mBitCount - NumOfBits);
-  
-  //
-  // Copy NumOfBits of bits from mSubBitBuf into mBitBuf
-  //
-  Sd->mBitBuf |= Sd->mSubBitBuf >> Sd->mBitCount;
+    Sd->mBitCount = (UINT16) (Sd->mBitCount - Bits);
+    NumOfBits     = (UINT16) (NumOfBits - Bits);
+  }
 }
 
 /**
@@ -525,6 +520,25 @@ DecodeC (
     if (Sd->mBadTableFlag != 0) {
       return 0;
     }
+
+    //
+    // Let DecodeFast () look up the code length together with the Char&Len
+    // Set symbol. It only handles code lengths of up to 16 bits, which is
+    // all that a valid block has.
+    //
+    for (Index2 = 0; Index2 < ARRAY_SIZE (Sd->mCLenTable); Index2++) {
+      Sd->mCLenTable[Index2] = Sd->mCTable[Index2];
+      if (Sd->mCTable[Index2] < NC) {
+        Sd->mCLenTable[Index2] = (UINT16) (Sd->mCTable[Index2] | (Sd->mCLen[Sd->mCTable[Index2]] << CLEN_TABLE_SHIFT));
+      }
+    }
+
+    Sd->mFastBlock = TRUE;
+    for (Index2 = 0; Index2 < MAXNP; Index2++) {
+      if (Sd->mPTLen[Index2] > 16) {
+        Sd->mFastBlock = FALSE;
+      }
+    }
   }
 
   //
@@ -554,6 +568,163 @@ DecodeC (
   return Index2;
 }
 
+///
+/// Shift NumOfBits (0 - 31) bits out of BitBuf and the same number of bits
+/// in from SubBitBuf. SubBitBuf holds BitCount valid bits and is reloaded
+/// with the next 32 bits at Src when it runs out. This is FillBuf () for the
+/// bit buffers that DecodeFast () keeps in local variables.
+///
+#define FAST_FILL_BUF(NumOfBits) \
+  do { \
+    Bits = (NumOfBits); \
+    if (Bits != 0) { \
+      BitBuf = (BitBuf << Bits) | (SubBitBuf >> (BITBUFSIZ - Bits)); \
+      if (Bits <= BitCount) { \
+        SubBitBuf <<= Bits; \
+        BitCount   -= Bits; \
+      } else { \
+        Bits      -= BitCount; \
+        SubBitBuf  = ((UINT32) Src[0] << 24) | ((UINT32) Src[1] << 16) | ((UINT32) Src[2] << 8) | Src[3]; \
+        Src       += sizeof (UINT32); \
+        BitBuf    |= SubBitBuf >> (BITBUFSIZ - Bits); \
+        SubBitBuf <<= Bits; \
+        BitCount   = BITBUFSIZ - Bits; \
+      } \
+    } \
+  } while (FALSE)
+
+/**
+  Decode codes of the current block with the bit buffers, the source and
+  the destination positions kept in local variables.
+
+  Decodes exactly like DecodeC (), DecodeP () and Decode (), but only while
+  the current block has codes left, the source has the 8 bytes that one
+  code can take, and the destination has room for the longest string. The
+  caller decodes the rest the slow way.
+
+  @param  Sd The global scratch data
+
+**/
+VOID
+DecodeFast (
+  IN  SCRATCH_DATA  *Sd
+  )
+{
+  CONST UINT8  *Src;
+  CONST UINT8  *SrcEnd;
+  UINT8        *Dst;
+  UINT32       OutBuf;
+  UINT32       BitBuf;
+  UINT32       SubBitBuf;
+  UINTN        BitCount;
+  UINTN        Bits;
+  UINT16       BlockSize;
+  UINT16       CharC;
+  UINT16       Val;
+  UINT32       Mask;
+  UINT32       Distance;
+  UINT32       DataIdx;
+  UINT16       BytesRemain;
+
+  Src       = Sd->mSrcBase + Sd->mInBuf;
+  SrcEnd    = Src + Sd->mCompSize;
+  Dst       = Sd->mDstBase;
+  OutBuf    = Sd->mOutBuf;
+  BitBuf    = Sd->mBitBuf;
+  SubBitBuf = Sd->mSubBitBuf;
+  BitCount  = Sd->mBitCount;
+  BlockSize = Sd->mBlockSize;
+
+  while (BlockSize != 0 &&
+         (UINTN) (SrcEnd - Src) >= 2 * sizeof (UINT32) &&
+         Sd->mOrigSize - OutBuf > MAXMATCH) {
+    //
+    // Get one code according to Code&Set Huffman Table
+    //
+    BlockSize--;
+    CharC = Sd->mCLenTable[BitBuf >> (BITBUFSIZ - 12)];
+    Bits  = CharC >> CLEN_TABLE_SHIFT;
+    CharC = (UINT16) (CharC & ((1U << CLEN_TABLE_SHIFT) - 1));
+
+    if (CharC >= NC) {
+      Mask = 1U << (BITBUFSIZ - 1 - 12);
+
+      do {
+        if ((BitBuf & Mask) != 0) {
+          CharC = Sd->mRight[CharC];
+        } else {
+          CharC = Sd->mLeft[CharC];
+        }
+
+        Mask >>= 1;
+      } while (CharC >= NC);
+
+      Bits = Sd->mCLen[CharC];
+    }
+
+    FAST_FILL_BUF (Bits);
+
+    if (CharC < 256) {
+      //
+      // Write orignal character into Dst
+      //
+      Dst[OutBuf++] = (UINT8) CharC;
+      continue;
+    }
+
+    //
+    // Get string length and decode the position value
+    //
+    BytesRemain = (UINT16) (CharC - (BIT8 - THRESHOLD));
+    Val         = Sd->mPTTable[BitBuf >> (BITBUFSIZ - 8)];
+
+    if (Val >= MAXNP) {
+      Mask = 1U << (BITBUFSIZ - 1 - 8);
+
+      do {
+        if ((BitBuf & Mask) != 0) {
+          Val = Sd->mRight[Val];
+        } else {
+          Val = Sd->mLeft[Val];
+        }
+
+        Mask >>= 1;
+      } while (Val >= MAXNP);
+    }
+
+    FAST_FILL_BUF (Sd->mPTLen[Val]);
+
+    Distance = Val;
+    if (Val > 1) {
+      Distance = (1U << (Val - 1)) + (BitBuf >> (BITBUFSIZ - (Val - 1)));
+      FAST_FILL_BUF (Val - 1);
+    }
+
+    Distance++;
+    DataIdx = OutBuf - Distance;
+
+    //
+    // Write BytesRemain of bytes into Dst, as Decode () does
+    //
+    if (Distance >= BytesRemain && Distance <= OutBuf) {
+      CopyMem (&Dst[OutBuf], &Dst[DataIdx], BytesRemain);
+      OutBuf += BytesRemain;
+    } else {
+      while (BytesRemain-- > 0) {
+        Dst[OutBuf++] = Dst[DataIdx++];
+      }
+    }
+  }
+
+  Sd->mInBuf      = (UINT32) (Src - Sd->mSrcBase);
+  Sd->mCompSize   = (UINT32) (SrcEnd - Src);
+  Sd->mOutBuf     = OutBuf;
+  Sd->mBitBuf     = BitBuf;
+  Sd->mSubBitBuf  = SubBitBuf;
+  Sd->mBitCount   = (UINT16) BitCount;
+  Sd->mBlockSize  = BlockSize;
+}
+
 /**
   Decode the source data and put the resulting data into the destination buffer.
   
@@ -566,6 +737,7 @@ Decode (
 {
   UINT16  BytesRemain;
   UINT32  DataIdx;
+  UINT32  Distance;
   UINT16  CharC;
 
   BytesRemain = (UINT16) (-1);
@@ -573,6 +745,14 @@ Decode (
   DataIdx     = 0;
 
   for (;;) {
+    //
+    // Decode what can be decoded without checking for the end of the source,
+    // the destination or the block
+    //
+    if (Sd->mBlockSize != 0 && Sd->mFastBlock) {
+      DecodeFast (Sd);
+    }
+
     //
     // Get one code from mBitBuf
     // 
@@ -608,19 +788,35 @@ Decode (
       //
       // Locate string position
       //
-      DataIdx     = Sd->mOutBuf - DecodeP (Sd) - 1;
+      Distance    = DecodeP (Sd) + 1;
+      DataIdx     = Sd->mOutBuf - Distance;
+
+      //
+      // Stop at the end of mDstBase
+      //
+      if (Sd->mOutBuf >= Sd->mOrigSize) {
+        goto Done;
+      }
+      if (BytesRemain > Sd->mOrigSize - Sd->mOutBuf) {
+        BytesRemain = (UINT16) (Sd->mOrigSize - Sd->mOutBuf);
+      }
 
       //
-      // Write BytesRemain of bytes into mDstBase
+      // Write BytesRemain of bytes into mDstBase. A string that overlaps
+      // its own output repeats a pattern, and a corrupt position wraps
+      // DataIdx, so both are copied one byte at a time.
       //
-      BytesRemain--;
-      while ((INT16) (BytesRemain) >= 0) {
-        Sd->mDstBase[Sd->mOutBuf++] = Sd->mDstBase[DataIdx++];
-        if (Sd->mOutBuf >= Sd->mOrigSize) {
-          goto Done ;
+      if (Distance >= BytesRemain && Distance <= Sd->mOutBuf) {
+        CopyMem (&Sd->mDstBase[Sd->mOutBuf], &Sd->mDstBase[DataIdx], BytesRemain);
+        Sd->mOutBuf += BytesRemain;
+      } else {
+        while (BytesRemain-- > 0) {
+          Sd->mDstBase[Sd->mOutBuf++] = Sd->mDstBase[DataIdx++];
         }
+      }
 
-        BytesRemain--;
+      if (Sd->mOutBuf >= Sd->mOrigSize) {
+        goto Done;
       }
     }
   }
@@ -1,7 +1,7 @@
 /** @file
   Internal data structure and interfaces defintions for UEFI and Tiano Decompress Library.
 
-  Copyright (c) 2006 - 2009, Intel Corporation. All rights reserved.<BR>
+  Copyright (c) 2006 - 2017, Intel Corporation. All rights reserved.<BR>
   This program and the accompanying materials
   are licensed and made available under the terms and conditions of the BSD License
   which accompanies this distribution.  The full text of the license may be found at
@@ -32,6 +32,7 @@
 #define THRESHOLD 3
 #define CODE_BIT  16
 #define BAD_TABLE - 1
+#define CLEN_TABLE_SHIFT 10
 
 //
 // C: Char&Len Set; P: Position Set; T: exTra Set
@@ -54,6 +55,10 @@ typedef struct {
   UINT32  mOutBuf;
   UINT32  mInBuf;
 
+  ///
+  /// mBitBuf holds the next BITBUFSIZ bits of the source. mSubBitBuf holds
+  /// the mBitCount bits that follow them, in its most significant bits.
+  ///
   UINT16  mBitCount;
   UINT32  mBitBuf;
   UINT32  mSubBitBuf;
@@ -70,6 +75,13 @@ typedef struct {
   UINT16  mCTable[4096];
   UINT16  mPTTable[256];
 
+  ///
+  /// mCTable with the code length in the top bits of each entry that is a
+  /// Char&Len Set symbol, so that DecodeFast () gets both in one lookup.
+  ///
+  UINT16  mCLenTable[4096];
+  BOOLEAN mFastBlock;
+
   ///
   /// The length of the field 'Position Set Code Length Array Size' in Block Header.
   /// For UEFI 2.0 de/compression algorithm, mPBit = 4
@@ -206,6 +218,23 @@ DecodeC (
   SCRATCH_DATA  *Sd
   );
 
+/**
+  Decode codes of the current block with the bit buffers, the source and
+  the destination positions kept in local variables.
+
+  Decodes exactly like DecodeC (), DecodeP () and Decode (), but only while
+  the current block has codes left, the source has the 8 bytes that one
+  code can take, and the destination has room for the longest string. The
+  caller decodes the rest the slow way.
+
+  @param  Sd The global scratch data
+
+**/
+VOID
+DecodeFast (
+  IN  SCRATCH_DATA  *Sd
+  );
+
 /**
   Decode the source data and put the resulting data into the destination buffer.
 
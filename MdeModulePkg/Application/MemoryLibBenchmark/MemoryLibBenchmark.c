@@ -0,0 +1,254 @@
+/** @file
+  A shell application that measures the BaseMemoryLib functions over a sweep of
+  buffer sizes and alignments.
+
+  The application is built once for every BaseMemoryLib instance, each build
+  with its own FILE_GUID (see MdeModulePkg.dsc). The results are printed as
+  comma separated values, headed by the FILE_GUID of the build, so the output
+  of the builds can be compared to choose the instance for a platform.
+
+  Copyright (c) 2017, Intel Corporation. All rights reserved.<BR>
+  This program and the accompanying materials
+  are licensed and made available under the terms and conditions of the BSD License
+  which accompanies this distribution.  The full text of the license may be found at
+  http://opensource.org/licenses/bsd-license.php
+
+THE PROGRAM IS DISTRIBUTED UNDER THE BSD LICENSE ON AN "AS IS" BASIS,
+WITHOUT WARRANTIES OR REPRESENTATIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED.
+
+**/
+
+#include <Uefi.h>
+#include <Library/UefiLib.h>
+#include <Library/UefiApplicationEntryPoint.h>
+#include <Library/BaseMemoryLib.h>
+#include <Library/BaseLib.h>
+#include <Library/MemoryAllocationLib.h>
+#include <Library/TimerLib.h>
+
+//
+// Each measurement processes about this many bytes, in at least
+// BENCHMARK_MIN_CALLS and at most BENCHMARK_MAX_CALLS calls.
+//
+#define BENCHMARK_BYTES_PER_RUN   SIZE_16MB
+#define BENCHMARK_MIN_CALLS       16
+#define BENCHMARK_MAX_CALLS       1000000
+
+//
+// The buffers hold the largest size plus room for the misalignments.
+//
+#define BENCHMARK_MAX_SIZE        SIZE_8MB
+#define BENCHMARK_BUFFER_PAGES    EFI_SIZE_TO_PAGES (BENCHMARK_MAX_SIZE + SIZE_4KB)
+
+typedef enum {
+  MemFunctionCopyMem,
+  MemFunctionSetMem,
+  MemFunctionZeroMem,
+  MemFunctionCompareMem,
+  MemFunctionScanMem8,
+  MemFunctionMax
+} MEM_FUNCTION;
+
+typedef struct {
+  UINTN  DestinationOffset;
+  UINTN  SourceOffset;
+} BENCHMARK_ALIGNMENT;
+
+GLOBAL_REMOVE_IF_UNREFERENCED CONST CHAR16 *mFunctionNames[MemFunctionMax] = {
+  L"CopyMem",
+  L"SetMem",
+  L"ZeroMem",
+  L"CompareMem",
+  L"ScanMem8"
+};
+
+GLOBAL_REMOVE_IF_UNREFERENCED CONST UINTN mSizes[] = {
+  8, 16, 32, 64, 128, 256, 512,
+  SIZE_1KB, SIZE_2KB, SIZE_4KB, SIZE_16KB, SIZE_64KB, SIZE_256KB,
+  SIZE_1MB, SIZE_4MB, BENCHMARK_MAX_SIZE
+};
+
+//
+// Offsets of the buffers from a page boundary. SetMem, ZeroMem and ScanMem8
+// only use the destination buffer.
+//
+GLOBAL_REMOVE_IF_UNREFERENCED CONST BENCHMARK_ALIGNMENT mAlignments[] = {
+  { 0,  0  },
+  { 1,  0  },
+  { 0,  5  },
+  { 31, 13 }
+};
+
+/**
+  Calls a BaseMemoryLib function a number of times.
+
+  @param[in]  Function     The function to call.
+  @param[in]  Destination  The destination buffer.
+  @param[in]  Source       The source buffer. It has the same content as
+                           Destination for CompareMem.
+  @param[in]  Size         The size of the buffers.
+  @param[in]  Calls        The number of calls.
+
+**/
+VOID
+RunMemFunction (
+  IN MEM_FUNCTION  Function,
+  IN UINT8         *Destination,
+  IN UINT8         *Source,
+  IN UINTN         Size,
+  IN UINTN         Calls
+  )
+{
+  UINTN  Index;
+
+  for (Index = 0; Index < Calls; Index++) {
+    switch (Function) {
+    case MemFunctionCopyMem:
+      CopyMem (Destination, Source, Size);
+      break;
+    case MemFunctionSetMem:
+      SetMem (Destination, Size, 0x5A);
+      break;
+    case MemFunctionZeroMem:
+      ZeroMem (Destination, Size);
+      break;
+    case MemFunctionCompareMem:
+      CompareMem (Destination, Source, Size);
+      break;
+    default:
+      //
+      // The buffer is zero, so the whole buffer is scanned.
+      //
+      ScanMem8 (Destination, Size, 0xA5);
+      break;
+    }
+  }
+}
+
+/**
+  Converts the difference between two performance counter values to
+  nanoseconds. The counter may have wrapped around once between them.
+
+  @param[in]  Begin         The counter value at the beginning.
+  @param[in]  Finish        The counter value at the end.
+  @param[in]  CounterStart  The first value the counter counts from.
+  @param[in]  CounterEnd    The last value the counter counts to.
+
+  @return  The elapsed time in nanoseconds.
+
+**/
+UINT64
+ElapsedNanoSeconds (
+  IN UINT64  Begin,
+  IN UINT64  Finish,
+  IN UINT64  CounterStart,
+  IN UINT64  CounterEnd
+  )
+{
+  if (CounterStart > CounterEnd) {
+    if (Finish > Begin) {
+      return GetTimeInNanoSecond (Begin - CounterEnd + CounterStart - Finish);
+    }
+    return GetTimeInNanoSecond (Begin - Finish);
+  }
+  if (Finish < Begin) {
+    return GetTimeInNanoSecond (CounterEnd - Begin + Finish - CounterStart);
+  }
+  return GetTimeInNanoSecond (Finish - Begin);
+}
+
+/**
+  The user Entry Point for Application. The user code starts with this function
+  as the real entry point for the application.
+
+  @param[in] ImageHandle    The firmware allocated handle for the EFI image.
+  @param[in] SystemTable    A pointer to the EFI System Table.
+
+  @retval EFI_SUCCESS           The benchmark ran.
+  @retval EFI_UNSUPPORTED       There is no performance counter.
+  @retval EFI_OUT_OF_RESOURCES  The buffers could not be allocated.
+
+**/
+EFI_STATUS
+EFIAPI
+UefiMain (
+  IN EFI_HANDLE        ImageHandle,
+  IN EFI_SYSTEM_TABLE  *SystemTable
+  )
+{
+  UINT8         *DestinationBuffer;
+  UINT8         *SourceBuffer;
+  UINT8         *Destination;
+  UINT8         *Source;
+  UINT64        Frequency;
+  UINT64        CounterStart;
+  UINT64        CounterEnd;
+  UINT64        Begin;
+  UINT64        NanoSeconds;
+  UINTN         Function;
+  UINTN         SizeIndex;
+  UINTN         AlignIndex;
+  UINTN         Size;
+  UINTN         Calls;
+
+  Frequency = GetPerformanceCounterProperties (&CounterStart, &CounterEnd);
+  if (Frequency == 0) {
+    Print (L"MemoryLibBenchmark: no performance counter\n");
+    return EFI_UNSUPPORTED;
+  }
+
+  DestinationBuffer = AllocatePages (BENCHMARK_BUFFER_PAGES);
+  SourceBuffer      = AllocatePages (BENCHMARK_BUFFER_PAGES);
+  if (DestinationBuffer == NULL || SourceBuffer == NULL) {
+    if (DestinationBuffer != NULL) {
+      FreePages (DestinationBuffer, BENCHMARK_BUFFER_PAGES);
+    }
+    if (SourceBuffer != NULL) {
+      FreePages (SourceBuffer, BENCHMARK_BUFFER_PAGES);
+    }
+    return EFI_OUT_OF_RESOURCES;
+  }
+
+  Print (L"# BaseMemoryLib benchmark, module %g\n", &gEfiCallerIdGuid);
+  Print (L"Function,Size,DestinationOffset,SourceOffset,NanoSecondsPerCall,MBPerSecond\n");
+
+  for (Function = MemFunctionCopyMem; Function < MemFunctionMax; Function++) {
+    for (SizeIndex = 0; SizeIndex < ARRAY_SIZE (mSizes); SizeIndex++) {
+      Size  = mSizes[SizeIndex];
+      Calls = BENCHMARK_BYTES_PER_RUN / Size;
+      Calls = MAX (Calls, BENCHMARK_MIN_CALLS);
+      Calls = MIN (Calls, BENCHMARK_MAX_CALLS);
+
+      for (AlignIndex = 0; AlignIndex < ARRAY_SIZE (mAlignments); AlignIndex++) {
+        Destination = DestinationBuffer + mAlignments[AlignIndex].DestinationOffset;
+        Source      = SourceBuffer + mAlignments[AlignIndex].SourceOffset;
+
+        //
+        // Start from equal, zeroed buffers: CompareMem then compares all the
+        // bytes and ScanMem8 scans all of them. This also warms up the caches.
+        //
+        ZeroMem (Destination, Size);
+        ZeroMem (Source, Size);
+
+        Begin = GetPerformanceCounter ();
+        RunMemFunction ((MEM_FUNCTION) Function, Destination, Source, Size, Calls);
+        NanoSeconds = ElapsedNanoSeconds (Begin, GetPerformanceCounter (), CounterStart, CounterEnd);
+        NanoSeconds = MAX (NanoSeconds, 1);
+
+        Print (
+          L"%s,%Lu,%Lu,%Lu,%Lu,%Lu\n",
+          mFunctionNames[Function],
+          (UINT64) Size,
+          (UINT64) mAlignments[AlignIndex].DestinationOffset,
+          (UINT64) mAlignments[AlignIndex].SourceOffset,
+          DivU64x64Remainder (NanoSeconds, Calls, NULL),
+          DivU64x64Remainder (MultU64x64 (Size, Calls) * 1000, NanoSeconds, NULL)
+          );
+      }
+    }
+  }
+
+  FreePages (DestinationBuffer, BENCHMARK_BUFFER_PAGES);
+  FreePages (SourceBuffer, BENCHMARK_BUFFER_PAGES);
+  return EFI_SUCCESS;
+}
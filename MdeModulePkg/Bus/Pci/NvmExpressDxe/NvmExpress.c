@@ -2,7 +2,7 @@
   NvmExpressDxe driver is used to manage non-volatile memory subsystem which follows
   NVM Express specification.
 
-  Copyright (c) 2013 - 2016, Intel Corporation. All rights reserved.<BR>
+  Copyright (c) 2013 - 2017, Intel Corporation. All rights reserved.<BR>
   This program and the accompanying materials
   are licensed and made available under the terms and conditions of the BSD License
   which accompanies this distribution.  The full text of the license may be found at
@@ -645,17 +645,38 @@ ProcessAsyncTaskList (
           );
 
         RemoveEntryList (Link);
-        gBS->SignalEvent (AsyncRequest->CallerEvent);
-        FreePool (AsyncRequest);
 
         //
-        // Update submission queue head.
+        // Release the mappings of the command, which also completes the
+        // transfer of the data read into the caller's buffer.
         //
-        Private->AsyncSqHead = Cq->Sqhd;
+        if (AsyncRequest->MapData != NULL) {
+          Private->PciIo->Unmap (Private->PciIo, AsyncRequest->MapData);
+        }
+        if (AsyncRequest->MapMeta != NULL) {
+          Private->PciIo->Unmap (Private->PciIo, AsyncRequest->MapMeta);
+        }
+        if (AsyncRequest->PrpListHost != NULL) {
+          NvmeFreePrpList (
+            Private,
+            AsyncRequest->PrpListHost,
+            AsyncRequest->PrpListNo,
+            AsyncRequest->MapPrpList
+            );
+        }
+
+        gBS->SignalEvent (AsyncRequest->CallerEvent);
+        FreePool (AsyncRequest);
         break;
       }
     }
 
+    //
+    // Update submission queue head, also for the commands that have been
+    // given up by NvmeAbortPipelinedIo().
+    //
+    Private->AsyncSqHead = Cq->Sqhd;
+
     Private->CqHdbl[QueueId].Cqh++;
     if (Private->CqHdbl[QueueId].Cqh > NVME_ASYNC_CCQ_SIZE) {
       Private->CqHdbl[QueueId].Cqh = 0;
@@ -974,6 +995,40 @@ NvmExpressDriverBindingStart (
 
     Private->BufferPciAddr = (UINT8 *)(UINTN)MappedAddr;
 
+    //
+    // Allocate the PRP list pool, and map it for bus master read and write.
+    // Without the pool, the PRP lists are allocated for every command.
+    //
+    Status = PciIo->AllocateBuffer (
+                      PciIo,
+                      AllocateAnyPages,
+                      EfiBootServicesData,
+                      NVME_PRP_POOL_PAGES,
+                      (VOID**)&Private->PrpPool,
+                      0
+                      );
+    if (!EFI_ERROR (Status)) {
+      Bytes = EFI_PAGES_TO_SIZE (NVME_PRP_POOL_PAGES);
+      Status = PciIo->Map (
+                        PciIo,
+                        EfiPciIoOperationBusMasterCommonBuffer,
+                        Private->PrpPool,
+                        &Bytes,
+                        &MappedAddr,
+                        &Private->PrpPoolMapping
+                        );
+      if (EFI_ERROR (Status) || (Bytes != EFI_PAGES_TO_SIZE (NVME_PRP_POOL_PAGES))) {
+        if (!EFI_ERROR (Status)) {
+          PciIo->Unmap (PciIo, Private->PrpPoolMapping);
+        }
+        PciIo->FreeBuffer (PciIo, NVME_PRP_POOL_PAGES, Private->PrpPool);
+        Private->PrpPool        = NULL;
+        Private->PrpPoolMapping = NULL;
+      } else {
+        Private->PrpPoolPciAddr = (UINT8 *)(UINTN)MappedAddr;
+      }
+    }
+
     Private->Signature = NVME_CONTROLLER_PRIVATE_DATA_SIGNATURE;
     Private->ControllerHandle          = Controller;
     Private->ImageHandle               = This->DriverBindingHandle;
@@ -1076,6 +1131,14 @@ Exit:
     PciIo->Unmap (PciIo, Private->Mapping);
   }
 
+  if ((Private != NULL) && (Private->PrpPoolMapping != NULL)) {
+    PciIo->Unmap (PciIo, Private->PrpPoolMapping);
+  }
+
+  if ((Private != NULL) && (Private->PrpPool != NULL)) {
+    PciIo->FreeBuffer (PciIo, NVME_PRP_POOL_PAGES, Private->PrpPool);
+  }
+
   if ((Private != NULL) && (Private->Buffer != NULL)) {
     PciIo->FreeBuffer (PciIo, 6, Private->Buffer);
   }
@@ -1203,6 +1266,14 @@ NvmExpressDriverBindingStop (
         Private->PciIo->FreeBuffer (Private->PciIo, 6, Private->Buffer);
       }
 
+      if (Private->PrpPoolMapping != NULL) {
+        Private->PciIo->Unmap (Private->PciIo, Private->PrpPoolMapping);
+      }
+
+      if (Private->PrpPool != NULL) {
+        Private->PciIo->FreeBuffer (Private->PciIo, NVME_PRP_POOL_PAGES, Private->PrpPool);
+      }
+
       FreePool (Private->ControllerData);
       FreePool (Private);
     }
@@ -3,7 +3,7 @@
   NVM Express specification.
 
   (C) Copyright 2016 Hewlett Packard Enterprise Development LP<BR>
-  Copyright (c) 2013 - 2016, Intel Corporation. All rights reserved.<BR>
+  Copyright (c) 2013 - 2017, Intel Corporation. All rights reserved.<BR>
   This program and the accompanying materials
   are licensed and made available under the terms and conditions of the BSD License
   which accompanies this distribution.  The full text of the license may be found at
@@ -79,6 +79,13 @@ extern EFI_DRIVER_SUPPORTED_EFI_VERSION_PROTOCOL  gNvmExpressDriverSupportedEfiV
 
 #define NVME_MAX_QUEUES                           3     // Number of queues supported by the driver
 
+//
+// Number of 4kB pages in the PRP list pool of a controller. The PRP lists of
+// a command are taken from the pool when it has enough free pages in a row,
+// which saves allocating and mapping them for every command.
+//
+#define NVME_PRP_POOL_PAGES                       64
+
 #define NVME_CONTROLLER_ID                        0
 
 //
@@ -156,6 +163,14 @@ struct _NVME_CONTROLLER_PRIVATE_DATA {
 
   VOID                                *Mapping;
 
+  //
+  // Preallocated PRP lists, and a bitmap of the pages in use.
+  //
+  UINT8                               *PrpPool;
+  UINT8                               *PrpPoolPciAddr;
+  VOID                                *PrpPoolMapping;
+  UINT64                              PrpPoolUsed;
+
   //
   // For Non-blocking operations.
   //
@@ -293,6 +308,14 @@ typedef struct {
   EFI_NVM_EXPRESS_PASS_THRU_COMMAND_PACKET *Packet;
   UINT16                                   CommandId;
   EFI_EVENT                                CallerEvent;
+  //
+  // The mappings and PRP lists released when the command completes.
+  //
+  VOID                                     *MapData;
+  VOID                                     *MapMeta;
+  VOID                                     *MapPrpList;
+  VOID                                     *PrpListHost;
+  UINTN                                    PrpListNo;
 } NVME_PASS_THRU_ASYNC_REQ;
 
 #define NVME_PASS_THRU_ASYNC_REQ_FROM_THIS(a) \
@@ -716,4 +739,93 @@ NvmeDumpStatus (
   IN NVME_CQ             *Cq
   );
 
+/**
+  Free the PRP lists created by NvmeCreatePrpList().
+
+  @param[in]     Private             The pointer to the NVME_CONTROLLER_PRIVATE_DATA data structure.
+  @param[in]     PrpListHost         The host base address of PRP lists.
+  @param[in]     PrpListNo           The number of PRP List.
+  @param[in]     Mapping             The mapping value returned by NvmeCreatePrpList().
+
+**/
+VOID
+NvmeFreePrpList (
+  IN NVME_CONTROLLER_PRIVATE_DATA     *Private,
+  IN VOID                             *PrpListHost,
+  IN UINTN                            PrpListNo,
+  IN VOID                             *Mapping
+  );
+
+/**
+  Call back function when the timer event is signaled.
+
+  @param[in]  Event     The Event this notify function registered to.
+  @param[in]  Context   Pointer to the context data registered to the
+                        Event.
+
+**/
+VOID
+EFIAPI
+ProcessAsyncTaskList (
+  IN EFI_EVENT                    Event,
+  IN VOID*                        Context
+  );
+
+/**
+  Free a BlockIo2 subtask together with its command packet.
+
+  @param  Subtask                The subtask to free.
+
+**/
+VOID
+NvmeFreeSubtask (
+  IN NVME_BLKIO2_SUBTASK                *Subtask
+  );
+
+/**
+  Give up the BlockIo2 request of a transfer started by NvmePipelinedIo().
+
+  The subtasks still waiting for a submission queue slot are dropped. The
+  commands already submitted are forgotten, as NvmExpressPassThru() does for
+  a blocking command that times out: their mappings are released, and their
+  completions, if they ever arrive, match no request.
+
+  The caller is responsible for running at TPL_NOTIFY.
+
+  @param  Device                 The pointer to the NVME_DEVICE_PRIVATE_DATA data structure.
+  @param  Token                  The token of the transfer.
+
+**/
+VOID
+NvmeAbortPipelinedIo (
+  IN     NVME_DEVICE_PRIVATE_DATA       *Device,
+  IN     EFI_BLOCK_IO2_TOKEN            *Token
+  );
+
+/**
+  Read or write some blocks through the asynchronous I/O queue, and wait for
+  the transfer to complete.
+
+  @param  Device                 The pointer to the NVME_DEVICE_PRIVATE_DATA data structure.
+  @param  IsWrite                Indicates a write rather than a read.
+  @param  Buffer                 The buffer of the data to transfer.
+  @param  Lba                    The start block number.
+  @param  Blocks                 Total block number to be transferred.
+
+  @retval EFI_SUCCESS            Datum are transferred.
+  @retval EFI_DEVICE_ERROR       The controller completed no command for
+                                 NVME_GENERIC_TIMEOUT. The transfer has been
+                                 given up.
+  @retval Others                 Fail to transfer all the datum.
+
+**/
+EFI_STATUS
+NvmePipelinedIo (
+  IN     NVME_DEVICE_PRIVATE_DATA       *Device,
+  IN     BOOLEAN                        IsWrite,
+  IN OUT VOID                           *Buffer,
+  IN     UINT64                         Lba,
+  IN     UINTN                          Blocks
+  );
+
 #endif
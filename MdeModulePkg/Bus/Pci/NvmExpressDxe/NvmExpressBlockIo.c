@@ -2,7 +2,7 @@
   NvmExpressDxe driver is used to manage non-volatile memory subsystem which follows
   NVM Express specification.
 
-  Copyright (c) 2013 - 2016, Intel Corporation. All rights reserved.<BR>
+  Copyright (c) 2013 - 2017, Intel Corporation. All rights reserved.<BR>
   This program and the accompanying materials
   are licensed and made available under the terms and conditions of the BSD License
   which accompanies this distribution.  The full text of the license may be found at
@@ -201,21 +201,17 @@ NvmeRead (
     MaxTransferBlocks = 1024;
   }
 
-  while (Blocks > 0) {
-    if (Blocks > MaxTransferBlocks) {
-      Status = ReadSectors (Device, (UINT64)(UINTN)Buffer, Lba, MaxTransferBlocks);
-
-      Blocks -= MaxTransferBlocks;
-      Buffer  = (VOID *)(UINTN)((UINT64)(UINTN)Buffer + MaxTransferBlocks * BlockSize);
-      Lba    += MaxTransferBlocks;
-    } else {
-      Status = ReadSectors (Device, (UINT64)(UINTN)Buffer, Lba, (UINT32)Blocks);
-      Blocks = 0;
-    }
+  if (Blocks > MaxTransferBlocks) {
+    //
+    // Queue all the chunks of a large transfer at once.
+    //
+    Status = NvmePipelinedIo (Device, FALSE, Buffer, Lba, Blocks);
+  } else {
+    Status = ReadSectors (Device, (UINT64)(UINTN)Buffer, Lba, (UINT32)Blocks);
+  }
 
-    if (EFI_ERROR(Status)) {
-      break;
-    }
+  if (!EFI_ERROR(Status)) {
+    Blocks = 0;
   }
 
   DEBUG ((EFI_D_VERBOSE, "%a: Lba = 0x%08Lx, Original = 0x%08Lx, "
@@ -279,21 +275,17 @@ NvmeWrite (
     MaxTransferBlocks = 1024;
   }
 
-  while (Blocks > 0) {
-    if (Blocks > MaxTransferBlocks) {
-      Status = WriteSectors (Device, (UINT64)(UINTN)Buffer, Lba, MaxTransferBlocks);
-
-      Blocks -= MaxTransferBlocks;
-      Buffer  = (VOID *)(UINTN)((UINT64)(UINTN)Buffer + MaxTransferBlocks * BlockSize);
-      Lba    += MaxTransferBlocks;
-    } else {
-      Status = WriteSectors (Device, (UINT64)(UINTN)Buffer, Lba, (UINT32)Blocks);
-      Blocks = 0;
-    }
+  if (Blocks > MaxTransferBlocks) {
+    //
+    // Queue all the chunks of a large transfer at once.
+    //
+    Status = NvmePipelinedIo (Device, TRUE, Buffer, Lba, Blocks);
+  } else {
+    Status = WriteSectors (Device, (UINT64)(UINTN)Buffer, Lba, (UINT32)Blocks);
+  }
 
-    if (EFI_ERROR(Status)) {
-      break;
-    }
+  if (!EFI_ERROR(Status)) {
+    Blocks = 0;
   }
 
   DEBUG ((EFI_D_VERBOSE, "%a: Lba = 0x%08Lx, Original = 0x%08Lx, "
@@ -929,6 +921,216 @@ NvmeAsyncWrite (
   return Status;
 }
 
+/**
+  Free a BlockIo2 subtask together with its command packet.
+
+  @param  Subtask                The subtask to free.
+
+**/
+VOID
+NvmeFreeSubtask (
+  IN NVME_BLKIO2_SUBTASK                *Subtask
+  )
+{
+  gBS->CloseEvent (Subtask->Event);
+  FreePool (Subtask->CommandPacket->NvmeCmd);
+  FreePool (Subtask->CommandPacket->NvmeCompletion);
+  FreePool (Subtask->CommandPacket);
+  FreePool (Subtask);
+}
+
+/**
+  Give up the BlockIo2 request of a transfer started by NvmePipelinedIo().
+
+  The subtasks still waiting for a submission queue slot are dropped. The
+  commands already submitted are forgotten, as NvmExpressPassThru() does for
+  a blocking command that times out: their mappings are released, and their
+  completions, if they ever arrive, match no request.
+
+  The caller is responsible for running at TPL_NOTIFY.
+
+  @param  Device                 The pointer to the NVME_DEVICE_PRIVATE_DATA data structure.
+  @param  Token                  The token of the transfer.
+
+**/
+VOID
+NvmeAbortPipelinedIo (
+  IN     NVME_DEVICE_PRIVATE_DATA       *Device,
+  IN     EFI_BLOCK_IO2_TOKEN            *Token
+  )
+{
+  NVME_CONTROLLER_PRIVATE_DATA     *Private;
+  NVME_BLKIO2_REQUEST              *BlkIo2Req;
+  NVME_BLKIO2_SUBTASK              *Subtask;
+  NVME_PASS_THRU_ASYNC_REQ         *AsyncRequest;
+  LIST_ENTRY                       *Link;
+  LIST_ENTRY                       *NextLink;
+
+  Private = Device->Controller;
+  for (Link = GetFirstNode (&Device->AsyncQueue);
+       !IsNull (&Device->AsyncQueue, Link);
+       Link = GetNextNode (&Device->AsyncQueue, Link)) {
+    BlkIo2Req = NVME_BLKIO2_REQUEST_FROM_LINK (Link);
+    if (BlkIo2Req->Token == Token) {
+      break;
+    }
+  }
+
+  if (IsNull (&Device->AsyncQueue, Link)) {
+    //
+    // The request has completed in the meantime.
+    //
+    return;
+  }
+
+  for (Link = GetFirstNode (&Private->UnsubmittedSubtasks);
+       !IsNull (&Private->UnsubmittedSubtasks, Link);
+       Link = NextLink) {
+    NextLink = GetNextNode (&Private->UnsubmittedSubtasks, Link);
+    Subtask  = NVME_BLKIO2_SUBTASK_FROM_LINK (Link);
+    if (Subtask->BlockIo2Request == BlkIo2Req) {
+      RemoveEntryList (Link);
+      BlkIo2Req->UnsubmittedSubtaskNum--;
+      NvmeFreeSubtask (Subtask);
+    }
+  }
+
+  while (!IsListEmpty (&BlkIo2Req->SubtasksQueue)) {
+    Link    = GetFirstNode (&BlkIo2Req->SubtasksQueue);
+    Subtask = NVME_BLKIO2_SUBTASK_FROM_LINK (Link);
+    RemoveEntryList (Link);
+
+    for (Link = GetFirstNode (&Private->AsyncPassThruQueue);
+         !IsNull (&Private->AsyncPassThruQueue, Link);
+         Link = GetNextNode (&Private->AsyncPassThruQueue, Link)) {
+      AsyncRequest = NVME_PASS_THRU_ASYNC_REQ_FROM_THIS (Link);
+      if (AsyncRequest->CallerEvent == Subtask->Event) {
+        RemoveEntryList (Link);
+        if (AsyncRequest->MapData != NULL) {
+          Private->PciIo->Unmap (Private->PciIo, AsyncRequest->MapData);
+        }
+        if (AsyncRequest->MapMeta != NULL) {
+          Private->PciIo->Unmap (Private->PciIo, AsyncRequest->MapMeta);
+        }
+        if (AsyncRequest->PrpListHost != NULL) {
+          NvmeFreePrpList (
+            Private,
+            AsyncRequest->PrpListHost,
+            AsyncRequest->PrpListNo,
+            AsyncRequest->MapPrpList
+            );
+        }
+        FreePool (AsyncRequest);
+        break;
+      }
+    }
+
+    NvmeFreeSubtask (Subtask);
+  }
+
+  RemoveEntryList (&BlkIo2Req->Link);
+  FreePool (BlkIo2Req);
+}
+
+/**
+  Read or write some blocks through the asynchronous I/O queue, and wait for
+  the transfer to complete.
+
+  The transfer is split into chunks of the maximum data transfer size, and
+  the chunks are all queued at once, so that the controller works on several
+  of them at the same time rather than one after another.
+
+  The wait is bounded by NVME_GENERIC_TIMEOUT, the timeout of each chunk,
+  which restarts whenever the controller completes a command.
+
+  @param  Device                 The pointer to the NVME_DEVICE_PRIVATE_DATA data structure.
+  @param  IsWrite                Indicates a write rather than a read.
+  @param  Buffer                 The buffer of the data to transfer.
+  @param  Lba                    The start block number.
+  @param  Blocks                 Total block number to be transferred.
+
+  @retval EFI_SUCCESS            Datum are transferred.
+  @retval EFI_DEVICE_ERROR       The controller completed no command for
+                                 NVME_GENERIC_TIMEOUT. The transfer has been
+                                 given up.
+  @retval Others                 Fail to transfer all the datum.
+
+**/
+EFI_STATUS
+NvmePipelinedIo (
+  IN     NVME_DEVICE_PRIVATE_DATA       *Device,
+  IN     BOOLEAN                        IsWrite,
+  IN OUT VOID                           *Buffer,
+  IN     UINT64                         Lba,
+  IN     UINTN                          Blocks
+  )
+{
+  EFI_STATUS                       Status;
+  EFI_BLOCK_IO2_TOKEN              Token;
+  EFI_TPL                          OldTpl;
+  NVME_CONTROLLER_PRIVATE_DATA     *Private;
+  UINT16                           Cqh;
+  UINT16                           LastCqh;
+  UINT64                           Idle;
+
+  Private = Device->Controller;
+  Status  = gBS->CreateEvent (0, 0, NULL, NULL, &Token.Event);
+  if (EFI_ERROR (Status)) {
+    return Status;
+  }
+
+  Token.TransactionStatus = EFI_SUCCESS;
+  if (IsWrite) {
+    Status = NvmeAsyncWrite (Device, Buffer, Lba, Blocks, &Token);
+  } else {
+    Status = NvmeAsyncRead (Device, Buffer, Lba, Blocks, &Token);
+  }
+
+  if (!EFI_ERROR (Status)) {
+    //
+    // Submit the chunks and reap their completions right away, rather than
+    // at the next tick of the asynchronous I/O timer. Queue #2 is the
+    // asynchronous I/O queue; its completion queue head moves whenever the
+    // controller completes a command.
+    //
+    LastCqh = Private->CqHdbl[2].Cqh;
+    Idle    = 0;
+    while (TRUE) {
+      OldTpl = gBS->RaiseTPL (TPL_NOTIFY);
+      ProcessAsyncTaskList (NULL, Private);
+      Cqh = Private->CqHdbl[2].Cqh;
+      gBS->RestoreTPL (OldTpl);
+
+      if (gBS->CheckEvent (Token.Event) != EFI_NOT_READY) {
+        Status = Token.TransactionStatus;
+        break;
+      }
+
+      if (Cqh != LastCqh) {
+        LastCqh = Cqh;
+        Idle    = 0;
+      } else if (Idle >= NVME_GENERIC_TIMEOUT) {
+        DEBUG ((EFI_D_ERROR, "%a: Lba = 0x%08Lx, Blocks = 0x%08Lx timed out\n",
+          __FUNCTION__, Lba, (UINT64)Blocks));
+        OldTpl = gBS->RaiseTPL (TPL_NOTIFY);
+        NvmeAbortPipelinedIo (Device, &Token);
+        gBS->RestoreTPL (OldTpl);
+        Status = EFI_DEVICE_ERROR;
+        break;
+      }
+
+      //
+      // Idle counts in 100ns units, like NVME_GENERIC_TIMEOUT.
+      //
+      gBS->Stall (1);
+      Idle += 10;
+    }
+  }
+
+  gBS->CloseEvent (Token.Event);
+  return Status;
+}
+
 /**
   Reset the Block Device.
 
@@ -3,7 +3,7 @@
   NVM Express specification.
 
   (C) Copyright 2014 Hewlett-Packard Development Company, L.P.<BR>
-  Copyright (c) 2013 - 2016, Intel Corporation. All rights reserved.<BR>
+  Copyright (c) 2013 - 2017, Intel Corporation. All rights reserved.<BR>
   This program and the accompanying materials
   are licensed and made available under the terms and conditions of the BSD License
   which accompanies this distribution.  The full text of the license may be found at
@@ -198,23 +198,68 @@ NvmeDumpStatus (
   }
 }
 
+/**
+  Take PrpListNo pages in a row from the PRP list pool of the controller.
+
+  @param[in]     Private             The pointer to the NVME_CONTROLLER_PRIVATE_DATA data structure.
+  @param[in]     PrpListNo           The number of PRP List.
+
+  @return The index of the first page taken, or NVME_PRP_POOL_PAGES if there
+          are not enough free pages in a row.
+
+**/
+UINTN
+NvmeAllocatePrpPoolPages (
+  IN NVME_CONTROLLER_PRIVATE_DATA     *Private,
+  IN UINTN                            PrpListNo
+  )
+{
+  UINTN                       Index;
+  UINT64                      Mask;
+  EFI_TPL                     OldTpl;
+
+  if ((Private->PrpPool == NULL) || (PrpListNo >= NVME_PRP_POOL_PAGES)) {
+    return NVME_PRP_POOL_PAGES;
+  }
+
+  //
+  // Commands are also sent from the asynchronous I/O timer at TPL_NOTIFY.
+  //
+  OldTpl = gBS->RaiseTPL (TPL_NOTIFY);
+  Mask   = LShiftU64 (1, PrpListNo) - 1;
+  for (Index = 0; Index + PrpListNo <= NVME_PRP_POOL_PAGES; Index++) {
+    if ((Private->PrpPoolUsed & LShiftU64 (Mask, Index)) == 0) {
+      Private->PrpPoolUsed |= LShiftU64 (Mask, Index);
+      break;
+    }
+  }
+  gBS->RestoreTPL (OldTpl);
+
+  if (Index + PrpListNo > NVME_PRP_POOL_PAGES) {
+    return NVME_PRP_POOL_PAGES;
+  }
+  return Index;
+}
+
 /**
   Create PRP lists for data transfer which is larger than 2 memory pages.
   Note here we calcuate the number of required PRP lists and allocate them at one time.
+  The PRP lists are taken from the PRP list pool of the controller if possible.
 
-  @param[in]     PciIo               A pointer to the EFI_PCI_IO_PROTOCOL instance.
+  @param[in]     Private             The pointer to the NVME_CONTROLLER_PRIVATE_DATA data structure.
   @param[in]     PhysicalAddr        The physical base address of data buffer.
   @param[in]     Pages               The number of pages to be transfered.
   @param[out]    PrpListHost         The host base address of PRP lists.
   @param[in,out] PrpListNo           The number of PRP List.
-  @param[out]    Mapping             The mapping value returned from PciIo.Map().
+  @param[out]    Mapping             The mapping value returned from PciIo.Map(), or NULL if the
+                                     PRP lists are taken from the pool.
 
   @retval The pointer to the first PRP List of the PRP lists.
 
 **/
 VOID*
 NvmeCreatePrpList (
-  IN     EFI_PCI_IO_PROTOCOL          *PciIo,
+  IN     NVME_CONTROLLER_PRIVATE_DATA *Private,
   IN     EFI_PHYSICAL_ADDRESS         PhysicalAddr,
   IN     UINTN                        Pages,
      OUT VOID                         **PrpListHost,
@@ -222,6 +267,7 @@ NvmeCreatePrpList (
      OUT VOID                         **Mapping
   )
 {
+  EFI_PCI_IO_PROTOCOL         *PciIo;
   UINTN                       PrpEntryNo;
   UINT64                      PrpListBase;
   UINTN                       PrpListIndex;
@@ -229,8 +275,12 @@ NvmeCreatePrpList (
   UINT64                      Remainder;
   EFI_PHYSICAL_ADDRESS        PrpListPhyAddr;
   UINTN                       Bytes;
+  UINTN                       PoolIndex;
   EFI_STATUS                  Status;
 
+  PciIo    = Private->PciIo;
+  *Mapping = NULL;
+
   //
   // The number of Prp Entry in a memory page.
   //
@@ -250,39 +300,45 @@ NvmeCreatePrpList (
     Remainder = PrpEntryNo - 1;
   }
 
-  Status = PciIo->AllocateBuffer (
-                    PciIo,
-                    AllocateAnyPages,
-                    EfiBootServicesData,
-                    *PrpListNo,
-                    PrpListHost,
-                    0
-                    );
+  Bytes     = EFI_PAGES_TO_SIZE (*PrpListNo);
+  PoolIndex = NvmeAllocatePrpPoolPages (Private, *PrpListNo);
+  if (PoolIndex < NVME_PRP_POOL_PAGES) {
+    *PrpListHost   = Private->PrpPool + EFI_PAGES_TO_SIZE (PoolIndex);
+    PrpListPhyAddr = (EFI_PHYSICAL_ADDRESS)(UINTN)Private->PrpPoolPciAddr + EFI_PAGES_TO_SIZE (PoolIndex);
+  } else {
+    Status = PciIo->AllocateBuffer (
+                      PciIo,
+                      AllocateAnyPages,
+                      EfiBootServicesData,
+                      *PrpListNo,
+                      PrpListHost,
+                      0
+                      );
 
-  if (EFI_ERROR (Status)) {
-    return NULL;
-  }
+    if (EFI_ERROR (Status)) {
+      return NULL;
+    }
 
-  Bytes = EFI_PAGES_TO_SIZE (*PrpListNo);
-  Status = PciIo->Map (
-                    PciIo,
-                    EfiPciIoOperationBusMasterCommonBuffer,
-                    *PrpListHost,
-                    &Bytes,
-                    &PrpListPhyAddr,
-                    Mapping
-                    );
-
-  if (EFI_ERROR (Status) || (Bytes != EFI_PAGES_TO_SIZE (*PrpListNo))) {
-    DEBUG ((EFI_D_ERROR, "NvmeCreatePrpList: create PrpList failure!\n"));
-    goto EXIT;
+    Status = PciIo->Map (
+                      PciIo,
+                      EfiPciIoOperationBusMasterCommonBuffer,
+                      *PrpListHost,
+                      &Bytes,
+                      &PrpListPhyAddr,
+                      Mapping
+                      );
+
+    if (EFI_ERROR (Status) || (Bytes != EFI_PAGES_TO_SIZE (*PrpListNo))) {
+      DEBUG ((EFI_D_ERROR, "NvmeCreatePrpList: create PrpList failure!\n"));
+      goto EXIT;
+    }
   }
   //
   // Fill all PRP lists except of last one.
   //
   ZeroMem (*PrpListHost, Bytes);
   for (PrpListIndex = 0; PrpListIndex < *PrpListNo - 1; ++PrpListIndex) {
-    PrpListBase = *(UINT64*)PrpListHost + PrpListIndex * EFI_PAGE_SIZE;
+    PrpListBase = (UINTN)*PrpListHost + PrpListIndex * EFI_PAGE_SIZE;
 
     for (PrpEntryIndex = 0; PrpEntryIndex < PrpEntryNo; ++PrpEntryIndex) {
       if (PrpEntryIndex != PrpEntryNo - 1) {
@@ -302,7 +358,7 @@ NvmeCreatePrpList (
   //
   // Fill last PRP list.
   //
-  PrpListBase = *(UINT64*)PrpListHost + PrpListIndex * EFI_PAGE_SIZE;
+  PrpListBase = (UINTN)*PrpListHost + PrpListIndex * EFI_PAGE_SIZE;
   for (PrpEntryIndex = 0; PrpEntryIndex < Remainder; ++PrpEntryIndex) {
     *((UINT64*)(UINTN)PrpListBase + PrpEntryIndex) = PhysicalAddr;
     PhysicalAddr += EFI_PAGE_SIZE;
@@ -311,10 +367,48 @@ NvmeCreatePrpList (
   return (VOID*)(UINTN)PrpListPhyAddr;
 
 EXIT:
+  if (*Mapping != NULL) {
+    PciIo->Unmap (PciIo, *Mapping);
+    *Mapping = NULL;
+  }
   PciIo->FreeBuffer (PciIo, *PrpListNo, *PrpListHost);
   return NULL;
 }
 
+/**
+  Free the PRP lists created by NvmeCreatePrpList().
+
+  @param[in]     Private             The pointer to the NVME_CONTROLLER_PRIVATE_DATA data structure.
+  @param[in]     PrpListHost         The host base address of PRP lists.
+  @param[in]     PrpListNo           The number of PRP List.
+  @param[in]     Mapping             The mapping value returned by NvmeCreatePrpList().
+
+**/
+VOID
+NvmeFreePrpList (
+  IN NVME_CONTROLLER_PRIVATE_DATA     *Private,
+  IN VOID                             *PrpListHost,
+  IN UINTN                            PrpListNo,
+  IN VOID                             *Mapping
+  )
+{
+  UINTN                       PoolIndex;
+  EFI_TPL                     OldTpl;
+
+  if (Mapping != NULL) {
+    Private->PciIo->Unmap (Private->PciIo, Mapping);
+    Private->PciIo->FreeBuffer (Private->PciIo, PrpListNo, PrpListHost);
+    return;
+  }
+
+  PoolIndex = EFI_SIZE_TO_PAGES ((UINTN)PrpListHost - (UINTN)Private->PrpPool);
+  ASSERT (PoolIndex + PrpListNo <= NVME_PRP_POOL_PAGES);
+
+  OldTpl = gBS->RaiseTPL (TPL_NOTIFY);
+  Private->PrpPoolUsed &= ~LShiftU64 (LShiftU64 (1, PrpListNo) - 1, PoolIndex);
+  gBS->RestoreTPL (OldTpl);
+}
+
 
 /**
   Sends an NVM Express Command Packet to an NVM Express controller or namespace. This function supports
@@ -363,6 +457,7 @@ NvmExpressPassThru (
   NVME_SQ                        *Sq;
   NVME_CQ                        *Cq;
   UINT16                         QueueId;
+  UINT16                         Sqt;
   UINT32                         Bytes;
   UINT16                         Offset;
   EFI_EVENT                      TimerEvent;
@@ -450,6 +545,7 @@ NvmExpressPassThru (
   PrpListNo   = 0;
   Prp         = NULL;
   TimerEvent  = NULL;
+  AsyncRequest = NULL;
   Status      = EFI_SUCCESS;
 
   if (Packet->QueueType == NVME_ADMIN_QUEUE) {
@@ -558,8 +654,9 @@ NvmExpressPassThru (
     // Create PrpList for remaining data buffer.
     //
     PhyAddr = (Sq->Prp[0] + EFI_PAGE_SIZE) & ~(EFI_PAGE_SIZE - 1);
-    Prp = NvmeCreatePrpList (PciIo, PhyAddr, EFI_SIZE_TO_PAGES(Offset + Bytes) - 1, &PrpListHost, &PrpListNo, &MapPrpList);
+    Prp = NvmeCreatePrpList (Private, PhyAddr, EFI_SIZE_TO_PAGES(Offset + Bytes) - 1, &PrpListHost, &PrpListNo, &MapPrpList);
     if (Prp == NULL) {
+      Status = EFI_OUT_OF_RESOURCES;
       goto EXIT;
     }
 
@@ -594,27 +691,9 @@ NvmExpressPassThru (
   }
 
   //
-  // Ring the submission queue doorbell.
-  //
-  if ((Event != NULL) && (QueueId != 0)) {
-    Private->SqTdbl[QueueId].Sqt =
-      (Private->SqTdbl[QueueId].Sqt + 1) % (NVME_ASYNC_CSQ_SIZE + 1);
-  } else {
-    Private->SqTdbl[QueueId].Sqt ^= 1;
-  }
-  Data = ReadUnaligned32 ((UINT32*)&Private->SqTdbl[QueueId]);
-  PciIo->Mem.Write (
-               PciIo,
-               EfiPciIoWidthUint32,
-               NVME_BAR,
-               NVME_SQTDBL_OFFSET(QueueId, Private->Cap.Dstrd),
-               1,
-               &Data
-               );
-
-  //
-  // For non-blocking requests, return directly if the command is placed
-  // in the submission queue.
+  // For non-blocking requests, the mappings and PRP lists are released when
+  // the command completes. The request is queued before the doorbell is rung,
+  // so that the asynchronous I/O timer always finds the completed command.
   //
   if ((Event != NULL) && (QueueId != 0)) {
     AsyncRequest = AllocateZeroPool (sizeof (NVME_PASS_THRU_ASYNC_REQ));
@@ -627,11 +706,59 @@ NvmExpressPassThru (
     AsyncRequest->Packet        = Packet;
     AsyncRequest->CommandId     = Sq->Cid;
     AsyncRequest->CallerEvent   = Event;
+    AsyncRequest->MapData       = MapData;
+    AsyncRequest->MapMeta       = MapMeta;
+    if (Prp != NULL) {
+      AsyncRequest->MapPrpList  = MapPrpList;
+      AsyncRequest->PrpListHost = PrpListHost;
+      AsyncRequest->PrpListNo   = PrpListNo;
+    }
 
     OldTpl = gBS->RaiseTPL (TPL_NOTIFY);
     InsertTailList (&Private->AsyncPassThruQueue, &AsyncRequest->Link);
     gBS->RestoreTPL (OldTpl);
+  }
 
+  //
+  // Ring the submission queue doorbell.
+  //
+  Sqt = Private->SqTdbl[QueueId].Sqt;
+  if ((Event != NULL) && (QueueId != 0)) {
+    Private->SqTdbl[QueueId].Sqt =
+      (Private->SqTdbl[QueueId].Sqt + 1) % (NVME_ASYNC_CSQ_SIZE + 1);
+  } else {
+    Private->SqTdbl[QueueId].Sqt ^= 1;
+  }
+  Data = ReadUnaligned32 ((UINT32*)&Private->SqTdbl[QueueId]);
+  Status = PciIo->Mem.Write (
+                        PciIo,
+                        EfiPciIoWidthUint32,
+                        NVME_BAR,
+                        NVME_SQTDBL_OFFSET(QueueId, Private->Cap.Dstrd),
+                        1,
+                        &Data
+                        );
+  if (EFI_ERROR (Status)) {
+    //
+    // The controller has not seen the command: give its submission queue
+    // entry back, and take the request off the queue again, as its
+    // resources are released below.
+    //
+    Private->SqTdbl[QueueId].Sqt = Sqt;
+    if (AsyncRequest != NULL) {
+      OldTpl = gBS->RaiseTPL (TPL_NOTIFY);
+      RemoveEntryList (&AsyncRequest->Link);
+      gBS->RestoreTPL (OldTpl);
+      FreePool (AsyncRequest);
+    }
+    goto EXIT;
+  }
+
+  //
+  // For non-blocking requests, return directly if the command is placed
+  // in the submission queue.
+  //
+  if ((Event != NULL) && (QueueId != 0)) {
     return EFI_SUCCESS;
   }
 
@@ -723,15 +850,8 @@ EXIT:
              );
   }
 
-  if (MapPrpList != NULL) {
-    PciIo->Unmap (
-             PciIo,
-             MapPrpList
-             );
-  }
-
   if (Prp != NULL) {
-    PciIo->FreeBuffer (PciIo, PrpListNo, PrpListHost);
+    NvmeFreePrpList (Private, PrpListHost, PrpListNo, MapPrpList);
   }
 
   if (TimerEvent != NULL) {
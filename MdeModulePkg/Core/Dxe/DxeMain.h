@@ -53,6 +53,7 @@ WITHOUT WARRANTIES OR REPRESENTATIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED.
 #include <Protocol/TcgService.h>
 #include <Protocol/HiiPackageList.h>
 #include <Protocol/SmmBase2.h>
+#include <Protocol/TimerStatistics.h>
 #include <Guid/MemoryTypeInformation.h>
 #include <Guid/FirmwareFileSystem2.h>
 #include <Guid/FirmwareFileSystem3.h>
@@ -419,6 +420,16 @@ CoreInitializeEventServices (
   );
 
 
+/**
+  Install the timer statistics protocol.
+
+**/
+VOID
+CoreInstallTimerStatisticsProtocol (
+  VOID
+  );
+
+
 /**
   Add the Image Services to EFI Boot Services Table and install the protocol
   interfaces for this image.
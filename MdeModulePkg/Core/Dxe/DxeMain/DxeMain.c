@@ -396,6 +396,8 @@ DxeMain (
 
   MemoryProfileInstallProtocol ();
 
+  CoreInstallTimerStatisticsProtocol ();
+
   CoreInitializePropertiesTable ();
   CoreInitializeMemoryAttributesTable ();
 
@@ -168,6 +168,7 @@ CoreDispatchEventNotifies (
 {
   IEVENT          *Event;
   LIST_ENTRY      *Head;
+  UINT64          StartTick;
 
   CoreAcquireEventLock ();
   ASSERT (gEventQueueLock.OwnerTpl == Priority);
@@ -197,8 +198,21 @@ CoreDispatchEventNotifies (
     // Notify this event
     //
     ASSERT (Event->NotifyFunction != NULL);
+    StartTick = 0;
+    PERF_CODE (
+      if ((Event->Type & EVT_TIMER) != 0) {
+        StartTick = CoreStartTimerNotify ();
+      }
+    );
+
     Event->NotifyFunction (Event, Event->NotifyContext);
 
+    PERF_CODE (
+      if ((Event->Type & EVT_TIMER) != 0) {
+        CoreEndTimerNotify (StartTick);
+      }
+    );
+
     //
     // Check for next pending event
     //
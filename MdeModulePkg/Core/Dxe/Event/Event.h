@@ -36,11 +36,29 @@ extern  UINTN                   gEventPending;
 ///
 /// Timer event information
 ///
-typedef struct {
-  LIST_ENTRY      Link;
-  UINT64          TriggerTime;
-  UINT64          Period;
-} TIMER_EVENT_INFO;
+/// Queued timer events form a pairing heap ordered by TriggerTime, and then
+/// by Sequence so that timers due at the same time expire in the order they
+/// were set.
+///
+typedef struct _TIMER_EVENT_INFO  TIMER_EVENT_INFO;
+struct _TIMER_EVENT_INFO {
+  BOOLEAN           Queued;
+  ///
+  /// First child of this node in the timer heap
+  ///
+  TIMER_EVENT_INFO  *Child;
+  ///
+  /// Next sibling of this node in the timer heap
+  ///
+  TIMER_EVENT_INFO  *Sibling;
+  ///
+  /// Previous sibling of this node, or its parent if it is the first child
+  ///
+  TIMER_EVENT_INFO  *Prev;
+  UINT64            TriggerTime;
+  UINT64            Period;
+  UINT64            Sequence;
+};
 
 #define EVENT_SIGNATURE         SIGNATURE_32('e','v','n','t')
 typedef struct {
@@ -94,4 +112,32 @@ CoreInitializeTimer (
   VOID
   );
 
+
+/**
+  Returns the current value of the performance counter, to time the
+  notification function of a timer event. Only called when performance
+  measurement is enabled.
+
+  @return The current value of the performance counter
+
+**/
+UINT64
+CoreStartTimerNotify (
+  VOID
+  );
+
+
+/**
+  Accounts the time spent in the notification function of a timer event
+  into the timer statistics.
+
+  @param  StartTick              The value returned by CoreStartTimerNotify ()
+                                 before the notification function was called
+
+**/
+VOID
+CoreEndTimerNotify (
+  IN UINT64   StartTick
+  );
+
 #endif
@@ -20,16 +20,144 @@ WITHOUT WARRANTIES OR REPRESENTATIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED.
 // Internal data
 //
 
-LIST_ENTRY       mEfiTimerList = INITIALIZE_LIST_HEAD_VARIABLE (mEfiTimerList);
+TIMER_EVENT_INFO *mEfiTimerHeap = NULL;
+UINT64           mEfiTimerSequence = 0;
 EFI_LOCK         mEfiTimerLock = EFI_INITIALIZE_LOCK_VARIABLE (TPL_HIGH_LEVEL - 1);
 EFI_EVENT        mEfiCheckTimerEvent = NULL;
 
 EFI_LOCK         mEfiSystemTimeLock = EFI_INITIALIZE_LOCK_VARIABLE (TPL_HIGH_LEVEL);
 UINT64           mEfiSystemTime = 0;
 
+//
+// Timer statistics. The tick fields are protected by mEfiSystemTimeLock,
+// the others by mEfiTimerLock.
+//
+EDKII_TIMER_STATISTICS  mEfiTimerStatistics = { 0, MAX_UINT64 };
+UINT64                  mEfiPerformanceCounterStart = 0;
+UINT64                  mEfiPerformanceCounterEnd   = 0;
+
 //
 // Timer functions
 //
+/**
+  Checks whether a timer expires before another one.
+
+  @param  Timer1                 The first timer
+  @param  Timer2                 The second timer
+
+  @retval TRUE                   Timer1 expires before Timer2.
+  @retval FALSE                  Timer1 expires after Timer2.
+
+**/
+BOOLEAN
+CoreTimerBefore (
+  IN TIMER_EVENT_INFO   *Timer1,
+  IN TIMER_EVENT_INFO   *Timer2
+  )
+{
+  if (Timer1->TriggerTime != Timer2->TriggerTime) {
+    return (BOOLEAN) (Timer1->TriggerTime < Timer2->TriggerTime);
+  }
+  return (BOOLEAN) (Timer1->Sequence < Timer2->Sequence);
+}
+
+/**
+  Melds two timer heaps. The heap that expires last becomes the first child
+  of the other one.
+
+  @param  Heap1                  The root of the first heap, or NULL
+  @param  Heap2                  The root of the second heap, or NULL
+
+  @return The root of the melded heap
+
+**/
+TIMER_EVENT_INFO *
+CoreMeldTimerHeaps (
+  IN TIMER_EVENT_INFO   *Heap1,
+  IN TIMER_EVENT_INFO   *Heap2
+  )
+{
+  TIMER_EVENT_INFO  *Root;
+  TIMER_EVENT_INFO  *Child;
+
+  if (Heap1 == NULL) {
+    return Heap2;
+  }
+  if (Heap2 == NULL) {
+    return Heap1;
+  }
+
+  if (CoreTimerBefore (Heap2, Heap1)) {
+    Root  = Heap2;
+    Child = Heap1;
+  } else {
+    Root  = Heap1;
+    Child = Heap2;
+  }
+
+  Child->Prev    = Root;
+  Child->Sibling = Root->Child;
+  if (Root->Child != NULL) {
+    Root->Child->Prev = Child;
+  }
+  Root->Child = Child;
+
+  return Root;
+}
+
+/**
+  Melds a list of sibling timer heaps into a single heap, pairing them from
+  left to right, then melding the pairs from right to left.
+
+  @param  First                  The first heap of the sibling list, or NULL
+
+  @return The root of the melded heap
+
+**/
+TIMER_EVENT_INFO *
+CoreMergeTimerSiblings (
+  IN TIMER_EVENT_INFO   *First
+  )
+{
+  TIMER_EVENT_INFO  *Pairs;
+  TIMER_EVENT_INFO  *Heap1;
+  TIMER_EVENT_INFO  *Heap2;
+  TIMER_EVENT_INFO  *Next;
+  TIMER_EVENT_INFO  *Root;
+
+  Pairs = NULL;
+  while (First != NULL) {
+    Heap1 = First;
+    Heap2 = First->Sibling;
+    Next  = (Heap2 != NULL) ? Heap2->Sibling : NULL;
+
+    Heap1->Sibling = NULL;
+    Heap1->Prev    = NULL;
+    if (Heap2 != NULL) {
+      Heap2->Sibling = NULL;
+      Heap2->Prev    = NULL;
+      Heap1 = CoreMeldTimerHeaps (Heap1, Heap2);
+    }
+
+    //
+    // Stack the pairs so that they are melded from right to left
+    //
+    Heap1->Sibling = Pairs;
+    Pairs = Heap1;
+    First = Next;
+  }
+
+  Root = NULL;
+  while (Pairs != NULL) {
+    Next = Pairs->Sibling;
+    Pairs->Sibling = NULL;
+    Root = CoreMeldTimerHeaps (Root, Pairs);
+    Pairs = Next;
+  }
+
+  return Root;
+}
+
 /**
   Inserts the timer event.
 
@@ -42,29 +170,67 @@ CoreInsertEventTimer (
   IN IEVENT   *Event
   )
 {
-  UINT64          TriggerTime;
-  LIST_ENTRY      *Link;
-  IEVENT          *Event2;
+  TIMER_EVENT_INFO  *Timer;
 
   ASSERT_LOCKED (&mEfiTimerLock);
 
-  //
-  // Get the timer's trigger time
-  //
-  TriggerTime = Event->Timer.TriggerTime;
+  Timer = &Event->Timer;
+  ASSERT (!Timer->Queued);
 
-  //
-  // Insert the timer into the timer database in assending sorted order
-  //
-  for (Link = mEfiTimerList.ForwardLink; Link != &mEfiTimerList; Link = Link->ForwardLink) {
-    Event2 = CR (Link, IEVENT, Timer.Link, EVENT_SIGNATURE);
+  Timer->Queued   = TRUE;
+  Timer->Sequence = mEfiTimerSequence++;
+  Timer->Child    = NULL;
+  Timer->Sibling  = NULL;
+  Timer->Prev     = NULL;
 
-    if (Event2->Timer.TriggerTime > TriggerTime) {
-      break;
+  mEfiTimerHeap = CoreMeldTimerHeaps (mEfiTimerHeap, Timer);
+  mEfiTimerStatistics.QueuedTimers++;
+}
+
+/**
+  Removes the timer event from the timer database.
+
+  @param  Event                  Points to the internal structure of timer event
+                                 to be removed
+
+**/
+VOID
+CoreRemoveEventTimer (
+  IN IEVENT   *Event
+  )
+{
+  TIMER_EVENT_INFO  *Timer;
+  TIMER_EVENT_INFO  *Children;
+
+  ASSERT_LOCKED (&mEfiTimerLock);
+
+  Timer = &Event->Timer;
+  ASSERT (Timer->Queued);
+
+  Children = CoreMergeTimerSiblings (Timer->Child);
+  if (Timer == mEfiTimerHeap) {
+    mEfiTimerHeap = Children;
+  } else {
+    //
+    // Unlink the timer from its parent or previous sibling, and meld back
+    // its children
+    //
+    if (Timer->Prev->Child == Timer) {
+      Timer->Prev->Child = Timer->Sibling;
+    } else {
+      Timer->Prev->Sibling = Timer->Sibling;
+    }
+    if (Timer->Sibling != NULL) {
+      Timer->Sibling->Prev = Timer->Prev;
     }
+    mEfiTimerHeap = CoreMeldTimerHeaps (mEfiTimerHeap, Children);
   }
 
-  InsertTailList (Link, &Event->Timer.Link);
+  Timer->Queued  = FALSE;
+  Timer->Child   = NULL;
+  Timer->Sibling = NULL;
+  Timer->Prev    = NULL;
+  mEfiTimerStatistics.QueuedTimers--;
 }
 
 /**
@@ -104,15 +270,17 @@ CoreCheckTimers (
 {
   UINT64                  SystemTime;
   IEVENT                  *Event;
+  UINT64                  Fired;
 
   //
   // Check the timer database for expired timers
   //
   CoreAcquireLock (&mEfiTimerLock);
   SystemTime = CoreCurrentSystemTime ();
+  Fired      = 0;
 
-  while (!IsListEmpty (&mEfiTimerList)) {
-    Event = CR (mEfiTimerList.ForwardLink, IEVENT, Timer.Link, EVENT_SIGNATURE);
+  while (mEfiTimerHeap != NULL) {
+    Event = CR (mEfiTimerHeap, IEVENT, Timer, EVENT_SIGNATURE);
 
     //
     // If this timer is not expired, then we're done
@@ -124,9 +292,12 @@ CoreCheckTimers (
     //
     // Remove this timer from the timer queue
     //
+    CoreRemoveEventTimer (Event);
 
-    RemoveEntryList (&Event->Timer.Link);
-    Event->Timer.Link.ForwardLink = NULL;
+    Fired++;
+    if (SystemTime - Event->Timer.TriggerTime > mEfiTimerStatistics.MaxTimerLatency) {
+      mEfiTimerStatistics.MaxTimerLatency = SystemTime - Event->Timer.TriggerTime;
+    }
 
     //
     // Signal it
@@ -157,6 +328,11 @@ CoreCheckTimers (
     }
   }
 
+  mEfiTimerStatistics.TimersFired += Fired;
+  if (Fired > mEfiTimerStatistics.MaxTimersFiredPerTick) {
+    mEfiTimerStatistics.MaxTimersFiredPerTick = Fired;
+  }
+
   CoreReleaseLock (&mEfiTimerLock);
 }
 
@@ -181,6 +357,165 @@ CoreInitializeTimer (
              &mEfiCheckTimerEvent
              );
   ASSERT_EFI_ERROR (Status);
+
+  PERF_CODE (
+    GetPerformanceCounterProperties (&mEfiPerformanceCounterStart, &mEfiPerformanceCounterEnd);
+  );
+}
+
+
+/**
+  Returns the current value of the performance counter, to time the
+  notification function of a timer event. Only called when performance
+  measurement is enabled.
+
+  @return The current value of the performance counter
+
+**/
+UINT64
+CoreStartTimerNotify (
+  VOID
+  )
+{
+  return GetPerformanceCounter ();
+}
+
+
+/**
+  Accounts the time spent in the notification function of a timer event
+  into the timer statistics.
+
+  @param  StartTick              The value returned by CoreStartTimerNotify ()
+                                 before the notification function was called
+
+**/
+VOID
+CoreEndTimerNotify (
+  IN UINT64   StartTick
+  )
+{
+  UINT64  EndTick;
+  UINT64  Elapsed;
+  UINT64  CounterStart;
+  UINT64  CounterEnd;
+
+  EndTick = GetPerformanceCounter ();
+
+  //
+  // Normalize to an incrementing counter and account for a single wrap
+  //
+  CounterStart = mEfiPerformanceCounterStart;
+  CounterEnd   = mEfiPerformanceCounterEnd;
+  if (CounterStart > CounterEnd) {
+    StartTick    = CounterStart - StartTick;
+    EndTick      = CounterStart - EndTick;
+    CounterEnd   = CounterStart - CounterEnd;
+    CounterStart = 0;
+  }
+  if (EndTick >= StartTick) {
+    Elapsed = EndTick - StartTick;
+  } else {
+    Elapsed = (CounterEnd - StartTick) + (EndTick - CounterStart);
+  }
+  Elapsed = DivU64x32 (GetTimeInNanoSecond (Elapsed), 100);
+
+  CoreAcquireLock (&mEfiTimerLock);
+  mEfiTimerStatistics.NotifyCount++;
+  if (Elapsed > mEfiTimerStatistics.MaxNotifyTime) {
+    mEfiTimerStatistics.MaxNotifyTime = Elapsed;
+  }
+  CoreReleaseLock (&mEfiTimerLock);
+}
+
+
+/**
+  Get the timer statistics gathered since boot or since the last reset.
+
+  @param  This                   The protocol instance pointer.
+  @param  Statistics             Returns the timer statistics.
+
+  @retval EFI_SUCCESS            The statistics were returned.
+  @retval EFI_INVALID_PARAMETER  Statistics is NULL.
+
+**/
+EFI_STATUS
+EFIAPI
+CoreGetTimerStatistics (
+  IN  EDKII_TIMER_STATISTICS_PROTOCOL *This,
+  OUT EDKII_TIMER_STATISTICS          *Statistics
+  )
+{
+  if (Statistics == NULL) {
+    return EFI_INVALID_PARAMETER;
+  }
+
+  CoreAcquireLock (&mEfiTimerLock);
+  CoreAcquireLock (&mEfiSystemTimeLock);
+  CopyMem (Statistics, &mEfiTimerStatistics, sizeof (EDKII_TIMER_STATISTICS));
+  CoreReleaseLock (&mEfiSystemTimeLock);
+  CoreReleaseLock (&mEfiTimerLock);
+
+  if (Statistics->TickCount == 0) {
+    Statistics->MinTickPeriod = 0;
+  }
+  return EFI_SUCCESS;
+}
+
+
+/**
+  Reset the timer statistics. QueuedTimers is not affected.
+
+  @param  This                   The protocol instance pointer.
+
+  @retval EFI_SUCCESS            The statistics were reset.
+
+**/
+EFI_STATUS
+EFIAPI
+CoreResetTimerStatistics (
+  IN  EDKII_TIMER_STATISTICS_PROTOCOL *This
+  )
+{
+  UINT64  QueuedTimers;
+
+  CoreAcquireLock (&mEfiTimerLock);
+  CoreAcquireLock (&mEfiSystemTimeLock);
+  QueuedTimers = mEfiTimerStatistics.QueuedTimers;
+  ZeroMem (&mEfiTimerStatistics, sizeof (EDKII_TIMER_STATISTICS));
+  mEfiTimerStatistics.MinTickPeriod = MAX_UINT64;
+  mEfiTimerStatistics.QueuedTimers  = QueuedTimers;
+  CoreReleaseLock (&mEfiSystemTimeLock);
+  CoreReleaseLock (&mEfiTimerLock);
+
+  return EFI_SUCCESS;
+}
+
+EDKII_TIMER_STATISTICS_PROTOCOL mTimerStatisticsProtocol = {
+  CoreGetTimerStatistics,
+  CoreResetTimerStatistics
+};
+
+
+/**
+  Install the timer statistics protocol.
+
+**/
+VOID
+CoreInstallTimerStatisticsProtocol (
+  VOID
+  )
+{
+  EFI_HANDLE    Handle;
+  EFI_STATUS    Status;
+
+  Handle = NULL;
+  Status = CoreInstallMultipleProtocolInterfaces (
+             &Handle,
+             &gEdkiiTimerStatisticsProtocolGuid,
+             &mTimerStatisticsProtocol,
+             NULL
+             );
+  ASSERT_EFI_ERROR (Status);
 }
 
 
@@ -197,7 +532,7 @@ CoreTimerTick (
   IN UINT64   Duration
   )
 {
-  IEVENT          *Event;
+  TIMER_EVENT_INFO  *Timer;
 
   //
   // Check runtiem flag in case there are ticks while exiting boot services
@@ -209,14 +544,21 @@ CoreTimerTick (
   //
   mEfiSystemTime += Duration;
 
+  mEfiTimerStatistics.TickCount++;
+  if (Duration < mEfiTimerStatistics.MinTickPeriod) {
+    mEfiTimerStatistics.MinTickPeriod = Duration;
+  }
+  if (Duration > mEfiTimerStatistics.MaxTickPeriod) {
+    mEfiTimerStatistics.MaxTickPeriod = Duration;
+  }
+
   //
-  // If the head of the list is expired, fire the timer event
+  // If the root of the timer heap is expired, fire the timer event
   // to process it
   //
-  if (!IsListEmpty (&mEfiTimerList)) {
-    Event = CR (mEfiTimerList.ForwardLink, IEVENT, Timer.Link, EVENT_SIGNATURE);
-
-    if (Event->Timer.TriggerTime <= mEfiSystemTime) {
+  Timer = mEfiTimerHeap;
+  if (Timer != NULL) {
+    if (Timer->TriggerTime <= mEfiSystemTime) {
       CoreSignalEvent (mEfiCheckTimerEvent);
     }
   }
@@ -270,9 +612,8 @@ CoreSetTimer (
   //
   // If the timer is queued to the timer database, remove it
   //
-  if (Event->Timer.Link.ForwardLink != NULL) {
-    RemoveEntryList (&Event->Timer.Link);
-    Event->Timer.Link.ForwardLink = NULL;
+  if (Event->Timer.Queued) {
+    CoreRemoveEventTimer (Event);
   }
 
   Event->Timer.TriggerTime = 0;
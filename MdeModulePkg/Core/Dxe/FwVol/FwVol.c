@@ -3,7 +3,7 @@
   Layers on top of Firmware Block protocol to produce a file abstraction
   of FV based files.
 
-Copyright (c) 2006 - 2014, Intel Corporation. All rights reserved.<BR>
+Copyright (c) 2006 - 2017, Intel Corporation. All rights reserved.<BR>
 This program and the accompanying materials
 are licensed and made available under the terms and conditions of the BSD License
 which accompanies this distribution.  The full text of the license may be found at
@@ -45,6 +45,10 @@ FV_DEVICE mFvDevice = {
   NULL,
   NULL,
   { NULL, NULL },
+  NULL,
+  0,
+  NULL,
+  0,
   0,
   0,
   FALSE,
@@ -288,6 +292,18 @@ FreeFvDeviceResource (
     FfsFileEntry = (FFS_FILE_LIST_ENTRY *) NextEntry;
   }
 
+  //
+  // Free the file index
+  //
+  if (FvDevice->FfsFileIndex != NULL) {
+    CoreFreePool (FvDevice->FfsFileIndex);
+    FvDevice->FfsFileIndex = NULL;
+  }
+  if (FvDevice->FfsFileHashTable != NULL) {
+    CoreFreePool (FvDevice->FfsFileHashTable);
+    FvDevice->FfsFileHashTable = NULL;
+  }
+
   if (!FvDevice->IsMemoryMapped) {
     //
     // Free the cached FV buffer.
@@ -305,6 +321,153 @@ FreeFvDeviceResource (
 
 
 
+/**
+  Computes the hash value of a file name.
+
+  @param  NameGuid              The name of the file.
+
+  @return The hash value, to be reduced modulo the size of the table it indexes
+
+**/
+UINTN
+FvHashFileName (
+  IN CONST EFI_GUID   *NameGuid
+  )
+{
+  UINT32  *Data;
+  UINT32  Hash;
+
+  Data = (UINT32 *) NameGuid;
+  Hash = ReadUnaligned32 (&Data[0]) ^ ReadUnaligned32 (&Data[1]) ^
+         ReadUnaligned32 (&Data[2]) ^ ReadUnaligned32 (&Data[3]);
+  Hash ^= Hash >> 16;
+  Hash ^= Hash >> 8;
+  return (UINTN) Hash;
+}
+
+
+
+/**
+  Build the file index of an FV from its list of non-deleted files.
+
+  The index holds the name and type of every file in FV order, and a table of
+  the non-pad files hashed by name. It is built once when the FV is checked,
+  and then used by GetNextFile(), ReadFile() and ReadSection().
+
+  @param  FvDevice              The FV whose FfsFileListHeader has been built.
+
+  @retval EFI_OUT_OF_RESOURCES  No enough buffer could be allocated.
+  @retval EFI_SUCCESS           The file index is built.
+
+**/
+EFI_STATUS
+FvBuildFileIndex (
+  IN OUT FV_DEVICE  *FvDevice
+  )
+{
+  LIST_ENTRY                            *Link;
+  FFS_FILE_LIST_ENTRY                   *FfsFileEntry;
+  FFS_FILE_INDEX_ENTRY                  *IndexEntry;
+  UINTN                                 Count;
+  UINTN                                 HashSize;
+  UINTN                                 Index;
+  UINTN                                 Bucket;
+
+  Count = 0;
+  for (Link = FvDevice->FfsFileListHeader.ForwardLink;
+       Link != &FvDevice->FfsFileListHeader;
+       Link = Link->ForwardLink) {
+    Count++;
+  }
+
+  HashSize = 1;
+  while (HashSize < Count) {
+    HashSize <<= 1;
+  }
+
+  FvDevice->FfsFileHashTable = AllocateZeroPool (HashSize * sizeof (UINT32));
+  if (FvDevice->FfsFileHashTable == NULL) {
+    return EFI_OUT_OF_RESOURCES;
+  }
+  FvDevice->FfsFileHashSize = HashSize;
+
+  if (Count == 0) {
+    return EFI_SUCCESS;
+  }
+
+  FvDevice->FfsFileIndex = AllocatePool (Count * sizeof (FFS_FILE_INDEX_ENTRY));
+  if (FvDevice->FfsFileIndex == NULL) {
+    return EFI_OUT_OF_RESOURCES;
+  }
+  FvDevice->FfsFileCount = Count;
+
+  Index = 0;
+  for (Link = FvDevice->FfsFileListHeader.ForwardLink;
+       Link != &FvDevice->FfsFileListHeader;
+       Link = Link->ForwardLink) {
+    FfsFileEntry = (FFS_FILE_LIST_ENTRY *) Link;
+    FfsFileEntry->Index = Index;
+
+    IndexEntry = &FvDevice->FfsFileIndex[Index];
+    CopyGuid (&IndexEntry->Name, &FfsFileEntry->FfsHeader->Name);
+    IndexEntry->Type      = FfsFileEntry->FfsHeader->Type;
+    IndexEntry->HashNext  = FFS_FILE_HASH_END;
+    IndexEntry->FileEntry = FfsFileEntry;
+    Index++;
+  }
+
+  //
+  // Insert the files from the end of the FV, so that each hash chain lists
+  // its files in FV order and a lookup finds the first file of a given name,
+  // as the walk of the file list did. Pad files are never looked up by name.
+  //
+  for (Index = Count; Index > 0; Index--) {
+    IndexEntry = &FvDevice->FfsFileIndex[Index - 1];
+    if (IndexEntry->Type == EFI_FV_FILETYPE_FFS_PAD) {
+      continue;
+    }
+    Bucket = FvHashFileName (&IndexEntry->Name) & (HashSize - 1);
+    IndexEntry->HashNext = FvDevice->FfsFileHashTable[Bucket];
+    FvDevice->FfsFileHashTable[Bucket] = (UINT32) Index;
+  }
+
+  return EFI_SUCCESS;
+}
+
+
+
+/**
+  Find the first non-pad file of the FV with a given name in the file index.
+
+  @param  FvDevice       The FV to search
+  @param  NameGuid       The name of the file
+
+  @return The FFS_FILE_LIST_ENTRY of the file, or NULL if it is not in the FV
+
+**/
+FFS_FILE_LIST_ENTRY *
+FvLocateFileEntry (
+  IN FV_DEVICE            *FvDevice,
+  IN CONST EFI_GUID       *NameGuid
+  )
+{
+  FFS_FILE_INDEX_ENTRY    *IndexEntry;
+  UINT32                  Next;
+
+  Next = FvDevice->FfsFileHashTable[FvHashFileName (NameGuid) & (FvDevice->FfsFileHashSize - 1)];
+  while (Next != FFS_FILE_HASH_END) {
+    IndexEntry = &FvDevice->FfsFileIndex[Next - 1];
+    if (CompareGuid (&IndexEntry->Name, NameGuid)) {
+      return IndexEntry->FileEntry;
+    }
+    Next = IndexEntry->HashNext;
+  }
+
+  return NULL;
+}
+
+
+
 /**
   Check if an FV is consistent and allocate cache for it.
 
@@ -596,6 +759,13 @@ FvCheck (
   }
 
 Done:
+  if (!EFI_ERROR (Status)) {
+    //
+    // Index the files once, for all the following file queries
+    //
+    Status = FvBuildFileIndex (FvDevice);
+  }
+
   if (EFI_ERROR (Status)) {
     if (FileCached) {
       CoreFreePool (CacheFfsHeader);
@@ -2,7 +2,7 @@
   Firmware File System protocol. Layers on top of Firmware
   Block protocol to produce a file abstraction of FV based files.
 
-Copyright (c) 2006 - 2014, Intel Corporation. All rights reserved.<BR>
+Copyright (c) 2006 - 2017, Intel Corporation. All rights reserved.<BR>
 This program and the accompanying materials
 are licensed and made available under the terms and conditions of the BSD License
 which accompanies this distribution.  The full text of the license may be found at
@@ -19,6 +19,12 @@ WITHOUT WARRANTIES OR REPRESENTATIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED.
 
 #define FV2_DEVICE_SIGNATURE SIGNATURE_32 ('_', 'F', 'V', '2')
 
+//
+// Value of FFS_FILE_INDEX_ENTRY.HashNext and of the FfsFileHashTable buckets
+// that ends a hash chain. Other values are the position in FfsFileIndex plus one.
+//
+#define FFS_FILE_HASH_END    0
+
 //
 // Used to track all non-deleted files
 //
@@ -27,8 +33,27 @@ typedef struct {
   EFI_FFS_FILE_HEADER             *FfsHeader;
   UINTN                           StreamHandle;
   BOOLEAN                         FileCached;
+  ///
+  /// Position of the file in FV_DEVICE.FfsFileIndex
+  ///
+  UINTN                           Index;
 } FFS_FILE_LIST_ENTRY;
 
+//
+// Compact copy of the name and type of each non-deleted file, in the order of
+// the files in the FV. Queries by type or name only touch this array and not
+// the FFS headers, which may be in flash.
+//
+typedef struct {
+  EFI_GUID                        Name;
+  EFI_FV_FILETYPE                 Type;
+  ///
+  /// Next file of the same FfsFileHashTable bucket, in FV order
+  ///
+  UINT32                          HashNext;
+  FFS_FILE_LIST_ENTRY             *FileEntry;
+} FFS_FILE_INDEX_ENTRY;
+
 typedef struct {
   UINTN                                   Signature;
   EFI_FIRMWARE_VOLUME_BLOCK_PROTOCOL      *Fvb;
@@ -43,6 +68,11 @@ typedef struct {
 
   LIST_ENTRY                              FfsFileListHeader;
 
+  FFS_FILE_INDEX_ENTRY                    *FfsFileIndex;
+  UINTN                                   FfsFileCount;
+  UINT32                                  *FfsFileHashTable;
+  UINTN                                   FfsFileHashSize;
+
   UINT32                                  AuthenticationStatus;
   UINT8                                   ErasePolarity;
   BOOLEAN                                 IsFfs3Fv;
@@ -405,4 +435,20 @@ IsValidFfsFile (
   IN EFI_FFS_FILE_HEADER  *FfsHeader
   );
 
+
+/**
+  Find the first non-pad file of the FV with a given name in the file index.
+
+  @param  FvDevice       The FV to search
+  @param  NameGuid       The name of the file
+
+  @return The FFS_FILE_LIST_ENTRY of the file, or NULL if it is not in the FV
+
+**/
+FFS_FILE_LIST_ENTRY *
+FvLocateFileEntry (
+  IN FV_DEVICE            *FvDevice,
+  IN CONST EFI_GUID       *NameGuid
+  );
+
 #endif
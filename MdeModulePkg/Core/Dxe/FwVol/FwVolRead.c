@@ -1,7 +1,7 @@
 /** @file
   Implements functions to read firmware file
 
-Copyright (c) 2006 - 2016, Intel Corporation. All rights reserved.<BR>
+Copyright (c) 2006 - 2017, Intel Corporation. All rights reserved.<BR>
 This program and the accompanying materials
 are licensed and made available under the terms and conditions of the BSD License
 which accompanies this distribution.  The full text of the license may be found at
@@ -119,8 +119,8 @@ FvGetNextFile (
   EFI_FV_ATTRIBUTES                           FvAttributes;
   EFI_FFS_FILE_HEADER                         *FfsFileHeader;
   UINTN                                       *KeyValue;
-  LIST_ENTRY                                  *Link;
-  FFS_FILE_LIST_ENTRY                         *FfsFileEntry;
+  UINTN                                       Index;
+  FFS_FILE_INDEX_ENTRY                        *IndexEntry;
 
   FvDevice = FV_DEVICE_FROM_THIS (This);
 
@@ -143,36 +143,27 @@ FvGetNextFile (
     return EFI_NOT_FOUND;
   }
 
+  IndexEntry = NULL;
   KeyValue = (UINTN *)Key;
-  for (;;) {
-    if (*KeyValue == 0) {
-      //
-      // Search for 1st matching file
-      //
-      Link = &FvDevice->FfsFileListHeader;
-    } else {
-      //
-      // Key is pointer to FFsFileEntry, so get next one
-      //
-      Link = (LIST_ENTRY *)(*KeyValue);
-    }
-
-    if (Link->ForwardLink == &FvDevice->FfsFileListHeader) {
-      //
-      // Next is end of list so we did not find data
-      //
-      return EFI_NOT_FOUND;
-    }
-
-    FfsFileEntry = (FFS_FILE_LIST_ENTRY *)Link->ForwardLink;
-    FfsFileHeader = (EFI_FFS_FILE_HEADER *)FfsFileEntry->FfsHeader;
-
+  if (*KeyValue == 0) {
+    //
+    // Search for 1st matching file
     //
-    // remember the key
+    Index = 0;
+  } else {
     //
-    *KeyValue = (UINTN)FfsFileEntry;
+    // Key is pointer to FFsFileEntry, so start from the next one
+    //
+    Index = ((FFS_FILE_LIST_ENTRY *)(*KeyValue))->Index + 1;
+  }
 
-    if (FfsFileHeader->Type == EFI_FV_FILETYPE_FFS_PAD) {
+  //
+  // Scan the file index, so the FFS headers of the skipped files are not read
+  //
+  for (; Index < FvDevice->FfsFileCount; Index++) {
+    IndexEntry = &FvDevice->FfsFileIndex[Index];
+
+    if (IndexEntry->Type == EFI_FV_FILETYPE_FFS_PAD) {
       //
       // we ignore pad files
       //
@@ -186,20 +177,35 @@ FvGetNextFile (
       break;
     }
 
-    if (*FileType == FfsFileHeader->Type) {
+    if (*FileType == IndexEntry->Type) {
       //
       // Found a matching file type
       //
       break;
     }
+  }
 
+  if (Index >= FvDevice->FfsFileCount) {
+    //
+    // End of list so we did not find data
+    //
+    if (FvDevice->FfsFileCount != 0) {
+      *KeyValue = (UINTN)FvDevice->FfsFileIndex[FvDevice->FfsFileCount - 1].FileEntry;
+    }
+    return EFI_NOT_FOUND;
   }
 
+  //
+  // remember the key
+  //
+  *KeyValue = (UINTN)IndexEntry->FileEntry;
+  FfsFileHeader = IndexEntry->FileEntry->FfsHeader;
+
   //
   // Return FileType, NameGuid, and Attributes
   //
-  *FileType = FfsFileHeader->Type;
-  CopyGuid (NameGuid, &FfsFileHeader->Name);
+  *FileType = IndexEntry->Type;
+  CopyGuid (NameGuid, &IndexEntry->Name);
   *Attributes = FfsAttributes2FvFileAttributes (FfsFileHeader->Attributes);
   if ((FvDevice->FwVolHeader->Attributes & EFI_FVB2_MEMORY_MAPPED) == EFI_FVB2_MEMORY_MAPPED) {
     *Attributes |= EFI_FV_FILE_ATTRIB_MEMORY_MAPPED;
@@ -273,9 +279,7 @@ FvReadFile (
 {
   EFI_STATUS                        Status;
   FV_DEVICE                         *FvDevice;
-  EFI_GUID                          SearchNameGuid;
-  EFI_FV_FILETYPE                   LocalFoundType;
-  EFI_FV_FILE_ATTRIBUTES            LocalAttributes;
+  EFI_FV_ATTRIBUTES                 FvAttributes;
   UINTN                             FileSize;
   UINT8                             *SrcPtr;
   EFI_FFS_FILE_HEADER               *FfsHeader;
@@ -289,30 +293,29 @@ FvReadFile (
   FvDevice = FV_DEVICE_FROM_THIS (This);
 
 
+  Status = FvGetVolumeAttributes (This, &FvAttributes);
+  if (EFI_ERROR (Status) || ((FvAttributes & EFI_FV2_READ_STATUS) == 0)) {
+    return EFI_NOT_FOUND;
+  }
+
   //
-  // Keep looking until we find the matching NameGuid.
+  // Look up the matching NameGuid in the file index.
   // The Key is really a FfsFileEntry
   //
-  FvDevice->LastKey = 0;
-  do {
-    LocalFoundType = 0;
-    Status = FvGetNextFile (
-              This,
-              &FvDevice->LastKey,
-              &LocalFoundType,
-              &SearchNameGuid,
-              &LocalAttributes,
-              &FileSize
-              );
-    if (EFI_ERROR (Status)) {
-      return EFI_NOT_FOUND;
-    }
-  } while (!CompareGuid (&SearchNameGuid, NameGuid));
+  FvDevice->LastKey = FvLocateFileEntry (FvDevice, NameGuid);
+  if (FvDevice->LastKey == NULL) {
+    return EFI_NOT_FOUND;
+  }
 
   //
-  // Get a pointer to the header
+  // Get a pointer to the header, and the size of the file without it
   //
   FfsHeader = FvDevice->LastKey->FfsHeader;
+  if (IS_FFS_FILE2 (FfsHeader)) {
+    FileSize = FFS_FILE2_SIZE (FfsHeader) - sizeof (EFI_FFS_FILE_HEADER2);
+  } else {
+    FileSize = FFS_FILE_SIZE (FfsHeader) - sizeof (EFI_FFS_FILE_HEADER);
+  }
   if (FvDevice->IsMemoryMapped) {
     //
     // Memory mapped FV has not been cached, so here is to cache by file.
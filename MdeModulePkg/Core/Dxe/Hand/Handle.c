@@ -18,11 +18,14 @@ WITHOUT WARRANTIES OR REPRESENTATIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED.
 
 //
 // mProtocolDatabase     - A list of all protocols in the system.  (simple list for now)
+// mProtocolHashTable    - The protocols of mProtocolDatabase, hashed by GUID
 // gHandleList           - A list of all the handles in the system
 // gProtocolDatabaseLock - Lock to protect the mProtocolDatabase
 // gHandleDatabaseKey    -  The Key to show that the handle has been created/modified
 //
 LIST_ENTRY      mProtocolDatabase     = INITIALIZE_LIST_HEAD_VARIABLE (mProtocolDatabase);
+LIST_ENTRY      mProtocolHashTable[PROTOCOL_HASH_SIZE];
+BOOLEAN         mProtocolHashTableInitialized = FALSE;
 LIST_ENTRY      gHandleList           = INITIALIZE_LIST_HEAD_VARIABLE (gHandleList);
 EFI_LOCK        gProtocolDatabaseLock = EFI_INITIALIZE_LOCK_VARIABLE (TPL_NOTIFY);
 UINT64          gHandleDatabaseKey    = 0;
@@ -85,6 +88,32 @@ CoreValidateHandle (
 
 
 
+/**
+  Computes the hash value of a protocol GUID.
+
+  @param  Protocol               The ID of the protocol
+
+  @return The hash value, to be reduced modulo the size of the table it indexes
+
+**/
+UINTN
+CoreHashProtocolGuid (
+  IN EFI_GUID   *Protocol
+  )
+{
+  UINT32  *Data;
+  UINT32  Hash;
+
+  Data = (UINT32 *) Protocol;
+  Hash = ReadUnaligned32 (&Data[0]) ^ ReadUnaligned32 (&Data[1]) ^
+         ReadUnaligned32 (&Data[2]) ^ ReadUnaligned32 (&Data[3]);
+  Hash ^= Hash >> 16;
+  Hash ^= Hash >> 8;
+  return (UINTN) Hash;
+}
+
+
+
 /**
   Finds the protocol entry for the requested protocol.
   The gProtocolDatabaseLock must be owned
@@ -102,22 +131,34 @@ CoreFindProtocolEntry (
   )
 {
   LIST_ENTRY          *Link;
+  LIST_ENTRY          *Bucket;
   PROTOCOL_ENTRY      *Item;
   PROTOCOL_ENTRY      *ProtEntry;
+  UINTN               Hash;
+  UINTN               Index;
 
   ASSERT_LOCKED(&gProtocolDatabaseLock);
 
+  if (!mProtocolHashTableInitialized) {
+    for (Index = 0; Index < PROTOCOL_HASH_SIZE; Index++) {
+      InitializeListHead (&mProtocolHashTable[Index]);
+    }
+    mProtocolHashTableInitialized = TRUE;
+  }
+
   //
-  // Search the database for the matching GUID
+  // Search the hash bucket of the GUID for the matching entry
   //
 
   ProtEntry = NULL;
-  for (Link = mProtocolDatabase.ForwardLink;
-       Link != &mProtocolDatabase;
+  Hash      = CoreHashProtocolGuid (Protocol);
+  Bucket    = &mProtocolHashTable[Hash % PROTOCOL_HASH_SIZE];
+  for (Link = Bucket->ForwardLink;
+       Link != Bucket;
        Link = Link->ForwardLink) {
 
-    Item = CR(Link, PROTOCOL_ENTRY, AllEntries, PROTOCOL_ENTRY_SIGNATURE);
-    if (CompareGuid (&Item->ProtocolID, Protocol)) {
+    Item = CR(Link, PROTOCOL_ENTRY, HashLink, PROTOCOL_ENTRY_SIGNATURE);
+    if (Item->Hash == Hash && CompareGuid (&Item->ProtocolID, Protocol)) {
 
       //
       // This is the protocol entry
@@ -140,14 +181,16 @@ CoreFindProtocolEntry (
       // Initialize new protocol entry structure
       //
       ProtEntry->Signature = PROTOCOL_ENTRY_SIGNATURE;
+      ProtEntry->Hash      = Hash;
       CopyGuid ((VOID *)&ProtEntry->ProtocolID, Protocol);
       InitializeListHead (&ProtEntry->Protocols);
       InitializeListHead (&ProtEntry->Notify);
 
       //
-      // Add it to protocol database
+      // Add it to protocol database and to the hash index
       //
       InsertTailList (&mProtocolDatabase, &ProtEntry->AllEntries);
+      InsertHeadList (Bucket, &ProtEntry->HashLink);
     }
   }
 
@@ -156,6 +199,79 @@ CoreFindProtocolEntry (
 
 
 
+/**
+  Finds the protocol interface installed on a handle for a protocol entry.
+  The gProtocolDatabaseLock must be owned
+
+  @param  Handle                 The handle to search the protocol on
+  @param  ProtEntry              The protocol entry of the protocol
+
+  @return Protocol instance (NULL: Not found)
+
+**/
+PROTOCOL_INTERFACE *
+CoreFindHandleProtocolEntry (
+  IN IHANDLE          *Handle,
+  IN PROTOCOL_ENTRY   *ProtEntry
+  )
+{
+  PROTOCOL_INTERFACE  *Prot;
+  LIST_ENTRY          *Link;
+  UINTN               Slot;
+
+  ASSERT_LOCKED(&gProtocolDatabaseLock);
+
+  //
+  // A handle carries at most one interface per protocol, so a hit in the
+  // protocol interface map of the handle is the answer
+  //
+  Slot = ProtEntry->Hash % HANDLE_PROTOCOL_MAP_SIZE;
+  Prot = Handle->ProtocolMap[Slot];
+  if (Prot != NULL && Prot->Protocol == ProtEntry) {
+    return Prot;
+  }
+
+  //
+  // Look at each protocol interface for a match, and remember it
+  //
+  for (Link = Handle->Protocols.ForwardLink; Link != &Handle->Protocols; Link = Link->ForwardLink) {
+    Prot = CR(Link, PROTOCOL_INTERFACE, Link, PROTOCOL_INTERFACE_SIGNATURE);
+    if (Prot->Protocol == ProtEntry) {
+      Handle->ProtocolMap[Slot] = Prot;
+      return Prot;
+    }
+  }
+
+  return NULL;
+}
+
+
+
+/**
+  Removes a protocol interface from the protocol interface map of its handle.
+  The gProtocolDatabaseLock must be owned
+
+  @param  Prot                   The protocol interface being removed from
+                                 its handle
+
+**/
+VOID
+CoreUnmapHandleProtocol (
+  IN PROTOCOL_INTERFACE   *Prot
+  )
+{
+  UINTN               Slot;
+
+  ASSERT_LOCKED(&gProtocolDatabaseLock);
+
+  Slot = Prot->Protocol->Hash % HANDLE_PROTOCOL_MAP_SIZE;
+  if (Prot->Handle->ProtocolMap[Slot] == Prot) {
+    Prot->Handle->ProtocolMap[Slot] = NULL;
+  }
+}
+
+
+
 /**
   Finds the protocol instance for the requested handle and protocol.
   Note: This function doesn't do parameters checking, it's caller's responsibility
@@ -177,7 +293,6 @@ CoreFindProtocolInterface (
 {
   PROTOCOL_INTERFACE  *Prot;
   PROTOCOL_ENTRY      *ProtEntry;
-  LIST_ENTRY          *Link;
 
   ASSERT_LOCKED(&gProtocolDatabaseLock);
   Prot = NULL;
@@ -190,18 +305,10 @@ CoreFindProtocolInterface (
   if (ProtEntry != NULL) {
 
     //
-    // Look at each protocol interface for any matches
+    // Look up the protocol interface of the handle, and check that it matches
     //
-    for (Link = Handle->Protocols.ForwardLink; Link != &Handle->Protocols; Link=Link->ForwardLink) {
-
-      //
-      // If this protocol interface matches, remove it
-      //
-      Prot = CR(Link, PROTOCOL_INTERFACE, Link, PROTOCOL_INTERFACE_SIGNATURE);
-      if (Prot->Interface == Interface && Prot->Protocol == ProtEntry) {
-        break;
-      }
-
+    Prot = CoreFindHandleProtocolEntry (Handle, ProtEntry);
+    if (Prot != NULL && Prot->Interface != Interface) {
       Prot = NULL;
     }
   }
@@ -779,6 +886,7 @@ CoreUninstallProtocolInterface (
     //
     // Remove the protocol interface from the handle
     //
+    CoreUnmapHandleProtocol (Prot);
     RemoveEntryList (&Prot->Link);
 
     //
@@ -893,9 +1001,7 @@ CoreGetProtocolInterface (
 {
   EFI_STATUS          Status;
   PROTOCOL_ENTRY      *ProtEntry;
-  PROTOCOL_INTERFACE  *Prot;
   IHANDLE             *Handle;
-  LIST_ENTRY          *Link;
 
   Status = CoreValidateHandle (UserHandle);
   if (EFI_ERROR (Status)) {
@@ -905,16 +1011,14 @@ CoreGetProtocolInterface (
   Handle = (IHANDLE *)UserHandle;
 
   //
-  // Look at each protocol interface for a match
+  // A protocol without an entry in the database is not installed anywhere
   //
-  for (Link = Handle->Protocols.ForwardLink; Link != &Handle->Protocols; Link = Link->ForwardLink) {
-    Prot = CR(Link, PROTOCOL_INTERFACE, Link, PROTOCOL_INTERFACE_SIGNATURE);
-    ProtEntry = Prot->Protocol;
-    if (CompareGuid (&ProtEntry->ProtocolID, Protocol)) {
-      return Prot;
-    }
+  ProtEntry = CoreFindProtocolEntry (Protocol, FALSE);
+  if (ProtEntry == NULL) {
+    return NULL;
   }
-  return NULL;
+
+  return CoreFindHandleProtocolEntry (Handle, ProtEntry);
 }
 
 
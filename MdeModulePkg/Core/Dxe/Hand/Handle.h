@@ -18,6 +18,16 @@ WITHOUT WARRANTIES OR REPRESENTATIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED.
 
 #define EFI_HANDLE_SIGNATURE            SIGNATURE_32('h','n','d','l')
 
+///
+/// Number of buckets of the GUID hash index of the protocol database
+///
+#define PROTOCOL_HASH_SIZE              64
+
+///
+/// Number of slots of the per-handle protocol interface map
+///
+#define HANDLE_PROTOCOL_MAP_SIZE        8
+
 ///
 /// IHANDLE - contains a list of protocol handles
 ///
@@ -30,6 +40,8 @@ typedef struct {
   UINTN               LocateRequest;
   /// The Handle Database Key value when this handle was last created or modified
   UINT64              Key;
+  /// Direct mapped PROTOCOL_INTERFACE's of this handle, indexed by PROTOCOL_ENTRY.Hash
+  struct _PROTOCOL_INTERFACE *ProtocolMap[HANDLE_PROTOCOL_MAP_SIZE];
 } IHANDLE;
 
 #define ASSERT_IS_HANDLE(a)  ASSERT((a)->Signature == EFI_HANDLE_SIGNATURE)
@@ -45,6 +57,10 @@ typedef struct {
   UINTN               Signature;
   /// Link Entry inserted to mProtocolDatabase
   LIST_ENTRY          AllEntries;  
+  /// Link Entry inserted to the mProtocolHashTable bucket of ProtocolID
+  LIST_ENTRY          HashLink;
+  /// Hash value of ProtocolID
+  UINTN               Hash;
   /// ID of the protocol
   EFI_GUID            ProtocolID;  
   /// All protocol interfaces
@@ -60,7 +76,7 @@ typedef struct {
 /// PROTOCOL_INTERFACE - each protocol installed on a handle is tracked
 /// with a protocol interface structure
 ///
-typedef struct {
+typedef struct _PROTOCOL_INTERFACE {
   UINTN                       Signature;
   /// Link on IHANDLE.Protocols
   LIST_ENTRY                  Link;   
@@ -159,6 +175,37 @@ CoreFindProtocolInterface (
   );
 
 
+/**
+  Finds the protocol interface installed on a handle for a protocol entry.
+  The gProtocolDatabaseLock must be owned
+
+  @param  Handle                 The handle to search the protocol on
+  @param  ProtEntry              The protocol entry of the protocol
+
+  @return Protocol instance (NULL: Not found)
+
+**/
+PROTOCOL_INTERFACE *
+CoreFindHandleProtocolEntry (
+  IN IHANDLE          *Handle,
+  IN PROTOCOL_ENTRY   *ProtEntry
+  );
+
+
+/**
+  Removes a protocol interface from the protocol interface map of its handle.
+  The gProtocolDatabaseLock must be owned
+
+  @param  Prot                   The protocol interface being removed from
+                                 its handle
+
+**/
+VOID
+CoreUnmapHandleProtocol (
+  IN PROTOCOL_INTERFACE   *Prot
+  );
+
+
 /**
   Removes Protocol from the protocol list (but not the handle list).
 
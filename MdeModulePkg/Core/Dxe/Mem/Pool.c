@@ -26,7 +26,7 @@ typedef struct {
 #define POOL_HEAD_SIGNATURE   SIGNATURE_32('p','h','d','0')
 typedef struct {
   UINT32          Signature;
-  UINT32          Reserved;
+  UINT32          SlabOffset;
   EFI_MEMORY_TYPE Type;
   UINTN           Size;
   CHAR8           Data[1];
@@ -62,6 +62,42 @@ STATIC CONST UINT16 mPoolSizeTable[] = {
 
 #define MAX_POOL_SIZE     (MAX_ADDRESS - POOL_OVERHEAD)
 
+//
+// All entries of mPoolSizeTable are multiples of POOL_SIZE_UNIT, so the bin
+// serving a given size can be found with a single lookup in mPoolSizeIndex.
+//
+#define POOL_SIZE_UNIT          128
+#define POOL_SIZE_INDEX_COUNT   (29824 / POOL_SIZE_UNIT + 1)
+
+//
+// A slab is a run of pages dedicated to a single bin. Its header sits at the
+// start of the run and the remaining space is handed out in blocks of the
+// bin size. Each block served from a slab records its offset from the slab
+// header in POOL_HEAD.SlabOffset, so that FreePool finds the slab in O(1).
+// Blocks beyond CarveOffset have never been handed out; blocks that have
+// been freed are kept on the slab's own FreeList.
+//
+#define POOL_SLAB_SIGNATURE   SIGNATURE_32('p','s','l','b')
+typedef struct {
+  UINT32          Signature;
+  UINT32          Index;
+  UINT32          Count;
+  UINT32          Used;
+  UINTN           CarveOffset;
+  UINTN           NoPages;
+  LIST_ENTRY      FreeList;
+  LIST_ENTRY      Link;
+} POOL_SLAB;
+
+#define SIZE_OF_POOL_SLAB  ALIGN_VALUE (sizeof (POOL_SLAB), sizeof (UINT64))
+
+//
+// Upper bound on the pages of a single slab, and the largest fraction
+// (1/POOL_SLAB_WASTE_RATIO) of a slab allowed to go unused.
+//
+#define MAX_POOL_SLAB_PAGES     8
+#define POOL_SLAB_WASTE_RATIO   8
+
 //
 // Globals
 //
@@ -72,6 +108,7 @@ typedef struct {
     UINTN            Used;
     EFI_MEMORY_TYPE  MemoryType;
     LIST_ENTRY       FreeList[MAX_POOL_LIST];
+    LIST_ENTRY       SlabList[MAX_POOL_LIST];
     LIST_ENTRY       Link;
 } POOL;
 
@@ -85,6 +122,16 @@ POOL            mPoolHead[EfiMaxMemoryType];
 //
 LIST_ENTRY      mPoolHeadList = INITIALIZE_LIST_HEAD_VARIABLE (mPoolHeadList);
 
+//
+// Bin index for each multiple of POOL_SIZE_UNIT, filled in by CoreInitializePool ()
+//
+STATIC UINT8    mPoolSizeIndex[POOL_SIZE_INDEX_COUNT];
+
+//
+// Number of pages backing a slab of each bin, filled in by CoreInitializePool ()
+//
+STATIC UINTN    mPoolSlabPages[MAX_POOL_LIST];
+
 /**
   Get pool size table index from the specified size.
 
@@ -99,14 +146,33 @@ GetPoolIndexFromSize (
   UINTN   Size
   )
 {
-  UINTN   Index;
+  UINTN   Unit;
+
+  Unit = (Size + POOL_SIZE_UNIT - 1) / POOL_SIZE_UNIT;
+  if (Unit >= POOL_SIZE_INDEX_COUNT) {
+    return MAX_POOL_LIST;
+  }
+  return mPoolSizeIndex[Unit];
+}
+
+/**
+  Initialize the free lists and slab lists of a pool head.
+
+  @param  Pool          The pool head to initialize.
+
+**/
+STATIC
+VOID
+InitializePoolLists (
+  IN POOL   *Pool
+  )
+{
+  UINTN  Index;
 
   for (Index = 0; Index < MAX_POOL_LIST; Index++) {
-    if (mPoolSizeTable [Index] >= Size) {
-      return Index;
-    }
+    InitializeListHead (&Pool->FreeList[Index]);
+    InitializeListHead (&Pool->SlabList[Index]);
   }
-  return MAX_POOL_LIST;
 }
 
 /**
@@ -120,15 +186,180 @@ CoreInitializePool (
 {
   UINTN  Type;
   UINTN  Index;
+  UINTN  Unit;
+  UINTN  NoPages;
+  UINTN  SlabSize;
+
+  ASSERT (LIST_TO_SIZE (MAX_POOL_LIST - 1) / POOL_SIZE_UNIT + 1 == POOL_SIZE_INDEX_COUNT);
 
   for (Type=0; Type < EfiMaxMemoryType; Type++) {
     mPoolHead[Type].Signature  = 0;
     mPoolHead[Type].Used       = 0;
     mPoolHead[Type].MemoryType = (EFI_MEMORY_TYPE) Type;
-    for (Index=0; Index < MAX_POOL_LIST; Index++) {
-      InitializeListHead (&mPoolHead[Type].FreeList[Index]);
+    InitializePoolLists (&mPoolHead[Type]);
+  }
+
+  Index = 0;
+  for (Unit = 0; Unit < POOL_SIZE_INDEX_COUNT; Unit++) {
+    while (LIST_TO_SIZE (Index) < Unit * POOL_SIZE_UNIT) {
+      Index++;
+    }
+    mPoolSizeIndex[Unit] = (UINT8) Index;
+  }
+
+  //
+  // Give each bin the smallest slab that leaves no more than
+  // 1/POOL_SLAB_WASTE_RATIO of its pages unused
+  //
+  for (Index = 0; Index < MAX_POOL_LIST; Index++) {
+    for (NoPages = 1; NoPages < MAX_POOL_SLAB_PAGES; NoPages++) {
+      SlabSize = EFI_PAGES_TO_SIZE (NoPages) - SIZE_OF_POOL_SLAB;
+      if ((SlabSize % LIST_TO_SIZE (Index)) * POOL_SLAB_WASTE_RATIO <= EFI_PAGES_TO_SIZE (NoPages) &&
+          SlabSize >= LIST_TO_SIZE (Index)) {
+        break;
+      }
+    }
+    mPoolSlabPages[Index] = NoPages;
+  }
+}
+
+/**
+  Check whether a pool type is served from slabs.
+
+  Pool types that need the larger runtime page granularity keep using the
+  carved bins, so that a handful of runtime allocations does not pin a whole
+  slab of each bin size in the runtime memory map.
+
+  @param  Granularity            The page allocation granularity of the pool type.
+  @param  Index                  The bin index of the allocation.
+
+  @retval TRUE                   The allocation is served from a slab.
+  @retval FALSE                  The allocation is served from the carved bins
+                                 or directly from pages.
+
+**/
+STATIC
+BOOLEAN
+IsSlabBin (
+  IN UINTN  Granularity,
+  IN UINTN  Index
+  )
+{
+  return (BOOLEAN) (Granularity == DEFAULT_PAGE_ALLOCATION && Index < SIZE_TO_LIST (Granularity));
+}
+
+/**
+  Take a block from a slab of the specified bin, allocating a new slab if
+  all the slabs of that bin are full.
+  Caller must have the memory lock held
+
+  @param  Pool                   The pool head of the memory type.
+  @param  Index                  The bin index of the allocation.
+  @param  Granularity            The page allocation granularity of the pool type.
+
+  @return The block, or NULL if a new slab could not be allocated.
+
+**/
+STATIC
+POOL_HEAD *
+AllocateFromSlab (
+  IN POOL   *Pool,
+  IN UINTN  Index,
+  IN UINTN  Granularity
+  )
+{
+  POOL_SLAB   *Slab;
+  POOL_FREE   *Free;
+  POOL_HEAD   *Head;
+
+  if (IsListEmpty (&Pool->SlabList[Index])) {
+    Slab = CoreAllocatePoolPages (Pool->MemoryType, mPoolSlabPages[Index], Granularity);
+    if (Slab == NULL) {
+      return NULL;
     }
+    Slab->Signature   = POOL_SLAB_SIGNATURE;
+    Slab->Index       = (UINT32) Index;
+    Slab->NoPages     = mPoolSlabPages[Index];
+    Slab->Count       = (UINT32) ((EFI_PAGES_TO_SIZE (Slab->NoPages) - SIZE_OF_POOL_SLAB) / LIST_TO_SIZE (Index));
+    Slab->Used        = 0;
+    Slab->CarveOffset = SIZE_OF_POOL_SLAB;
+    InitializeListHead (&Slab->FreeList);
+    InsertHeadList (&Pool->SlabList[Index], &Slab->Link);
+  }
+
+  Slab = CR (Pool->SlabList[Index].ForwardLink, POOL_SLAB, Link, POOL_SLAB_SIGNATURE);
+
+  if (!IsListEmpty (&Slab->FreeList)) {
+    Free = CR (Slab->FreeList.ForwardLink, POOL_FREE, Link, POOL_FREE_SIGNATURE);
+    RemoveEntryList (&Free->Link);
+    Head = (POOL_HEAD *) Free;
+  } else {
+    Head = (POOL_HEAD *) ((CHAR8 *) Slab + Slab->CarveOffset);
+    Slab->CarveOffset += LIST_TO_SIZE (Index);
+  }
+
+  //
+  // A full slab leaves the bin's list until one of its blocks is freed
+  //
+  Slab->Used++;
+  if (Slab->Used == Slab->Count) {
+    RemoveEntryList (&Slab->Link);
   }
+
+  Head->SlabOffset = (UINT32) ((UINTN) Head - (UINTN) Slab);
+  return Head;
+}
+
+/**
+  Return a block to the slab it was served from, and return the slab's
+  pages once none of its blocks is in use.
+  Caller must have the memory lock held
+
+  @param  Pool                   The pool head of the memory type.
+  @param  Head                   The block to free.
+
+  @retval EFI_INVALID_PARAMETER  The block does not belong to a valid slab.
+  @retval EFI_SUCCESS            The block was freed.
+
+**/
+STATIC
+EFI_STATUS
+FreeToSlab (
+  IN POOL       *Pool,
+  IN POOL_HEAD  *Head
+  )
+{
+  POOL_SLAB   *Slab;
+  POOL_FREE   *Free;
+
+  Slab = (POOL_SLAB *) ((CHAR8 *) Head - Head->SlabOffset);
+  if (Slab->Signature != POOL_SLAB_SIGNATURE || Slab->Used == 0) {
+    ASSERT (FALSE);
+    return EFI_INVALID_PARAMETER;
+  }
+
+  DEBUG_CLEAR_MEMORY (Head, LIST_TO_SIZE (Slab->Index));
+
+  Free = (POOL_FREE *) Head;
+  Free->Signature = POOL_FREE_SIGNATURE;
+  Free->Index     = Slab->Index;
+  InsertHeadList (&Slab->FreeList, &Free->Link);
+
+  //
+  // A slab that was full becomes the first candidate of its bin again
+  //
+  if (Slab->Used == Slab->Count) {
+    InsertHeadList (&Pool->SlabList[Slab->Index], &Slab->Link);
+  }
+
+  Slab->Used--;
+  if (Slab->Used == 0) {
+    RemoveEntryList (&Slab->Link);
+    Slab->Signature = 0;
+    CoreFreePoolPages ((EFI_PHYSICAL_ADDRESS) (UINTN) Slab, Slab->NoPages);
+  }
+
+  return EFI_SUCCESS;
 }
 
 
@@ -147,7 +378,6 @@ LookupPoolHead (
 {
   LIST_ENTRY      *Link;
   POOL            *Pool;
-  UINTN           Index;
 
   if ((UINT32)MemoryType < EfiMaxMemoryType) {
     return &mPoolHead[MemoryType];
@@ -175,9 +405,7 @@ LookupPoolHead (
     Pool->Signature = POOL_SIGNATURE;
     Pool->Used      = 0;
     Pool->MemoryType = MemoryType;
-    for (Index=0; Index < MAX_POOL_LIST; Index++) {
-      InitializeListHead (&Pool->FreeList[Index]);
-    }
+    InitializePoolLists (Pool);
 
     InsertHeadList (&mPoolHeadList, &Pool->Link);
 
@@ -356,6 +584,17 @@ CoreAllocatePoolI (
     NoPages = EFI_SIZE_TO_PAGES(Size) + EFI_SIZE_TO_PAGES (Granularity) - 1;
     NoPages &= ~(UINTN)(EFI_SIZE_TO_PAGES (Granularity) - 1);
     Head = CoreAllocatePoolPages (PoolType, NoPages, Granularity);
+    if (Head != NULL) {
+      Head->SlabOffset = 0;
+    }
+    goto Done;
+  }
+
+  //
+  // Small allocations of the boot time types are served from slabs
+  //
+  if (IsSlabBin (Granularity, Index)) {
+    Head = AllocateFromSlab (Pool, Index, Granularity);
     goto Done;
   }
 
@@ -413,6 +652,7 @@ Carve:
     }
 
     ASSERT (Offset == MaxOffset);
+    Head->SlabOffset = 0;
     goto Done;
   }
 
@@ -423,6 +663,7 @@ Carve:
   RemoveEntryList (&Free->Link);
 
   Head = (POOL_HEAD *) Free;
+  Head->SlabOffset = 0;
 
 Done:
   Buffer = NULL;
@@ -542,6 +783,7 @@ CoreFreePoolI (
   OUT EFI_MEMORY_TYPE   *PoolType OPTIONAL
   )
 {
+  EFI_STATUS  Status;
   POOL        *Pool;
   POOL_HEAD   *Head;
   POOL_TAIL   *Tail;
@@ -612,12 +854,25 @@ CoreFreePoolI (
   // Determine the pool list
   //
   Index = SIZE_TO_LIST(Size);
-  DEBUG_CLEAR_MEMORY (Head, Size);
 
-  //
-  // If it's not on the list, it must be pool pages
-  //
-  if (Index >= SIZE_TO_LIST (Granularity)) {
+  if (Head->SlabOffset != 0) {
+
+    //
+    // Return the block to its slab
+    //
+    ASSERT (IsSlabBin (Granularity, Index));
+    Status = FreeToSlab (Pool, Head);
+    if (EFI_ERROR (Status)) {
+      Pool->Used += Size;
+      return Status;
+    }
+
+  } else if (Index >= SIZE_TO_LIST (Granularity)) {
+
+    //
+    // If it's not on the list, it must be pool pages
+    //
+    DEBUG_CLEAR_MEMORY (Head, Size);
 
     //
     // Return the memory pages back to free memory
@@ -631,6 +886,7 @@ CoreFreePoolI (
     //
     // Put the pool entry onto the free pool list
     //
+    DEBUG_CLEAR_MEMORY (Head, Size);
     Free = (POOL_FREE *) Head;
     ASSERT(Free != NULL);
     Free->Signature = POOL_FREE_SIGNATURE;
@@ -1,7 +1,7 @@
 /** @file
   Lzma Custom decompress algorithm Guid definition.
 
-Copyright (c) 2009 - 2012, Intel Corporation. All rights reserved.<BR>
+Copyright (c) 2009 - 2017, Intel Corporation. All rights reserved.<BR>
 This program and the accompanying materials are licensed and made available under 
 the terms and conditions of the BSD License that accompanies this distribution.  
 The full text of the license may be found at
@@ -29,7 +29,43 @@ WITHOUT WARRANTIES OR REPRESENTATIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED.
 #define LZMAF86_CUSTOM_DECOMPRESS_GUID  \
   { 0xD42AE6BD, 0x1352, 0x4bfb, { 0x90, 0x9A, 0xCA, 0x72, 0xA6, 0xEA, 0xE8, 0x89 } }
 
+///
+/// The Global ID used to identify a section of an FFS file of type
+/// EFI_SECTION_GUID_DEFINED, whose contents have been split into blocks that
+/// are compressed using LZMA independently of each other.
+///
+#define LZMA_BLOCK_CUSTOM_DECOMPRESS_GUID  \
+  { 0x8EF51FB9, 0x7A39, 0x4B9B, { 0x95, 0x4C, 0x44, 0x8B, 0xCF, 0xDB, 0x6D, 0xBD } }
+
+#define LZMA_BLOCK_SIGNATURE  SIGNATURE_32 ('L', 'Z', 'B', 'K')
+
+///
+/// The contents of a section compressed with LZMA_BLOCK_CUSTOM_DECOMPRESS_GUID
+/// start with this header, followed by NumberOfBlocks LZMA_BLOCK_ENTRY
+/// structures and the compressed blocks. Every block is a complete LZMA
+/// stream with its own LZMA header. It decompresses to BlockSize bytes,
+/// except for the last block, which holds the rest of the DecodedSize bytes.
+///
+typedef struct {
+  UINT32  Signature;
+  UINT32  NumberOfBlocks;
+  UINT32  BlockSize;
+  UINT32  DecodedSize;
+} LZMA_BLOCK_HEADER;
+
+typedef struct {
+  ///
+  /// Offset of the compressed block from the start of the LZMA_BLOCK_HEADER.
+  ///
+  UINT32  Offset;
+  ///
+  /// Size of the compressed block, including its LZMA header.
+  ///
+  UINT32  Size;
+} LZMA_BLOCK_ENTRY;
+
 extern GUID gLzmaCustomDecompressGuid;
 extern GUID gLzmaF86CustomDecompressGuid;
+extern GUID gLzmaBlockCustomDecompressGuid;
 
 #endif
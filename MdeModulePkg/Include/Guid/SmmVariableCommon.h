@@ -72,6 +72,20 @@ typedef struct {
 #define SMM_VARIABLE_FUNCTION_VAR_CHECK_VARIABLE_PROPERTY_GET  10
 
 #define SMM_VARIABLE_FUNCTION_GET_PAYLOAD_SIZE        11
+//
+// The payload for this function is SMM_VARIABLE_COMMUNICATE_RUNTIME_CACHE.
+// It returns the size of the buffer needed by the runtime variable cache.
+//
+#define SMM_VARIABLE_FUNCTION_GET_RUNTIME_CACHE_INFO  12
+//
+// The payload for this function is SMM_VARIABLE_COMMUNICATE_RUNTIME_CACHE.
+// It registers the buffer of the runtime variable cache, only before EndOfDxe.
+//
+#define SMM_VARIABLE_FUNCTION_INIT_RUNTIME_CACHE      13
+//
+// The payload for this function is VARIABLE_RECLAIM_STATISTICS.
+//
+#define SMM_VARIABLE_FUNCTION_GET_RECLAIM_STATISTICS  14
 
 ///
 /// Size of SMM communicate header, without including the payload.
@@ -126,4 +140,38 @@ typedef struct {
   UINTN                         VariablePayloadSize;
 } SMM_VARIABLE_COMMUNICATE_GET_PAYLOAD_SIZE;
 
+///
+/// This structure is used to communicate with SMI handler by GetRuntimeCacheInfo
+/// and InitRuntimeCache.
+///
+typedef struct {
+  EFI_PHYSICAL_ADDRESS          CacheBuffer;
+  UINT64                        CacheSize;
+} SMM_VARIABLE_COMMUNICATE_RUNTIME_CACHE;
+
+///
+/// Header of the runtime variable cache.
+///
+/// The runtime variable cache is a buffer in runtime memory that holds a copy
+/// of the volatile, HOB and non-volatile variable stores, so that variables can
+/// be read without entering SMM. Only the SMM variable driver writes it, each
+/// time it modifies a variable store.
+///
+/// Sequence is 0 until the cache is filled. It is odd while the SMM variable
+/// driver updates the cache. A reader must check that Sequence is even and not
+/// 0 before reading the cache, and unchanged afterwards.
+///
+typedef struct {
+  UINT32                        Sequence;
+  BOOLEAN                       AuthFormat;
+  UINT8                         Reserved[3];
+  ///
+  /// Offsets of the variable store headers from the start of the cache,
+  /// 0 if there is no such variable store.
+  ///
+  UINT32                        VolatileStoreOffset;
+  UINT32                        HobStoreOffset;
+  UINT32                        NvStoreOffset;
+} VARIABLE_RUNTIME_CACHE_HEADER;
+
 #endif // _SMM_VARIABLE_COMMON_H_
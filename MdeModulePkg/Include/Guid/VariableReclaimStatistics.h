@@ -0,0 +1,64 @@
+/** @file
+  Variable reclaim statistics definitions.
+
+  The variable driver counts how many bytes it writes to the non-volatile
+  variable store, how many of them carry user data, how often the store is
+  reclaimed and how long SetVariable() takes at most. With these counters the
+  write amplification of the variable store is
+  (VariableBytesWritten + ReclaimBytesWritten) / UserDataBytes.
+
+  The non-SMM variable driver installs the statistics as a configuration table
+  at ReadyToBoot. The SMM variable driver returns them with
+  SMM_VARIABLE_FUNCTION_GET_RECLAIM_STATISTICS.
+
+  Copyright (c) 2017, Intel Corporation. All rights reserved.<BR>
+  This program and the accompanying materials
+  are licensed and made available under the terms and conditions of the BSD License
+  which accompanies this distribution.  The full text of the license may be found at
+  http://opensource.org/licenses/bsd-license.php
+
+  THE PROGRAM IS DISTRIBUTED UNDER THE BSD LICENSE ON AN "AS IS" BASIS,
+  WITHOUT WARRANTIES OR REPRESENTATIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED.
+
+**/
+
+#ifndef _VARIABLE_RECLAIM_STATISTICS_H_
+#define _VARIABLE_RECLAIM_STATISTICS_H_
+
+#define EDKII_VARIABLE_RECLAIM_STATISTICS_GUID { \
+  0x3a4bc2fc, 0x10e4, 0x4027, { 0xbd, 0x03, 0x09, 0x5b, 0x97, 0x84, 0xfc, 0x4e } \
+}
+
+///
+/// Non-volatile variable store statistics gathered since boot.
+///
+typedef struct {
+  ///
+  /// Number of reclaim operations of the non-volatile variable store, and how
+  /// many of them compacted the whole store rather than its tail.
+  ///
+  UINT64    ReclaimCount;
+  UINT64    FullReclaimCount;
+  ///
+  /// Bytes written to the non-volatile variable store by reclaim operations.
+  ///
+  UINT64    ReclaimBytesWritten;
+  ///
+  /// Bytes written to the non-volatile variable store outside of reclaim,
+  /// including variable headers, names and state updates.
+  ///
+  UINT64    VariableBytesWritten;
+  ///
+  /// Payload bytes of the non-volatile variables set successfully.
+  ///
+  UINT64    UserDataBytes;
+  ///
+  /// Number of SetVariable() calls and the longest one, in nanoseconds.
+  ///
+  UINT64    SetVariableCount;
+  UINT64    MaxSetVariableLatency;
+} VARIABLE_RECLAIM_STATISTICS;
+
+extern EFI_GUID gEdkiiVariableReclaimStatisticsGuid;
+
+#endif
@@ -0,0 +1,118 @@
+/** @file
+  The Managed Network Diagnostics Protocol reports how the MNP driver receives
+  the packets of one network device: how many frames it received and dropped,
+  how often it polled the Simple Network Protocol and how deep the receive
+  queues of its children grew.
+
+Copyright (c) 2017, Intel Corporation. All rights reserved.<BR>
+This program and the accompanying materials are licensed and made available under
+the terms and conditions of the BSD License that accompanies this distribution.
+The full text of the license may be found at
+http://opensource.org/licenses/bsd-license.php.
+
+THE PROGRAM IS DISTRIBUTED UNDER THE BSD LICENSE ON AN "AS IS" BASIS,
+WITHOUT WARRANTIES OR REPRESENTATIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED.
+
+**/
+
+#ifndef _MANAGED_NETWORK_DIAGNOSTICS_H_
+#define _MANAGED_NETWORK_DIAGNOSTICS_H_
+
+///
+/// Global ID for the EDKII_MANAGED_NETWORK_DIAGNOSTICS_PROTOCOL.
+///
+#define EDKII_MANAGED_NETWORK_DIAGNOSTICS_PROTOCOL_GUID \
+  { \
+    0xf18164d2, 0x971c, 0x4058, { 0xa5, 0xf5, 0xed, 0x5f, 0xa1, 0x24, 0x3a, 0x1e } \
+  }
+
+///
+/// Forward declaration for the EDKII_MANAGED_NETWORK_DIAGNOSTICS_PROTOCOL.
+///
+typedef struct _EDKII_MANAGED_NETWORK_DIAGNOSTICS_PROTOCOL  EDKII_MANAGED_NETWORK_DIAGNOSTICS_PROTOCOL;
+
+///
+/// Receive statistics of one network device.
+///
+typedef struct {
+  ///
+  /// Number of frames received from the Simple Network Protocol.
+  ///
+  UINT64    RxFrames;
+  ///
+  /// Number of received frames that no MNP child accepted.
+  ///
+  UINT64    RxNoReceiver;
+  ///
+  /// Number of frames dropped from a full receive queue of a child, and
+  /// dropped because they timed out in the queue.
+  ///
+  UINT64    RxDroppedQueueFull;
+  UINT64    RxDroppedTimeout;
+  ///
+  /// Number of times no receive buffer could be allocated, and of receive
+  /// errors reported by the Simple Network Protocol.
+  ///
+  UINT64    RxNoBuffer;
+  UINT64    RxErrors;
+  ///
+  /// Number of polls of the Simple Network Protocol, the number of them that
+  /// received no frame, and the most frames received in one poll.
+  ///
+  UINT64    PollCount;
+  UINT64    EmptyPollCount;
+  UINT64    MaxFramesPerPoll;
+  ///
+  /// Current period of the system poll in 100ns units, 0 if the system poll
+  /// is disabled.
+  ///
+  UINT64    PollInterval;
+  ///
+  /// Number of frames currently queued for the children, and the most of
+  /// them queued at once.
+  ///
+  UINT64    RxQueueDepth;
+  UINT64    MaxRxQueueDepth;
+} EDKII_MANAGED_NETWORK_STATISTICS;
+
+/**
+  Get the receive statistics gathered since the device was started or since
+  the last reset.
+
+  @param[in]  This                   The protocol instance pointer.
+  @param[out] Statistics             Returns the receive statistics.
+
+  @retval EFI_SUCCESS                The statistics were returned.
+  @retval EFI_INVALID_PARAMETER      This or Statistics is NULL.
+
+**/
+typedef
+EFI_STATUS
+(EFIAPI *EDKII_MANAGED_NETWORK_DIAGNOSTICS_GET)(
+  IN  EDKII_MANAGED_NETWORK_DIAGNOSTICS_PROTOCOL  *This,
+  OUT EDKII_MANAGED_NETWORK_STATISTICS            *Statistics
+  );
+
+/**
+  Reset the receive statistics. PollInterval and RxQueueDepth are not affected.
+
+  @param[in]  This                   The protocol instance pointer.
+
+  @retval EFI_SUCCESS                The statistics were reset.
+  @retval EFI_INVALID_PARAMETER      This is NULL.
+
+**/
+typedef
+EFI_STATUS
+(EFIAPI *EDKII_MANAGED_NETWORK_DIAGNOSTICS_RESET)(
+  IN  EDKII_MANAGED_NETWORK_DIAGNOSTICS_PROTOCOL  *This
+  );
+
+struct _EDKII_MANAGED_NETWORK_DIAGNOSTICS_PROTOCOL {
+  EDKII_MANAGED_NETWORK_DIAGNOSTICS_GET     GetStatistics;
+  EDKII_MANAGED_NETWORK_DIAGNOSTICS_RESET   ResetStatistics;
+};
+
+extern EFI_GUID gEdkiiManagedNetworkDiagnosticsProtocolGuid;
+
+#endif
@@ -0,0 +1,109 @@
+/** @file
+  The Timer Statistics Protocol reports how the DXE core services timer events:
+  how many timers expire per tick, how long their notification functions run
+  and how regular the timer ticks are.
+
+Copyright (c) 2017, Intel Corporation. All rights reserved.<BR>
+This program and the accompanying materials are licensed and made available under
+the terms and conditions of the BSD License that accompanies this distribution.
+The full text of the license may be found at
+http://opensource.org/licenses/bsd-license.php.
+
+THE PROGRAM IS DISTRIBUTED UNDER THE BSD LICENSE ON AN "AS IS" BASIS,
+WITHOUT WARRANTIES OR REPRESENTATIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED.
+
+**/
+
+#ifndef _TIMER_STATISTICS_H_
+#define _TIMER_STATISTICS_H_
+
+///
+/// Global ID for the EDKII_TIMER_STATISTICS_PROTOCOL.
+///
+#define EDKII_TIMER_STATISTICS_PROTOCOL_GUID \
+  { \
+    0xa2e168da, 0x5b25, 0x424c, { 0x84, 0xd9, 0x64, 0xe4, 0x27, 0xc2, 0x36, 0x8a } \
+  }
+
+///
+/// Forward declaration for the EDKII_TIMER_STATISTICS_PROTOCOL.
+///
+typedef struct _EDKII_TIMER_STATISTICS_PROTOCOL  EDKII_TIMER_STATISTICS_PROTOCOL;
+
+///
+/// Timer statistics. All times are in 100ns units.
+///
+typedef struct {
+  ///
+  /// Number of timer ticks reported by the Timer Architectural Protocol.
+  ///
+  UINT64    TickCount;
+  ///
+  /// Shortest and longest period between two timer ticks. The difference
+  /// between them is the tick jitter.
+  ///
+  UINT64    MinTickPeriod;
+  UINT64    MaxTickPeriod;
+  ///
+  /// Number of timer events that expired, in total and at most in one tick.
+  ///
+  UINT64    TimersFired;
+  UINT64    MaxTimersFiredPerTick;
+  ///
+  /// Longest delay between the trigger time of a timer event and the moment
+  /// it was signaled.
+  ///
+  UINT64    MaxTimerLatency;
+  ///
+  /// Number of notification functions of timer events run, and the longest
+  /// time spent in one of them. They are only gathered when the
+  /// PERFORMANCE_LIBRARY_PROPERTY_MEASUREMENT_ENABLED bit of
+  /// PcdPerformanceLibraryPropertyMask is set, and are 0 otherwise.
+  ///
+  UINT64    NotifyCount;
+  UINT64    MaxNotifyTime;
+  ///
+  /// Number of timer events currently queued.
+  ///
+  UINT64    QueuedTimers;
+} EDKII_TIMER_STATISTICS;
+
+/**
+  Get the timer statistics gathered since boot or since the last reset.
+
+  @param[in]  This                   The protocol instance pointer.
+  @param[out] Statistics             Returns the timer statistics.
+
+  @retval EFI_SUCCESS                The statistics were returned.
+  @retval EFI_INVALID_PARAMETER      Statistics is NULL.
+
+**/
+typedef
+EFI_STATUS
+(EFIAPI *EDKII_TIMER_STATISTICS_GET)(
+  IN  EDKII_TIMER_STATISTICS_PROTOCOL *This,
+  OUT EDKII_TIMER_STATISTICS          *Statistics
+  );
+
+/**
+  Reset the timer statistics. QueuedTimers is not affected.
+
+  @param[in]  This                   The protocol instance pointer.
+
+  @retval EFI_SUCCESS                The statistics were reset.
+
+**/
+typedef
+EFI_STATUS
+(EFIAPI *EDKII_TIMER_STATISTICS_RESET)(
+  IN  EDKII_TIMER_STATISTICS_PROTOCOL *This
+  );
+
+struct _EDKII_TIMER_STATISTICS_PROTOCOL {
+  EDKII_TIMER_STATISTICS_GET      GetStatistics;
+  EDKII_TIMER_STATISTICS_RESET    ResetStatistics;
+};
+
+extern EFI_GUID gEdkiiTimerStatisticsProtocolGuid;
+
+#endif
@@ -1,7 +1,7 @@
 /** @file
   Network library functions providing net buffer operation support.
 
-Copyright (c) 2005 - 2016, Intel Corporation. All rights reserved.<BR>
+Copyright (c) 2005 - 2017, Intel Corporation. All rights reserved.<BR>
 This program and the accompanying materials
 are licensed and made available under the terms and conditions of the BSD License
 which accompanies this distribution.  The full text of the license may be found at
@@ -1644,6 +1644,10 @@ NetbufQueFlush (
 /**
   Compute the checksum for a bulk of data.
 
+  The data is added up in 32-bit words to a 64-bit accumulator, which can't
+  overflow for any length of a UINT32, and the carries are folded back to
+  16 bits once at the end.
+
   @param[in]   Bulk                  Pointer to the data.
   @param[in]   Len                   Length of the data, in bytes.
 
@@ -1657,32 +1661,81 @@ NetblockChecksum (
   IN UINT32                 Len
   )
 {
-  register UINT32           Sum;
+  UINT64                    Sum;
+  UINT32                    Sum32;
+  UINT32                    High;
+  BOOLEAN                   OddAddress;
 
-  Sum = 0;
+  Sum        = 0;
+  OddAddress = FALSE;
 
   //
-  // Add left-over byte, if any
+  // Add the words from an even address. If the data starts at an
+  // odd address, add the first byte as the high byte of a word, the
+  // sum of the following words is then the byte swapped checksum,
+  // which is swapped back at the end (RFC1071).
   //
-  if (Len % 2 != 0) {
-    Sum += *(Bulk + Len - 1);
+  if ((((UINTN) Bulk & 0x01) != 0) && (Len != 0)) {
+    Sum        = (UINT32) (*Bulk) << 8;
+    OddAddress = TRUE;
+    Bulk++;
+    Len--;
+  }
+
+  if ((((UINTN) Bulk & 0x02) != 0) && (Len >= 2)) {
+    Sum  += *(UINT16 *) Bulk;
+    Bulk += 2;
+    Len  -= 2;
+  }
+
+  while (Len >= 16) {
+    Sum  += ((UINT32 *) Bulk)[0];
+    Sum  += ((UINT32 *) Bulk)[1];
+    Sum  += ((UINT32 *) Bulk)[2];
+    Sum  += ((UINT32 *) Bulk)[3];
+    Bulk += 16;
+    Len  -= 16;
+  }
+
+  while (Len >= 4) {
+    Sum  += *(UINT32 *) Bulk;
+    Bulk += 4;
+    Len  -= 4;
   }
 
-  while (Len > 1) {
-    Sum += *(UINT16 *) Bulk;
+  if (Len >= 2) {
+    Sum  += *(UINT16 *) Bulk;
     Bulk += 2;
-    Len -= 2;
+    Len  -= 2;
   }
 
   //
-  // Fold 32-bit sum to 16 bits
+  // Add left-over byte, if any
+  //
+  if (Len != 0) {
+    Sum += *Bulk;
+  }
+
+  //
+  // Fold 64-bit sum to 32 bits with the end-around carry,
+  // then to 16 bits.
   //
-  while ((Sum >> 16) != 0) {
-    Sum = (Sum & 0xffff) + (Sum >> 16);
+  Sum32 = (UINT32) Sum;
+  High  = (UINT32) RShiftU64 (Sum, 32);
 
+  Sum32 += High;
+  if (Sum32 < High) {
+    Sum32++;
   }
 
-  return (UINT16) Sum;
+  Sum32 = (Sum32 & 0xffff) + (Sum32 >> 16);
+  Sum32 = (Sum32 & 0xffff) + (Sum32 >> 16);
+
+  if (OddAddress) {
+    return SwapBytes16 ((UINT16) Sum32);
+  }
+
+  return (UINT16) Sum32;
 }
 
 
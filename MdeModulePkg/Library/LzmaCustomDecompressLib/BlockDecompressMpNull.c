@@ -0,0 +1,35 @@
+/** @file
+  LZMA block decompression without MP services: all the blocks are
+  decompressed by the calling processor.
+
+  Copyright (c) 2017, Intel Corporation. All rights reserved.<BR>
+  This program and the accompanying materials
+  are licensed and made available under the terms and conditions of the BSD License
+  which accompanies this distribution.  The full text of the license may be found at
+  http://opensource.org/licenses/bsd-license.php
+
+  THE PROGRAM IS DISTRIBUTED UNDER THE BSD LICENSE ON AN "AS IS" BASIS,
+  WITHOUT WARRANTIES OR REPRESENTATIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED.
+
+**/
+
+#include "LzmaDecompressLibInternal.h"
+
+/**
+  Run a procedure on all the enabled APs, and wait for them to finish.
+
+  The procedure must not use any PEI or boot service.
+
+  @param  Procedure  The procedure to run on the APs.
+  @param  Argument   The argument passed to Procedure.
+
+  @retval  RETURN_UNSUPPORTED  The MP services are not available in this phase.
+**/
+RETURN_STATUS
+LzmaBlockStartupAllAps (
+  IN EFI_AP_PROCEDURE  Procedure,
+  IN VOID              *Argument
+  )
+{
+  return RETURN_UNSUPPORTED;
+}
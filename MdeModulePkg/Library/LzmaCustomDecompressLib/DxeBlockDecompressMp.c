@@ -0,0 +1,62 @@
+/** @file
+  LZMA block decompression on the APs through the MP Services Protocol.
+
+  Copyright (c) 2017, Intel Corporation. All rights reserved.<BR>
+  This program and the accompanying materials
+  are licensed and made available under the terms and conditions of the BSD License
+  which accompanies this distribution.  The full text of the license may be found at
+  http://opensource.org/licenses/bsd-license.php
+
+  THE PROGRAM IS DISTRIBUTED UNDER THE BSD LICENSE ON AN "AS IS" BASIS,
+  WITHOUT WARRANTIES OR REPRESENTATIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED.
+
+**/
+
+#include "LzmaDecompressLibInternal.h"
+#include <Protocol/MpService.h>
+#include <Library/UefiBootServicesTableLib.h>
+
+/**
+  Run a procedure on all the enabled APs, and wait for them to finish.
+
+  The procedure must not use any PEI or boot service.
+
+  @param  Procedure  The procedure to run on the APs.
+  @param  Argument   The argument passed to Procedure.
+
+  @retval  RETURN_SUCCESS      All the enabled APs ran Procedure.
+  @retval  RETURN_UNSUPPORTED  The MP Services Protocol is not installed yet.
+  @retval  Others              The APs could not be started.
+**/
+RETURN_STATUS
+LzmaBlockStartupAllAps (
+  IN EFI_AP_PROCEDURE  Procedure,
+  IN VOID              *Argument
+  )
+{
+  EFI_STATUS                Status;
+  EFI_MP_SERVICES_PROTOCOL  *MpServices;
+
+  Status = gBS->LocateProtocol (
+                  &gEfiMpServiceProtocolGuid,
+                  NULL,
+                  (VOID **) &MpServices
+                  );
+  if (EFI_ERROR (Status)) {
+    //
+    // The DXE core decompresses the first firmware volumes before the CPU
+    // driver installs the MP Services Protocol.
+    //
+    return RETURN_UNSUPPORTED;
+  }
+
+  return MpServices->StartupAllAPs (
+                       MpServices,
+                       Procedure,
+                       FALSE,
+                       NULL,
+                       0,
+                       Argument,
+                       NULL
+                       );
+}
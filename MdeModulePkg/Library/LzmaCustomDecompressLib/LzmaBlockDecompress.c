@@ -0,0 +1,262 @@
+/** @file
+  Decompression of data split into blocks that are compressed using LZMA
+  independently of each other, so that they can be decompressed in parallel.
+
+  Copyright (c) 2017, Intel Corporation. All rights reserved.<BR>
+  This program and the accompanying materials
+  are licensed and made available under the terms and conditions of the BSD License
+  which accompanies this distribution.  The full text of the license may be found at
+  http://opensource.org/licenses/bsd-license.php
+
+  THE PROGRAM IS DISTRIBUTED UNDER THE BSD LICENSE ON AN "AS IS" BASIS,
+  WITHOUT WARRANTIES OR REPRESENTATIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED.
+
+**/
+
+#include "LzmaDecompressLibInternal.h"
+#include "Sdk/C/7zTypes.h"
+#include "Sdk/C/LzmaDec.h"
+
+#define LZMA_HEADER_SIZE (LZMA_PROPS_SIZE + 8)
+
+typedef struct {
+  CONST UINT8              *Source;
+  UINT8                    *Destination;
+  UINT8                    *Scratch;
+  UINT32                   BlockScratchSize;
+  CONST LZMA_BLOCK_HEADER  *Header;
+  CONST LZMA_BLOCK_ENTRY   *Entries;
+  volatile UINT32          NextBlock;
+  volatile BOOLEAN         Error;
+} LZMA_BLOCK_CONTEXT;
+
+/**
+  Check the block header and the block index of a source buffer compressed in
+  LZMA blocks, and retrieve the scratch buffer size that one block needs.
+
+  Every block must lie in the source buffer after the block index, and must
+  decompress to exactly its share of the decoded data.
+
+  @param  Source            The source buffer containing the compressed data.
+  @param  SourceSize        The size, in bytes, of the source buffer.
+  @param  BlockScratchSize  Return the scratch buffer size of one block.
+
+  @retval  RETURN_SUCCESS            The block index is valid.
+  @retval  RETURN_INVALID_PARAMETER  The block index is corrupted.
+
+**/
+RETURN_STATUS
+LzmaBlockCheckIndex (
+  IN  CONST VOID  *Source,
+  IN  UINTN       SourceSize,
+  OUT UINT32      *BlockScratchSize
+  )
+{
+  CONST LZMA_BLOCK_HEADER  *Header;
+  CONST LZMA_BLOCK_ENTRY   *Entries;
+  UINTN                    IndexSize;
+  UINT32                   Index;
+  UINT32                   ExpectedSize;
+  UINT32                   DecodedSize;
+  UINT32                   ScratchSize;
+
+  if (SourceSize < sizeof (LZMA_BLOCK_HEADER)) {
+    return RETURN_INVALID_PARAMETER;
+  }
+
+  Header = (CONST LZMA_BLOCK_HEADER *) Source;
+  if (Header->Signature != LZMA_BLOCK_SIGNATURE ||
+      Header->BlockSize == 0 ||
+      Header->NumberOfBlocks == 0 ||
+      Header->NumberOfBlocks > (SourceSize - sizeof (LZMA_BLOCK_HEADER)) / sizeof (LZMA_BLOCK_ENTRY) ||
+      Header->NumberOfBlocks != Header->DecodedSize / Header->BlockSize +
+                                ((Header->DecodedSize % Header->BlockSize) != 0 ? 1 : 0)) {
+    return RETURN_INVALID_PARAMETER;
+  }
+
+  IndexSize = sizeof (LZMA_BLOCK_HEADER) + Header->NumberOfBlocks * sizeof (LZMA_BLOCK_ENTRY);
+  Entries   = (CONST LZMA_BLOCK_ENTRY *) (Header + 1);
+
+  *BlockScratchSize = 0;
+  for (Index = 0; Index < Header->NumberOfBlocks; Index++) {
+    if (Entries[Index].Offset < IndexSize ||
+        Entries[Index].Offset > SourceSize ||
+        Entries[Index].Size > SourceSize - Entries[Index].Offset ||
+        Entries[Index].Size < LZMA_HEADER_SIZE) {
+      return RETURN_INVALID_PARAMETER;
+    }
+
+    if (Index == Header->NumberOfBlocks - 1) {
+      ExpectedSize = Header->DecodedSize - Index * Header->BlockSize;
+    } else {
+      ExpectedSize = Header->BlockSize;
+    }
+
+    LzmaUefiDecompressGetInfo (
+      (CONST UINT8 *) Source + Entries[Index].Offset,
+      Entries[Index].Size,
+      &DecodedSize,
+      &ScratchSize
+      );
+    //
+    // The LZMA header holds a 64-bit decoded size, whose upper half must be 0.
+    //
+    if (DecodedSize != ExpectedSize ||
+        ReadUnaligned32 ((UINT32 *) ((UINT8 *) Source + Entries[Index].Offset + LZMA_PROPS_SIZE + 4)) != 0) {
+      return RETURN_INVALID_PARAMETER;
+    }
+
+    *BlockScratchSize = MAX (*BlockScratchSize, ScratchSize);
+  }
+
+  return RETURN_SUCCESS;
+}
+
+/**
+  Decompress the blocks of a LZMA block context, until there is no block left.
+
+  This runs on the APs and on the BSP at the same time. Each processor takes
+  the next block with an atomic increment, so every block is decompressed
+  once. It does not use any PEI or boot service.
+
+  @param  Buffer  Pointer to the LZMA_BLOCK_CONTEXT.
+
+**/
+VOID
+EFIAPI
+LzmaBlockDecompressProcedure (
+  IN OUT VOID  *Buffer
+  )
+{
+  LZMA_BLOCK_CONTEXT  *Context;
+  UINT32              Index;
+  RETURN_STATUS       Status;
+
+  Context = (LZMA_BLOCK_CONTEXT *) Buffer;
+
+  while (TRUE) {
+    Index = InterlockedIncrement (&Context->NextBlock) - 1;
+    if (Index >= Context->Header->NumberOfBlocks) {
+      break;
+    }
+
+    Status = LzmaUefiDecompress (
+               Context->Source + Context->Entries[Index].Offset,
+               Context->Entries[Index].Size,
+               Context->Destination + (UINTN) Index * Context->Header->BlockSize,
+               Context->Scratch + (UINTN) Index * Context->BlockScratchSize
+               );
+    if (RETURN_ERROR (Status)) {
+      Context->Error = TRUE;
+    }
+  }
+}
+
+/**
+  Given a source buffer compressed in LZMA blocks, this function retrieves the
+  size of the uncompressed buffer and the size of the scratch buffer required
+  to decompress the compressed source buffer.
+
+  The scratch buffer holds one LZMA scratch buffer per block, so that all the
+  blocks can be decompressed at the same time.
+
+  @param  Source          The source buffer containing the compressed data.
+  @param  SourceSize      The size, in bytes, of the source buffer.
+  @param  DestinationSize A pointer to the size, in bytes, of the uncompressed buffer
+                          that will be generated when the compressed buffer specified
+                          by Source and SourceSize is decompressed.
+  @param  ScratchSize     A pointer to the size, in bytes, of the scratch buffer that
+                          is required to decompress the compressed buffer specified
+                          by Source and SourceSize.
+
+  @retval  RETURN_SUCCESS The size of the uncompressed data was returned
+                          in DestinationSize and the size of the scratch
+                          buffer was returned in ScratchSize.
+  @retval  RETURN_INVALID_PARAMETER
+                          The block index in the source buffer is corrupted.
+
+**/
+RETURN_STATUS
+EFIAPI
+LzmaBlockUefiDecompressGetInfo (
+  IN  CONST VOID  *Source,
+  IN  UINT32      SourceSize,
+  OUT UINT32      *DestinationSize,
+  OUT UINT32      *ScratchSize
+  )
+{
+  RETURN_STATUS            Status;
+  CONST LZMA_BLOCK_HEADER  *Header;
+  UINT32                   BlockScratchSize;
+
+  Status = LzmaBlockCheckIndex (Source, SourceSize, &BlockScratchSize);
+  if (RETURN_ERROR (Status)) {
+    return Status;
+  }
+
+  Header = (CONST LZMA_BLOCK_HEADER *) Source;
+  if (BlockScratchSize != 0 && Header->NumberOfBlocks > MAX_UINT32 / BlockScratchSize) {
+    return RETURN_INVALID_PARAMETER;
+  }
+
+  *DestinationSize = Header->DecodedSize;
+  *ScratchSize     = Header->NumberOfBlocks * BlockScratchSize;
+  return RETURN_SUCCESS;
+}
+
+/**
+  Decompresses a source buffer compressed in LZMA blocks.
+
+  The blocks are decompressed on all the enabled APs if the MP services are
+  available, and on the calling processor otherwise.
+
+  @param  Source      The source buffer containing the compressed data.
+  @param  SourceSize  The size of source buffer.
+  @param  Destination The destination buffer to store the decompressed data
+  @param  Scratch     A temporary scratch buffer that is used to perform the decompression.
+
+  @retval  RETURN_SUCCESS Decompression completed successfully, and
+                          the uncompressed buffer is returned in Destination.
+  @retval  RETURN_INVALID_PARAMETER
+                          The source buffer specified by Source is corrupted
+                          (not in a valid compressed format).
+**/
+RETURN_STATUS
+EFIAPI
+LzmaBlockUefiDecompress (
+  IN CONST VOID  *Source,
+  IN UINTN       SourceSize,
+  IN OUT VOID    *Destination,
+  IN OUT VOID    *Scratch
+  )
+{
+  RETURN_STATUS       Status;
+  LZMA_BLOCK_CONTEXT  Context;
+
+  Status = LzmaBlockCheckIndex (Source, SourceSize, &Context.BlockScratchSize);
+  if (RETURN_ERROR (Status)) {
+    return Status;
+  }
+
+  Context.Source      = (CONST UINT8 *) Source;
+  Context.Destination = (UINT8 *) Destination;
+  Context.Scratch     = (UINT8 *) Scratch;
+  Context.Header      = (CONST LZMA_BLOCK_HEADER *) Source;
+  Context.Entries     = (CONST LZMA_BLOCK_ENTRY *) (Context.Header + 1);
+  Context.NextBlock   = 0;
+  Context.Error       = FALSE;
+
+  //
+  // Let the APs decompress the blocks, then decompress whatever they left on
+  // the BSP. This is all the blocks if the APs could not be started.
+  //
+  if (Context.Header->NumberOfBlocks > 1) {
+    LzmaBlockStartupAllAps (LzmaBlockDecompressProcedure, &Context);
+  }
+  LzmaBlockDecompressProcedure (&Context);
+
+  if (Context.Error) {
+    return RETURN_INVALID_PARAMETER;
+  }
+  return RETURN_SUCCESS;
+}
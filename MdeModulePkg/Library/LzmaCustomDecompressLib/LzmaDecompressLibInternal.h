@@ -1,7 +1,7 @@
 /** @file
   LZMA Decompress Library internal header file declares Lzma decompress interfaces.
 
-  Copyright (c) 2009 - 2010, Intel Corporation. All rights reserved.<BR>
+  Copyright (c) 2009 - 2017, Intel Corporation. All rights reserved.<BR>
   This program and the accompanying materials
   are licensed and made available under the terms and conditions of the BSD License
   which accompanies this distribution.  The full text of the license may be found at
@@ -20,6 +20,7 @@
 #include <Library/BaseMemoryLib.h>
 #include <Library/DebugLib.h>
 #include <Library/ExtractGuidedSectionLib.h>
+#include <Library/SynchronizationLib.h>
 #include <Guid/LzmaDecompress.h>
 
 /**
@@ -92,5 +93,83 @@ LzmaUefiDecompress (
   IN OUT VOID    *Scratch
   );
 
+/**
+  Given a source buffer compressed in LZMA blocks, this function retrieves the
+  size of the uncompressed buffer and the size of the scratch buffer required
+  to decompress the compressed source buffer.
+
+  The scratch buffer holds one LZMA scratch buffer per block, so that all the
+  blocks can be decompressed at the same time.
+
+  @param  Source          The source buffer containing the compressed data.
+  @param  SourceSize      The size, in bytes, of the source buffer.
+  @param  DestinationSize A pointer to the size, in bytes, of the uncompressed buffer
+                          that will be generated when the compressed buffer specified
+                          by Source and SourceSize is decompressed.
+  @param  ScratchSize     A pointer to the size, in bytes, of the scratch buffer that
+                          is required to decompress the compressed buffer specified
+                          by Source and SourceSize.
+
+  @retval  RETURN_SUCCESS The size of the uncompressed data was returned
+                          in DestinationSize and the size of the scratch
+                          buffer was returned in ScratchSize.
+  @retval  RETURN_INVALID_PARAMETER
+                          The block index in the source buffer is corrupted.
+
+**/
+RETURN_STATUS
+EFIAPI
+LzmaBlockUefiDecompressGetInfo (
+  IN  CONST VOID  *Source,
+  IN  UINT32      SourceSize,
+  OUT UINT32      *DestinationSize,
+  OUT UINT32      *ScratchSize
+  );
+
+/**
+  Decompresses a source buffer compressed in LZMA blocks.
+
+  The blocks are decompressed on all the enabled APs if the MP services are
+  available, and on the calling processor otherwise.
+
+  @param  Source      The source buffer containing the compressed data.
+  @param  SourceSize  The size of source buffer.
+  @param  Destination The destination buffer to store the decompressed data
+  @param  Scratch     A temporary scratch buffer that is used to perform the decompression.
+
+  @retval  RETURN_SUCCESS Decompression completed successfully, and
+                          the uncompressed buffer is returned in Destination.
+  @retval  RETURN_INVALID_PARAMETER
+                          The source buffer specified by Source is corrupted
+                          (not in a valid compressed format).
+**/
+RETURN_STATUS
+EFIAPI
+LzmaBlockUefiDecompress (
+  IN CONST VOID  *Source,
+  IN UINTN       SourceSize,
+  IN OUT VOID    *Destination,
+  IN OUT VOID    *Scratch
+  );
+
+/**
+  Run a procedure on all the enabled APs, and wait for them to finish.
+
+  The procedure must not use any PEI or boot service.
+
+  @param  Procedure  The procedure to run on the APs.
+  @param  Argument   The argument passed to Procedure.
+
+  @retval  RETURN_SUCCESS      All the enabled APs ran Procedure.
+  @retval  RETURN_UNSUPPORTED  The MP services are not available in this phase,
+                               or there is no enabled AP.
+  @retval  Others              The APs could not be started.
+**/
+RETURN_STATUS
+LzmaBlockStartupAllAps (
+  IN EFI_AP_PROCEDURE  Procedure,
+  IN VOID              *Argument
+  );
+
 #endif
 
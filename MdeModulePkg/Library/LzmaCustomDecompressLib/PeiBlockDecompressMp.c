@@ -0,0 +1,59 @@
+/** @file
+  LZMA block decompression on the APs through the PEI MP Services PPI.
+
+  Copyright (c) 2017, Intel Corporation. All rights reserved.<BR>
+  This program and the accompanying materials
+  are licensed and made available under the terms and conditions of the BSD License
+  which accompanies this distribution.  The full text of the license may be found at
+  http://opensource.org/licenses/bsd-license.php
+
+  THE PROGRAM IS DISTRIBUTED UNDER THE BSD LICENSE ON AN "AS IS" BASIS,
+  WITHOUT WARRANTIES OR REPRESENTATIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED.
+
+**/
+
+#include "LzmaDecompressLibInternal.h"
+#include <Ppi/MpServices.h>
+#include <Library/PeiServicesLib.h>
+#include <Library/PeiServicesTablePointerLib.h>
+
+/**
+  Run a procedure on all the enabled APs, and wait for them to finish.
+
+  The procedure must not use any PEI or boot service.
+
+  @param  Procedure  The procedure to run on the APs.
+  @param  Argument   The argument passed to Procedure.
+
+  @retval  RETURN_SUCCESS      All the enabled APs ran Procedure.
+  @retval  RETURN_UNSUPPORTED  The PEI MP Services PPI is not installed.
+  @retval  Others              The APs could not be started.
+**/
+RETURN_STATUS
+LzmaBlockStartupAllAps (
+  IN EFI_AP_PROCEDURE  Procedure,
+  IN VOID              *Argument
+  )
+{
+  EFI_STATUS               Status;
+  EFI_PEI_MP_SERVICES_PPI  *MpServices;
+
+  Status = PeiServicesLocatePpi (
+             &gEfiPeiMpServicesPpiGuid,
+             0,
+             NULL,
+             (VOID **) &MpServices
+             );
+  if (EFI_ERROR (Status)) {
+    return RETURN_UNSUPPORTED;
+  }
+
+  return MpServices->StartupAllAPs (
+                       GetPeiServicesTablePointer (),
+                       MpServices,
+                       Procedure,
+                       FALSE,
+                       0,
+                       Argument
+                       );
+}
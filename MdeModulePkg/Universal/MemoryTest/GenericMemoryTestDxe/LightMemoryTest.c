@@ -1,6 +1,6 @@
 /** @file
 
-  Copyright (c) 2006 - 2010, Intel Corporation. All rights reserved.<BR>
+  Copyright (c) 2006 - 2017, Intel Corporation. All rights reserved.<BR>
 
   This program and the accompanying materials
   are licensed and made available under the terms and conditions
@@ -358,10 +358,8 @@ VerifyMemory (
 {
   EFI_PHYSICAL_ADDRESS            Address;
   INTN                            ErrorFound;
-  EFI_MEMORY_EXTENDED_ERROR_DATA  *ExtendedErrorData;
 
   Address           = Start;
-  ExtendedErrorData = NULL;
 
   //
   // Add 4G memory address check for IA32 platform
@@ -386,33 +384,340 @@ VerifyMemory (
       //
       // Report uncorrectable errors
       //
-      ExtendedErrorData = AllocateZeroPool (sizeof (EFI_MEMORY_EXTENDED_ERROR_DATA));
-      if (ExtendedErrorData == NULL) {
-        return EFI_OUT_OF_RESOURCES;
+      return ReportMemoryError (Address);
+    }
+
+    Address += Private->CoverageSpan;
+  }
+
+  return EFI_SUCCESS;
+}
+
+/**
+  Report an uncorrectable memory error found by the software memory test.
+
+  @param[in] Address  The address of the miscompare.
+
+  @retval EFI_DEVICE_ERROR     The error is reported.
+  @retval EFI_OUT_OF_RESOURCES Could not allocate the extended error data.
+
+**/
+EFI_STATUS
+ReportMemoryError (
+  IN  EFI_PHYSICAL_ADDRESS         Address
+  )
+{
+  EFI_MEMORY_EXTENDED_ERROR_DATA  *ExtendedErrorData;
+
+  ExtendedErrorData = AllocateZeroPool (sizeof (EFI_MEMORY_EXTENDED_ERROR_DATA));
+  if (ExtendedErrorData == NULL) {
+    return EFI_OUT_OF_RESOURCES;
+  }
+
+  ExtendedErrorData->DataHeader.HeaderSize  = (UINT16) sizeof (EFI_STATUS_CODE_DATA);
+  ExtendedErrorData->DataHeader.Size        = (UINT16) (sizeof (EFI_MEMORY_EXTENDED_ERROR_DATA) - sizeof (EFI_STATUS_CODE_DATA));
+  ExtendedErrorData->Granularity            = EFI_MEMORY_ERROR_DEVICE;
+  ExtendedErrorData->Operation              = EFI_MEMORY_OPERATION_READ;
+  ExtendedErrorData->Syndrome               = 0x0;
+  ExtendedErrorData->Address                = Address;
+  ExtendedErrorData->Resolution             = 0x40;
+
+  REPORT_STATUS_CODE_EX (
+      EFI_ERROR_CODE,
+      EFI_COMPUTING_UNIT_MEMORY | EFI_CU_MEMORY_EC_UNCORRECTABLE,
+      0,
+      &gEfiGenericMemTestProtocolGuid,
+      NULL,
+      (UINT8 *) ExtendedErrorData + sizeof (EFI_STATUS_CODE_DATA),
+      ExtendedErrorData->DataHeader.Size
+      );
+
+  FreePool (ExtendedErrorData);
+  return EFI_DEVICE_ERROR;
+}
+
+/**
+  Write the memory test pattern into the slice of the test block assigned to
+  the calling AP, and verify it.
+
+  This runs on the APs, so it does not use any boot service. The first
+  miscompare is only recorded in the slice, and reported later by the BSP.
+
+  @param[in, out] Buffer  Point to generic memory test driver's private data.
+
+**/
+VOID
+EFIAPI
+MemoryTestSliceProcedure (
+  IN OUT VOID                      *Buffer
+  )
+{
+  EFI_STATUS                  Status;
+  GENERIC_MEMORY_TEST_PRIVATE *Private;
+  MEMORY_TEST_SLICE           *Slice;
+  UINTN                       ProcessorNumber;
+  EFI_PHYSICAL_ADDRESS        Address;
+  EFI_PHYSICAL_ADDRESS        End;
+
+  Private = (GENERIC_MEMORY_TEST_PRIVATE *) Buffer;
+
+  Status = Private->MpServices->WhoAmI (Private->MpServices, &ProcessorNumber);
+  if (EFI_ERROR (Status) || Private->ProcessorSlice[ProcessorNumber] >= Private->NumberOfSlices) {
+    return;
+  }
+
+  Slice = &Private->Slices[Private->ProcessorSlice[ProcessorNumber]];
+  End   = Slice->Start + Slice->Length;
+
+  for (Address = Slice->Start; Address < End; Address += Private->CoverageSpan) {
+    CopyMem ((VOID *) (UINTN) Address, Private->MonoPattern, Private->MonoTestSize);
+    //
+    // Flush the pattern out of the caches, so that it is read back from the
+    // memory below.
+    //
+    WriteBackInvalidateDataCacheRange ((VOID *) (UINTN) Address, Private->MonoTestSize);
+  }
+
+  for (Address = Slice->Start; Address < End; Address += Private->CoverageSpan) {
+    if (CompareMemWithoutCheckArgument (
+          (VOID *) (UINTN) Address,
+          Private->MonoPattern,
+          Private->MonoTestSize
+          ) != 0) {
+      Slice->ErrorAddress = Address;
+      Slice->ErrorFound   = TRUE;
+      break;
+    }
+  }
+
+  Slice->Tested = TRUE;
+}
+
+/**
+  Prepare the APs to share the memory test.
+
+  The enabled APs are ordered by package, so that the slices of a test block
+  which are handed to the processors of one package are contiguous.
+
+  @param[in] Private  Point to generic memory test driver's private data.
+
+  @retval EFI_SUCCESS      The test blocks will be split across the APs.
+  @retval EFI_UNSUPPORTED  There is no AP to share the memory test.
+  @retval Others           Failed to get the processor information.
+
+**/
+EFI_STATUS
+InitializeMpMemoryTest (
+  IN  GENERIC_MEMORY_TEST_PRIVATE  *Private
+  )
+{
+  EFI_STATUS                 Status;
+  EFI_MP_SERVICES_PROTOCOL   *MpServices;
+  EFI_PROCESSOR_INFORMATION  *ProcessorInfo;
+  UINTN                      NumberOfProcessors;
+  UINTN                      NumberOfEnabledProcessors;
+  UINTN                      NumberOfSlices;
+  UINTN                      Index;
+  UINT32                     Package;
+  BOOLEAN                    PackageFound;
+
+  Status = gBS->LocateProtocol (
+                  &gEfiMpServiceProtocolGuid,
+                  NULL,
+                  (VOID **) &MpServices
+                  );
+  if (EFI_ERROR (Status)) {
+    return EFI_UNSUPPORTED;
+  }
+
+  Status = MpServices->GetNumberOfProcessors (
+                         MpServices,
+                         &NumberOfProcessors,
+                         &NumberOfEnabledProcessors
+                         );
+  if (EFI_ERROR (Status)) {
+    return Status;
+  }
+  if (NumberOfEnabledProcessors <= 1) {
+    return EFI_UNSUPPORTED;
+  }
+
+  Private->MpServices     = MpServices;
+  Private->ProcessorSlice = AllocatePool (NumberOfProcessors * sizeof (UINTN));
+  Private->Slices         = AllocateZeroPool ((NumberOfEnabledProcessors - 1) * sizeof (MEMORY_TEST_SLICE));
+  ProcessorInfo           = AllocatePool (NumberOfProcessors * sizeof (EFI_PROCESSOR_INFORMATION));
+  if (Private->ProcessorSlice == NULL || Private->Slices == NULL || ProcessorInfo == NULL) {
+    Status = EFI_OUT_OF_RESOURCES;
+    goto Done;
+  }
+
+  for (Index = 0; Index < NumberOfProcessors; Index++) {
+    Private->ProcessorSlice[Index] = MAX_UINTN;
+    Status = MpServices->GetProcessorInfo (MpServices, Index, &ProcessorInfo[Index]);
+    if (EFI_ERROR (Status)) {
+      goto Done;
+    }
+  }
+
+  //
+  // Hand out the slices package by package, lowest package first. Each test
+  // block is split into contiguous slices in this order, so the processors of
+  // one package work on neighbouring memory.
+  //
+  NumberOfSlices = 0;
+  do {
+    PackageFound = FALSE;
+    Package      = 0;
+    for (Index = 0; Index < NumberOfProcessors; Index++) {
+      if ((ProcessorInfo[Index].StatusFlag & (PROCESSOR_ENABLED_BIT | PROCESSOR_AS_BSP_BIT)) == PROCESSOR_ENABLED_BIT &&
+          Private->ProcessorSlice[Index] == MAX_UINTN &&
+          (!PackageFound || ProcessorInfo[Index].Location.Package < Package)) {
+        PackageFound = TRUE;
+        Package      = ProcessorInfo[Index].Location.Package;
       }
+    }
 
-      ExtendedErrorData->DataHeader.HeaderSize  = (UINT16) sizeof (EFI_STATUS_CODE_DATA);
-      ExtendedErrorData->DataHeader.Size        = (UINT16) (sizeof (EFI_MEMORY_EXTENDED_ERROR_DATA) - sizeof (EFI_STATUS_CODE_DATA));
-      ExtendedErrorData->Granularity            = EFI_MEMORY_ERROR_DEVICE;
-      ExtendedErrorData->Operation              = EFI_MEMORY_OPERATION_READ;
-      ExtendedErrorData->Syndrome               = 0x0;
-      ExtendedErrorData->Address                = Address;
-      ExtendedErrorData->Resolution             = 0x40;
+    for (Index = 0; PackageFound && Index < NumberOfProcessors; Index++) {
+      if ((ProcessorInfo[Index].StatusFlag & (PROCESSOR_ENABLED_BIT | PROCESSOR_AS_BSP_BIT)) == PROCESSOR_ENABLED_BIT &&
+          Private->ProcessorSlice[Index] == MAX_UINTN &&
+          ProcessorInfo[Index].Location.Package == Package &&
+          NumberOfSlices < NumberOfEnabledProcessors - 1) {
+        Private->ProcessorSlice[Index] = NumberOfSlices++;
+      }
+    }
+  } while (PackageFound && NumberOfSlices < NumberOfEnabledProcessors - 1);
 
-      REPORT_STATUS_CODE_EX (
-          EFI_ERROR_CODE,
-          EFI_COMPUTING_UNIT_MEMORY | EFI_CU_MEMORY_EC_UNCORRECTABLE,
-          0,
-          &gEfiGenericMemTestProtocolGuid,
-          NULL,
-          (UINT8 *) ExtendedErrorData + sizeof (EFI_STATUS_CODE_DATA),
-          ExtendedErrorData->DataHeader.Size
-          ); 
+  if (NumberOfSlices == 0) {
+    Status = EFI_UNSUPPORTED;
+    goto Done;
+  }
+
+  //
+  // Give every AP a full block to test in each call, so BDS still gets a
+  // progress update for every TEST_BLOCK_SIZE of memory per processor.
+  //
+  Private->NumberOfSlices = NumberOfSlices;
+  Private->BdsBlockSize   = MultU64x32 (TEST_BLOCK_SIZE, (UINT32) NumberOfSlices);
+
+  DEBUG ((EFI_D_INFO, "GenericMemoryTest: %d APs share the memory test, block size 0x%lx\n", NumberOfSlices, Private->BdsBlockSize));
+
+Done:
+  if (ProcessorInfo != NULL) {
+    FreePool (ProcessorInfo);
+  }
+  if (EFI_ERROR (Status)) {
+    FreeMpMemoryTest (Private);
+  }
+  return Status;
+}
+
+/**
+  Free the resources used to share the memory test with the APs.
 
-      return EFI_DEVICE_ERROR;
+  @param[in] Private  Point to generic memory test driver's private data.
+
+**/
+VOID
+FreeMpMemoryTest (
+  IN  GENERIC_MEMORY_TEST_PRIVATE  *Private
+  )
+{
+  if (Private->ProcessorSlice != NULL) {
+    FreePool (Private->ProcessorSlice);
+  }
+  if (Private->Slices != NULL) {
+    FreePool (Private->Slices);
+  }
+
+  Private->MpServices     = NULL;
+  Private->NumberOfSlices = 0;
+  Private->Slices         = NULL;
+  Private->ProcessorSlice = NULL;
+  Private->BdsBlockSize   = TEST_BLOCK_SIZE;
+}
+
+/**
+  Write and verify the memory test pattern in a range of physical memory,
+  with every enabled AP testing one slice of the range.
+
+  @param[in] Private  Point to generic memory test driver's private data.
+  @param[in] Start    The memory range's start address.
+  @param[in] Size     The memory range's size.
+
+  @retval EFI_SUCCESS Successful verify the range of memory, no errors' location found.
+  @retval Others      The range of memory have errors contained.
+
+**/
+EFI_STATUS
+MpWriteVerifyMemory (
+  IN  GENERIC_MEMORY_TEST_PRIVATE  *Private,
+  IN  EFI_PHYSICAL_ADDRESS         Start,
+  IN  UINT64                       Size
+  )
+{
+  EFI_STATUS            Status;
+  MEMORY_TEST_SLICE     *Slice;
+  EFI_PHYSICAL_ADDRESS  Address;
+  UINT64                Remaining;
+  UINT64                SliceSize;
+  UINTN                 Index;
+
+  //
+  // Add 4G memory address check for IA32 platform
+  // NOTE: Without page table, there is no way to use memory above 4G.
+  //
+  if (Start + Size > MAX_ADDRESS) {
+    return EFI_SUCCESS;
+  }
+
+  //
+  // Keep the slices a multiple of the coverage span, so the pattern goes to
+  // the same locations as when the BSP tests the whole block.
+  //
+  SliceSize = DivU64x32 (Size + Private->NumberOfSlices - 1, (UINT32) Private->NumberOfSlices);
+  SliceSize = (SliceSize + Private->CoverageSpan - 1) & ~((UINT64) Private->CoverageSpan - 1);
+
+  Address   = Start;
+  Remaining = Size;
+  for (Index = 0; Index < Private->NumberOfSlices; Index++) {
+    Slice             = &Private->Slices[Index];
+    Slice->Start      = Address;
+    Slice->Length     = MIN (SliceSize, Remaining);
+    Slice->Tested     = FALSE;
+    Slice->ErrorFound = FALSE;
+    Address          += Slice->Length;
+    Remaining        -= Slice->Length;
+  }
+
+  Private->MpServices->StartupAllAPs (
+                         Private->MpServices,
+                         MemoryTestSliceProcedure,
+                         FALSE,
+                         NULL,
+                         0,
+                         Private,
+                         NULL
+                         );
+
+  for (Index = 0; Index < Private->NumberOfSlices; Index++) {
+    Slice = &Private->Slices[Index];
+    if (Slice->Length == 0) {
+      continue;
     }
 
-    Address += Private->CoverageSpan;
+    if (!Slice->Tested) {
+      //
+      // The AP did not run, e.g. it was disabled after the memory test was
+      // initialized, so test its slice on the BSP.
+      //
+      WriteMemory (Private, Slice->Start, Slice->Length);
+      Status = VerifyMemory (Private, Slice->Start, Slice->Length);
+      if (EFI_ERROR (Status)) {
+        return Status;
+      }
+    } else if (Slice->ErrorFound) {
+      return ReportMemoryError (Slice->ErrorAddress);
+    }
   }
 
   return EFI_SUCCESS;
@@ -504,6 +809,13 @@ InitializeMemoryTest (
     return EFI_NO_MEDIA;
   }
   //
+  // Split every test block across the APs if the platform asks for it
+  //
+  FreeMpMemoryTest (Private);
+  if (FeaturePcdGet (PcdMemoryTestUseAllProcessors) && Private->CoverLevel != IGNORE) {
+    InitializeMpMemoryTest (Private);
+  }
+  //
   // ready to perform the R/W/V memory test
   //
   mTestedSystemMemory = Private->BaseMemorySize;
@@ -590,9 +902,13 @@ GenPerformMemoryTest (
       // The software memory test (R/W/V) perform here. It will detect the
       // memory mis-compare error.
       //
-      WriteMemory (Private, mCurrentAddress, BlockBoundary);
+      if (Private->NumberOfSlices != 0) {
+        Status = MpWriteVerifyMemory (Private, mCurrentAddress, BlockBoundary);
+      } else {
+        WriteMemory (Private, mCurrentAddress, BlockBoundary);
 
-      Status = VerifyMemory (Private, mCurrentAddress, BlockBoundary);
+        Status = VerifyMemory (Private, mCurrentAddress, BlockBoundary);
+      }
       if (EFI_ERROR (Status)) {
         //
         // If perform here, means there is mis-compare error, and no agent can
@@ -674,6 +990,8 @@ GenMemoryTestFinished (
   //
   DestroyLinkList (Private);
 
+  FreeMpMemoryTest (Private);
+
   return EFI_SUCCESS;
 }
 
@@ -828,7 +1146,11 @@ GENERIC_MEMORY_TEST_PRIVATE mGenericMemoryTestPrivate = {
   {
     NULL,
     NULL
-  }
+  },
+  NULL,
+  0,
+  NULL,
+  NULL
 };
 
 /**
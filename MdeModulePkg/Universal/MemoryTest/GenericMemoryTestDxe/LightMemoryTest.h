@@ -1,7 +1,7 @@
 /** @file
   The generic memory test driver definition
 
-  Copyright (c) 2006 - 2010, Intel Corporation. All rights reserved.<BR>
+  Copyright (c) 2006 - 2017, Intel Corporation. All rights reserved.<BR>
 
   This program and the accompanying materials
   are licensed and made available under the terms and conditions
@@ -20,6 +20,7 @@
 #include <Guid/StatusCodeDataTypeId.h>
 #include <Protocol/GenericMemoryTest.h>
 #include <Protocol/Cpu.h>
+#include <Protocol/MpService.h>
 
 #include <Library/DebugLib.h>
 #include <Library/UefiDriverEntryPoint.h>
@@ -30,6 +31,8 @@
 #include <Library/BaseMemoryLib.h>
 #include <Library/MemoryAllocationLib.h>
 #include <Library/UefiBootServicesTableLib.h>
+#include <Library/CacheMaintenanceLib.h>
+#include <Library/PcdLib.h>
 
 //
 // Some global define
@@ -74,6 +77,18 @@ typedef struct {
   EFI_NONTESTED_MEMORY_RANGE_SIGNATURE \
   )
 
+//
+// This structure records the part of a test block that one AP writes and
+// verifies, and the first miscompare the AP found in it.
+//
+typedef struct {
+  EFI_PHYSICAL_ADDRESS  Start;
+  UINT64                Length;
+  BOOLEAN               Tested;
+  BOOLEAN               ErrorFound;
+  EFI_PHYSICAL_ADDRESS  ErrorAddress;
+} MEMORY_TEST_SLICE;
+
 //
 // This is the memory test driver's structure definition
 //
@@ -117,6 +132,15 @@ typedef struct {
   //
   LIST_ENTRY                    NonTestedMemRanList;
 
+  //
+  // MP services protocol's pointer and the per AP slices of the block under
+  // test, only used when PcdMemoryTestUseAllProcessors is TRUE
+  //
+  EFI_MP_SERVICES_PROTOCOL          *MpServices;
+  UINTN                             NumberOfSlices;
+  MEMORY_TEST_SLICE                 *Slices;
+  UINTN                             *ProcessorSlice;
+
 } GENERIC_MEMORY_TEST_PRIVATE;
 
 #define GENERIC_MEMORY_TEST_PRIVATE_FROM_THIS(a) \
@@ -241,6 +265,84 @@ VerifyMemory (
   IN  UINT64                       Size
   );
 
+/**
+  Report an uncorrectable memory error found by the software memory test.
+
+  @param[in] Address  The address of the miscompare.
+
+  @retval EFI_DEVICE_ERROR     The error is reported.
+  @retval EFI_OUT_OF_RESOURCES Could not allocate the extended error data.
+
+**/
+EFI_STATUS
+ReportMemoryError (
+  IN  EFI_PHYSICAL_ADDRESS         Address
+  );
+
+/**
+  Write the memory test pattern into the slice of the test block assigned to
+  the calling AP, and verify it.
+
+  This runs on the APs, so it does not use any boot service. The first
+  miscompare is only recorded in the slice, and reported later by the BSP.
+
+  @param[in, out] Buffer  Point to generic memory test driver's private data.
+
+**/
+VOID
+EFIAPI
+MemoryTestSliceProcedure (
+  IN OUT VOID                      *Buffer
+  );
+
+/**
+  Prepare the APs to share the memory test.
+
+  The enabled APs are ordered by package, so that the slices of a test block
+  which are handed to the processors of one package are contiguous.
+
+  @param[in] Private  Point to generic memory test driver's private data.
+
+  @retval EFI_SUCCESS      The test blocks will be split across the APs.
+  @retval EFI_UNSUPPORTED  There is no AP to share the memory test.
+  @retval Others           Failed to get the processor information.
+
+**/
+EFI_STATUS
+InitializeMpMemoryTest (
+  IN  GENERIC_MEMORY_TEST_PRIVATE  *Private
+  );
+
+/**
+  Free the resources used to share the memory test with the APs.
+
+  @param[in] Private  Point to generic memory test driver's private data.
+
+**/
+VOID
+FreeMpMemoryTest (
+  IN  GENERIC_MEMORY_TEST_PRIVATE  *Private
+  );
+
+/**
+  Write and verify the memory test pattern in a range of physical memory,
+  with every enabled AP testing one slice of the range.
+
+  @param[in] Private  Point to generic memory test driver's private data.
+  @param[in] Start    The memory range's start address.
+  @param[in] Size     The memory range's size.
+
+  @retval EFI_SUCCESS Successful verify the range of memory, no errors' location found.
+  @retval Others      The range of memory have errors contained.
+
+**/
+EFI_STATUS
+MpWriteVerifyMemory (
+  IN  GENERIC_MEMORY_TEST_PRIVATE  *Private,
+  IN  EFI_PHYSICAL_ADDRESS         Start,
+  IN  UINT64                       Size
+  );
+
 /**
   Test a range of the memory directly .
 
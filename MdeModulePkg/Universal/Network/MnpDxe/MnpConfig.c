@@ -1,7 +1,7 @@
 /** @file
   Implementation of Managed Network Protocol private services.
 
-Copyright (c) 2005 - 2016, Intel Corporation. All rights reserved.<BR>
+Copyright (c) 2005 - 2017, Intel Corporation. All rights reserved.<BR>
 This program and the accompanying materials
 are licensed and made available under the terms and conditions
 of the BSD License which accompanies this distribution.  The full
@@ -32,6 +32,11 @@ EFI_MANAGED_NETWORK_PROTOCOL    mMnpProtocolTemplate = {
   MnpPoll
 };
 
+EDKII_MANAGED_NETWORK_DIAGNOSTICS_PROTOCOL  mMnpDiagnosticsProtocolTemplate = {
+  MnpGetStatistics,
+  MnpResetStatistics
+};
+
 EFI_MANAGED_NETWORK_CONFIG_DATA mMnpDefaultConfigData = {
   10000000,
   10000000,
@@ -443,6 +448,7 @@ MnpInitializeDeviceData (
   // Copy the MNP Protocol interfaces from the template.
   //
   CopyMem (&MnpDeviceData->VlanConfig, &mVlanConfigProtocolTemplate, sizeof (EFI_VLAN_CONFIG_PROTOCOL));
+  CopyMem (&MnpDeviceData->Diagnostics, &mMnpDiagnosticsProtocolTemplate, sizeof (EDKII_MANAGED_NETWORK_DIAGNOSTICS_PROTOCOL));
 
   //
   // Open the Simple Network protocol.
@@ -568,6 +574,21 @@ MnpInitializeDeviceData (
     goto ERROR;
   }
 
+  //
+  // Install the Managed Network Diagnostics Protocol.
+  //
+  Status = gBS->InstallMultipleProtocolInterfaces (
+                  &ControllerHandle,
+                  &gEdkiiManagedNetworkDiagnosticsProtocolGuid,
+                  &MnpDeviceData->Diagnostics,
+                  NULL
+                  );
+  if (EFI_ERROR (Status)) {
+    DEBUG ((EFI_D_ERROR, "MnpInitializeDeviceData: Install diagnostics protocol failed, %r.\n", Status));
+
+    goto ERROR;
+  }
+
 ERROR:
   if (EFI_ERROR (Status)) {
     //
@@ -643,6 +664,16 @@ MnpDestroyDeviceData (
   //
   ASSERT (IsListEmpty (&MnpDeviceData->GroupAddressList));
 
+  //
+  // Uninstall the Managed Network Diagnostics Protocol.
+  //
+  gBS->UninstallMultipleProtocolInterfaces (
+         MnpDeviceData->ControllerHandle,
+         &gEdkiiManagedNetworkDiagnosticsProtocolGuid,
+         &MnpDeviceData->Diagnostics,
+         NULL
+         );
+
   //
   // Close the event.
   //
@@ -1287,6 +1318,8 @@ MnpStart (
     }
 
     MnpDeviceData->EnableSystemPoll = EnableSystemPoll;
+    MnpDeviceData->PollInterval     = MNP_SYS_POLL_INTERVAL;
+    MnpDeviceData->IdlePollCount    = 0;
   }
 
   //
@@ -1396,6 +1429,7 @@ MnpFlushRcvdDataQueue (
     //
     MnpRecycleRxData (NULL, (VOID *) RxDataWrap);
     Instance->RcvdPacketQueueSize--;
+    Instance->MnpServiceData->MnpDeviceData->Statistics.RxQueueDepth--;
   }
 
   ASSERT (Instance->RcvdPacketQueueSize == 0);
@@ -1,7 +1,7 @@
 /** @file
   Declaration of strctures and functions for MnpDxe driver.
 
-Copyright (c) 2005 - 2016, Intel Corporation. All rights reserved.<BR>
+Copyright (c) 2005 - 2017, Intel Corporation. All rights reserved.<BR>
 This program and the accompanying materials
 are licensed and made available under the terms and conditions
 of the BSD License which accompanies this distribution.  The full
@@ -22,6 +22,7 @@ WITHOUT WARRANTIES OR REPRESENTATIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED.
 #include <Protocol/SimpleNetwork.h>
 #include <Protocol/ServiceBinding.h>
 #include <Protocol/VlanConfig.h>
+#include <Protocol/ManagedNetworkDiagnostics.h>
 
 #include <Library/BaseLib.h>
 #include <Library/BaseMemoryLib.h>
@@ -52,6 +53,8 @@ typedef struct {
 
   EFI_VLAN_CONFIG_PROTOCOL      VlanConfig;
   UINTN                         NumberOfVlan;
+  EDKII_MANAGED_NETWORK_DIAGNOSTICS_PROTOCOL  Diagnostics;
+  EDKII_MANAGED_NETWORK_STATISTICS            Statistics;
   CHAR16                        *MacString;
   EFI_SIMPLE_NETWORK_PROTOCOL   *Snp;
 
@@ -76,6 +79,12 @@ typedef struct {
 
   EFI_EVENT                     PollTimer;
   BOOLEAN                       EnableSystemPoll;
+  //
+  // Current period of the system poll, and the number of empty polls
+  // since the period was last changed.
+  //
+  UINT32                        PollInterval;
+  UINT32                        IdlePollCount;
 
   EFI_EVENT                     TimeoutCheckTimer;
   EFI_EVENT                     MediaDetectTimer;
@@ -102,6 +111,14 @@ typedef struct {
   MNP_DEVICE_DATA_SIGNATURE \
   )
 
+#define MNP_DEVICE_DATA_FROM_DIAGNOSTICS(a) \
+  CR ( \
+  (a), \
+  MNP_DEVICE_DATA, \
+  Diagnostics, \
+  MNP_DEVICE_DATA_SIGNATURE \
+  )
+
 #define MNP_SERVICE_DATA_SIGNATURE  SIGNATURE_32 ('M', 'n', 'p', 'S')
 
 typedef struct {
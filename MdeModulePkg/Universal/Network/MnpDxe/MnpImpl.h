@@ -1,7 +1,7 @@
 /** @file
   Declaration of structures and functions of MnpDxe driver.
 
-Copyright (c) 2005 - 2016, Intel Corporation. All rights reserved.<BR>
+Copyright (c) 2005 - 2017, Intel Corporation. All rights reserved.<BR>
 This program and the accompanying materials
 are licensed and made available under the terms and conditions
 of the BSD License which accompanies this distribution.  The full
@@ -20,7 +20,10 @@ WITHOUT WARRANTIES OR REPRESENTATIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED.
 
 #define NET_ETHER_FCS_SIZE            4
 
-#define MNP_SYS_POLL_INTERVAL         (10 * TICKS_PER_MS)   // 10 milliseconds
+#define MNP_SYS_POLL_INTERVAL         (10 * TICKS_PER_MS)   // 10 milliseconds, the poll period when idle
+#define MNP_SYS_POLL_INTERVAL_MIN     (1 * TICKS_PER_MS)    // 1 millisecond, the poll period under traffic
+#define MNP_SYS_POLL_IDLE_COUNT       8     // Empty polls before the poll period is doubled.
+#define MNP_RX_BATCH_MAX              64    // Frames received at most in one poll.
 #define MNP_TIMEOUT_CHECK_INTERVAL    (50 * TICKS_PER_MS)   // 50 milliseconds
 #define MNP_MEDIA_DETECT_INTERVAL     (500 * TICKS_PER_MS)  // 500 milliseconds
 #define MNP_TX_TIMEOUT_TIME           (500 * TICKS_PER_MS)  // 500 milliseconds
@@ -437,6 +440,22 @@ MnpReceivePacket (
   IN OUT MNP_DEVICE_DATA   *MnpDeviceData
   );
 
+/**
+  Receive and deliver the packets pending in Snp, up to MNP_RX_BATCH_MAX of them.
+
+  @param[in, out]  MnpDeviceData        Pointer to the mnp device context data.
+
+  @retval EFI_SUCCESS           At least one packet is received.
+  @retval EFI_NOT_STARTED       The simple network protocol is not started.
+  @retval EFI_NOT_READY         No packet received.
+  @retval EFI_DEVICE_ERROR      An unexpected error occurs.
+
+**/
+EFI_STATUS
+MnpReceivePackets (
+  IN OUT MNP_DEVICE_DATA   *MnpDeviceData
+  );
+
 /**
   Allocate a free NET_BUF from MnpDeviceData->FreeNbufQue. If there is none
   in the queue, first try to allocate some and add them into the queue, then
@@ -886,6 +905,40 @@ MnpPoll (
   IN EFI_MANAGED_NETWORK_PROTOCOL    *This
   );
 
+/**
+  Get the receive statistics of the network device gathered since the device
+  was started or since the last reset.
+
+  @param[in]  This                   The protocol instance pointer.
+  @param[out] Statistics             Returns the receive statistics.
+
+  @retval EFI_SUCCESS                The statistics were returned.
+  @retval EFI_INVALID_PARAMETER      This or Statistics is NULL.
+
+**/
+EFI_STATUS
+EFIAPI
+MnpGetStatistics (
+  IN  EDKII_MANAGED_NETWORK_DIAGNOSTICS_PROTOCOL  *This,
+  OUT EDKII_MANAGED_NETWORK_STATISTICS            *Statistics
+  );
+
+/**
+  Reset the receive statistics of the network device. PollInterval and
+  RxQueueDepth are not affected.
+
+  @param[in]  This                   The protocol instance pointer.
+
+  @retval EFI_SUCCESS                The statistics were reset.
+  @retval EFI_INVALID_PARAMETER      This is NULL.
+
+**/
+EFI_STATUS
+EFIAPI
+MnpResetStatistics (
+  IN  EDKII_MANAGED_NETWORK_DIAGNOSTICS_PROTOCOL  *This
+  );
+
 /**
   Configure the Snp receive filters according to the instances' receive filter
   settings.
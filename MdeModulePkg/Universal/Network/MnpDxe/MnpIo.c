@@ -1,7 +1,7 @@
 /** @file
   Implementation of Managed Network Protocol I/O functions.
 
-Copyright (c) 2005 - 2016, Intel Corporation. All rights reserved.<BR>
+Copyright (c) 2005 - 2017, Intel Corporation. All rights reserved.<BR>
 This program and the accompanying materials
 are licensed and made available under the terms and conditions
 of the BSD License which accompanies this distribution.  The full
@@ -363,6 +363,7 @@ MnpInstanceDeliverPacket (
   //
   NetListRemoveHead (&Instance->RcvdPacketQueue);
   Instance->RcvdPacketQueueSize--;
+  MnpDeviceData->Statistics.RxQueueDepth--;
 
   RxData  = &RxDataWrap->RxData;
   SnpMode = MnpDeviceData->Snp->Mode;
@@ -486,8 +487,10 @@ MnpQueueRcvdPacket (
   )
 {
   MNP_RXDATA_WRAP *OldRxDataWrap;
+  MNP_DEVICE_DATA *MnpDeviceData;
 
   NET_CHECK_SIGNATURE (Instance, MNP_INSTANCE_DATA_SIGNATURE);
+  MnpDeviceData = Instance->MnpServiceData->MnpDeviceData;
 
   //
   // Check the queue size. If it exceeds the limit, drop one packet
@@ -511,6 +514,8 @@ MnpQueueRcvdPacket (
     //
     MnpRecycleRxData (NULL, (VOID *) OldRxDataWrap);
     Instance->RcvdPacketQueueSize--;
+    MnpDeviceData->Statistics.RxQueueDepth--;
+    MnpDeviceData->Statistics.RxDroppedQueueFull++;
   }
 
   //
@@ -523,6 +528,11 @@ MnpQueueRcvdPacket (
   //
   InsertTailList (&Instance->RcvdPacketQueue, &RxDataWrap->WrapEntry);
   Instance->RcvdPacketQueueSize++;
+
+  MnpDeviceData->Statistics.RxQueueDepth++;
+  if (MnpDeviceData->Statistics.RxQueueDepth > MnpDeviceData->Statistics.MaxRxQueueDepth) {
+    MnpDeviceData->Statistics.MaxRxQueueDepth = MnpDeviceData->Statistics.RxQueueDepth;
+  }
 }
 
 
@@ -885,6 +895,7 @@ MnpReceivePacket (
       //
       // No available buffer in the buffer pool.
       //
+      MnpDeviceData->Statistics.RxNoBuffer++;
       return EFI_DEVICE_ERROR;
     }
 
@@ -905,15 +916,16 @@ MnpReceivePacket (
   //
   Status = Snp->Receive (Snp, &HeaderSize, &BufLen, BufPtr, NULL, NULL, NULL);
   if (EFI_ERROR (Status)) {
-    DEBUG_CODE (
-      if (Status != EFI_NOT_READY) {
-        DEBUG ((EFI_D_WARN, "MnpReceivePacket: Snp->Receive() = %r.\n", Status));
-      }
-    );
+    if (Status != EFI_NOT_READY) {
+      DEBUG ((EFI_D_WARN, "MnpReceivePacket: Snp->Receive() = %r.\n", Status));
+      MnpDeviceData->Statistics.RxErrors++;
+    }
 
     return Status;
   }
 
+  MnpDeviceData->Statistics.RxFrames++;
+
   //
   // Sanity check.
   //
@@ -924,6 +936,7 @@ MnpReceivePacket (
       HeaderSize,
       BufLen)
       );
+    MnpDeviceData->Statistics.RxErrors++;
     return EFI_DEVICE_ERROR;
   }
 
@@ -951,6 +964,7 @@ MnpReceivePacket (
     //
     // VLAN is not set for this tagged frame, ignore this packet
     //
+    MnpDeviceData->Statistics.RxNoReceiver++;
     if (Trimmed > 0) {
       NetbufAllocSpace (Nbuf, Trimmed, NET_BUF_TAIL);
     }
@@ -978,6 +992,7 @@ MnpReceivePacket (
     MnpDeviceData->RxNbufCache = Nbuf;
     if (Nbuf == NULL) {
       DEBUG ((EFI_D_ERROR, "MnpReceivePacket: Alloc packet for receiving cache failed.\n"));
+      MnpDeviceData->Statistics.RxNoBuffer++;
       return EFI_DEVICE_ERROR;
     }
 
@@ -986,6 +1001,7 @@ MnpReceivePacket (
     //
     // No receiver for this packet.
     //
+    MnpDeviceData->Statistics.RxNoReceiver++;
     if (Trimmed > 0) {
       NetbufAllocSpace (Nbuf, Trimmed, NET_BUF_TAIL);
     }
@@ -1008,6 +1024,56 @@ EXIT:
 }
 
 
+/**
+  Receive and deliver the packets pending in Snp, up to MNP_RX_BATCH_MAX of them.
+
+  @param[in, out]  MnpDeviceData        Pointer to the mnp device context data.
+
+  @retval EFI_SUCCESS           At least one packet is received.
+  @retval EFI_NOT_STARTED       The simple network protocol is not started.
+  @retval EFI_NOT_READY         No packet received.
+  @retval EFI_DEVICE_ERROR      An unexpected error occurs.
+
+**/
+EFI_STATUS
+MnpReceivePackets (
+  IN OUT MNP_DEVICE_DATA   *MnpDeviceData
+  )
+{
+  EFI_STATUS  Status;
+  UINT32      Count;
+
+  Count = 0;
+  do {
+    Status = MnpReceivePacket (MnpDeviceData);
+
+    //
+    // Dispatch the DPC queued by the NotifyFunction of rx token's events,
+    // so the receivers can queue a new token before the next packet.
+    //
+    DispatchDpc ();
+
+    if (EFI_ERROR (Status)) {
+      break;
+    }
+
+    Count++;
+  } while (Count < MNP_RX_BATCH_MAX);
+
+  MnpDeviceData->Statistics.PollCount++;
+  if (Count == 0) {
+    MnpDeviceData->Statistics.EmptyPollCount++;
+    return Status;
+  }
+
+  if (Count > MnpDeviceData->Statistics.MaxFramesPerPoll) {
+    MnpDeviceData->Statistics.MaxFramesPerPoll = Count;
+  }
+
+  return EFI_SUCCESS;
+}
+
+
 /**
   Remove the received packets if timeout occurs.
 
@@ -1069,6 +1135,8 @@ MnpCheckPacketTimeout (
           DEBUG ((EFI_D_WARN, "MnpCheckPacketTimeout: Received packet timeout.\n"));
           MnpRecycleRxData (NULL, RxDataWrap);
           Instance->RcvdPacketQueueSize--;
+          MnpDeviceData->Statistics.RxQueueDepth--;
+          MnpDeviceData->Statistics.RxDroppedTimeout++;
         }
       }
 
@@ -1124,6 +1192,8 @@ MnpSystemPoll (
   )
 {
   MNP_DEVICE_DATA  *MnpDeviceData;
+  EFI_STATUS       Status;
+  UINT32           Interval;
 
   MnpDeviceData = (MNP_DEVICE_DATA *) Context;
   NET_CHECK_SIGNATURE (MnpDeviceData, MNP_DEVICE_DATA_SIGNATURE);
@@ -1131,10 +1201,30 @@ MnpSystemPoll (
   //
   // Try to receive packets from Snp.
   //
-  MnpReceivePacket (MnpDeviceData);
+  Status = MnpReceivePackets (MnpDeviceData);
+
+  if (!MnpDeviceData->EnableSystemPoll) {
+    return;
+  }
 
   //
-  // Dispatch the DPC queued by the NotifyFunction of rx token's events.
+  // Adapt the poll period to the traffic: poll at the shortest period while
+  // packets arrive, and double the period after each run of empty polls until
+  // it is back at MNP_SYS_POLL_INTERVAL.
   //
-  DispatchDpc ();
+  Interval = MnpDeviceData->PollInterval;
+  if (!EFI_ERROR (Status)) {
+    MnpDeviceData->IdlePollCount = 0;
+    Interval = MNP_SYS_POLL_INTERVAL_MIN;
+  } else if (++MnpDeviceData->IdlePollCount >= MNP_SYS_POLL_IDLE_COUNT) {
+    MnpDeviceData->IdlePollCount = 0;
+    Interval = (UINT32) MIN (Interval * 2, MNP_SYS_POLL_INTERVAL);
+  }
+
+  if (Interval != MnpDeviceData->PollInterval) {
+    Status = gBS->SetTimer (MnpDeviceData->PollTimer, TimerPeriodic, Interval);
+    if (!EFI_ERROR (Status)) {
+      MnpDeviceData->PollInterval = Interval;
+    }
+  }
 }
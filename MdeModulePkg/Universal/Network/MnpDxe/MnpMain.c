@@ -1,7 +1,7 @@
 /** @file
   Implementation of Managed Network Protocol public services.
 
-Copyright (c) 2005 - 2016, Intel Corporation. All rights reserved.<BR>
+Copyright (c) 2005 - 2017, Intel Corporation. All rights reserved.<BR>
 This program and the accompanying materials
 are licensed and made available under the terms and conditions
 of the BSD License which accompanies this distribution.  The full
@@ -782,15 +782,85 @@ MnpPoll (
   //
   // Try to receive packets.
   //
-  Status = MnpReceivePacket (Instance->MnpServiceData->MnpDeviceData);
-
-  //
-  // Dispatch the DPC queued by the NotifyFunction of rx token's events.
-  //
-  DispatchDpc ();
+  Status = MnpReceivePackets (Instance->MnpServiceData->MnpDeviceData);
 
 ON_EXIT:
   gBS->RestoreTPL (OldTpl);
 
   return Status;
 }
+
+/**
+  Get the receive statistics of the network device gathered since the device
+  was started or since the last reset.
+
+  @param[in]  This                   The protocol instance pointer.
+  @param[out] Statistics             Returns the receive statistics.
+
+  @retval EFI_SUCCESS                The statistics were returned.
+  @retval EFI_INVALID_PARAMETER      This or Statistics is NULL.
+
+**/
+EFI_STATUS
+EFIAPI
+MnpGetStatistics (
+  IN  EDKII_MANAGED_NETWORK_DIAGNOSTICS_PROTOCOL  *This,
+  OUT EDKII_MANAGED_NETWORK_STATISTICS            *Statistics
+  )
+{
+  MNP_DEVICE_DATA    *MnpDeviceData;
+  EFI_TPL            OldTpl;
+
+  if ((This == NULL) || (Statistics == NULL)) {
+    return EFI_INVALID_PARAMETER;
+  }
+
+  MnpDeviceData = MNP_DEVICE_DATA_FROM_DIAGNOSTICS (This);
+
+  OldTpl = gBS->RaiseTPL (TPL_NOTIFY);
+
+  CopyMem (Statistics, &MnpDeviceData->Statistics, sizeof (EDKII_MANAGED_NETWORK_STATISTICS));
+  Statistics->PollInterval = MnpDeviceData->EnableSystemPoll ? MnpDeviceData->PollInterval : 0;
+
+  gBS->RestoreTPL (OldTpl);
+
+  return EFI_SUCCESS;
+}
+
+/**
+  Reset the receive statistics of the network device. PollInterval and
+  RxQueueDepth are not affected.
+
+  @param[in]  This                   The protocol instance pointer.
+
+  @retval EFI_SUCCESS                The statistics were reset.
+  @retval EFI_INVALID_PARAMETER      This is NULL.
+
+**/
+EFI_STATUS
+EFIAPI
+MnpResetStatistics (
+  IN  EDKII_MANAGED_NETWORK_DIAGNOSTICS_PROTOCOL  *This
+  )
+{
+  MNP_DEVICE_DATA    *MnpDeviceData;
+  UINT64             RxQueueDepth;
+  EFI_TPL            OldTpl;
+
+  if (This == NULL) {
+    return EFI_INVALID_PARAMETER;
+  }
+
+  MnpDeviceData = MNP_DEVICE_DATA_FROM_DIAGNOSTICS (This);
+
+  OldTpl = gBS->RaiseTPL (TPL_NOTIFY);
+
+  RxQueueDepth = MnpDeviceData->Statistics.RxQueueDepth;
+  ZeroMem (&MnpDeviceData->Statistics, sizeof (EDKII_MANAGED_NETWORK_STATISTICS));
+  MnpDeviceData->Statistics.RxQueueDepth    = RxQueueDepth;
+  MnpDeviceData->Statistics.MaxRxQueueDepth = RxQueueDepth;
+
+  gBS->RestoreTPL (OldTpl);
+
+  return EFI_SUCCESS;
+}
@@ -9,7 +9,7 @@
   RFC2348 - TFTP Blocksize Option
   RFC2349 - TFTP Timeout Interval and Transfer Size Options
   
-Copyright (c) 2006 - 2012, Intel Corporation. All rights reserved.<BR>
+Copyright (c) 2006 - 2017, Intel Corporation. All rights reserved.<BR>
 This program and the accompanying materials
 are licensed and made available under the terms and conditions of the BSD License
 which accompanies this distribution.  The full text of the license may be found at
@@ -56,6 +56,7 @@ typedef struct _MTFTP4_PROTOCOL MTFTP4_PROTOCOL;
 #define MTFTP4_DEFAULT_TIMEOUT      3
 #define MTFTP4_DEFAULT_RETRY        5
 #define MTFTP4_DEFAULT_BLKSIZE      512
+#define MTFTP4_DEFAULT_WINDOWSIZE   1
 #define MTFTP4_TIME_TO_GETMAP       5
 
 #define MTFTP4_STATE_UNCONFIGED     0
@@ -120,6 +121,16 @@ struct _MTFTP4_PROTOCOL {
   UINT16                        LastBlock;
   LIST_ENTRY                    Blocks;
 
+  //
+  // Number of blocks the server sends before it waits for an ACK, and
+  // the number of blocks received since the last ACK (RFC 7440). HoleAcked
+  // is set once a lost block of the window has been reported to the server,
+  // until the expected block arrives.
+  //
+  UINT16                        WindowSize;
+  UINT16                        WindowCount;
+  BOOLEAN                       HoleAcked;
+
   //
   // The server's communication end point: IP and two ports. one for
   // initial request, one for its selected port.
@@ -207,6 +218,23 @@ Mtftp4RrqStart (
   IN UINT16                 Operation
   );
 
+/**
+  Build and send a ACK packet for the download session.
+
+  @param  Instance              The Mtftp session
+  @param  BlkNo                 The BlkNo to ack.
+
+  @retval EFI_OUT_OF_RESOURCES  Failed to allocate memory for the packet
+  @retval EFI_SUCCESS           The ACK has been sent
+  @retval Others                Failed to send the ACK.
+
+**/
+EFI_STATUS
+Mtftp4RrqSendAck (
+  IN MTFTP4_PROTOCOL        *Instance,
+  IN UINT16                 BlkNo
+  );
+
 #define MTFTP4_SERVICE_FROM_THIS(a)   \
   CR (a, MTFTP4_SERVICE, ServiceBinding, MTFTP4_SERVICE_SIGNATURE)
 
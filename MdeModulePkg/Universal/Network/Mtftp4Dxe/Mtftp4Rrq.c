@@ -2,7 +2,7 @@
   Routines to process Rrq (download).
   
 (C) Copyright 2014 Hewlett-Packard Development Company, L.P.<BR>
-Copyright (c) 2006 - 2014, Intel Corporation. All rights reserved.<BR>
+Copyright (c) 2006 - 2017, Intel Corporation. All rights reserved.<BR>
 This program and the accompanying materials
 are licensed and made available under the terms and conditions of the BSD License
 which accompanies this distribution.  The full text of the license may be found at
@@ -115,6 +115,8 @@ Mtftp4RrqSendAck (
   Ack->Ack.OpCode   = HTONS (EFI_MTFTP4_OPCODE_ACK);
   Ack->Ack.Block[0] = HTONS (BlkNo);
 
+  Instance->WindowCount = 0;
+
   return Mtftp4SendPacket (Instance, Packet);
 }
 
@@ -268,7 +270,35 @@ Mtftp4RrqHandleData (
   // the block.
   //
   if (Instance->Master && (Expected != BlockNum)) {
-    Mtftp4Retransmit (Instance);
+    if (Instance->WindowSize == 1) {
+      Mtftp4Retransmit (Instance);
+      return EFI_SUCCESS;
+    }
+
+    //
+    // A block after the expected one in the same window means that a block
+    // is lost. ACK the last block received in order, once per expected
+    // block, so that the server sends the window again from there.
+    //
+    if ((UINT16) (BlockNum - (UINT16) Expected) < Instance->WindowSize) {
+      if (!Instance->HoleAcked) {
+        Instance->HoleAcked = TRUE;
+        return Mtftp4RrqSendAck (Instance, (UINT16) (Expected - 1));
+      }
+
+      return EFI_SUCCESS;
+    }
+
+    //
+    // Otherwise the server sends an old window again, as the ACK of it may
+    // be lost. Send the last ACK again at the end of that window, unless the
+    // timer already did: with the same timeout on both sides, a second copy
+    // would make the server send each later window twice.
+    //
+    if ((BlockNum == (UINT16) (Expected - 1)) && (Instance->CurRetry == 0)) {
+      Mtftp4Retransmit (Instance);
+    }
+
     return EFI_SUCCESS;
   }
 
@@ -278,11 +308,14 @@ Mtftp4RrqHandleData (
     return Status;
   }
 
+  Instance->HoleAcked = FALSE;
+
   //
   // Reset the passive client's timer whenever it received a
-  // valid data packet.
+  // valid data packet. So is the active client's when the
+  // server sends a window of blocks per ACK.
   //
-  if (!Instance->Master) {
+  if (!Instance->Master || (Instance->WindowSize > 1)) {
     Mtftp4SetTimeout (Instance);
   }
 
@@ -307,6 +340,13 @@ Mtftp4RrqHandleData (
 
     } else {
       BlockNum = (UINT16) (Expected - 1);
+
+      //
+      // ACK only the last block of each window.
+      //
+      if (++Instance->WindowCount < Instance->WindowSize) {
+        return EFI_SUCCESS;
+      }
     }
 
     Mtftp4RrqSendAck (Instance, BlockNum);
@@ -324,6 +364,7 @@ Mtftp4RrqHandleData (
   2. The server can only use smaller blksize than that is requested
   3. The server can only use the same timeout as requested
   4. The server doesn't change its multicast channel.
+  5. The server can only use smaller windowsize than that is requested
 
   @param  This                  The downloading Mtftp session
   @param  Reply                 The options in the OACK packet
@@ -357,6 +398,10 @@ Mtftp4RrqOackValid (
     return FALSE;
   }
 
+  if (((Reply->Exist & MTFTP4_WINDOWSIZE_EXIST) != 0) && (Reply->WindowSize > Request->WindowSize)) {
+    return FALSE;
+  }
+
   //
   // The server can send ",,master" to client to change its master
   // setting. But if it use the specific multicast channel, it can't
@@ -611,6 +656,13 @@ Mtftp4RrqHandleOack (
       Instance->BlkSize = Reply.BlkSize;
     }
 
+    //
+    // The window is only used for unicast download.
+    //
+    if (Reply.WindowSize != 0) {
+      Instance->WindowSize = Reply.WindowSize;
+    }
+
     if (Reply.Timeout != 0) {
       Instance->Timeout = Reply.Timeout;
     }
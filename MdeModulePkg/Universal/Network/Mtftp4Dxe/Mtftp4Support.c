@@ -1,7 +1,7 @@
 /** @file
   Support routines for Mtftp.
   
-Copyright (c) 2006 - 2015, Intel Corporation. All rights reserved.<BR>
+Copyright (c) 2006 - 2017, Intel Corporation. All rights reserved.<BR>
 This program and the accompanying materials
 are licensed and made available under the terms and conditions of the BSD License
 which accompanies this distribution.  The full text of the license may be found at
@@ -624,7 +624,15 @@ Mtftp4OnTimerTick (
     // otherwise exit the transfer.
     //
     if (++Instance->CurRetry < Instance->MaxRetry) {
-      Mtftp4Retransmit (Instance);
+      if (Instance->WindowCount != 0) {
+        //
+        // The end of the window is lost. ACK the blocks received since the
+        // last ACK rather than sending that ACK again.
+        //
+        Mtftp4RrqSendAck (Instance, (UINT16) (Mtftp4GetNextBlockNum (&Instance->Blocks) - 1));
+      } else {
+        Mtftp4Retransmit (Instance);
+      }
       Mtftp4SetTimeout (Instance);
     } else {
       Mtftp4CleanOperation (Instance, EFI_TIMEOUT);
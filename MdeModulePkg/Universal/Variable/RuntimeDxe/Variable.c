@@ -243,6 +243,64 @@ UpdateVariableInfo (
   }
 }
 
+/**
+  Routine used to track the payload size and the latency of SetVariable().
+  The data is part of the variable reclaim statistics, which also count the
+  bytes written to the non-volatile variable store. The
+  PcdVariableCollectStatistics build flag controls if this feature is enabled.
+
+  @param[in] StartTime      Performance counter value when SetVariable() started.
+  @param[in] Attributes     Attributes of the variable.
+  @param[in] PayloadSize    Size of the variable data, without authentication data.
+  @param[in] Status         Status returned by SetVariable().
+
+**/
+VOID
+UpdateSetVariableStatistics (
+  IN  UINT64                  StartTime,
+  IN  UINT32                  Attributes,
+  IN  UINTN                   PayloadSize,
+  IN  EFI_STATUS              Status
+  )
+{
+  VARIABLE_RECLAIM_STATISTICS *Statistics;
+  UINT64                      EndTime;
+  UINT64                      CounterStart;
+  UINT64                      CounterEnd;
+  UINT64                      Ticks;
+  UINT64                      Latency;
+
+  if (!FeaturePcdGet (PcdVariableCollectStatistics)) {
+    return;
+  }
+
+  Statistics = &mVariableModuleGlobal->ReclaimStatistics;
+
+  EndTime = GetPerformanceCounter ();
+  GetPerformanceCounterProperties (&CounterStart, &CounterEnd);
+  if (CounterEnd >= CounterStart) {
+    if (EndTime >= StartTime) {
+      Ticks = EndTime - StartTime;
+    } else {
+      Ticks = (CounterEnd - StartTime) + (EndTime - CounterStart);
+    }
+  } else {
+    if (StartTime >= EndTime) {
+      Ticks = StartTime - EndTime;
+    } else {
+      Ticks = (StartTime - CounterEnd) + (CounterStart - EndTime);
+    }
+  }
+  Latency = GetTimeInNanoSecond (Ticks);
+
+  Statistics->SetVariableCount++;
+  if (Latency > Statistics->MaxSetVariableLatency) {
+    Statistics->MaxSetVariableLatency = Latency;
+  }
+  if (!EFI_ERROR (Status) && (Attributes & EFI_VARIABLE_NON_VOLATILE) != 0) {
+    Statistics->UserDataBytes += PayloadSize;
+  }
+}
 
 /**
 
@@ -366,6 +424,8 @@ UpdateVariableStore (
   //
   // If we are here we are dealing with Non-Volatile Variables.
   //
+  mVariableModuleGlobal->ReclaimStatistics.VariableBytesWritten += DataSize;
+
   LinearOffset  = (UINTN) FwVolHeader;
   CurrWritePtr  = (UINTN) DataPtr;
   CurrWriteSize = DataSize;
@@ -978,10 +1038,124 @@ InitializeVariableQuota (
   CalculateCommonUserVariableTotalSize ();
 }
 
+/**
+  Check whether a variable is kept by the reclaim of its variable store.
+
+  A variable in VAR_ADDED state is kept. A variable in IN_DELETED_TRANSITION
+  state is kept, and promoted to VAR_ADDED, only if the variable store holds
+  no VAR_ADDED copy of it. The variable being updated is never kept.
+
+  @param[in] VariableStoreHeader          Pointer to the variable store header.
+  @param[in] Variable                     Pointer to the variable to check.
+  @param[in] UpdatingVariable             Pointer to the variable being updated.
+  @param[in] UpdatingInDeletedTransition  Pointer to the IN_DELETED_TRANSITION
+                                          copy of the variable being updated.
+
+  @retval TRUE                 The variable is kept.
+  @retval FALSE                The variable is dropped.
+
+**/
+BOOLEAN
+IsReclaimKeptVariable (
+  IN VARIABLE_STORE_HEADER      *VariableStoreHeader,
+  IN VARIABLE_HEADER            *Variable,
+  IN VARIABLE_HEADER            *UpdatingVariable,
+  IN VARIABLE_HEADER            *UpdatingInDeletedTransition
+  )
+{
+  VARIABLE_HEADER       *AddedVariable;
+  UINTN                 NameSize;
+
+  if (Variable == UpdatingVariable || Variable == UpdatingInDeletedTransition) {
+    return FALSE;
+  }
+  if (Variable->State == VAR_ADDED) {
+    return TRUE;
+  }
+  if (Variable->State != (VAR_IN_DELETED_TRANSITION & VAR_ADDED)) {
+    return FALSE;
+  }
+
+  //
+  // Per IN_DELETED variable, we have to guarantee that
+  // no ADDED one in the variable store.
+  //
+  NameSize      = NameSizeOfVariable (Variable);
+  AddedVariable = GetStartPointer (VariableStoreHeader);
+  while (IsValidVariableHeader (AddedVariable, GetEndPointer (VariableStoreHeader))) {
+    if (AddedVariable->State == VAR_ADDED &&
+        AddedVariable != UpdatingVariable &&
+        CompareGuid (GetVendorGuidPtr (AddedVariable), GetVendorGuidPtr (Variable)) &&
+        NameSize == NameSizeOfVariable (AddedVariable) &&
+        CompareMem (GetVariableNamePtr (AddedVariable), GetVariableNamePtr (Variable), NameSize) == 0) {
+      return FALSE;
+    }
+    AddedVariable = GetNextVariablePtr (AddedVariable);
+  }
+
+  return TRUE;
+}
+
+/**
+  Get how many bytes must be freed in the non-volatile variable store to
+  store a new variable.
+
+  Both the space left at the end of the variable store and the quota of the
+  variable class are considered, as the variable totals also count the
+  deleted variables still present in the variable store.
+
+  @param[in] StoreEndOffset     Offset of the end of the variables in the store.
+  @param[in] StoreSize          Size of the variable store.
+  @param[in] NewVariable        Pointer to the new variable.
+  @param[in] NewVariableSize    Size of the new variable.
+
+  @return The number of bytes to free, 0 if the new variable fits already.
+
+**/
+UINTN
+GetReclaimNeededSize (
+  IN UINTN                      StoreEndOffset,
+  IN UINTN                      StoreSize,
+  IN VARIABLE_HEADER            *NewVariable,
+  IN UINTN                      NewVariableSize
+  )
+{
+  UINTN                 NeededSize;
+
+  NeededSize = 0;
+  if (StoreEndOffset + NewVariableSize > StoreSize) {
+    NeededSize = StoreEndOffset + NewVariableSize - StoreSize;
+  }
+
+  if ((NewVariable->Attributes & EFI_VARIABLE_HARDWARE_ERROR_RECORD) == EFI_VARIABLE_HARDWARE_ERROR_RECORD) {
+    if (mVariableModuleGlobal->HwErrVariableTotalSize + NewVariableSize > PcdGet32 (PcdHwErrStorageSize)) {
+      NeededSize = MAX (NeededSize, mVariableModuleGlobal->HwErrVariableTotalSize + NewVariableSize - PcdGet32 (PcdHwErrStorageSize));
+    }
+  } else {
+    if (mVariableModuleGlobal->CommonVariableTotalSize + NewVariableSize > mVariableModuleGlobal->CommonVariableSpace) {
+      NeededSize = MAX (NeededSize, mVariableModuleGlobal->CommonVariableTotalSize + NewVariableSize - mVariableModuleGlobal->CommonVariableSpace);
+    }
+    if (IsUserVariable (NewVariable) &&
+        (mVariableModuleGlobal->CommonUserVariableTotalSize + NewVariableSize > mVariableModuleGlobal->CommonMaxUserVariableSpace)) {
+      NeededSize = MAX (NeededSize, mVariableModuleGlobal->CommonUserVariableTotalSize + NewVariableSize - mVariableModuleGlobal->CommonMaxUserVariableSpace);
+    }
+  }
+
+  return NeededSize;
+}
+
 /**
 
   Variable store garbage collection and reclaim operation.
 
+  The variables kept by the reclaim stay in the order they have in the
+  variable store, so the variable store is only compacted from the first
+  variable that is dropped or promoted, and everything before it is left as
+  it is. The volatile variable store is always compacted as a whole. When the
+  non-volatile variable store is reclaimed to make room for a new variable,
+  only the tail of the variable store holding just enough dropped variables
+  is compacted, so that the Fault Tolerant Write only rewrites that tail.
+
   @param[in]      VariableBase            Base address of variable store.
   @param[out]     LastVariableOffset      Offset of last variable.
   @param[in]      IsVolatile              The variable store is volatile or not;
@@ -1006,24 +1180,28 @@ Reclaim (
   )
 {
   VARIABLE_HEADER       *Variable;
-  VARIABLE_HEADER       *AddedVariable;
   VARIABLE_HEADER       *NextVariable;
-  VARIABLE_HEADER       *NextAddedVariable;
   VARIABLE_STORE_HEADER *VariableStoreHeader;
   UINT8                 *ValidBuffer;
   UINTN                 MaximumBufferSize;
   UINTN                 VariableSize;
-  UINTN                 NameSize;
   UINT8                 *CurrPtr;
-  VOID                  *Point0;
-  VOID                  *Point1;
-  BOOLEAN               FoundAdded;
   EFI_STATUS            Status;
   UINTN                 CommonVariableTotalSize;
   UINTN                 CommonUserVariableTotalSize;
   UINTN                 HwErrVariableTotalSize;
   VARIABLE_HEADER       *UpdatingVariable;
   VARIABLE_HEADER       *UpdatingInDeletedTransition;
+  VARIABLE_HEADER       *FirstChangedVariable;
+  VARIABLE_HEADER       *CompactStart;
+  UINTN                 CompactOffset;
+  UINTN                 StoreEndOffset;
+  UINTN                 DroppedSize;
+  UINTN                 NeededSize;
+  UINTN                 WriteEndOffset;
+  BOOLEAN               InStore;
+  BOOLEAN               *KeptVariable;
+  UINTN                 Index;
 
   UpdatingVariable = NULL;
   UpdatingInDeletedTransition = NULL;
@@ -1034,30 +1212,81 @@ Reclaim (
 
   VariableStoreHeader = (VARIABLE_STORE_HEADER *) ((UINTN) VariableBase);
 
-  CommonVariableTotalSize = 0;
-  CommonUserVariableTotalSize = 0;
-  HwErrVariableTotalSize  = 0;
-
-  if (IsVolatile) {
-    //
-    // Start Pointers for the variable.
-    //
-    Variable          = GetStartPointer (VariableStoreHeader);
-    MaximumBufferSize = sizeof (VARIABLE_STORE_HEADER);
+  //
+  // Whether a variable in deleted transition is kept takes a scan of the
+  // store, so decide it once per variable and keep the result, indexed by
+  // the position of the variable in the store.
+  //
+  KeptVariable = mVariableModuleGlobal->ReclaimKeptVariable;
 
-    while (IsValidVariableHeader (Variable, GetEndPointer (VariableStoreHeader))) {
-      NextVariable = GetNextVariablePtr (Variable);
-      if ((Variable->State == VAR_ADDED || Variable->State == (VAR_IN_DELETED_TRANSITION & VAR_ADDED)) &&
-          Variable != UpdatingVariable &&
-          Variable != UpdatingInDeletedTransition
-         ) {
-        VariableSize = (UINTN) NextVariable - (UINTN) Variable;
-        MaximumBufferSize += VariableSize;
+  //
+  // Find the first variable that is dropped or promoted, and the size of
+  // the dropped variables.
+  //
+  FirstChangedVariable = NULL;
+  DroppedSize          = 0;
+  MaximumBufferSize    = sizeof (VARIABLE_STORE_HEADER);
+  Index    = 0;
+  Variable = GetStartPointer (VariableStoreHeader);
+  while (IsValidVariableHeader (Variable, GetEndPointer (VariableStoreHeader))) {
+    NextVariable = GetNextVariablePtr (Variable);
+    VariableSize = (UINTN) NextVariable - (UINTN) Variable;
+    ASSERT (Index < mVariableModuleGlobal->ReclaimKeptVariableCount);
+    KeptVariable[Index] = IsReclaimKeptVariable (VariableStoreHeader, Variable, UpdatingVariable, UpdatingInDeletedTransition);
+    if (KeptVariable[Index]) {
+      MaximumBufferSize += VariableSize;
+      if (Variable->State != VAR_ADDED && FirstChangedVariable == NULL) {
+        FirstChangedVariable = Variable;
+      }
+    } else {
+      DroppedSize += VariableSize;
+      if (FirstChangedVariable == NULL) {
+        FirstChangedVariable = Variable;
       }
+    }
+    Index++;
+    Variable = NextVariable;
+  }
+  StoreEndOffset = (UINTN) Variable - (UINTN) VariableStoreHeader;
+  if (FirstChangedVariable == NULL) {
+    FirstChangedVariable = Variable;
+  }
 
-      Variable = NextVariable;
+  //
+  // To make room for a new variable in the non-volatile variable store, start
+  // the compaction at the last dropped variable that leaves enough dropped
+  // variables behind it, but not after the variable being updated.
+  //
+  CompactStart = FirstChangedVariable;
+  if (!IsVolatile && NewVariable != NULL) {
+    NeededSize = GetReclaimNeededSize (StoreEndOffset, VariableStoreHeader->Size, NewVariable, NewVariableSize);
+    if (DroppedSize >= NeededSize) {
+      Index    = 0;
+      Variable = GetStartPointer (VariableStoreHeader);
+      while (IsValidVariableHeader (Variable, GetEndPointer (VariableStoreHeader))) {
+        NextVariable = GetNextVariablePtr (Variable);
+        if (!KeptVariable[Index]) {
+          if (DroppedSize < NeededSize) {
+            break;
+          }
+          CompactStart = Variable;
+          DroppedSize -= (UINTN) NextVariable - (UINTN) Variable;
+        }
+        Index++;
+        Variable = NextVariable;
+      }
+      if ((UINTN) UpdatingVariable >= (UINTN) GetStartPointer (VariableStoreHeader) &&
+          (UINTN) UpdatingVariable < (UINTN) CompactStart) {
+        CompactStart = UpdatingVariable;
+      }
+      if ((UINTN) UpdatingInDeletedTransition >= (UINTN) GetStartPointer (VariableStoreHeader) &&
+          (UINTN) UpdatingInDeletedTransition < (UINTN) CompactStart) {
+        CompactStart = UpdatingInDeletedTransition;
+      }
     }
+  }
 
+  if (IsVolatile) {
     if (NewVariable != NULL) {
       //
       // Add the new variable size.
@@ -1083,120 +1312,98 @@ Reclaim (
     ValidBuffer = (UINT8 *) mNvVariableCache;
   }
 
-  SetMem (ValidBuffer, MaximumBufferSize, 0xff);
+  while (TRUE) {
+    SetMem (ValidBuffer, MaximumBufferSize, 0xff);
 
-  //
-  // Copy variable store header.
-  //
-  CopyMem (ValidBuffer, VariableStoreHeader, sizeof (VARIABLE_STORE_HEADER));
-  CurrPtr = (UINT8 *) GetStartPointer ((VARIABLE_STORE_HEADER *) ValidBuffer);
+    //
+    // Copy variable store header and the variables before the compaction start.
+    //
+    CompactOffset = (UINTN) CompactStart - (UINTN) VariableStoreHeader;
+    CopyMem (ValidBuffer, VariableStoreHeader, CompactOffset);
+    CurrPtr = ValidBuffer + CompactOffset;
 
-  //
-  // Reinstall all ADDED variables as long as they are not identical to Updating Variable.
-  //
-  Variable = GetStartPointer (VariableStoreHeader);
-  while (IsValidVariableHeader (Variable, GetEndPointer (VariableStoreHeader))) {
-    NextVariable = GetNextVariablePtr (Variable);
-    if (Variable != UpdatingVariable && Variable->State == VAR_ADDED) {
+    //
+    // Reinstall the kept variables after the compaction start, and count all
+    // the variables that will be in the store.
+    //
+    CommonVariableTotalSize = 0;
+    CommonUserVariableTotalSize = 0;
+    HwErrVariableTotalSize  = 0;
+    Index    = 0;
+    Variable = GetStartPointer (VariableStoreHeader);
+    while (IsValidVariableHeader (Variable, GetEndPointer (VariableStoreHeader))) {
+      NextVariable = GetNextVariablePtr (Variable);
       VariableSize = (UINTN) NextVariable - (UINTN) Variable;
-      CopyMem (CurrPtr, (UINT8 *) Variable, VariableSize);
-      CurrPtr += VariableSize;
-      if ((!IsVolatile) && ((Variable->Attributes & EFI_VARIABLE_HARDWARE_ERROR_RECORD) == EFI_VARIABLE_HARDWARE_ERROR_RECORD)) {
-        HwErrVariableTotalSize += VariableSize;
-      } else if ((!IsVolatile) && ((Variable->Attributes & EFI_VARIABLE_HARDWARE_ERROR_RECORD) != EFI_VARIABLE_HARDWARE_ERROR_RECORD)) {
-        CommonVariableTotalSize += VariableSize;
-        if (IsUserVariable (Variable)) {
-          CommonUserVariableTotalSize += VariableSize;
-        }
-      }
-    }
-    Variable = NextVariable;
-  }
-
-  //
-  // Reinstall all in delete transition variables.
-  //
-  Variable = GetStartPointer (VariableStoreHeader);
-  while (IsValidVariableHeader (Variable, GetEndPointer (VariableStoreHeader))) {
-    NextVariable = GetNextVariablePtr (Variable);
-    if (Variable != UpdatingVariable && Variable != UpdatingInDeletedTransition && Variable->State == (VAR_IN_DELETED_TRANSITION & VAR_ADDED)) {
-
-      //
-      // Buffer has cached all ADDED variable.
-      // Per IN_DELETED variable, we have to guarantee that
-      // no ADDED one in previous buffer.
-      //
-
-      FoundAdded = FALSE;
-      AddedVariable = GetStartPointer ((VARIABLE_STORE_HEADER *) ValidBuffer);
-      while (IsValidVariableHeader (AddedVariable, GetEndPointer ((VARIABLE_STORE_HEADER *) ValidBuffer))) {
-        NextAddedVariable = GetNextVariablePtr (AddedVariable);
-        NameSize = NameSizeOfVariable (AddedVariable);
-        if (CompareGuid (GetVendorGuidPtr (AddedVariable), GetVendorGuidPtr (Variable)) &&
-            NameSize == NameSizeOfVariable (Variable)
-           ) {
-          Point0 = (VOID *) GetVariableNamePtr (AddedVariable);
-          Point1 = (VOID *) GetVariableNamePtr (Variable);
-          if (CompareMem (Point0, Point1, NameSize) == 0) {
-            FoundAdded = TRUE;
-            break;
-          }
+      if ((UINTN) Variable < (UINTN) CompactStart) {
+        InStore = TRUE;
+      } else {
+        InStore = KeptVariable[Index];
+        if (InStore) {
+          //
+          // Reinstall the variable, promoting VAR_IN_DELETED_TRANSITION to VAR_ADDED.
+          //
+          CopyMem (CurrPtr, (UINT8 *) Variable, VariableSize);
+          ((VARIABLE_HEADER *) CurrPtr)->State = VAR_ADDED;
+          CurrPtr += VariableSize;
         }
-        AddedVariable = NextAddedVariable;
       }
-      if (!FoundAdded) {
-        //
-        // Promote VAR_IN_DELETED_TRANSITION to VAR_ADDED.
-        //
-        VariableSize = (UINTN) NextVariable - (UINTN) Variable;
-        CopyMem (CurrPtr, (UINT8 *) Variable, VariableSize);
-        ((VARIABLE_HEADER *) CurrPtr)->State = VAR_ADDED;
-        CurrPtr += VariableSize;
-        if ((!IsVolatile) && ((Variable->Attributes & EFI_VARIABLE_HARDWARE_ERROR_RECORD) == EFI_VARIABLE_HARDWARE_ERROR_RECORD)) {
+      if (InStore && !IsVolatile) {
+        if ((Variable->Attributes & EFI_VARIABLE_HARDWARE_ERROR_RECORD) == EFI_VARIABLE_HARDWARE_ERROR_RECORD) {
           HwErrVariableTotalSize += VariableSize;
-        } else if ((!IsVolatile) && ((Variable->Attributes & EFI_VARIABLE_HARDWARE_ERROR_RECORD) != EFI_VARIABLE_HARDWARE_ERROR_RECORD)) {
+        } else {
           CommonVariableTotalSize += VariableSize;
           if (IsUserVariable (Variable)) {
             CommonUserVariableTotalSize += VariableSize;
           }
         }
       }
+      Index++;
+      Variable = NextVariable;
     }
 
-    Variable = NextVariable;
-  }
-
-  //
-  // Install the new variable if it is not NULL.
-  //
-  if (NewVariable != NULL) {
-    if ((UINTN) (CurrPtr - ValidBuffer) + NewVariableSize > VariableStoreHeader->Size) {
-      //
-      // No enough space to store the new variable.
-      //
-      Status = EFI_OUT_OF_RESOURCES;
-      goto Done;
+    if (NewVariable == NULL) {
+      break;
     }
-    if (!IsVolatile) {
+
+    if ((UINTN) (CurrPtr - ValidBuffer) + NewVariableSize <= VariableStoreHeader->Size) {
+      if (IsVolatile) {
+        break;
+      }
       if ((NewVariable->Attributes & EFI_VARIABLE_HARDWARE_ERROR_RECORD) == EFI_VARIABLE_HARDWARE_ERROR_RECORD) {
-        HwErrVariableTotalSize += NewVariableSize;
-      } else if ((NewVariable->Attributes & EFI_VARIABLE_HARDWARE_ERROR_RECORD) != EFI_VARIABLE_HARDWARE_ERROR_RECORD) {
+        if (HwErrVariableTotalSize + NewVariableSize <= PcdGet32 (PcdHwErrStorageSize)) {
+          HwErrVariableTotalSize += NewVariableSize;
+          break;
+        }
+      } else if ((CommonVariableTotalSize + NewVariableSize <= mVariableModuleGlobal->CommonVariableSpace) &&
+                 (!IsUserVariable (NewVariable) ||
+                  (CommonUserVariableTotalSize + NewVariableSize <= mVariableModuleGlobal->CommonMaxUserVariableSpace))) {
         CommonVariableTotalSize += NewVariableSize;
         if (IsUserVariable (NewVariable)) {
           CommonUserVariableTotalSize += NewVariableSize;
         }
-      }
-      if ((HwErrVariableTotalSize > PcdGet32 (PcdHwErrStorageSize)) ||
-          (CommonVariableTotalSize > mVariableModuleGlobal->CommonVariableSpace) ||
-          (CommonUserVariableTotalSize > mVariableModuleGlobal->CommonMaxUserVariableSpace)) {
-        //
-        // No enough space to store the new variable by NV or NV+HR attribute.
-        //
-        Status = EFI_OUT_OF_RESOURCES;
-        goto Done;
+        break;
       }
     }
 
+    if (CompactStart == FirstChangedVariable) {
+      //
+      // No enough space to store the new variable even with the whole store compacted.
+      //
+      Status = EFI_OUT_OF_RESOURCES;
+      goto Done;
+    }
+
+    //
+    // The dropped variables before the compaction start take the space the
+    // new variable needs, compact the whole store instead.
+    //
+    CompactStart = FirstChangedVariable;
+  }
+
+  //
+  // Install the new variable if it is not NULL.
+  //
+  if (NewVariable != NULL) {
     CopyMem (CurrPtr, (UINT8 *) NewVariable, NewVariableSize);
     ((VARIABLE_HEADER *) CurrPtr)->State = VAR_ADDED;
     if (UpdatingVariable != NULL) {
@@ -1216,17 +1423,34 @@ Reclaim (
     Status  = EFI_SUCCESS;
   } else {
     //
-    // If non-volatile variable store, perform FTW here.
+    // If non-volatile variable store, perform FTW here, from the compaction
+    // start to the end of the variables. Without a new variable the reclaim
+    // is also meant to clean the free space, so write up to the end of the store.
     //
-    Status = FtwVariableSpace (
-              VariableBase,
-              (VARIABLE_STORE_HEADER *) ValidBuffer
-              );
+    if (NewVariable == NULL) {
+      WriteEndOffset = VariableStoreHeader->Size;
+    } else {
+      WriteEndOffset = MAX ((UINTN) (CurrPtr - ValidBuffer), StoreEndOffset);
+    }
+    Status = EFI_SUCCESS;
+    if (WriteEndOffset > CompactOffset) {
+      Status = FtwVariableSpace (
+                VariableBase,
+                (VARIABLE_STORE_HEADER *) ValidBuffer,
+                CompactOffset,
+                WriteEndOffset - CompactOffset
+                );
+    }
     if (!EFI_ERROR (Status)) {
       *LastVariableOffset = (UINTN) (CurrPtr - ValidBuffer);
       mVariableModuleGlobal->HwErrVariableTotalSize = HwErrVariableTotalSize;
       mVariableModuleGlobal->CommonVariableTotalSize = CommonVariableTotalSize;
       mVariableModuleGlobal->CommonUserVariableTotalSize = CommonUserVariableTotalSize;
+      mVariableModuleGlobal->ReclaimStatistics.ReclaimCount++;
+      if (CompactStart == FirstChangedVariable) {
+        mVariableModuleGlobal->ReclaimStatistics.FullReclaimCount++;
+      }
+      mVariableModuleGlobal->ReclaimStatistics.ReclaimBytesWritten += WriteEndOffset - CompactOffset;
     } else {
       mVariableModuleGlobal->HwErrVariableTotalSize = 0;
       mVariableModuleGlobal->CommonVariableTotalSize = 0;
@@ -1260,6 +1484,11 @@ Done:
     CopyMem (mNvVariableCache, (UINT8 *)(UINTN)VariableBase, VariableStoreHeader->Size);
   }
 
+  //
+  // Variables have moved, the hash index of the store must be rebuilt.
+  //
+  InvalidateVariableIndex (IsVolatile ? VariableStoreTypeVolatile : VariableStoreTypeNv);
+
   return Status;
 }
 
@@ -1396,7 +1625,10 @@ FindVariable (
     PtrTrack->EndPtr   = GetEndPointer   (VariableStoreHeader[Type]);
     PtrTrack->Volatile = (BOOLEAN) (Type == VariableStoreTypeVolatile);
 
-    Status = FindVariableEx (VariableName, VendorGuid, IgnoreRtCheck, PtrTrack);
+    Status = FindVariableByIndex (Type, VariableStoreHeader[Type], VariableName, VendorGuid, IgnoreRtCheck, PtrTrack);
+    if (Status == EFI_UNSUPPORTED) {
+      Status = FindVariableEx (VariableName, VendorGuid, IgnoreRtCheck, PtrTrack);
+    }
     if (!EFI_ERROR (Status)) {
       return Status;
     }
@@ -3133,6 +3365,7 @@ VariableServiceSetVariable (
   VARIABLE_HEADER                     *NextVariable;
   EFI_PHYSICAL_ADDRESS                Point;
   UINTN                               PayloadSize;
+  UINT64                              StartTime;
 
   //
   // Check input parameters.
@@ -3256,6 +3489,11 @@ VariableServiceSetVariable (
     return Status;
   }
 
+  StartTime = 0;
+  if (FeaturePcdGet (PcdVariableCollectStatistics)) {
+    StartTime = GetPerformanceCounter ();
+  }
+
   AcquireLockOnlyAtBootTime(&mVariableModuleGlobal->VariableGlobal.VariableServicesLock);
 
   //
@@ -3315,6 +3553,7 @@ VariableServiceSetVariable (
   }
 
 Done:
+  UpdateSetVariableStatistics (StartTime, Attributes, PayloadSize, Status);
   InterlockedDecrement (&mVariableModuleGlobal->VariableGlobal.ReentrantState);
   ReleaseLockOnlyAtBootTime (&mVariableModuleGlobal->VariableGlobal.VariableServicesLock);
 
@@ -4129,6 +4368,25 @@ VariableCommonInitialize (
 
   SetMem (VolatileVariableStore, PcdGet32 (PcdVariableStoreSize) + ScratchSize, 0xff);
 
+  //
+  // Allocate the per variable results of Reclaim(), for the larger of the
+  // variable stores. No variable is smaller than its header.
+  //
+  mVariableModuleGlobal->ReclaimKeptVariableCount =
+    MAX (mNvVariableCache->Size, PcdGet32 (PcdVariableStoreSize)) / GetVariableHeaderSize () + 1;
+  mVariableModuleGlobal->ReclaimKeptVariable = AllocateRuntimePool (
+                                                 mVariableModuleGlobal->ReclaimKeptVariableCount * sizeof (BOOLEAN)
+                                                 );
+  if (mVariableModuleGlobal->ReclaimKeptVariable == NULL) {
+    FreePool (VolatileVariableStore);
+    if (mVariableModuleGlobal->VariableGlobal.HobVariableBase != 0) {
+      FreePool ((VOID *) (UINTN) mVariableModuleGlobal->VariableGlobal.HobVariableBase);
+    }
+    FreePool (NvFvHeader);
+    FreePool (mVariableModuleGlobal);
+    return EFI_OUT_OF_RESOURCES;
+  }
+
   //
   // Initialize Variable Specific Data.
   //
@@ -4142,6 +4400,12 @@ VariableCommonInitialize (
   VolatileVariableStore->Reserved    = 0;
   VolatileVariableStore->Reserved1   = 0;
 
+  //
+  // Allocate the hash indexes of the variable stores. Lookups fall back to
+  // walking the stores if this fails.
+  //
+  InitializeVariableIndex ();
+
   return EFI_SUCCESS;
 }
 
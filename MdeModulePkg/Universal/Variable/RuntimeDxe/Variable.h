@@ -37,12 +37,14 @@ WITHOUT WARRANTIES OR REPRESENTATIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED.
 #include <Library/MemoryAllocationLib.h>
 #include <Library/AuthVariableLib.h>
 #include <Library/VarCheckLib.h>
+#include <Library/TimerLib.h>
 #include <Guid/GlobalVariable.h>
 #include <Guid/EventGroup.h>
 #include <Guid/VariableFormat.h>
 #include <Guid/SystemNvDataGuid.h>
 #include <Guid/FaultTolerantWrite.h>
 #include <Guid/VarErrorFlag.h>
+#include <Guid/VariableReclaimStatistics.h>
 
 #define EFI_VARIABLE_ATTRIBUTES_MASK (EFI_VARIABLE_NON_VOLATILE | \
                                       EFI_VARIABLE_BOOTSERVICE_ACCESS | \
@@ -88,6 +90,36 @@ typedef struct {
   BOOLEAN               AuthSupport;
 } VARIABLE_GLOBAL;
 
+///
+/// A node of the variable index, recording the offset of one variable in
+/// its variable store. Nodes are chained per hash bucket through Next,
+/// which is the node number (index + 1) of the next node, or 0.
+///
+typedef struct {
+  UINT32          Offset;
+  UINT32          Hash;
+  UINT32          Next;
+} VARIABLE_INDEX_NODE;
+
+///
+/// (Name, Guid) hash index of a variable store.
+///
+/// The index holds every variable appended to the store up to IndexedOffset,
+/// and catches up with the variables appended since then on the next lookup.
+/// Nodes of variables found deleted are unlinked during lookups. The index is
+/// rebuilt from scratch after the store is reclaimed.
+///
+typedef struct {
+  UINT32              *Buckets;
+  UINT32              BucketCount;
+  VARIABLE_INDEX_NODE *Nodes;
+  UINT32              NodeCount;
+  UINT32              UsedNodes;
+  UINT32              FreeNodes;
+  UINTN               IndexedOffset;
+  BOOLEAN             Overflow;
+} VARIABLE_INDEX;
+
 typedef struct {
   VARIABLE_GLOBAL VariableGlobal;
   UINTN           VolatileLastVariableOffset;
@@ -101,11 +133,18 @@ typedef struct {
   UINTN           MaxVariableSize;
   UINTN           MaxAuthVariableSize;
   UINTN           ScratchBufferSize;
+  ///
+  /// Per variable results of Reclaim(), one entry for each variable a
+  /// store can hold.
+  ///
+  BOOLEAN         *ReclaimKeptVariable;
+  UINTN           ReclaimKeptVariableCount;
   CHAR8           *PlatformLangCodes;
   CHAR8           *LangCodes;
   CHAR8           *PlatformLang;
   CHAR8           Lang[ISO_639_2_ENTRY_SIZE + 1];
   EFI_FIRMWARE_VOLUME_BLOCK_PROTOCOL *FvbInstance;
+  VARIABLE_RECLAIM_STATISTICS        ReclaimStatistics;
 } VARIABLE_MODULE_GLOBAL;
 
 /**
@@ -128,8 +167,14 @@ FlushHobVariableToFlash (
   volume block device. The destination is specified by the parameter
   VariableBase. Fault Tolerant Write protocol is used for writing.
 
+  Only the range [Offset, Offset + NumBytes) of the variable store is written,
+  the rest of the variable store is left as it is.
+
   @param  VariableBase   Base address of the variable to write.
   @param  VariableBuffer Point to the variable data buffer.
+  @param  Offset         Offset of the range to write from the start of the
+                         variable store.
+  @param  NumBytes       Size of the range to write.
 
   @retval EFI_SUCCESS    The function completed successfully.
   @retval EFI_NOT_FOUND  Fail to locate Fault Tolerant Write protocol.
@@ -139,7 +184,9 @@ FlushHobVariableToFlash (
 EFI_STATUS
 FtwVariableSpace (
   IN EFI_PHYSICAL_ADDRESS   VariableBase,
-  IN VARIABLE_STORE_HEADER  *VariableBuffer
+  IN VARIABLE_STORE_HEADER  *VariableBuffer,
+  IN UINTN                  Offset,
+  IN UINTN                  NumBytes
   );
 
 /**
@@ -177,6 +224,65 @@ FindVariable (
   IN  BOOLEAN                 IgnoreRtCheck
   );
 
+/**
+
+  This code checks if variable header is valid or not.
+
+  @param Variable           Pointer to the Variable Header.
+  @param VariableStoreEnd   Pointer to the Variable Store End.
+
+  @retval TRUE              Variable header is valid.
+  @retval FALSE             Variable header is not valid.
+
+**/
+BOOLEAN
+IsValidVariableHeader (
+  IN  VARIABLE_HEADER       *Variable,
+  IN  VARIABLE_HEADER       *VariableStoreEnd
+  );
+
+/**
+
+  This code gets the size of name of variable.
+
+  @param Variable        Pointer to the Variable Header.
+
+  @return UINTN          Size of variable in bytes.
+
+**/
+UINTN
+NameSizeOfVariable (
+  IN  VARIABLE_HEADER   *Variable
+  );
+
+/**
+
+  This code gets the pointer to the next variable header.
+
+  @param Variable        Pointer to the Variable Header.
+
+  @return Pointer to next variable header.
+
+**/
+VARIABLE_HEADER *
+GetNextVariablePtr (
+  IN  VARIABLE_HEADER   *Variable
+  );
+
+/**
+
+  Gets the pointer to the first variable header in given variable store area.
+
+  @param VarStoreHeader  Pointer to the Variable Store Header.
+
+  @return Pointer to the first variable header.
+
+**/
+VARIABLE_HEADER *
+GetStartPointer (
+  IN VARIABLE_STORE_HEADER       *VarStoreHeader
+  );
+
 /**
 
   Gets the pointer to the end of the variable storage area.
@@ -767,7 +873,59 @@ InitializeVariableQuota (
   VOID
   );
 
+/**
+  Allocate the (Name, Guid) hash indexes of the volatile and non-volatile
+  variable stores. The indexes are filled on the first lookup.
+
+**/
+VOID
+InitializeVariableIndex (
+  VOID
+  );
+
+/**
+  Drop the content of the hash index of a variable store, so that it is
+  rebuilt on the next lookup. Must be called whenever variables are moved
+  within the store, as Reclaim () does.
+
+  @param[in] Type           Type of the variable store.
+
+**/
+VOID
+InvalidateVariableIndex (
+  IN VARIABLE_STORE_TYPE    Type
+  );
+
+/**
+  Find a variable in a variable store through the hash index of the store.
+
+  The result is the one FindVariableEx () would return for the whole store.
+
+  @param[in]       Type                Type of the variable store.
+  @param[in]       VariableStoreHeader Pointer to the variable store header.
+  @param[in]       VariableName        Name of the variable to be found, not empty.
+  @param[in]       VendorGuid          Vendor GUID to be found.
+  @param[in]       IgnoreRtCheck       Ignore EFI_VARIABLE_RUNTIME_ACCESS attribute
+                                       check at runtime when searching variable.
+  @param[in, out]  PtrTrack            Variable Track Pointer structure that contains Variable Information.
+
+  @retval          EFI_SUCCESS         Variable found successfully
+  @retval          EFI_NOT_FOUND       Variable not found
+  @retval          EFI_UNSUPPORTED     The store has no usable index, the caller
+                                       must search the store with FindVariableEx ().
+**/
+EFI_STATUS
+FindVariableByIndex (
+  IN     VARIABLE_STORE_TYPE     Type,
+  IN     VARIABLE_STORE_HEADER   *VariableStoreHeader,
+  IN     CHAR16                  *VariableName,
+  IN     EFI_GUID                *VendorGuid,
+  IN     BOOLEAN                 IgnoreRtCheck,
+  IN OUT VARIABLE_POINTER_TRACK  *PtrTrack
+  );
+
 extern VARIABLE_MODULE_GLOBAL  *mVariableModuleGlobal;
+extern VARIABLE_INDEX          mVariableIndex[VariableStoreTypeMax];
 
 extern AUTH_VAR_LIB_CONTEXT_OUT mAuthContextOut;
 
@@ -0,0 +1,495 @@
+/** @file
+  (Name, Guid) hash index of the volatile and non-volatile variable stores.
+
+  FindVariable () otherwise walks every variable of a store, including the
+  deleted ones, to find a single variable. The index maps the hash of the
+  name and GUID of a variable to its offset in the store. It is kept as a
+  superset of the live variables of the store: variables appended to the
+  store are indexed on the next lookup, and variables found deleted during a
+  lookup are dropped from the index. The index is rebuilt after the store is
+  reclaimed, as variables are moved.
+
+  All memory is allocated at initialization, the index keeps working at OS
+  runtime without allocating memory.
+
+Copyright (c) 2017, Intel Corporation. All rights reserved.<BR>
+This program and the accompanying materials
+are licensed and made available under the terms and conditions of the BSD License
+which accompanies this distribution.  The full text of the license may be found at
+http://opensource.org/licenses/bsd-license.php
+
+THE PROGRAM IS DISTRIBUTED UNDER THE BSD LICENSE ON AN "AS IS" BASIS,
+WITHOUT WARRANTIES OR REPRESENTATIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED.
+
+**/
+
+#include "Variable.h"
+
+extern VARIABLE_STORE_HEADER    *mNvVariableCache;
+
+#define VARIABLE_INDEX_FNV_OFFSET_BASIS   0x811C9DC5
+#define VARIABLE_INDEX_FNV_PRIME          0x01000193
+
+///
+/// Average number of variables per hash bucket when the index is full.
+///
+#define VARIABLE_INDEX_LOAD_FACTOR        4
+
+///
+/// Hash indexes of the variable stores, indexed by VARIABLE_STORE_TYPE.
+/// The HOB variable store is never indexed.
+///
+VARIABLE_INDEX          mVariableIndex[VariableStoreTypeMax];
+
+/**
+  Continue a FNV-1a hash over a buffer.
+
+  @param[in]  Hash          The hash value of the previous data.
+  @param[in]  Buffer        Pointer to the data.
+  @param[in]  Length        Length of the data in bytes.
+
+  @return The hash value.
+
+**/
+UINT32
+VariableIndexHashBuffer (
+  IN UINT32                 Hash,
+  IN CONST UINT8            *Buffer,
+  IN UINTN                  Length
+  )
+{
+  while (Length-- > 0) {
+    Hash = (Hash ^ *Buffer++) * VARIABLE_INDEX_FNV_PRIME;
+  }
+  return Hash;
+}
+
+/**
+  Compute the hash value of a variable name and vendor GUID.
+
+  The name is hashed up to and including its null terminator, but not
+  beyond MaxNameSize bytes, so that a name stored in a variable header hashes
+  to the same value as the same name passed by a caller.
+
+  @param[in]  VariableName  Name of the variable.
+  @param[in]  MaxNameSize   Maximum size of the name in bytes.
+  @param[in]  VendorGuid    Vendor GUID of the variable.
+
+  @return The hash value.
+
+**/
+UINT32
+VariableIndexHash (
+  IN CONST CHAR16           *VariableName,
+  IN UINTN                  MaxNameSize,
+  IN CONST EFI_GUID         *VendorGuid
+  )
+{
+  CONST UINT8               *Name;
+  UINTN                     NameSize;
+
+  //
+  // Variable names in a variable store are not necessarily CHAR16 aligned,
+  // look for the null terminator byte by byte.
+  //
+  Name = (CONST UINT8 *) VariableName;
+  for (NameSize = 0; NameSize + sizeof (CHAR16) <= MaxNameSize; NameSize += sizeof (CHAR16)) {
+    if (Name[NameSize] == 0 && Name[NameSize + 1] == 0) {
+      NameSize += sizeof (CHAR16);
+      break;
+    }
+  }
+
+  return VariableIndexHashBuffer (
+           VariableIndexHashBuffer (VARIABLE_INDEX_FNV_OFFSET_BASIS, Name, NameSize),
+           (CONST UINT8 *) VendorGuid,
+           sizeof (EFI_GUID)
+           );
+}
+
+/**
+  Check whether a variable has been deleted for good.
+
+  @param[in]  Variable      Pointer to the variable header.
+
+  @retval TRUE              The variable is deleted.
+  @retval FALSE             The variable is added, being deleted or not
+                            completely written yet.
+
+**/
+BOOLEAN
+IsDeletedVariable (
+  IN VARIABLE_HEADER        *Variable
+  )
+{
+  return (BOOLEAN) ((Variable->State & VAR_DELETED) == Variable->State);
+}
+
+/**
+  Get the offset of the end of the variables of a variable store.
+
+  @param[in]  Type          Type of the variable store.
+
+  @return Offset of the end of the last variable from the variable store header.
+
+**/
+UINTN
+GetVariableStoreLastOffset (
+  IN VARIABLE_STORE_TYPE    Type
+  )
+{
+  if (Type == VariableStoreTypeVolatile) {
+    return mVariableModuleGlobal->VolatileLastVariableOffset;
+  }
+  return mVariableModuleGlobal->NonVolatileLastVariableOffset;
+}
+
+/**
+  Allocate the hash index of a variable store.
+
+  @param[in]  Index         Pointer to the hash index.
+  @param[in]  StoreSize     Size of the variable store in bytes.
+
+**/
+VOID
+AllocateVariableIndex (
+  IN VARIABLE_INDEX         *Index,
+  IN UINTN                  StoreSize
+  )
+{
+  UINTN                     NodeCount;
+  UINTN                     BucketCount;
+
+  //
+  // No variable is smaller than its header plus a one character name.
+  //
+  NodeCount = StoreSize / (GetVariableHeaderSize () + sizeof (CHAR16)) + 1;
+  if (NodeCount > MAX_UINT32 / VARIABLE_INDEX_LOAD_FACTOR) {
+    return;
+  }
+  BucketCount = GetPowerOfTwo32 ((UINT32) (NodeCount / VARIABLE_INDEX_LOAD_FACTOR));
+  if (BucketCount == 0) {
+    BucketCount = 1;
+  }
+
+  Index->Buckets = AllocateRuntimeZeroPool (BucketCount * sizeof (UINT32));
+  Index->Nodes   = AllocateRuntimeZeroPool (NodeCount * sizeof (VARIABLE_INDEX_NODE));
+  if (Index->Buckets == NULL || Index->Nodes == NULL) {
+    if (Index->Buckets != NULL) {
+      FreePool (Index->Buckets);
+    }
+    if (Index->Nodes != NULL) {
+      FreePool (Index->Nodes);
+    }
+    ZeroMem (Index, sizeof (VARIABLE_INDEX));
+    return;
+  }
+
+  Index->BucketCount = (UINT32) BucketCount;
+  Index->NodeCount   = (UINT32) NodeCount;
+}
+
+/**
+  Allocate the (Name, Guid) hash indexes of the volatile and non-volatile
+  variable stores. The indexes are filled on the first lookup.
+
+**/
+VOID
+InitializeVariableIndex (
+  VOID
+  )
+{
+  VARIABLE_STORE_HEADER     *VolatileVariableStore;
+
+  ZeroMem (mVariableIndex, sizeof (mVariableIndex));
+
+  VolatileVariableStore = (VARIABLE_STORE_HEADER *) (UINTN) mVariableModuleGlobal->VariableGlobal.VolatileVariableBase;
+  if (VolatileVariableStore != NULL) {
+    AllocateVariableIndex (&mVariableIndex[VariableStoreTypeVolatile], VolatileVariableStore->Size);
+  }
+  if (mNvVariableCache != NULL) {
+    AllocateVariableIndex (&mVariableIndex[VariableStoreTypeNv], mNvVariableCache->Size);
+  }
+}
+
+/**
+  Drop the content of the hash index of a variable store, so that it is
+  rebuilt on the next lookup. Must be called whenever variables are moved
+  within the store, as Reclaim () does.
+
+  @param[in] Type           Type of the variable store.
+
+**/
+VOID
+InvalidateVariableIndex (
+  IN VARIABLE_STORE_TYPE    Type
+  )
+{
+  VARIABLE_INDEX            *Index;
+
+  Index = &mVariableIndex[Type];
+  if (Index->Buckets == NULL) {
+    return;
+  }
+
+  ZeroMem (Index->Buckets, Index->BucketCount * sizeof (UINT32));
+  Index->UsedNodes     = 0;
+  Index->FreeNodes     = 0;
+  Index->IndexedOffset = 0;
+  Index->Overflow      = FALSE;
+}
+
+/**
+  Add a variable to the hash index of its variable store.
+
+  @param[in]  Index         Pointer to the hash index.
+  @param[in]  StoreHeader   Pointer to the variable store header.
+  @param[in]  Variable      Pointer to the variable header.
+
+  @retval EFI_SUCCESS           The variable was added to the index.
+  @retval EFI_OUT_OF_RESOURCES  The index is full.
+
+**/
+EFI_STATUS
+AddVariableToIndex (
+  IN VARIABLE_INDEX         *Index,
+  IN VARIABLE_STORE_HEADER  *StoreHeader,
+  IN VARIABLE_HEADER        *Variable
+  )
+{
+  UINT32                    NodeNumber;
+  VARIABLE_INDEX_NODE       *Node;
+  UINT32                    Hash;
+
+  if (Index->FreeNodes != 0) {
+    NodeNumber       = Index->FreeNodes;
+    Index->FreeNodes = Index->Nodes[NodeNumber - 1].Next;
+  } else if (Index->UsedNodes < Index->NodeCount) {
+    NodeNumber = ++Index->UsedNodes;
+  } else {
+    return EFI_OUT_OF_RESOURCES;
+  }
+
+  Hash = VariableIndexHash (
+           GetVariableNamePtr (Variable),
+           NameSizeOfVariable (Variable),
+           GetVendorGuidPtr (Variable)
+           );
+
+  Node         = &Index->Nodes[NodeNumber - 1];
+  Node->Offset = (UINT32) ((UINTN) Variable - (UINTN) StoreHeader);
+  Node->Hash   = Hash;
+  Node->Next   = Index->Buckets[Hash & (Index->BucketCount - 1)];
+  Index->Buckets[Hash & (Index->BucketCount - 1)] = NodeNumber;
+
+  return EFI_SUCCESS;
+}
+
+/**
+  Add the variables appended to a variable store since the last lookup to
+  the hash index of the store.
+
+  @param[in]  Type          Type of the variable store.
+  @param[in]  StoreHeader   Pointer to the variable store header.
+
+  @retval EFI_SUCCESS       The index covers every variable of the store.
+  @retval EFI_UNSUPPORTED   The store has no usable index.
+
+**/
+EFI_STATUS
+UpdateVariableIndex (
+  IN VARIABLE_STORE_TYPE    Type,
+  IN VARIABLE_STORE_HEADER  *StoreHeader
+  )
+{
+  VARIABLE_INDEX            *Index;
+  VARIABLE_HEADER           *Variable;
+  VARIABLE_HEADER           *EndPtr;
+  VARIABLE_HEADER           *LastPtr;
+  UINTN                     LastOffset;
+  BOOLEAN                   Rebuilt;
+
+  Index = &mVariableIndex[Type];
+  if (Index->Buckets == NULL || Index->Overflow) {
+    return EFI_UNSUPPORTED;
+  }
+
+  LastOffset = GetVariableStoreLastOffset (Type);
+  if (LastOffset < Index->IndexedOffset) {
+    //
+    // The store shrank behind our back, start over.
+    //
+    InvalidateVariableIndex (Type);
+  }
+
+  EndPtr  = GetEndPointer (StoreHeader);
+  LastPtr = (VARIABLE_HEADER *) ((UINTN) StoreHeader + LastOffset);
+  Rebuilt = (BOOLEAN) (Index->IndexedOffset == 0);
+  if (Rebuilt) {
+    Index->IndexedOffset = (UINTN) GetStartPointer (StoreHeader) - (UINTN) StoreHeader;
+  }
+
+  Variable = (VARIABLE_HEADER *) ((UINTN) StoreHeader + Index->IndexedOffset);
+  while (Variable < LastPtr && IsValidVariableHeader (Variable, EndPtr)) {
+    if (!IsDeletedVariable (Variable)) {
+      if (EFI_ERROR (AddVariableToIndex (Index, StoreHeader, Variable))) {
+        if (Rebuilt) {
+          //
+          // Too many variables even without the deleted ones, give up until
+          // the store is reclaimed.
+          //
+          Index->Overflow = TRUE;
+          return EFI_UNSUPPORTED;
+        }
+        //
+        // Drop the stale nodes by building the index again.
+        //
+        InvalidateVariableIndex (Type);
+        Rebuilt              = TRUE;
+        Index->IndexedOffset = (UINTN) GetStartPointer (StoreHeader) - (UINTN) StoreHeader;
+        Variable             = GetStartPointer (StoreHeader);
+        continue;
+      }
+    }
+    Variable = GetNextVariablePtr (Variable);
+  }
+
+  Index->IndexedOffset = (UINTN) Variable - (UINTN) StoreHeader;
+  return EFI_SUCCESS;
+}
+
+/**
+  Check whether a variable of the index matches a lookup.
+
+  @param[in]  Variable      Pointer to the variable header.
+  @param[in]  VariableName  Name of the variable to be found.
+  @param[in]  VendorGuid    Vendor GUID to be found.
+  @param[in]  IgnoreRtCheck Ignore EFI_VARIABLE_RUNTIME_ACCESS attribute
+                            check at runtime when searching variable.
+
+  @retval TRUE              The variable matches.
+  @retval FALSE             The variable does not match.
+
+**/
+BOOLEAN
+IsIndexedVariableMatch (
+  IN VARIABLE_HEADER        *Variable,
+  IN CHAR16                 *VariableName,
+  IN EFI_GUID               *VendorGuid,
+  IN BOOLEAN                IgnoreRtCheck
+  )
+{
+  if (Variable->State != VAR_ADDED &&
+      Variable->State != (VAR_IN_DELETED_TRANSITION & VAR_ADDED)) {
+    return FALSE;
+  }
+  if (!IgnoreRtCheck && AtRuntime () && ((Variable->Attributes & EFI_VARIABLE_RUNTIME_ACCESS) == 0)) {
+    return FALSE;
+  }
+  if (!CompareGuid (VendorGuid, GetVendorGuidPtr (Variable))) {
+    return FALSE;
+  }
+  ASSERT (NameSizeOfVariable (Variable) != 0);
+  return (BOOLEAN) (CompareMem (VariableName, GetVariableNamePtr (Variable), NameSizeOfVariable (Variable)) == 0);
+}
+
+/**
+  Find a variable in a variable store through the hash index of the store.
+
+  The result is the one FindVariableEx () would return for the whole store.
+
+  @param[in]       Type                Type of the variable store.
+  @param[in]       VariableStoreHeader Pointer to the variable store header.
+  @param[in]       VariableName        Name of the variable to be found, not empty.
+  @param[in]       VendorGuid          Vendor GUID to be found.
+  @param[in]       IgnoreRtCheck       Ignore EFI_VARIABLE_RUNTIME_ACCESS attribute
+                                       check at runtime when searching variable.
+  @param[in, out]  PtrTrack            Variable Track Pointer structure that contains Variable Information.
+
+  @retval          EFI_SUCCESS         Variable found successfully
+  @retval          EFI_NOT_FOUND       Variable not found
+  @retval          EFI_UNSUPPORTED     The store has no usable index, the caller
+                                       must search the store with FindVariableEx ().
+**/
+EFI_STATUS
+FindVariableByIndex (
+  IN     VARIABLE_STORE_TYPE     Type,
+  IN     VARIABLE_STORE_HEADER   *VariableStoreHeader,
+  IN     CHAR16                  *VariableName,
+  IN     EFI_GUID                *VendorGuid,
+  IN     BOOLEAN                 IgnoreRtCheck,
+  IN OUT VARIABLE_POINTER_TRACK  *PtrTrack
+  )
+{
+  VARIABLE_INDEX            *Index;
+  VARIABLE_INDEX_NODE       *Node;
+  UINT32                    *Link;
+  UINT32                    NodeNumber;
+  UINT32                    Hash;
+  VARIABLE_HEADER           *Variable;
+  VARIABLE_HEADER           *AddedVariable;
+  VARIABLE_HEADER           *InDeletedVariable;
+
+  if (Type == VariableStoreTypeHob || VariableName[0] == 0) {
+    return EFI_UNSUPPORTED;
+  }
+
+  if (EFI_ERROR (UpdateVariableIndex (Type, VariableStoreHeader))) {
+    return EFI_UNSUPPORTED;
+  }
+
+  Index = &mVariableIndex[Type];
+  Hash  = VariableIndexHash (VariableName, StrSize (VariableName), VendorGuid);
+
+  //
+  // The variable with the lowest address wins, as with a walk of the store.
+  // Drop the variables deleted since they were indexed on the way.
+  //
+  AddedVariable = NULL;
+  Link          = &Index->Buckets[Hash & (Index->BucketCount - 1)];
+  while (*Link != 0) {
+    NodeNumber = *Link;
+    Node       = &Index->Nodes[NodeNumber - 1];
+    Variable   = (VARIABLE_HEADER *) ((UINTN) VariableStoreHeader + Node->Offset);
+    if (IsDeletedVariable (Variable)) {
+      *Link            = Node->Next;
+      Node->Next       = Index->FreeNodes;
+      Index->FreeNodes = NodeNumber;
+      continue;
+    }
+    if (Node->Hash == Hash &&
+        Variable->State == VAR_ADDED &&
+        (AddedVariable == NULL || Variable < AddedVariable) &&
+        IsIndexedVariableMatch (Variable, VariableName, VendorGuid, IgnoreRtCheck)) {
+      AddedVariable = Variable;
+    }
+    Link = &Node->Next;
+  }
+
+  //
+  // An in deleted transition copy is reported only if it precedes the added
+  // copy, or if there is no added copy. The last one wins.
+  //
+  InDeletedVariable = NULL;
+  for (NodeNumber = Index->Buckets[Hash & (Index->BucketCount - 1)]; NodeNumber != 0; NodeNumber = Node->Next) {
+    Node     = &Index->Nodes[NodeNumber - 1];
+    Variable = (VARIABLE_HEADER *) ((UINTN) VariableStoreHeader + Node->Offset);
+    if (Node->Hash == Hash &&
+        Variable->State == (VAR_IN_DELETED_TRANSITION & VAR_ADDED) &&
+        (AddedVariable == NULL || Variable < AddedVariable) &&
+        (InDeletedVariable == NULL || Variable > InDeletedVariable) &&
+        IsIndexedVariableMatch (Variable, VariableName, VendorGuid, IgnoreRtCheck)) {
+      InDeletedVariable = Variable;
+    }
+  }
+
+  if (AddedVariable != NULL) {
+    PtrTrack->CurrPtr                = AddedVariable;
+    PtrTrack->InDeletedTransitionPtr = InDeletedVariable;
+    return EFI_SUCCESS;
+  }
+
+  PtrTrack->CurrPtr                = InDeletedVariable;
+  PtrTrack->InDeletedTransitionPtr = NULL;
+  return (InDeletedVariable == NULL) ? EFI_NOT_FOUND : EFI_SUCCESS;
+}
@@ -0,0 +1,558 @@
+/** @file
+  Serve GetVariable () and GetNextVariableName () from the runtime variable
+  cache, a copy of the variable stores that the SMM variable driver keeps up to
+  date in runtime memory, so that reading a variable does not trigger an SMI.
+
+  Caution: This module requires additional review when modified.
+  The runtime variable cache is in memory the OS can modify. The header of every
+  variable is copied once and validated against the bounds of its variable store,
+  and only the copy is used afterwards. The cache can affect the results of
+  GetVariable () and GetNextVariableName (), both in the DXE phase and at OS
+  runtime, but never the variable stores kept by the SMM variable driver.
+
+Copyright (c) 2017, Intel Corporation. All rights reserved.<BR>
+This program and the accompanying materials
+are licensed and made available under the terms and conditions of the BSD License
+which accompanies this distribution.  The full text of the license may be found at
+http://opensource.org/licenses/bsd-license.php
+
+THE PROGRAM IS DISTRIBUTED UNDER THE BSD LICENSE ON AN "AS IS" BASIS,
+WITHOUT WARRANTIES OR REPRESENTATIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED.
+
+**/
+#include <PiDxe.h>
+
+#include <Library/UefiRuntimeLib.h>
+#include <Library/BaseMemoryLib.h>
+#include <Library/DebugLib.h>
+#include <Library/BaseLib.h>
+
+#include <Guid/VariableFormat.h>
+#include <Guid/SmmVariableCommon.h>
+
+///
+/// Variable stores of the runtime variable cache, in the search order of the
+/// SMM variable driver.
+///
+typedef enum {
+  RuntimeCacheStoreVolatile,
+  RuntimeCacheStoreHob,
+  RuntimeCacheStoreNv,
+  RuntimeCacheStoreMax
+} RUNTIME_CACHE_STORE_TYPE;
+
+typedef struct {
+  VARIABLE_HEADER           *StartPtr;
+  VARIABLE_HEADER           *EndPtr;
+} RUNTIME_CACHE_STORE;
+
+///
+/// The runtime variable cache, NULL if it is not used.
+///
+VARIABLE_RUNTIME_CACHE_HEADER  *mVariableRuntimeCache     = NULL;
+UINTN                          mVariableRuntimeCacheSize;
+
+///
+/// A variable of the runtime variable cache. The header is read from the
+/// cache once, and only this copy is used afterwards, so that the OS cannot
+/// change the sizes after they were validated.
+///
+typedef struct {
+  UINT8                     State;
+  UINT32                    Attributes;
+  UINTN                     NameSize;
+  UINTN                     DataSize;
+  EFI_GUID                  VendorGuid;
+  CHAR16                    *Name;
+  UINT8                     *Data;
+  VARIABLE_HEADER           *Next;
+} RUNTIME_CACHE_VARIABLE;
+
+/**
+  Get the size of the variable headers in the runtime variable cache.
+
+  @return Size of a variable header in bytes.
+
+**/
+UINTN
+RuntimeCacheHeaderSize (
+  VOID
+  )
+{
+  if (mVariableRuntimeCache->AuthFormat) {
+    return sizeof (AUTHENTICATED_VARIABLE_HEADER);
+  }
+  return sizeof (VARIABLE_HEADER);
+}
+
+/**
+  Read a variable of the runtime variable cache, and check that it is valid
+  and lies entirely within its variable store.
+
+  @param[in]  Variable      Pointer to the variable header.
+  @param[in]  EndPtr        End of the variable store.
+  @param[out] Info          Returns the variable read from the header.
+
+  @retval TRUE              The variable is valid.
+  @retval FALSE             The variable is not valid, or the end of the store
+                            has been reached.
+
+**/
+BOOLEAN
+RuntimeCacheReadVariable (
+  IN  VARIABLE_HEADER         *Variable,
+  IN  VARIABLE_HEADER         *EndPtr,
+  OUT RUNTIME_CACHE_VARIABLE  *Info
+  )
+{
+  AUTHENTICATED_VARIABLE_HEADER AuthHeader;
+  VARIABLE_HEADER               *Header;
+  UINTN                         HeaderSize;
+  UINTN                         Available;
+  UINT32                        NameSize;
+  UINT32                        DataSize;
+
+  HeaderSize = RuntimeCacheHeaderSize ();
+  if (Variable >= EndPtr || (UINTN) EndPtr - (UINTN) Variable < HeaderSize) {
+    return FALSE;
+  }
+
+  //
+  // Both header formats start with StartId, State, Reserved and Attributes.
+  //
+  CopyMem (&AuthHeader, Variable, HeaderSize);
+  Header = (VARIABLE_HEADER *) &AuthHeader;
+  if (mVariableRuntimeCache->AuthFormat) {
+    NameSize = AuthHeader.NameSize;
+    DataSize = AuthHeader.DataSize;
+    CopyGuid (&Info->VendorGuid, &AuthHeader.VendorGuid);
+  } else {
+    NameSize = Header->NameSize;
+    DataSize = Header->DataSize;
+    CopyGuid (&Info->VendorGuid, &Header->VendorGuid);
+  }
+
+  if (Header->StartId != VARIABLE_DATA) {
+    return FALSE;
+  }
+
+  //
+  // A variable header that is only partially written has no name.
+  //
+  if (Header->State == (UINT8) (-1) ||
+      DataSize == (UINT32) (-1) ||
+      NameSize == (UINT32) (-1) ||
+      Header->Attributes == (UINT32) (-1)) {
+    NameSize = 0;
+    DataSize = 0;
+  }
+
+  Available = (UINTN) EndPtr - (UINTN) Variable - HeaderSize;
+  if (NameSize > Available || DataSize > Available ||
+      NameSize + GET_PAD_SIZE (NameSize) + DataSize > Available) {
+    return FALSE;
+  }
+
+  Info->State      = Header->State;
+  Info->Attributes = Header->Attributes;
+  Info->NameSize   = NameSize;
+  Info->DataSize   = DataSize;
+  Info->Name       = (CHAR16 *) ((UINTN) Variable + HeaderSize);
+  Info->Data       = (UINT8 *) Info->Name + NameSize + GET_PAD_SIZE (NameSize);
+  Info->Next       = (VARIABLE_HEADER *) HEADER_ALIGN ((UINTN) Info->Data + DataSize + GET_PAD_SIZE (DataSize));
+  return TRUE;
+}
+
+/**
+  Get the variable stores of the runtime variable cache.
+
+  @param[out] Stores        Returns the bounds of the variable stores, with
+                            StartPtr set to NULL for a missing store.
+
+**/
+VOID
+GetRuntimeCacheStores (
+  OUT RUNTIME_CACHE_STORE   *Stores
+  )
+{
+  UINT32                    StoreOffset[RuntimeCacheStoreMax];
+  VARIABLE_STORE_HEADER     *StoreHeader;
+  UINTN                     Type;
+  UINTN                     EndOffset;
+
+  StoreOffset[RuntimeCacheStoreVolatile] = mVariableRuntimeCache->VolatileStoreOffset;
+  StoreOffset[RuntimeCacheStoreHob]      = mVariableRuntimeCache->HobStoreOffset;
+  StoreOffset[RuntimeCacheStoreNv]       = mVariableRuntimeCache->NvStoreOffset;
+
+  for (Type = 0; Type < RuntimeCacheStoreMax; Type++) {
+    Stores[Type].StartPtr = NULL;
+    Stores[Type].EndPtr   = NULL;
+    if (StoreOffset[Type] == 0 ||
+        StoreOffset[Type] > mVariableRuntimeCacheSize - sizeof (VARIABLE_STORE_HEADER)) {
+      continue;
+    }
+    StoreHeader = (VARIABLE_STORE_HEADER *) ((UINTN) mVariableRuntimeCache + StoreOffset[Type]);
+    EndOffset   = MIN ((UINTN) StoreOffset[Type] + StoreHeader->Size, mVariableRuntimeCacheSize);
+    Stores[Type].StartPtr = (VARIABLE_HEADER *) HEADER_ALIGN (StoreHeader + 1);
+    Stores[Type].EndPtr   = (VARIABLE_HEADER *) ((UINTN) mVariableRuntimeCache + EndOffset);
+  }
+}
+
+/**
+  Find a variable in one variable store of the runtime variable cache.
+
+  Like FindVariableEx () of the variable driver, the first added variable wins,
+  and a variable in deleted transition is only returned if there is no added
+  one.
+
+  @param[in]  Store         The variable store to search.
+  @param[in]  VariableName  Name of the variable to be found.
+  @param[in]  NameSize      Size of VariableName in bytes, including the
+                            terminating null character.
+  @param[in]  VendorGuid    Vendor GUID to be found.
+  @param[out] Found         Returns the variable found.
+
+  @retval TRUE              The variable is found.
+  @retval FALSE             The variable is not found.
+
+**/
+BOOLEAN
+FindRuntimeCacheVariableInStore (
+  IN  RUNTIME_CACHE_STORE     *Store,
+  IN  CHAR16                  *VariableName,
+  IN  UINTN                   NameSize,
+  IN  EFI_GUID                *VendorGuid,
+  OUT RUNTIME_CACHE_VARIABLE  *Found
+  )
+{
+  RUNTIME_CACHE_VARIABLE    Info;
+  VARIABLE_HEADER           *Variable;
+  BOOLEAN                   InDeletedFound;
+
+  InDeletedFound = FALSE;
+  if (Store->StartPtr == NULL) {
+    return FALSE;
+  }
+
+  for ( Variable = Store->StartPtr
+      ; RuntimeCacheReadVariable (Variable, Store->EndPtr, &Info)
+      ; Variable = Info.Next
+      ) {
+    if (Info.State != VAR_ADDED && Info.State != (VAR_IN_DELETED_TRANSITION & VAR_ADDED)) {
+      continue;
+    }
+    if (EfiAtRuntime () && ((Info.Attributes & EFI_VARIABLE_RUNTIME_ACCESS) == 0)) {
+      continue;
+    }
+    if (!CompareGuid (VendorGuid, &Info.VendorGuid)) {
+      continue;
+    }
+    if (Info.NameSize != NameSize || CompareMem (VariableName, Info.Name, NameSize) != 0) {
+      continue;
+    }
+    if (Info.State == VAR_ADDED) {
+      CopyMem (Found, &Info, sizeof (RUNTIME_CACHE_VARIABLE));
+      return TRUE;
+    }
+    if (!InDeletedFound) {
+      CopyMem (Found, &Info, sizeof (RUNTIME_CACHE_VARIABLE));
+      InDeletedFound = TRUE;
+    }
+  }
+
+  return InDeletedFound;
+}
+
+/**
+  Find a variable in the runtime variable cache.
+
+  @param[in]  Stores        The variable stores of the runtime variable cache.
+  @param[in]  VariableName  Name of the variable to be found, not empty.
+  @param[in]  VendorGuid    Vendor GUID to be found.
+  @param[out] Found         Returns the variable found.
+  @param[out] StoreType     Returns the variable store the variable was found in.
+
+  @retval TRUE              The variable is found.
+  @retval FALSE             The variable is not found.
+
+**/
+BOOLEAN
+FindRuntimeCacheVariable (
+  IN  RUNTIME_CACHE_STORE     *Stores,
+  IN  CHAR16                  *VariableName,
+  IN  EFI_GUID                *VendorGuid,
+  OUT RUNTIME_CACHE_VARIABLE  *Found,
+  OUT UINTN                   *StoreType
+  )
+{
+  UINTN                     NameSize;
+  UINTN                     Type;
+
+  NameSize = StrSize (VariableName);
+  for (Type = 0; Type < RuntimeCacheStoreMax; Type++) {
+    if (FindRuntimeCacheVariableInStore (&Stores[Type], VariableName, NameSize, VendorGuid, Found)) {
+      *StoreType = Type;
+      return TRUE;
+    }
+  }
+  return FALSE;
+}
+
+/**
+  Find the variable following a variable in the runtime variable cache, with
+  the semantics of VariableServiceGetNextVariableInternal ().
+
+  @param[in]  Stores        The variable stores of the runtime variable cache.
+  @param[in]  VariableName  Name of the current variable, empty to get the first one.
+  @param[in]  VendorGuid    Vendor GUID of the current variable.
+  @param[out] NextVariable  Returns the next variable.
+
+  @retval EFI_SUCCESS       The next variable is found.
+  @retval EFI_NOT_FOUND     The current variable is not found, or is the last one.
+
+**/
+EFI_STATUS
+FindRuntimeCacheNextVariable (
+  IN  RUNTIME_CACHE_STORE     *Stores,
+  IN  CHAR16                  *VariableName,
+  IN  EFI_GUID                *VendorGuid,
+  OUT RUNTIME_CACHE_VARIABLE  *NextVariable
+  )
+{
+  RUNTIME_CACHE_VARIABLE    Info;
+  RUNTIME_CACHE_VARIABLE    Found;
+  VARIABLE_HEADER           *Variable;
+  UINTN                     Type;
+
+  if (VariableName[0] != 0) {
+    if (!FindRuntimeCacheVariable (Stores, VariableName, VendorGuid, &Info, &Type)) {
+      return EFI_NOT_FOUND;
+    }
+    Variable = Info.Next;
+  } else {
+    for (Type = 0; Type < RuntimeCacheStoreMax && Stores[Type].StartPtr == NULL; Type++) {
+    }
+    if (Type == RuntimeCacheStoreMax) {
+      return EFI_NOT_FOUND;
+    }
+    Variable = Stores[Type].StartPtr;
+  }
+
+  while (TRUE) {
+    //
+    // Switch from Volatile to HOB, to Non-Volatile.
+    //
+    while (!RuntimeCacheReadVariable (Variable, Stores[Type].EndPtr, &Info)) {
+      for (Type++; Type < RuntimeCacheStoreMax && Stores[Type].StartPtr == NULL; Type++) {
+      }
+      if (Type == RuntimeCacheStoreMax) {
+        return EFI_NOT_FOUND;
+      }
+      Variable = Stores[Type].StartPtr;
+    }
+    Variable = Info.Next;
+
+    if (Info.NameSize != 0 &&
+        (Info.State == VAR_ADDED || Info.State == (VAR_IN_DELETED_TRANSITION & VAR_ADDED)) &&
+        (!EfiAtRuntime () || ((Info.Attributes & EFI_VARIABLE_RUNTIME_ACCESS) != 0))) {
+      //
+      // Skip a variable in deleted transition when the added copy exists, and
+      // a non-volatile variable overridden by the HOB store.
+      //
+      if (Info.State == (VAR_IN_DELETED_TRANSITION & VAR_ADDED)) {
+        if (FindRuntimeCacheVariableInStore (&Stores[Type], Info.Name, Info.NameSize, &Info.VendorGuid, &Found) &&
+            Found.State == VAR_ADDED) {
+          continue;
+        }
+      }
+      if (Type == RuntimeCacheStoreNv && Stores[RuntimeCacheStoreHob].StartPtr != NULL) {
+        if (FindRuntimeCacheVariableInStore (&Stores[RuntimeCacheStoreHob], Info.Name, Info.NameSize, &Info.VendorGuid, &Found)) {
+          continue;
+        }
+      }
+
+      CopyMem (NextVariable, &Info, sizeof (RUNTIME_CACHE_VARIABLE));
+      return EFI_SUCCESS;
+    }
+  }
+}
+
+/**
+  Start reading the runtime variable cache.
+
+  @param[out] Sequence      Returns the sequence number to pass to
+                            EndRuntimeCacheRead ().
+
+  @retval TRUE              The cache can be read.
+  @retval FALSE             The cache is not filled, or being updated.
+
+**/
+BOOLEAN
+StartRuntimeCacheRead (
+  OUT UINT32                *Sequence
+  )
+{
+  if (mVariableRuntimeCache == NULL) {
+    return FALSE;
+  }
+
+  *Sequence = mVariableRuntimeCache->Sequence;
+  MemoryFence ();
+  return (BOOLEAN) (*Sequence != 0 && (*Sequence & BIT0) == 0);
+}
+
+/**
+  Finish reading the runtime variable cache.
+
+  @param[in]  Sequence      The sequence number returned by StartRuntimeCacheRead ().
+
+  @retval TRUE              The cache was not modified while it was read.
+  @retval FALSE             The cache was modified, what was read must be discarded.
+
+**/
+BOOLEAN
+EndRuntimeCacheRead (
+  IN UINT32                 Sequence
+  )
+{
+  MemoryFence ();
+  return (BOOLEAN) (mVariableRuntimeCache->Sequence == Sequence);
+}
+
+/**
+  Get a variable from the runtime variable cache.
+
+  @param[in]      VariableName       Name of Variable to be found.
+  @param[in]      VendorGuid         Variable vendor GUID.
+  @param[out]     Attributes         Attribute value of the variable found.
+  @param[in, out] DataSize           Size of Data found. If size is less than the
+                                     data, this value contains the required size.
+  @param[out]     Data               Data pointer.
+
+  @retval EFI_INVALID_PARAMETER      Invalid parameter.
+  @retval EFI_SUCCESS                Find the specified variable.
+  @retval EFI_NOT_FOUND              Not found.
+  @retval EFI_BUFFER_TO_SMALL        DataSize is too small for the result.
+  @retval EFI_UNSUPPORTED            The cache cannot be used, the variable must
+                                     be read through SMI.
+
+**/
+EFI_STATUS
+GetVariableFromRuntimeCache (
+  IN      CHAR16                            *VariableName,
+  IN      EFI_GUID                          *VendorGuid,
+  OUT     UINT32                            *Attributes OPTIONAL,
+  IN OUT  UINTN                             *DataSize,
+  OUT     VOID                              *Data
+  )
+{
+  RUNTIME_CACHE_STORE       Stores[RuntimeCacheStoreMax];
+  RUNTIME_CACHE_VARIABLE    Variable;
+  UINTN                     StoreType;
+  UINTN                     VarDataSize;
+  UINT32                    VarAttributes;
+  UINT32                    Sequence;
+  EFI_STATUS                Status;
+
+  if (!StartRuntimeCacheRead (&Sequence)) {
+    return EFI_UNSUPPORTED;
+  }
+
+  if (VariableName[0] == 0) {
+    return EFI_NOT_FOUND;
+  }
+
+  GetRuntimeCacheStores (Stores);
+  if (!FindRuntimeCacheVariable (Stores, VariableName, VendorGuid, &Variable, &StoreType)) {
+    Status        = EFI_NOT_FOUND;
+    VarDataSize   = 0;
+    VarAttributes = 0;
+  } else {
+    VarDataSize   = Variable.DataSize;
+    VarAttributes = Variable.Attributes;
+    if (*DataSize < VarDataSize) {
+      Status = EFI_BUFFER_TOO_SMALL;
+    } else if (Data == NULL) {
+      Status = EFI_INVALID_PARAMETER;
+    } else {
+      CopyMem (Data, Variable.Data, VarDataSize);
+      Status = EFI_SUCCESS;
+    }
+  }
+
+  //
+  // Only report the result if SMM did not update the cache meanwhile.
+  //
+  if (!EndRuntimeCacheRead (Sequence)) {
+    return EFI_UNSUPPORTED;
+  }
+
+  if (Status == EFI_SUCCESS || Status == EFI_BUFFER_TOO_SMALL) {
+    *DataSize = VarDataSize;
+  }
+  if (Status == EFI_SUCCESS && Attributes != NULL) {
+    *Attributes = VarAttributes;
+  }
+  return Status;
+}
+
+/**
+  Get the next variable name from the runtime variable cache.
+
+  @param[in, out] VariableNameSize   Size of the variable name.
+  @param[in, out] VariableName       Pointer to variable name.
+  @param[in, out] VendorGuid         Variable Vendor Guid.
+
+  @retval EFI_SUCCESS                Find the specified variable.
+  @retval EFI_NOT_FOUND              Not found.
+  @retval EFI_BUFFER_TO_SMALL        DataSize is too small for the result.
+  @retval EFI_UNSUPPORTED            The cache cannot be used, the variable name
+                                     must be read through SMI. VariableName may
+                                     have been overwritten.
+
+**/
+EFI_STATUS
+GetNextVariableNameFromRuntimeCache (
+  IN OUT  UINTN                             *VariableNameSize,
+  IN OUT  CHAR16                            *VariableName,
+  IN OUT  EFI_GUID                          *VendorGuid
+  )
+{
+  RUNTIME_CACHE_STORE       Stores[RuntimeCacheStoreMax];
+  RUNTIME_CACHE_VARIABLE    Variable;
+  UINTN                     VarNameSize;
+  UINT32                    Sequence;
+  EFI_STATUS                Status;
+
+  if (!StartRuntimeCacheRead (&Sequence)) {
+    return EFI_UNSUPPORTED;
+  }
+
+  GetRuntimeCacheStores (Stores);
+  Status = FindRuntimeCacheNextVariable (Stores, VariableName, VendorGuid, &Variable);
+  if (EFI_ERROR (Status)) {
+    return EndRuntimeCacheRead (Sequence) ? Status : EFI_UNSUPPORTED;
+  }
+
+  VarNameSize = Variable.NameSize;
+  if (VarNameSize <= *VariableNameSize) {
+    CopyMem (VariableName, Variable.Name, VarNameSize);
+    Status = EFI_SUCCESS;
+  } else {
+    Status = EFI_BUFFER_TOO_SMALL;
+  }
+
+  //
+  // The caller keeps a copy of the input name to fall back to SMI, as
+  // VariableName may have been overwritten by then.
+  //
+  if (!EndRuntimeCacheRead (Sequence)) {
+    return EFI_UNSUPPORTED;
+  }
+
+  if (Status == EFI_SUCCESS) {
+    CopyGuid (VendorGuid, &Variable.VendorGuid);
+  }
+  *VariableNameSize = VarNameSize;
+  return Status;
+}
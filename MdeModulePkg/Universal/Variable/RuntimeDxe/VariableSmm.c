@@ -45,6 +45,198 @@ UINT8                                                *mVariableBufferPayload = N
 UINTN                                                mVariableBufferPayloadSize;
 extern BOOLEAN                                       mEndOfDxe;
 extern VAR_CHECK_REQUEST_SOURCE                      mRequestSource;
+extern VARIABLE_STORE_HEADER                         *mNvVariableCache;
+
+///
+/// The runtime variable cache registered by the variable wrapper driver, and
+/// the layout of the cache, kept in SMRAM as the cache itself is not trusted.
+///
+VARIABLE_RUNTIME_CACHE_HEADER                        *mVariableRuntimeCache  = NULL;
+UINT32                                               mVariableRuntimeCacheSequence;
+UINTN                                                mVariableRuntimeCacheStoreOffset[VariableStoreTypeMax];
+UINTN                                                mVariableRuntimeCacheStoreSize[VariableStoreTypeMax];
+UINTN                                                mVariableRuntimeCacheSyncedSize[VariableStoreTypeMax];
+
+/**
+  Get a variable store of the variable driver.
+
+  @param[in]  Type          Type of the variable store.
+
+  @return Pointer to the variable store header, NULL if there is no such store.
+
+**/
+VARIABLE_STORE_HEADER *
+GetRuntimeCacheVariableStore (
+  IN VARIABLE_STORE_TYPE    Type
+  )
+{
+  switch (Type) {
+    case VariableStoreTypeVolatile:
+      return (VARIABLE_STORE_HEADER *) (UINTN) mVariableModuleGlobal->VariableGlobal.VolatileVariableBase;
+    case VariableStoreTypeHob:
+      return (VARIABLE_STORE_HEADER *) (UINTN) mVariableModuleGlobal->VariableGlobal.HobVariableBase;
+    default:
+      return mNvVariableCache;
+  }
+}
+
+/**
+  Get the size of the buffer needed by the runtime variable cache.
+
+  @return Size of the runtime variable cache in bytes.
+
+**/
+UINTN
+GetRuntimeVariableCacheSize (
+  VOID
+  )
+{
+  VARIABLE_STORE_TYPE       Type;
+  VARIABLE_STORE_HEADER     *VariableStore;
+  UINTN                     Size;
+
+  Size = ALIGN_VALUE (sizeof (VARIABLE_RUNTIME_CACHE_HEADER), sizeof (UINT64));
+  for (Type = (VARIABLE_STORE_TYPE) 0; Type < VariableStoreTypeMax; Type++) {
+    VariableStore = GetRuntimeCacheVariableStore (Type);
+    if (VariableStore != NULL) {
+      Size += ALIGN_VALUE (VariableStore->Size, sizeof (UINT64));
+    }
+  }
+  return Size;
+}
+
+/**
+  Copy the variable stores modified since the last call to the runtime
+  variable cache, if the variable wrapper driver registered one.
+
+  Only the part of the volatile and non-volatile stores that holds variables,
+  now or at the previous call, is copied.
+
+**/
+VOID
+SynchronizeRuntimeVariableCache (
+  VOID
+  )
+{
+  VARIABLE_STORE_TYPE       Type;
+  VARIABLE_STORE_HEADER     *VariableStore;
+  UINTN                     LastOffset;
+  UINTN                     Length;
+  UINT32                    StoreOffset[VariableStoreTypeMax];
+
+  if (mVariableRuntimeCache == NULL) {
+    return;
+  }
+
+  //
+  // Readers ignore the cache while the sequence number is odd.
+  //
+  mVariableRuntimeCache->Sequence = ++mVariableRuntimeCacheSequence;
+  MemoryFence ();
+
+  for (Type = (VARIABLE_STORE_TYPE) 0; Type < VariableStoreTypeMax; Type++) {
+    StoreOffset[Type] = 0;
+    VariableStore     = GetRuntimeCacheVariableStore (Type);
+    if (VariableStore == NULL || mVariableRuntimeCacheStoreSize[Type] == 0) {
+      continue;
+    }
+
+    if (Type == VariableStoreTypeHob) {
+      //
+      // Variables of the HOB store are only marked deleted as they are flushed
+      // to flash, the store is small and copied as a whole.
+      //
+      Length = mVariableRuntimeCacheStoreSize[Type];
+    } else {
+      if (Type == VariableStoreTypeVolatile) {
+        LastOffset = mVariableModuleGlobal->VolatileLastVariableOffset;
+      } else {
+        LastOffset = mVariableModuleGlobal->NonVolatileLastVariableOffset;
+      }
+      //
+      // After a reclaim the store is shorter than the copy in the cache, the
+      // stale variables at the end of the copy must be erased too.
+      //
+      Length = MAX (LastOffset, mVariableRuntimeCacheSyncedSize[Type]);
+      Length = MIN (Length, mVariableRuntimeCacheStoreSize[Type]);
+      mVariableRuntimeCacheSyncedSize[Type] = LastOffset;
+    }
+
+    CopyMem (
+      (UINT8 *) mVariableRuntimeCache + mVariableRuntimeCacheStoreOffset[Type],
+      VariableStore,
+      Length
+      );
+    StoreOffset[Type] = (UINT32) mVariableRuntimeCacheStoreOffset[Type];
+  }
+
+  mVariableRuntimeCache->AuthFormat          = mVariableModuleGlobal->VariableGlobal.AuthFormat;
+  mVariableRuntimeCache->VolatileStoreOffset = StoreOffset[VariableStoreTypeVolatile];
+  mVariableRuntimeCache->HobStoreOffset      = StoreOffset[VariableStoreTypeHob];
+  mVariableRuntimeCache->NvStoreOffset       = StoreOffset[VariableStoreTypeNv];
+
+  MemoryFence ();
+  mVariableRuntimeCache->Sequence = ++mVariableRuntimeCacheSequence;
+}
+
+/**
+  Register the runtime variable cache of the variable wrapper driver and fill it.
+
+  Caution: This function may receive untrusted input.
+  The cache buffer is external input, it must be outside SMRAM and large enough.
+
+  @param[in]  CacheBuffer   Physical address of the runtime variable cache.
+  @param[in]  CacheSize     Size of the runtime variable cache in bytes.
+
+  @retval EFI_SUCCESS           The runtime variable cache is registered.
+  @retval EFI_ACCESS_DENIED     A runtime variable cache is already registered,
+                                or the cache buffer overlaps SMRAM.
+  @retval EFI_BUFFER_TOO_SMALL  The cache buffer is too small.
+
+**/
+EFI_STATUS
+InitRuntimeVariableCache (
+  IN EFI_PHYSICAL_ADDRESS   CacheBuffer,
+  IN UINT64                 CacheSize
+  )
+{
+  VARIABLE_STORE_TYPE       Type;
+  VARIABLE_STORE_HEADER     *VariableStore;
+  UINTN                     Offset;
+
+  if (mVariableRuntimeCache != NULL) {
+    return EFI_ACCESS_DENIED;
+  }
+
+  if (CacheSize < GetRuntimeVariableCacheSize ()) {
+    return EFI_BUFFER_TOO_SMALL;
+  }
+
+  if (!SmmIsBufferOutsideSmmValid (CacheBuffer, CacheSize)) {
+    DEBUG ((EFI_D_ERROR, "InitRuntimeVariableCache: Runtime variable cache in SMRAM or overflow!\n"));
+    return EFI_ACCESS_DENIED;
+  }
+
+  Offset = ALIGN_VALUE (sizeof (VARIABLE_RUNTIME_CACHE_HEADER), sizeof (UINT64));
+  for (Type = (VARIABLE_STORE_TYPE) 0; Type < VariableStoreTypeMax; Type++) {
+    VariableStore = GetRuntimeCacheVariableStore (Type);
+    if (VariableStore == NULL) {
+      mVariableRuntimeCacheStoreOffset[Type] = 0;
+      mVariableRuntimeCacheStoreSize[Type]   = 0;
+      continue;
+    }
+    mVariableRuntimeCacheStoreOffset[Type] = Offset;
+    mVariableRuntimeCacheStoreSize[Type]   = VariableStore->Size;
+    mVariableRuntimeCacheSyncedSize[Type]  = VariableStore->Size;
+    Offset += ALIGN_VALUE (VariableStore->Size, sizeof (UINT64));
+  }
+
+  mVariableRuntimeCacheSequence = 0;
+  mVariableRuntimeCache = (VARIABLE_RUNTIME_CACHE_HEADER *) (UINTN) CacheBuffer;
+  SynchronizeRuntimeVariableCache ();
+
+  return EFI_SUCCESS;
+}
 
 /**
   SecureBoot Hook for SetVariable.
@@ -105,6 +297,7 @@ SmmVariableSetVariable (
                      Data
                      );
   mRequestSource = VarCheckFromUntrusted;
+  SynchronizeRuntimeVariableCache ();
   return Status;
 }
 
@@ -476,6 +669,9 @@ SmmVariableHandler (
   VARIABLE_INFO_ENTRY                              *VariableInfo;
   SMM_VARIABLE_COMMUNICATE_LOCK_VARIABLE           *VariableToLock;
   SMM_VARIABLE_COMMUNICATE_VAR_CHECK_VARIABLE_PROPERTY *CommVariableProperty;
+  SMM_VARIABLE_COMMUNICATE_RUNTIME_CACHE           *RuntimeCache;
+  EFI_PHYSICAL_ADDRESS                             CacheBuffer;
+  UINT64                                           CacheSize;
   UINTN                                            InfoSize;
   UINTN                                            NameBufferSize;
   UINTN                                            CommBufferPayloadSize;
@@ -646,6 +842,7 @@ SmmVariableHandler (
                  SmmVariableHeader->DataSize,
                  (UINT8 *)SmmVariableHeader->Name + SmmVariableHeader->NameSize
                  );
+      SynchronizeRuntimeVariableCache ();
       break;
 
     case SMM_VARIABLE_FUNCTION_QUERY_VARIABLE_INFO:
@@ -687,6 +884,7 @@ SmmVariableHandler (
         InitializeVariableQuota ();
       }
       ReclaimForOS ();
+      SynchronizeRuntimeVariableCache ();
       Status = EFI_SUCCESS;
       break;
 
@@ -781,6 +979,44 @@ SmmVariableHandler (
       CopyMem (SmmVariableFunctionHeader->Data, mVariableBufferPayload, CommBufferPayloadSize);
       break;
 
+    case SMM_VARIABLE_FUNCTION_GET_RUNTIME_CACHE_INFO:
+      if (CommBufferPayloadSize < sizeof (SMM_VARIABLE_COMMUNICATE_RUNTIME_CACHE)) {
+        DEBUG ((EFI_D_ERROR, "GetRuntimeCacheInfo: SMM communication buffer size invalid!\n"));
+        return EFI_SUCCESS;
+      }
+      RuntimeCache = (SMM_VARIABLE_COMMUNICATE_RUNTIME_CACHE *) SmmVariableFunctionHeader->Data;
+      RuntimeCache->CacheBuffer = 0;
+      RuntimeCache->CacheSize   = GetRuntimeVariableCacheSize ();
+      Status = EFI_SUCCESS;
+      break;
+
+    case SMM_VARIABLE_FUNCTION_INIT_RUNTIME_CACHE:
+      if (CommBufferPayloadSize < sizeof (SMM_VARIABLE_COMMUNICATE_RUNTIME_CACHE)) {
+        DEBUG ((EFI_D_ERROR, "InitRuntimeCache: SMM communication buffer size invalid!\n"));
+        return EFI_SUCCESS;
+      }
+      if (mEndOfDxe) {
+        Status = EFI_ACCESS_DENIED;
+      } else {
+        //
+        // Read the communicate buffer once, it may be changed from outside SMM.
+        //
+        RuntimeCache = (SMM_VARIABLE_COMMUNICATE_RUNTIME_CACHE *) SmmVariableFunctionHeader->Data;
+        CacheBuffer  = RuntimeCache->CacheBuffer;
+        CacheSize    = RuntimeCache->CacheSize;
+        Status = InitRuntimeVariableCache (CacheBuffer, CacheSize);
+      }
+      break;
+
+    case SMM_VARIABLE_FUNCTION_GET_RECLAIM_STATISTICS:
+      if (CommBufferPayloadSize < sizeof (VARIABLE_RECLAIM_STATISTICS)) {
+        DEBUG ((EFI_D_ERROR, "GetReclaimStatistics: SMM communication buffer size invalid!\n"));
+        return EFI_SUCCESS;
+      }
+      CopyMem (SmmVariableFunctionHeader->Data, &mVariableModuleGlobal->ReclaimStatistics, sizeof (VARIABLE_RECLAIM_STATISTICS));
+      Status = EFI_SUCCESS;
+      break;
+
     default:
       Status = EFI_UNSUPPORTED;
   }
@@ -819,6 +1055,7 @@ SmmEndOfDxeCallback (
   InitializeVariableQuota ();
   if (PcdGetBool (PcdReclaimVariableSpaceAtEndOfDxe)) {
     ReclaimForOS ();
+    SynchronizeRuntimeVariableCache ();
   }
 
   return EFI_SUCCESS;
@@ -887,6 +1124,7 @@ SmmFtwNotificationEvent (
   if (EFI_ERROR (Status)) {
     DEBUG ((DEBUG_ERROR, "Variable write service initialization failed. Status = %r\n", Status));
   }
+  SynchronizeRuntimeVariableCache ();
 
   //
   // Notify the variable wrapper driver the variable write service is ready
@@ -40,6 +40,7 @@ WITHOUT WARRANTIES OR REPRESENTATIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED.
 #include <Library/DebugLib.h>
 #include <Library/UefiLib.h>
 #include <Library/BaseLib.h>
+#include <Library/PcdLib.h>
 
 #include <Guid/EventGroup.h>
 #include <Guid/SmmVariableCommon.h>
@@ -81,6 +82,58 @@ RecordSecureBootPolicyVarData(
   VOID
   );
 
+extern VARIABLE_RUNTIME_CACHE_HEADER  *mVariableRuntimeCache;
+extern UINTN                          mVariableRuntimeCacheSize;
+
+/**
+  Get a variable from the runtime variable cache.
+
+  @param[in]      VariableName       Name of Variable to be found.
+  @param[in]      VendorGuid         Variable vendor GUID.
+  @param[out]     Attributes         Attribute value of the variable found.
+  @param[in, out] DataSize           Size of Data found. If size is less than the
+                                     data, this value contains the required size.
+  @param[out]     Data               Data pointer.
+
+  @retval EFI_INVALID_PARAMETER      Invalid parameter.
+  @retval EFI_SUCCESS                Find the specified variable.
+  @retval EFI_NOT_FOUND              Not found.
+  @retval EFI_BUFFER_TO_SMALL        DataSize is too small for the result.
+  @retval EFI_UNSUPPORTED            The cache cannot be used, the variable must
+                                     be read through SMI.
+
+**/
+EFI_STATUS
+GetVariableFromRuntimeCache (
+  IN      CHAR16                            *VariableName,
+  IN      EFI_GUID                          *VendorGuid,
+  OUT     UINT32                            *Attributes OPTIONAL,
+  IN OUT  UINTN                             *DataSize,
+  OUT     VOID                              *Data
+  );
+
+/**
+  Get the next variable name from the runtime variable cache.
+
+  @param[in, out] VariableNameSize   Size of the variable name.
+  @param[in, out] VariableName       Pointer to variable name.
+  @param[in, out] VendorGuid         Variable Vendor Guid.
+
+  @retval EFI_SUCCESS                Find the specified variable.
+  @retval EFI_NOT_FOUND              Not found.
+  @retval EFI_BUFFER_TO_SMALL        DataSize is too small for the result.
+  @retval EFI_UNSUPPORTED            The cache cannot be used, the variable name
+                                     must be read through SMI. VariableName may
+                                     have been overwritten.
+
+**/
+EFI_STATUS
+GetNextVariableNameFromRuntimeCache (
+  IN OUT  UINTN                             *VariableNameSize,
+  IN OUT  CHAR16                            *VariableName,
+  IN OUT  EFI_GUID                          *VendorGuid
+  );
+
 /**
   Acquires lock only at boot time. Simply returns at runtime.
 
@@ -494,6 +547,16 @@ RuntimeServiceGetVariable (
 
   AcquireLockOnlyAtBootTime(&mVariableServicesLock);
 
+  //
+  // Serve the variable from the runtime variable cache without an SMI when possible.
+  //
+  if (mVariableRuntimeCache != NULL) {
+    Status = GetVariableFromRuntimeCache (VariableName, VendorGuid, Attributes, DataSize, Data);
+    if (Status != EFI_UNSUPPORTED) {
+      goto Done;
+    }
+  }
+
   //
   // Init the communicate buffer. The buffer data size is:
   // SMM_COMMUNICATE_HEADER_SIZE + SMM_VARIABLE_COMMUNICATE_HEADER_SIZE + PayloadSize.
@@ -636,6 +699,17 @@ RuntimeServiceGetNextVariableName (
     ZeroMem ((UINT8 *) SmmGetNextVariableName->Name + InVariableNameSize, OutVariableNameSize - InVariableNameSize);
   }
 
+  //
+  // Serve the variable name from the runtime variable cache without an SMI when
+  // possible. The communicate buffer keeps the input in case the cache fails.
+  //
+  if (mVariableRuntimeCache != NULL) {
+    Status = GetNextVariableNameFromRuntimeCache (VariableNameSize, VariableName, VendorGuid);
+    if (Status != EFI_UNSUPPORTED) {
+      goto Done;
+    }
+  }
+
   //
   // Send data to SMM
   //
@@ -911,6 +985,7 @@ VariableAddressChangeEvent (
 {
   EfiConvertPointer (0x0, (VOID **) &mVariableBuffer);
   EfiConvertPointer (0x0, (VOID **) &mSmmCommunication);
+  EfiConvertPointer (0x0, (VOID **) &mVariableRuntimeCache);
 }
 
 /**
@@ -987,6 +1062,73 @@ Done:
   return Status;
 }
 
+/**
+  Allocate the runtime variable cache and register it to the SMM variable
+  driver, which fills it and keeps it up to date.
+
+  The cache is not used if any step fails, variables are then read through SMI.
+
+**/
+VOID
+InitVariableRuntimeCache (
+  VOID
+  )
+{
+  EFI_STATUS                                Status;
+  SMM_VARIABLE_COMMUNICATE_RUNTIME_CACHE    *SmmRuntimeCache;
+  UINTN                                     CacheSize;
+  VOID                                      *CacheBuffer;
+
+  if (!FeaturePcdGet (PcdEnableVariableRuntimeCache)) {
+    return;
+  }
+
+  AcquireLockOnlyAtBootTime(&mVariableServicesLock);
+
+  CacheBuffer = NULL;
+  CacheSize   = 0;
+  Status = InitCommunicateBuffer ((VOID **) &SmmRuntimeCache, sizeof (*SmmRuntimeCache), SMM_VARIABLE_FUNCTION_GET_RUNTIME_CACHE_INFO);
+  if (EFI_ERROR (Status)) {
+    goto Done;
+  }
+  ZeroMem (SmmRuntimeCache, sizeof (*SmmRuntimeCache));
+  Status = SendCommunicateBuffer (sizeof (*SmmRuntimeCache));
+  if (EFI_ERROR (Status)) {
+    goto Done;
+  }
+
+  CacheSize   = (UINTN) SmmRuntimeCache->CacheSize;
+  CacheBuffer = AllocateRuntimePages (EFI_SIZE_TO_PAGES (CacheSize));
+  if (CacheBuffer == NULL) {
+    Status = EFI_OUT_OF_RESOURCES;
+    goto Done;
+  }
+  ZeroMem (CacheBuffer, CacheSize);
+
+  Status = InitCommunicateBuffer ((VOID **) &SmmRuntimeCache, sizeof (*SmmRuntimeCache), SMM_VARIABLE_FUNCTION_INIT_RUNTIME_CACHE);
+  if (EFI_ERROR (Status)) {
+    goto Done;
+  }
+  SmmRuntimeCache->CacheBuffer = (EFI_PHYSICAL_ADDRESS) (UINTN) CacheBuffer;
+  SmmRuntimeCache->CacheSize   = CacheSize;
+  Status = SendCommunicateBuffer (sizeof (*SmmRuntimeCache));
+  if (EFI_ERROR (Status)) {
+    goto Done;
+  }
+
+  mVariableRuntimeCacheSize = CacheSize;
+  mVariableRuntimeCache     = CacheBuffer;
+
+Done:
+  if (EFI_ERROR (Status)) {
+    DEBUG ((EFI_D_INFO, "Variable runtime cache is not used - %r\n", Status));
+    if (CacheBuffer != NULL) {
+      FreePages (CacheBuffer, EFI_SIZE_TO_PAGES (CacheSize));
+    }
+  }
+  ReleaseLockOnlyAtBootTime (&mVariableServicesLock);
+}
+
 /**
   Initialize variable service and install Variable Architectural protocol.
 
@@ -1025,6 +1167,8 @@ SmmVariableReady (
   //
   mVariableBufferPhysical = mVariableBuffer;
 
+  InitVariableRuntimeCache ();
+
   gRT->GetVariable         = RuntimeServiceGetVariable;
   gRT->GetNextVariableName = RuntimeServiceGetNextVariableName;
   gRT->SetVariable         = RuntimeServiceSetVariable;
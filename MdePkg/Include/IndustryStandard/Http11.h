@@ -82,6 +82,21 @@
 ///
 #define HTTP_HEADER_ACCEPT_RANGES      "Accept-Ranges"
 
+///
+/// Range Request Header
+/// The Range request-header field requests only part of the entity,
+/// given as one or more byte ranges, for example "bytes=0-499".
+///
+#define HTTP_HEADER_RANGE              "Range"
+
+///
+/// Content-Range Response Header
+/// The Content-Range entity-header is sent with a partial entity-body
+/// to specify where in the full entity-body the partial body should be applied,
+/// for example "bytes 0-499/1234".
+///
+#define HTTP_HEADER_CONTENT_RANGE      "Content-Range"
+
 
 /// 
 /// Accept-Encoding Request Header
@@ -6,6 +6,7 @@
     BaseMemoryLib
     BaseMemoryLibMmx
     BaseMemoryLibSse2
+    BaseMemoryLibErms
     BaseMemoryLibRepStr
     BaseMemoryLibOptDxe
     BaseMemoryLibOptPei
@@ -5,6 +5,7 @@
     BaseMemoryLib
     BaseMemoryLibMmx
     BaseMemoryLibSse2
+    BaseMemoryLibErms
     BaseMemoryLibRepStr
     BaseMemoryLibOptDxe
     BaseMemoryLibOptPei
@@ -452,21 +452,22 @@ HttpBootDiscoverBootInfo (
 }
 
 /**
-  Create a HttpIo instance for the file download.
+  Create and configure a HTTP child for the file download.
 
   @param[in]    Private        The pointer to the driver's private data.
+  @param[out]   HttpIo         The HTTP_IO wrapping the new HTTP child.
 
   @retval EFI_SUCCESS          Successfully created.
   @retval Others               Failed to create HttpIo.
 
 **/
 EFI_STATUS
-HttpBootCreateHttpIo (
-  IN     HTTP_BOOT_PRIVATE_DATA       *Private
+HttpBootCreateHttpIoInstance (
+  IN     HTTP_BOOT_PRIVATE_DATA       *Private,
+     OUT HTTP_IO                      *HttpIo
   )
 {
   HTTP_IO_CONFIG_DATA          ConfigData;
-  EFI_STATUS                   Status;
   EFI_HANDLE                   ImageHandle;
 
   ASSERT (Private != NULL);
@@ -485,13 +486,34 @@ HttpBootCreateHttpIo (
     ImageHandle = Private->Ip6Nic->ImageHandle;
   }
 
-  Status = HttpIoCreateIo (
-             ImageHandle,
-             Private->Controller,
-             Private->UsingIpv6 ? IP_VERSION_6 : IP_VERSION_4,
-             &ConfigData,
-             &Private->HttpIo
-             );
+  return HttpIoCreateIo (
+           ImageHandle,
+           Private->Controller,
+           Private->UsingIpv6 ? IP_VERSION_6 : IP_VERSION_4,
+           &ConfigData,
+           HttpIo
+           );
+}
+
+/**
+  Create a HttpIo instance for the file download.
+
+  @param[in]    Private        The pointer to the driver's private data.
+
+  @retval EFI_SUCCESS          Successfully created.
+  @retval Others               Failed to create HttpIo.
+
+**/
+EFI_STATUS
+HttpBootCreateHttpIo (
+  IN     HTTP_BOOT_PRIVATE_DATA       *Private
+  )
+{
+  EFI_STATUS                   Status;
+
+  ASSERT (Private != NULL);
+
+  Status = HttpBootCreateHttpIoInstance (Private, &Private->HttpIo);
   if (EFI_ERROR (Status)) {
     return Status;
   }
@@ -803,6 +825,16 @@ HttpBootGetBootFile (
       FreePool (Url);
       return Status;
     }
+
+    //
+    // Then, try to download a large file over several connections, if the
+    // server told in its reply to the HEAD method that it accepts ranges.
+    //
+    Status = HttpBootGetBootFileByRange (Private, BufferSize, Buffer, ImageType);
+    if (Status != EFI_UNSUPPORTED) {
+      FreePool (Url);
+      return Status;
+    }
   }
 
   //
@@ -959,6 +991,13 @@ HttpBootGetBootFile (
     goto ERROR_5;
   }
 
+  //
+  // Remember whether the file could be downloaded by ranges.
+  //
+  if (HeaderOnly) {
+    Private->AcceptRanges = HttpBootIsRangeAccepted (ResponseData->HeaderCount, ResponseData->Headers);
+  }
+
   //
   // 3.2 Cache the response header.
   //
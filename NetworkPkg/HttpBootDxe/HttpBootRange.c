@@ -0,0 +1,594 @@
+/** @file
+  Implementation of the multi-connection boot file download with HTTP range requests.
+
+  The file is split in ranges of HTTP_BOOT_RANGE_CHUNK_SIZE bytes. Each HTTP child
+  requests one range at a time on its persistent connection, and the received
+  message-body is written directly at the position of the range in the caller's
+  buffer, so no data is copied.
+
+Copyright (c) 2017, Intel Corporation. All rights reserved.<BR>
+This program and the accompanying materials are licensed and made available under
+the terms and conditions of the BSD License that accompanies this distribution.
+The full text of the license may be found at
+http://opensource.org/licenses/bsd-license.php.
+
+THE PROGRAM IS DISTRIBUTED UNDER THE BSD LICENSE ON AN "AS IS" BASIS,
+WITHOUT WARRANTIES OR REPRESENTATIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED.
+
+**/
+
+#include "HttpBootDxe.h"
+
+/**
+  Check whether the server accepts byte range requests for the boot file.
+
+  @param[in]    HeaderCount      Number of HTTP header structures in Headers list.
+  @param[in]    Headers          Array containing list of HTTP headers of the response.
+
+  @retval TRUE                   The server accepts byte range requests.
+  @retval FALSE                  The server does not accept byte range requests.
+
+**/
+BOOLEAN
+HttpBootIsRangeAccepted (
+  IN  UINTN                  HeaderCount,
+  IN  EFI_HTTP_HEADER        *Headers
+  )
+{
+  EFI_HTTP_HEADER            *Header;
+
+  Header = HttpFindHeader (HeaderCount, Headers, HTTP_HEADER_ACCEPT_RANGES);
+  if (Header == NULL || Header->FieldValue == NULL) {
+    return FALSE;
+  }
+
+  return (BOOLEAN) (AsciiStrStr (Header->FieldValue, "bytes") != NULL);
+}
+
+/**
+  Build the HTTP header of the range requests, the Range header field is
+  added for each request.
+
+  @param[in]    Private          The pointer to the driver's private data.
+
+  @return The HTTP header holder, or NULL if it could not be built.
+
+**/
+HTTP_IO_HEADER *
+HttpBootRangeCreateHeader (
+  IN     HTTP_BOOT_PRIVATE_DATA   *Private
+  )
+{
+  EFI_STATUS                 Status;
+  HTTP_IO_HEADER             *HttpIoHeader;
+  CHAR8                      *HostName;
+
+  //
+  // 4 header is needed to download a range of the boot file:
+  //   Host
+  //   Accept
+  //   User-Agent
+  //   Range
+  //
+  HttpIoHeader = HttpBootCreateHeader (4);
+  if (HttpIoHeader == NULL) {
+    return NULL;
+  }
+
+  HostName = NULL;
+  Status = HttpUrlGetHostName (
+             Private->BootFileUri,
+             Private->BootFileUriParser,
+             &HostName
+             );
+  if (EFI_ERROR (Status)) {
+    goto ON_ERROR;
+  }
+  Status = HttpBootSetHeader (HttpIoHeader, HTTP_HEADER_HOST, HostName);
+  FreePool (HostName);
+  if (EFI_ERROR (Status)) {
+    goto ON_ERROR;
+  }
+
+  Status = HttpBootSetHeader (HttpIoHeader, HTTP_HEADER_ACCEPT, "*/*");
+  if (EFI_ERROR (Status)) {
+    goto ON_ERROR;
+  }
+
+  Status = HttpBootSetHeader (HttpIoHeader, HTTP_HEADER_USER_AGENT, HTTP_USER_AGENT_EFI_HTTP_BOOT);
+  if (EFI_ERROR (Status)) {
+    goto ON_ERROR;
+  }
+
+  return HttpIoHeader;
+
+ON_ERROR:
+  HttpBootFreeHeader (HttpIoHeader);
+  return NULL;
+}
+
+/**
+  Create one more HTTP child for the range download.
+
+  @param[in, out]  Download        The range download.
+
+  @retval EFI_SUCCESS              The connection is created, it is the last one of
+                                   Download->Connection.
+  @retval EFI_OUT_OF_RESOURCES     The maximum connection count is reached, or no
+                                   enough buffer could be allocated.
+  @retval Others                   Failed to create the HTTP child.
+
+**/
+EFI_STATUS
+HttpBootRangeOpenConnection (
+  IN OUT HTTP_BOOT_RANGE_DOWNLOAD *Download
+  )
+{
+  EFI_STATUS                 Status;
+  HTTP_BOOT_RANGE_CONNECTION *Connection;
+
+  if (Download->ConnectionCount >= Download->MaxConnections) {
+    return EFI_OUT_OF_RESOURCES;
+  }
+
+  Connection = &Download->Connection[Download->ConnectionCount];
+  ZeroMem (Connection, sizeof (HTTP_BOOT_RANGE_CONNECTION));
+
+  Connection->RequestHeader = HttpBootRangeCreateHeader (Download->Private);
+  if (Connection->RequestHeader == NULL) {
+    return EFI_OUT_OF_RESOURCES;
+  }
+
+  Status = HttpBootCreateHttpIoInstance (Download->Private, &Connection->HttpIo);
+  if (EFI_ERROR (Status)) {
+    HttpBootFreeHeader (Connection->RequestHeader);
+    return Status;
+  }
+
+  Connection->State = HttpBootRangeIdle;
+  Download->ConnectionCount++;
+  return EFI_SUCCESS;
+}
+
+/**
+  Abort the pending responses and destroy all HTTP children of the range download.
+
+  @param[in, out]  Download        The range download.
+
+**/
+VOID
+HttpBootRangeCloseConnections (
+  IN OUT HTTP_BOOT_RANGE_DOWNLOAD *Download
+  )
+{
+  UINTN                      Index;
+  HTTP_BOOT_RANGE_CONNECTION *Connection;
+
+  for (Index = 0; Index < Download->ConnectionCount; Index++) {
+    Connection = &Download->Connection[Index];
+    if (Connection->State != HttpBootRangeIdle && !Connection->HttpIo.IsRxDone) {
+      Connection->HttpIo.Http->Cancel (Connection->HttpIo.Http, &Connection->HttpIo.RspToken);
+    }
+    gBS->SetTimer (Connection->HttpIo.TimeoutEvent, TimerCancel, 0);
+    if (Connection->HttpIo.RspToken.Message->Headers != NULL) {
+      HttpFreeHeaderFields (Connection->HttpIo.RspToken.Message->Headers, Connection->HttpIo.RspToken.Message->HeaderCount);
+      Connection->HttpIo.RspToken.Message->Headers = NULL;
+    }
+    HttpIoDestroyIo (&Connection->HttpIo);
+    HttpBootFreeHeader (Connection->RequestHeader);
+  }
+  Download->ConnectionCount = 0;
+}
+
+/**
+  Queue a response token on a connection, without waiting for its completion.
+
+  @param[in, out]  Connection      The connection.
+  @param[in]       RecvMsgHeader   TRUE to receive the response header of a new range,
+                                   FALSE to receive the rest of the range in the buffer.
+  @param[in]       Body            Where to receive the message-body.
+  @param[in]       BodyLength      The bytes of message-body to receive at most.
+
+  @retval EFI_SUCCESS              The token is queued.
+  @retval Others                   Failed to queue the token.
+
+**/
+EFI_STATUS
+HttpBootRangeQueueResponse (
+  IN OUT HTTP_BOOT_RANGE_CONNECTION *Connection,
+  IN     BOOLEAN                    RecvMsgHeader,
+  IN     UINT8                      *Body,
+  IN     UINTN                      BodyLength
+  )
+{
+  EFI_STATUS                 Status;
+  HTTP_IO                    *HttpIo;
+
+  HttpIo = &Connection->HttpIo;
+
+  Status = gBS->SetTimer (HttpIo->TimeoutEvent, TimerRelative, HTTP_BOOT_RESPONSE_TIMEOUT * TICKS_PER_MS);
+  if (EFI_ERROR (Status)) {
+    return Status;
+  }
+
+  HttpIo->RspToken.Status  = EFI_NOT_READY;
+  if (RecvMsgHeader) {
+    HttpIo->RspToken.Message->Data.Response = &Connection->Response;
+  } else {
+    HttpIo->RspToken.Message->Data.Response = NULL;
+  }
+  HttpIo->RspToken.Message->HeaderCount   = 0;
+  HttpIo->RspToken.Message->Headers       = NULL;
+  HttpIo->RspToken.Message->BodyLength    = BodyLength;
+  HttpIo->RspToken.Message->Body          = Body;
+
+  HttpIo->IsRxDone = FALSE;
+  Status = HttpIo->Http->Response (HttpIo->Http, &HttpIo->RspToken);
+  if (EFI_ERROR (Status)) {
+    gBS->SetTimer (HttpIo->TimeoutEvent, TimerCancel, 0);
+    HttpIo->IsRxDone = TRUE;
+  }
+
+  return Status;
+}
+
+/**
+  Request the next range of the file not yet requested on a connection.
+
+  @param[in, out]  Download        The range download.
+  @param[in, out]  Connection      An idle connection of the download.
+
+  @retval EFI_SUCCESS              The range is requested, or all the ranges are
+                                   requested and the connection stays idle.
+  @retval Others                   Failed to send the request.
+
+**/
+EFI_STATUS
+HttpBootRangeRequestNext (
+  IN OUT HTTP_BOOT_RANGE_DOWNLOAD   *Download,
+  IN OUT HTTP_BOOT_RANGE_CONNECTION *Connection
+  )
+{
+  EFI_STATUS                 Status;
+  CHAR8                      RangeValue[48];
+
+  Connection->State = HttpBootRangeIdle;
+  if (Download->NextOffset >= Download->FileSize) {
+    return EFI_SUCCESS;
+  }
+
+  Connection->RangeStart  = Download->NextOffset;
+  Connection->RangeLength = MIN (HTTP_BOOT_RANGE_CHUNK_SIZE, Download->FileSize - Download->NextOffset);
+  Connection->Received    = 0;
+  Download->NextOffset   += Connection->RangeLength;
+
+  AsciiSPrint (
+    RangeValue,
+    sizeof (RangeValue),
+    "bytes=%Lu-%Lu",
+    (UINT64) Connection->RangeStart,
+    (UINT64) (Connection->RangeStart + Connection->RangeLength - 1)
+    );
+  Status = HttpBootSetHeader (Connection->RequestHeader, HTTP_HEADER_RANGE, RangeValue);
+  if (EFI_ERROR (Status)) {
+    return Status;
+  }
+
+  Status = HttpIoSendRequest (
+             &Connection->HttpIo,
+             &Download->RequestData,
+             Connection->RequestHeader->HeaderCount,
+             Connection->RequestHeader->Headers,
+             0,
+             NULL
+             );
+  if (EFI_ERROR (Status)) {
+    return Status;
+  }
+
+  //
+  // First receive the response header only, to check the range served.
+  //
+  Connection->State = HttpBootRangeRecvHeader;
+  return HttpBootRangeQueueResponse (Connection, TRUE, NULL, 0);
+}
+
+/**
+  Check that the response header received on a connection is for the range requested.
+
+  @param[in]       Connection      The connection.
+
+  @retval EFI_SUCCESS              The server sends the range requested.
+  @retval EFI_UNSUPPORTED          The server doesn't send the range requested.
+
+**/
+EFI_STATUS
+HttpBootRangeCheckResponse (
+  IN     HTTP_BOOT_RANGE_CONNECTION *Connection
+  )
+{
+  EFI_HTTP_MESSAGE           *Message;
+  EFI_HTTP_HEADER            *Header;
+  CHAR8                      *Value;
+
+  Message = Connection->HttpIo.RspToken.Message;
+  if (Connection->Response.StatusCode != HTTP_STATUS_206_PARTIAL_CONTENT) {
+    DEBUG ((EFI_D_INFO, "HttpBootRangeCheckResponse: status code %d to a range request\n", Connection->Response.StatusCode));
+    return EFI_UNSUPPORTED;
+  }
+
+  //
+  // The response is expected to be a single part "Content-Range: bytes Start-End/Size".
+  //
+  Header = HttpFindHeader (Message->HeaderCount, Message->Headers, HTTP_HEADER_CONTENT_RANGE);
+  if (Header == NULL || Header->FieldValue == NULL) {
+    return EFI_UNSUPPORTED;
+  }
+  Value = Header->FieldValue;
+  if (AsciiStrnCmp (Value, "bytes ", 6) != 0) {
+    return EFI_UNSUPPORTED;
+  }
+  Value += 6;
+  if (AsciiStrDecimalToUintn (Value) != Connection->RangeStart) {
+    return EFI_UNSUPPORTED;
+  }
+  Value = AsciiStrStr (Value, "-");
+  if (Value == NULL ||
+      AsciiStrDecimalToUintn (Value + 1) != Connection->RangeStart + Connection->RangeLength - 1) {
+    return EFI_UNSUPPORTED;
+  }
+
+  return EFI_SUCCESS;
+}
+
+/**
+  Handle the completion of the response token of a connection, and queue what
+  comes next on the connection.
+
+  @param[in, out]  Download        The range download.
+  @param[in, out]  Connection      The connection whose response token is completed.
+
+  @retval EFI_SUCCESS              The completed response is handled.
+  @retval EFI_UNSUPPORTED          The server doesn't send the range requested.
+  @retval Others                   The response failed.
+
+**/
+EFI_STATUS
+HttpBootRangeProcessResponse (
+  IN OUT HTTP_BOOT_RANGE_DOWNLOAD   *Download,
+  IN OUT HTTP_BOOT_RANGE_CONNECTION *Connection
+  )
+{
+  EFI_STATUS                 Status;
+  EFI_HTTP_MESSAGE           *Message;
+
+  gBS->SetTimer (Connection->HttpIo.TimeoutEvent, TimerCancel, 0);
+
+  Message = Connection->HttpIo.RspToken.Message;
+  Status  = Connection->HttpIo.RspToken.Status;
+
+  if (Connection->State == HttpBootRangeRecvHeader) {
+    if (!EFI_ERROR (Status)) {
+      Status = HttpBootRangeCheckResponse (Connection);
+    }
+    if (Message->Headers != NULL) {
+      HttpFreeHeaderFields (Message->Headers, Message->HeaderCount);
+      Message->Headers = NULL;
+    }
+    if (EFI_ERROR (Status)) {
+      return Status;
+    }
+    Connection->State = HttpBootRangeRecvBody;
+  } else {
+    if (EFI_ERROR (Status)) {
+      return Status;
+    }
+    Connection->Received   += Message->BodyLength;
+    Download->ReceivedSize += Message->BodyLength;
+    if (Connection->Received >= Connection->RangeLength) {
+      return HttpBootRangeRequestNext (Download, Connection);
+    }
+  }
+
+  //
+  // Receive the rest of the range at its place in the caller's buffer.
+  //
+  return HttpBootRangeQueueResponse (
+           Connection,
+           FALSE,
+           Download->Buffer + Connection->RangeStart + Connection->Received,
+           Connection->RangeLength - Connection->Received
+           );
+}
+
+/**
+  Sample the throughput of the download, and add one connection while the
+  throughput keeps improving with the connections added.
+
+  @param[in, out]  Download        The range download.
+
+**/
+VOID
+HttpBootRangeAdjustConnections (
+  IN OUT HTTP_BOOT_RANGE_DOWNLOAD *Download
+  )
+{
+  EFI_STATUS                 Status;
+  UINTN                      Rate;
+
+  Rate = Download->ReceivedSize - Download->SampleSize;
+  Download->SampleSize = Download->ReceivedSize;
+
+  if (!Download->Growing) {
+    return;
+  }
+
+  //
+  // Give the latest connection a few samples to ramp up before judging it.
+  //
+  Download->SampleCount++;
+  if (Download->SampleCount < HTTP_BOOT_RANGE_SETTLE_SAMPLES) {
+    return;
+  }
+
+  //
+  // Stop adding connections once one more doesn't improve the throughput
+  // by at least 1/8, or when there is nothing left to give to a new one.
+  //
+  if ((Rate <= Download->LastRate + Download->LastRate / 8) ||
+      (Download->NextOffset >= Download->FileSize)) {
+    Download->Growing = FALSE;
+    return;
+  }
+
+  Status = HttpBootRangeOpenConnection (Download);
+  if (!EFI_ERROR (Status)) {
+    Status = HttpBootRangeRequestNext (Download, &Download->Connection[Download->ConnectionCount - 1]);
+  }
+  if (EFI_ERROR (Status)) {
+    //
+    // Keep going with the connections we have.
+    //
+    Download->Growing = FALSE;
+    return;
+  }
+
+  DEBUG ((EFI_D_INFO, "HttpBootRangeAdjustConnections: %d connections\n", (UINT32) Download->ConnectionCount));
+  Download->LastRate    = Rate;
+  Download->SampleCount = 0;
+}
+
+/**
+  Download the boot file with HTTP range requests over several connections,
+  directly into the caller's buffer.
+
+  The connection count starts at one and grows while the throughput measured
+  with the current count improves, up to PcdHttpBootMaxConnections.
+
+  @param[in]       Private         The pointer to the driver's private data.
+  @param[in, out]  BufferSize      On input the size of Buffer in bytes. On output with a return
+                                   code of EFI_SUCCESS, the amount of data transferred to
+                                   Buffer.
+  @param[out]      Buffer          The memory buffer to transfer the file to.
+  @param[out]      ImageType       The image type of the downloaded file.
+
+  @retval EFI_SUCCESS              The file was loaded.
+  @retval EFI_UNSUPPORTED          The file should be downloaded over a single connection,
+                                   because the range download is disabled, the file is small,
+                                   or the server didn't serve a range as requested.
+  @retval EFI_OUT_OF_RESOURCES     Could not allocate needed resources.
+  @retval Others                   Unexpected error happened.
+
+**/
+EFI_STATUS
+HttpBootGetBootFileByRange (
+  IN     HTTP_BOOT_PRIVATE_DATA   *Private,
+  IN OUT UINTN                    *BufferSize,
+     OUT UINT8                    *Buffer,
+     OUT HTTP_BOOT_IMAGE_TYPE     *ImageType
+  )
+{
+  EFI_STATUS                 Status;
+  HTTP_BOOT_RANGE_DOWNLOAD   *Download;
+  HTTP_BOOT_RANGE_CONNECTION *Connection;
+  UINTN                      UrlSize;
+  CHAR16                     *Url;
+  UINTN                      Index;
+
+  if (PcdGet8 (PcdHttpBootMaxConnections) <= 1 ||
+      !Private->AcceptRanges ||
+      Private->BootFileSize < HTTP_BOOT_RANGE_MIN_FILE_SIZE ||
+      *BufferSize < Private->BootFileSize ||
+      Buffer == NULL) {
+    return EFI_UNSUPPORTED;
+  }
+
+  Download = AllocateZeroPool (sizeof (HTTP_BOOT_RANGE_DOWNLOAD));
+  if (Download == NULL) {
+    return EFI_OUT_OF_RESOURCES;
+  }
+
+  UrlSize = AsciiStrSize (Private->BootFileUri);
+  Url = AllocatePool (UrlSize * sizeof (CHAR16));
+  if (Url == NULL) {
+    FreePool (Download);
+    return EFI_OUT_OF_RESOURCES;
+  }
+  AsciiStrToUnicodeStrS (Private->BootFileUri, Url, UrlSize);
+
+  Download->Private             = Private;
+  Download->RequestData.Method  = HttpMethodGet;
+  Download->RequestData.Url     = Url;
+  Download->Buffer              = Buffer;
+  Download->FileSize            = Private->BootFileSize;
+  Download->MaxConnections      = MIN (PcdGet8 (PcdHttpBootMaxConnections), HTTP_BOOT_RANGE_MAX_CONNECTIONS);
+  Download->Growing             = TRUE;
+
+  Status = gBS->CreateEvent (EVT_TIMER, TPL_CALLBACK, NULL, NULL, &Download->SampleEvent);
+  if (EFI_ERROR (Status)) {
+    goto ON_EXIT;
+  }
+  Status = gBS->SetTimer (Download->SampleEvent, TimerPeriodic, HTTP_BOOT_RANGE_SAMPLE_INTERVAL * TICKS_PER_MS);
+  if (EFI_ERROR (Status)) {
+    goto ON_EXIT;
+  }
+
+  //
+  // Start with one connection, the first range tells whether the server honors range requests.
+  //
+  Status = HttpBootRangeOpenConnection (Download);
+  if (EFI_ERROR (Status)) {
+    goto ON_EXIT;
+  }
+  Status = HttpBootRangeRequestNext (Download, &Download->Connection[0]);
+  if (EFI_ERROR (Status)) {
+    goto ON_EXIT;
+  }
+
+  while (Download->ReceivedSize < Download->FileSize) {
+    for (Index = 0; Index < Download->ConnectionCount; Index++) {
+      Connection = &Download->Connection[Index];
+      if (Connection->State == HttpBootRangeIdle) {
+        continue;
+      }
+
+      Connection->HttpIo.Http->Poll (Connection->HttpIo.Http);
+
+      if (Connection->HttpIo.IsRxDone) {
+        Status = HttpBootRangeProcessResponse (Download, Connection);
+        if (EFI_ERROR (Status)) {
+          goto ON_EXIT;
+        }
+      } else if (!EFI_ERROR (gBS->CheckEvent (Connection->HttpIo.TimeoutEvent))) {
+        Status = EFI_TIMEOUT;
+        goto ON_EXIT;
+      }
+    }
+
+    if (!EFI_ERROR (gBS->CheckEvent (Download->SampleEvent))) {
+      HttpBootRangeAdjustConnections (Download);
+    }
+  }
+
+  Status = EFI_SUCCESS;
+  *BufferSize = Download->FileSize;
+  *ImageType  = Private->ImageType;
+
+ON_EXIT:
+  if (EFI_ERROR (Status)) {
+    DEBUG ((EFI_D_WARN, "HttpBootGetBootFileByRange: %r after %Lu bytes\n", Status, (UINT64) Download->ReceivedSize));
+    if (Download->ReceivedSize == 0) {
+      //
+      // Nothing is downloaded yet, let the caller try the single connection download.
+      //
+      Status = EFI_UNSUPPORTED;
+    }
+  }
+  HttpBootRangeCloseConnections (Download);
+  if (Download->SampleEvent != NULL) {
+    gBS->CloseEvent (Download->SampleEvent);
+  }
+  FreePool (Url);
+  FreePool (Download);
+  return Status;
+}
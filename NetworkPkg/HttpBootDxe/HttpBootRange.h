@@ -0,0 +1,117 @@
+/** @file
+  Declaration of the multi-connection boot file download with HTTP range requests.
+
+Copyright (c) 2017, Intel Corporation. All rights reserved.<BR>
+This program and the accompanying materials are licensed and made available under
+the terms and conditions of the BSD License that accompanies this distribution.
+The full text of the license may be found at
+http://opensource.org/licenses/bsd-license.php.
+
+THE PROGRAM IS DISTRIBUTED UNDER THE BSD LICENSE ON AN "AS IS" BASIS,
+WITHOUT WARRANTIES OR REPRESENTATIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED.
+
+**/
+
+#ifndef __EFI_HTTP_BOOT_RANGE_H__
+#define __EFI_HTTP_BOOT_RANGE_H__
+
+#define HTTP_BOOT_RANGE_MAX_CONNECTIONS      16
+#define HTTP_BOOT_RANGE_MIN_FILE_SIZE        SIZE_8MB   // Smaller files use one connection.
+#define HTTP_BOOT_RANGE_CHUNK_SIZE           SIZE_2MB   // Size of the range of one request.
+#define HTTP_BOOT_RANGE_SAMPLE_INTERVAL      200        // 200 milliseconds between throughput samples.
+#define HTTP_BOOT_RANGE_SETTLE_SAMPLES       2          // Samples taken before a new connection count is judged.
+
+//
+// State of one connection of a range download.
+//
+typedef enum {
+  HttpBootRangeIdle,
+  HttpBootRangeRecvHeader,
+  HttpBootRangeRecvBody
+} HTTP_BOOT_RANGE_STATE;
+
+//
+// One HTTP child of a range download, it downloads one range at a time.
+//
+typedef struct {
+  HTTP_IO                    HttpIo;
+  HTTP_IO_HEADER             *RequestHeader;
+  EFI_HTTP_RESPONSE_DATA     Response;
+  HTTP_BOOT_RANGE_STATE      State;
+  UINTN                      RangeStart;
+  UINTN                      RangeLength;
+  UINTN                      Received;        // Bytes of the range already in the buffer.
+} HTTP_BOOT_RANGE_CONNECTION;
+
+//
+// A boot file download split in ranges over several HTTP children.
+//
+typedef struct {
+  HTTP_BOOT_PRIVATE_DATA     *Private;
+  EFI_HTTP_REQUEST_DATA      RequestData;
+  UINT8                      *Buffer;
+  UINTN                      FileSize;
+  UINTN                      NextOffset;      // Start of the first range not yet requested.
+  UINTN                      ReceivedSize;    // Bytes of the file already in the buffer.
+
+  UINTN                      ConnectionCount;
+  UINTN                      MaxConnections;
+  HTTP_BOOT_RANGE_CONNECTION Connection[HTTP_BOOT_RANGE_MAX_CONNECTIONS];
+
+  //
+  // Throughput sampling, to decide whether one more connection helps.
+  //
+  EFI_EVENT                  SampleEvent;
+  UINTN                      SampleSize;      // ReceivedSize at the previous sample.
+  UINTN                      LastRate;        // Bytes per sample with the current connection count.
+  UINTN                      SampleCount;     // Samples since the connection count changed.
+  BOOLEAN                    Growing;
+} HTTP_BOOT_RANGE_DOWNLOAD;
+
+/**
+  Check whether the server accepts byte range requests for the boot file.
+
+  @param[in]    HeaderCount      Number of HTTP header structures in Headers list.
+  @param[in]    Headers          Array containing list of HTTP headers of the response.
+
+  @retval TRUE                   The server accepts byte range requests.
+  @retval FALSE                  The server does not accept byte range requests.
+
+**/
+BOOLEAN
+HttpBootIsRangeAccepted (
+  IN  UINTN                  HeaderCount,
+  IN  EFI_HTTP_HEADER        *Headers
+  );
+
+/**
+  Download the boot file with HTTP range requests over several connections,
+  directly into the caller's buffer.
+
+  The connection count starts at one and grows while the throughput measured
+  with the current count improves, up to PcdHttpBootMaxConnections.
+
+  @param[in]       Private         The pointer to the driver's private data.
+  @param[in, out]  BufferSize      On input the size of Buffer in bytes. On output with a return
+                                   code of EFI_SUCCESS, the amount of data transferred to
+                                   Buffer.
+  @param[out]      Buffer          The memory buffer to transfer the file to.
+  @param[out]      ImageType       The image type of the downloaded file.
+
+  @retval EFI_SUCCESS              The file was loaded.
+  @retval EFI_UNSUPPORTED          The file should be downloaded over a single connection,
+                                   because the range download is disabled, the file is small,
+                                   or the server didn't serve a range as requested.
+  @retval EFI_OUT_OF_RESOURCES     Could not allocate needed resources.
+  @retval Others                   Unexpected error happened.
+
+**/
+EFI_STATUS
+HttpBootGetBootFileByRange (
+  IN     HTTP_BOOT_PRIVATE_DATA   *Private,
+  IN OUT UINTN                    *BufferSize,
+     OUT UINT8                    *Buffer,
+     OUT HTTP_BOOT_IMAGE_TYPE     *ImageType
+  );
+
+#endif
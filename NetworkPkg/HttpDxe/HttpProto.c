@@ -1081,7 +1081,7 @@ HttpConfigureTcp4 (
   IP4_COPY_ADDRESS (&Tcp4AP->RemoteAddress, &HttpInstance->RemoteAddr);
 
   Tcp4Option = Tcp4CfgData->ControlOption;
-  Tcp4Option->ReceiveBufferSize      = HTTP_BUFFER_SIZE_DEAULT;
+  Tcp4Option->ReceiveBufferSize      = HTTP_RCV_BUFFER_SIZE_DEAULT;
   Tcp4Option->SendBufferSize         = HTTP_BUFFER_SIZE_DEAULT;
   Tcp4Option->MaxSynBackLog          = HTTP_MAX_SYN_BACK_LOG;
   Tcp4Option->ConnectionTimeout      = HTTP_CONNECTION_TIMEOUT;
@@ -1091,9 +1091,19 @@ HttpConfigureTcp4 (
   Tcp4Option->KeepAliveTime          = HTTP_KEEP_ALIVE_TIME;
   Tcp4Option->KeepAliveInterval      = HTTP_KEEP_ALIVE_INTERVAL;
   Tcp4Option->EnableNagle            = TRUE;
+  Tcp4Option->EnableWindowScaling    = TRUE;
+  Tcp4Option->EnableSelectiveAck     = TRUE;
   Tcp4CfgData->ControlOption         = Tcp4Option;
 
   Status = HttpInstance->Tcp4->Configure (HttpInstance->Tcp4, Tcp4CfgData);
+  if (Status == EFI_UNSUPPORTED) {
+    //
+    // The TCP driver doesn't support SACK, configure it again without.
+    //
+    Tcp4Option->EnableSelectiveAck = FALSE;
+    Status = HttpInstance->Tcp4->Configure (HttpInstance->Tcp4, Tcp4CfgData);
+  }
+
   if (EFI_ERROR (Status)) {
     DEBUG ((EFI_D_ERROR, "HttpConfigureTcp4 - %r\n", Status));
     return Status;
@@ -1152,7 +1162,7 @@ HttpConfigureTcp6 (
   IP6_COPY_ADDRESS (&Tcp6Ap->RemoteAddress , &HttpInstance->RemoteIpv6Addr);
 
   Tcp6Option = Tcp6CfgData->ControlOption;
-  Tcp6Option->ReceiveBufferSize  = HTTP_BUFFER_SIZE_DEAULT;
+  Tcp6Option->ReceiveBufferSize  = HTTP_RCV_BUFFER_SIZE_DEAULT;
   Tcp6Option->SendBufferSize     = HTTP_BUFFER_SIZE_DEAULT;
   Tcp6Option->MaxSynBackLog      = HTTP_MAX_SYN_BACK_LOG;
   Tcp6Option->ConnectionTimeout  = HTTP_CONNECTION_TIMEOUT;
@@ -1162,8 +1172,18 @@ HttpConfigureTcp6 (
   Tcp6Option->KeepAliveTime      = HTTP_KEEP_ALIVE_TIME;
   Tcp6Option->KeepAliveInterval  = HTTP_KEEP_ALIVE_INTERVAL;
   Tcp6Option->EnableNagle        = TRUE;
+  Tcp6Option->EnableWindowScaling = TRUE;
+  Tcp6Option->EnableSelectiveAck = TRUE;
 
   Status = HttpInstance->Tcp6->Configure (HttpInstance->Tcp6, Tcp6CfgData);
+  if (Status == EFI_UNSUPPORTED) {
+    //
+    // The TCP driver doesn't support SACK, configure it again without.
+    //
+    Tcp6Option->EnableSelectiveAck = FALSE;
+    Status = HttpInstance->Tcp6->Configure (HttpInstance->Tcp6, Tcp6CfgData);
+  }
+
   if (EFI_ERROR (Status)) {
     DEBUG ((EFI_D_ERROR, "HttpConfigureTcp6 - %r\n", Status));
     return Status;
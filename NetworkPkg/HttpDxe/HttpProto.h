@@ -45,6 +45,7 @@ WITHOUT WARRANTIES OR REPRESENTATIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED.
 #define HTTP_TOS_DEAULT              8
 #define HTTP_TTL_DEAULT              255
 #define HTTP_BUFFER_SIZE_DEAULT      65535
+#define HTTP_RCV_BUFFER_SIZE_DEAULT  0       ///< Let TCP size the receive buffer to the throughput.
 #define HTTP_MAX_SYN_BACK_LOG        5
 #define HTTP_CONNECTION_TIMEOUT      60
 #define HTTP_RESPONSE_TIMEOUT        5
@@ -1,7 +1,7 @@
 /** @file
   Mtftp6 Rrq process functions implementation.
 
-  Copyright (c) 2009 - 2014, Intel Corporation. All rights reserved.<BR>
+  Copyright (c) 2009 - 2017, Intel Corporation. All rights reserved.<BR>
 
   This program and the accompanying materials
   are licensed and made available under the terms and conditions of the BSD License
@@ -59,7 +59,11 @@ Mtftp6RrqSendAck (
   // Reset current retry count of the instance.
   //
   Instance->CurRetry = 0;
+  if (Instance->LastPacket != NULL) {
+    NetbufFree (Instance->LastPacket);
+  }
   Instance->LastPacket = Packet;
+  Instance->WindowCount = 0;
 
   return Mtftp6TransmitPacket (Instance, Packet);
 }
@@ -242,7 +246,35 @@ Mtftp6RrqHandleData (
     NetbufFree (*UdpPacket);
     *UdpPacket = NULL;
 
-    Mtftp6TransmitPacket (Instance, Instance->LastPacket);
+    if (Instance->WindowSize == 1) {
+      Mtftp6TransmitPacket (Instance, Instance->LastPacket);
+      return EFI_SUCCESS;
+    }
+
+    //
+    // A block after the expected one in the same window means that a block
+    // is lost. ACK the last block received in order, once per expected
+    // block, so that the server sends the window again from there.
+    //
+    if ((UINT16) (BlockNum - (UINT16) Expected) < Instance->WindowSize) {
+      if (!Instance->HoleAcked) {
+        Instance->HoleAcked = TRUE;
+        return Mtftp6RrqSendAck (Instance, (UINT16) (Expected - 1));
+      }
+
+      return EFI_SUCCESS;
+    }
+
+    //
+    // Otherwise the server sends an old window again, as the ACK of it may
+    // be lost. Send the last ACK again at the end of that window, unless the
+    // timer already did: with the same timeout on both sides, a second copy
+    // would make the server send each later window twice.
+    //
+    if ((BlockNum == (UINT16) (Expected - 1)) && (Instance->CurRetry == 0)) {
+      Mtftp6TransmitPacket (Instance, Instance->LastPacket);
+    }
+
     return EFI_SUCCESS;
   }
 
@@ -252,11 +284,16 @@ Mtftp6RrqHandleData (
     return Status;
   }
 
+  Instance->HoleAcked = FALSE;
+
   //
   // Reset the passive client's timer whenever it received a valid data packet.
+  // So is the active client's when the server sends a window of blocks per ACK.
   //
   if (!Instance->IsMaster) {
     Instance->PacketToLive = Instance->Timeout * 2;
+  } else if (Instance->WindowSize > 1) {
+    Instance->PacketToLive = Instance->Timeout;
   }
 
   //
@@ -280,6 +317,13 @@ Mtftp6RrqHandleData (
 
     } else {
       BlockNum     = (UINT16) (Expected - 1);
+
+      //
+      // ACK only the last block of each window.
+      //
+      if (++Instance->WindowCount < Instance->WindowSize) {
+        return EFI_SUCCESS;
+      }
     }
     //
     // Free the received packet before send new packet in ReceiveNotify,
@@ -302,6 +346,7 @@ Mtftp6RrqHandleData (
   2. The server can only use smaller blksize than that is requested.
   3. The server can only use the same timeout as requested.
   4. The server doesn't change its multicast channel.
+  5. The server can only use smaller windowsize than that is requested.
 
   @param[in]  Instance              The pointer to the Mtftp6 instance.
   @param[in]  ReplyInfo             The pointer to options information in reply packet.
@@ -335,6 +380,10 @@ Mtftp6RrqOackValid (
     return FALSE;
   }
 
+  if (((ReplyInfo->BitMap & MTFTP6_OPT_WINDOWSIZE_BIT) != 0) && (ReplyInfo->WindowSize > RequestInfo->WindowSize)) {
+    return FALSE;
+  }
+
   //
   // The server can send ",,master" to client to change its master
   // setting. But if it use the specific multicast channel, it can't
@@ -625,6 +674,13 @@ Mtftp6RrqHandleOack (
       Instance->BlkSize = ExtInfo.BlkSize;
     }
 
+    //
+    // The window is only used for unicast download.
+    //
+    if (ExtInfo.WindowSize != 0) {
+      Instance->WindowSize = ExtInfo.WindowSize;
+    }
+
     if (ExtInfo.Timeout != 0) {
       Instance->Timeout = ExtInfo.Timeout;
     }
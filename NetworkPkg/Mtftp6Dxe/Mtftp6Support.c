@@ -1,7 +1,7 @@
 /** @file
   Mtftp6 support functions implementation.
 
-  Copyright (c) 2009 - 2016, Intel Corporation. All rights reserved.<BR>
+  Copyright (c) 2009 - 2017, Intel Corporation. All rights reserved.<BR>
 
   This program and the accompanying materials
   are licensed and made available under the terms and conditions of the BSD License
@@ -980,6 +980,9 @@ Mtftp6OperationClean (
   Instance->McastPort      = 0;
   Instance->BlkSize        = 0;
   Instance->LastBlk        = 0;
+  Instance->WindowSize     = 0;
+  Instance->WindowCount    = 0;
+  Instance->HoleAcked      = FALSE;
   Instance->PacketToLive   = 0;
   Instance->MaxRetry       = 0;
   Instance->CurRetry       = 0;
@@ -1066,6 +1069,15 @@ Mtftp6OperationStart (
     if (EFI_ERROR (Status)) {
       goto ON_ERROR;
     }
+
+    //
+    // The windowsize option is only supported for downloads.
+    //
+    if ((OpCode == EFI_MTFTP6_OPCODE_WRQ) &&
+        ((Instance->ExtInfo.BitMap & MTFTP6_OPT_WINDOWSIZE_BIT) != 0)) {
+      Status = EFI_UNSUPPORTED;
+      goto ON_ERROR;
+    }
   }
 
   //
@@ -1105,6 +1117,9 @@ Mtftp6OperationStart (
   if (Instance->BlkSize == 0) {
     Instance->BlkSize = MTFTP6_DEFAULT_BLK_SIZE;
   }
+  if (Instance->WindowSize == 0) {
+    Instance->WindowSize = MTFTP6_DEFAULT_WINDOW_SIZE;
+  }
   if (Instance->MaxRetry == 0) {
     Instance->MaxRetry = MTFTP6_DEFAULT_MAX_RETRY;
   }
@@ -1227,7 +1242,15 @@ Mtftp6OnTimerTick (
     // otherwise exit the transfer.
     //
     if (Instance->CurRetry < Instance->MaxRetry) {
-      Mtftp6TransmitPacket (Instance, Instance->LastPacket);
+      if (Instance->WindowCount != 0) {
+        //
+        // The end of the window is lost. ACK the blocks received since the
+        // last ACK rather than sending that ACK again.
+        //
+        Mtftp6RrqSendAck (Instance, (UINT16) (Mtftp6GetNextBlockNum (&Instance->BlkList) - 1));
+      } else {
+        Mtftp6TransmitPacket (Instance, Instance->LastPacket);
+      }
     } else {
       Mtftp6OperationClean (Instance, EFI_TIMEOUT);
       continue;
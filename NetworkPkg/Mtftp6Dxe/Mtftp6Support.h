@@ -1,7 +1,7 @@
 /** @file
   Mtftp6 support functions declaration.
 
-  Copyright (c) 2009 - 2010, Intel Corporation. All rights reserved.<BR>
+  Copyright (c) 2009 - 2017, Intel Corporation. All rights reserved.<BR>
 
   This program and the accompanying materials
   are licensed and made available under the terms and conditions of the BSD License
@@ -356,4 +356,22 @@ Mtftp6RrqStart (
   IN UINT16                 Operation
   );
 
+
+/**
+  Build and send a ACK packet for download.
+
+  @param[in]  Instance              The pointer to the Mtftp6 instance.
+  @param[in]  BlockNum              The block number to be acked.
+
+  @retval EFI_OUT_OF_RESOURCES  Failed to allocate memory for the packet.
+  @retval EFI_SUCCESS           The ACK has been sent.
+  @retval Others                Failed to send the ACK.
+
+**/
+EFI_STATUS
+Mtftp6RrqSendAck (
+  IN MTFTP6_INSTANCE        *Instance,
+  IN UINT16                 BlockNum
+  );
+
 #endif
@@ -1,7 +1,7 @@
 /** @file
   Common head file for TCP socket.
 
-  Copyright (c) 2009 - 2016, Intel Corporation. All rights reserved.<BR>
+  Copyright (c) 2009 - 2017, Intel Corporation. All rights reserved.<BR>
 
   This program and the accompanying materials
   are licensed and made available under the terms and conditions of the BSD License
@@ -34,8 +34,8 @@
 #define SOCK_RCV_BUF        1
 
 #define SOCK_BUFF_LOW_WATER (2 * 1024)
-#define SOCK_RCV_BUFF_SIZE  (8 * 1024)
-#define SOCK_SND_BUFF_SIZE  (8 * 1024)
+#define SOCK_RCV_BUFF_SIZE  (64 * 1024)  ///< Initial size of an autotuned receive buffer
+#define SOCK_SND_BUFF_SIZE  (64 * 1024)
 #define SOCK_BACKLOG        5
 
 #define PROTO_RESERVED_LEN  20
@@ -2,7 +2,7 @@
   The implementation of a dispatch routine for processing TCP requests.
 
   (C) Copyright 2014 Hewlett-Packard Development Company, L.P.<BR>
-  Copyright (c) 2009 - 2014, Intel Corporation. All rights reserved.<BR>
+  Copyright (c) 2009 - 2017, Intel Corporation. All rights reserved.<BR>
 
   This program and the accompanying materials
   are licensed and made available under the terms and conditions of the BSD License
@@ -126,7 +126,7 @@ Tcp4GetMode (
       Option->EnableTimeStamp        = (BOOLEAN) (!TCP_FLG_ON (Tcb->CtrlFlag, TCP_CTRL_NO_TS));
       Option->EnableWindowScaling    = (BOOLEAN) (!TCP_FLG_ON (Tcb->CtrlFlag, TCP_CTRL_NO_WS));
 
-      Option->EnableSelectiveAck     = FALSE;
+      Option->EnableSelectiveAck     = (BOOLEAN) (!TCP_FLG_ON (Tcb->CtrlFlag, TCP_CTRL_NO_SACK));
       Option->EnablePathMtuDiscovery = FALSE;
     }
   }
@@ -204,7 +204,7 @@ Tcp6GetMode (
       Option->EnableTimeStamp        = (BOOLEAN) (!TCP_FLG_ON (Tcb->CtrlFlag, TCP_CTRL_NO_TS));
       Option->EnableWindowScaling    = (BOOLEAN) (!TCP_FLG_ON (Tcb->CtrlFlag, TCP_CTRL_NO_WS));
 
-      Option->EnableSelectiveAck     = FALSE;
+      Option->EnableSelectiveAck     = (BOOLEAN) (!TCP_FLG_ON (Tcb->CtrlFlag, TCP_CTRL_NO_SACK));
       Option->EnablePathMtuDiscovery = FALSE;
     }
   }
@@ -632,7 +632,18 @@ TcpConfigurePcb (
     Option              = (EFI_TCP4_OPTION *) CfgData->Tcp6CfgData.ControlOption;
   }
 
-  if (Option != NULL) {
+  if ((Option == NULL) || (Option->ReceiveBufferSize == 0)) {
+    //
+    // The receive buffer is left to TCP, start with a small
+    // one and let it grow with the throughput of the connection.
+    // A ReceiveBufferSize of 0 no longer selects a fixed buffer of
+    // TCP_RCV_BUF_SIZE (2MB): the buffer starts at SOCK_RCV_BUFF_SIZE
+    // (64KB) and only reaches TCP_RCV_BUF_SIZE if the path needs it.
+    // A caller that wants a fixed buffer gives its size.
+    //
+    SET_RCV_BUFFSIZE (Sk, SOCK_RCV_BUFF_SIZE);
+    TCP_SET_FLG (Tcb->CtrlFlag, TCP_CTRL_RCV_AUTOTUNE);
+  } else {
     SET_RCV_BUFFSIZE (
       Sk,
       (UINT32) (TCP_COMP_VAL (
@@ -643,6 +654,10 @@ TcpConfigurePcb (
                   )
                )
       );
+    TCP_CLEAR_FLG (Tcb->CtrlFlag, TCP_CTRL_RCV_AUTOTUNE);
+  }
+
+  if (Option != NULL) {
     SET_SND_BUFFSIZE (
       Sk,
       (UINT32) (TCP_COMP_VAL (
@@ -730,6 +745,10 @@ TcpConfigurePcb (
     if (!Option->EnableWindowScaling) {
       TCP_SET_FLG (Tcb->CtrlFlag, TCP_CTRL_NO_WS);
     }
+
+    if (!Option->EnableSelectiveAck) {
+      TCP_SET_FLG (Tcb->CtrlFlag, TCP_CTRL_NO_SACK);
+    }
   }
 
   //
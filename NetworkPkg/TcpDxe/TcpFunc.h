@@ -1,7 +1,7 @@
 /** @file
   Declaration of external functions shared in TCP driver.
 
-  Copyright (c) 2009 - 2014, Intel Corporation. All rights reserved.<BR>
+  Copyright (c) 2009 - 2017, Intel Corporation. All rights reserved.<BR>
 
   This program and the accompanying materials
   are licensed and made available under the terms and conditions of the BSD License
@@ -366,6 +366,22 @@ TcpRetransmit (
   IN TCP_SEQNO Seq
   );
 
+/**
+  Retransmit the next hole reported by the peer with SACK during fast
+  recovery.
+
+  @param[in, out]  Tcb     Pointer to the TCP_CB of this TCP instance.
+
+  @retval 1       A hole was retransmitted.
+  @retval 0       No hole is left to retransmit.
+  @retval -1      Error condition occurred.
+
+**/
+INTN
+TcpSackRetransmit (
+  IN OUT TCP_CB *Tcb
+  );
+
 /**
   Check whether to send data/SYN/FIN and piggyback an ACK.
 
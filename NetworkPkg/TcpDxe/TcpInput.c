@@ -1,7 +1,7 @@
 /** @file
   TCP input process routines.
 
-  Copyright (c) 2009 - 2016, Intel Corporation. All rights reserved.<BR>
+  Copyright (c) 2009 - 2017, Intel Corporation. All rights reserved.<BR>
 
   This program and the accompanying materials
   are licensed and made available under the terms and conditions of the BSD License
@@ -71,7 +71,8 @@ TcpFastRecover (
     // Step 2: Entering fast retransmission
     //
     TcpRetransmit (Tcb, Tcb->SndUna);
-    Tcb->CWnd = Tcb->Ssthresh + 3 * Tcb->SndMss;
+    Tcb->CWnd       = Tcb->Ssthresh + 3 * Tcb->SndMss;
+    Tcb->SackRexmit = Tcb->SndUna;
 
     DEBUG (
       (EFI_D_NET,
@@ -90,12 +91,18 @@ TcpFastRecover (
     //
     // Step 3: Fast Recovery,
     // If this is a duplicated ACK, increse Cwnd by SMSS.
+    // With SACK, a duplicated ACK that makes a hole
+    // retransmitted instead doesn't inflate the Cwnd, the
+    // retransmission takes the place of the segment which
+    // has left the network.
     //
 
     // Step 4 is skipped here only to be executed later
     // by TcpToSendData
     //
-    Tcb->CWnd += Tcb->SndMss;
+    if (!TCP_FLG_ON (Tcb->CtrlFlag, TCP_CTRL_RCVD_SACK) || (TcpSackRetransmit (Tcb) <= 0)) {
+      Tcb->CWnd += Tcb->SndMss;
+    }
     DEBUG (
       (EFI_D_NET,
       "TcpFastRecover: received another duplicated ACK (%d) for TCB %p\n",
@@ -137,6 +144,10 @@ TcpFastRecover (
       TcpRetransmit (Tcb, Seg->Ack);
       Acked = TCP_SUB_SEQ (Seg->Ack, Tcb->SndUna);
 
+      if (TCP_SEQ_LT (Tcb->SackRexmit, Seg->Ack)) {
+        Tcb->SackRexmit = Seg->Ack;
+      }
+
       //
       // Deflate the CWnd by the amount of new data
       // ACKed by SEG.ACK. If more than one SMSS data
@@ -581,6 +592,14 @@ TcpQueueData (
   Seg   = TCPSEG_NETBUF (Nbuf);
   Head  = &Tcb->RcvQue;
 
+  //
+  // Remember the latest out-of-order segment, its
+  // block is the first one in the SACK option.
+  //
+  if (TCP_SEQ_GT (Seg->Seq, Tcb->RcvNxt)) {
+    Tcb->SackLatest = Seg->Seq;
+  }
+
   //
   // Fast path to process normal case. That is,
   // no out-of-order segments are received.
@@ -706,6 +725,102 @@ TcpAdjustSndQue (
   }
 }
 
+/**
+  Mark the segments on the SndQue that the peer has selectively acknowledged.
+  The blocks outside of the data in flight, such as D-SACK blocks, are ignored.
+
+  @param[in]  Tcb      Pointer to the TCP_CB of this TCP instance.
+  @param[in]  Option   Pointer to the options of the received segment.
+
+**/
+VOID
+TcpMarkSacked (
+  IN TCP_CB     *Tcb,
+  IN TCP_OPTION *Option
+  )
+{
+  LIST_ENTRY      *Entry;
+  TCP_SEG         *Seg;
+  TCP_SEQNO       Left;
+  TCP_SEQNO       Right;
+  UINT8           Index;
+
+  for (Index = 0; Index < Option->SackCount; Index++) {
+    Left  = Option->Sack[Index].Left;
+    Right = Option->Sack[Index].Right;
+
+    if (TCP_SEQ_GEQ (Left, Right) ||
+        TCP_SEQ_LEQ (Left, Tcb->SndUna) ||
+        TCP_SEQ_GT (Right, Tcb->SndNxt)
+        ) {
+      continue;
+    }
+
+    NET_LIST_FOR_EACH (Entry, &Tcb->SndQue) {
+      Seg = TCPSEG_NETBUF (NET_LIST_USER_STRUCT (Entry, NET_BUF, List));
+
+      if (TCP_SEQ_GEQ (Seg->Seq, Right)) {
+        break;
+      }
+
+      if (TCP_SEQ_LEQ (Left, Seg->Seq) && TCP_SEQ_LEQ (Seg->End, Right)) {
+        Seg->Sacked = TRUE;
+      }
+    }
+  }
+}
+
+/**
+  Grow the receive buffer when the peer is limited by the receive window
+  while the application keeps up with the data. The buffer is doubled at most
+  once for each buffer of data received, that is, once a round trip as long as
+  the peer fills the window, so the window follows the bandwidth-delay product
+  of the path up to TCP_RCV_BUF_SIZE.
+
+  @param[in, out]  Tcb      Pointer to the TCP_CB of this TCP instance.
+  @param[in]       Seg      Pointer to the received segment with data.
+
+**/
+VOID
+TcpRcvAutotune (
+  IN OUT TCP_CB  *Tcb,
+  IN     TCP_SEG *Seg
+  )
+{
+  SOCKET  *Sk;
+  UINT32  BufSize;
+  UINT32  MaxSize;
+
+  Sk      = Tcb->Sk;
+  BufSize = GET_RCV_BUFFSIZE (Sk);
+  MaxSize = MIN (TCP_RCV_BUF_SIZE, TCP_MAX_WIN << Tcb->RcvWndScale);
+
+  if (!TCP_FLG_ON (Tcb->CtrlFlag, TCP_CTRL_RCV_AUTOTUNE) || (BufSize >= MaxSize)) {
+    return;
+  }
+
+  //
+  // The peer is limited by the window if the segment
+  // leaves less than a segment of the advertised window.
+  //
+  if (TCP_SEQ_LT (Seg->End + Tcb->RcvMss, Tcb->RcvWl2 + Tcb->RcvWnd) ||
+      (TCP_SUB_SEQ (Tcb->RcvNxt, Tcb->RcvAutoSeq) < BufSize) ||
+      (GET_RCV_DATASIZE (Sk) >= BufSize / 2)
+      ) {
+    return;
+  }
+
+  SET_RCV_BUFFSIZE (Sk, MIN (BufSize * 2, MaxSize));
+  Tcb->RcvAutoSeq = Tcb->RcvNxt;
+
+  DEBUG (
+    (EFI_D_NET,
+    "TcpRcvAutotune: grow the receive buffer to %d for TCB %p\n",
+    GET_RCV_BUFFSIZE (Sk),
+    Tcb)
+    );
+}
+
 /**
   Process the received TCP segments.
 
@@ -1202,6 +1317,13 @@ TcpInput (
     TCP_CLEAR_FLG (Tcb->CtrlFlag, TCP_CTRL_RTT_ON);
   }
 
+  if (TCP_FLG_ON (Option.Flag, TCP_OPTION_RCVD_SACK) &&
+      TCP_FLG_ON (Tcb->CtrlFlag, TCP_CTRL_RCVD_SACK))
+  {
+
+    TcpMarkSacked (Tcb, &Option);
+  }
+
   if (Seg->Ack == Tcb->SndNxt) {
 
     TcpClearTimer (Tcb, TCP_TIMER_REXMIT);
@@ -1470,6 +1592,7 @@ StepSix:
       goto RESET_THEN_DROP;
     }
 
+    TcpRcvAutotune (Tcb, Seg);
     TcpQueueData (Tcb, Nbuf);
     if (TcpDeliverData (Tcb) == -1) {
       goto RESET_THEN_DROP;
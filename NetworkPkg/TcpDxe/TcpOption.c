@@ -1,7 +1,7 @@
 /** @file
   Routines to process TCP option.
 
-  Copyright (c) 2009 - 2010, Intel Corporation. All rights reserved.<BR>
+  Copyright (c) 2009 - 2017, Intel Corporation. All rights reserved.<BR>
 
   This program and the accompanying materials
   are licensed and made available under the terms and conditions of the BSD License
@@ -86,7 +86,15 @@ TcpComputeScale (
 
   ASSERT ((Tcb != NULL) && (Tcb->Sk != NULL));
 
-  BufSize = GET_RCV_BUFFSIZE (Tcb->Sk);
+  //
+  // An autotuned receive buffer may grow to TCP_RCV_BUF_SIZE later,
+  // the scale is fixed in the handshake so it must cover that size.
+  //
+  if (TCP_FLG_ON (Tcb->CtrlFlag, TCP_CTRL_RCV_AUTOTUNE)) {
+    BufSize = TCP_RCV_BUF_SIZE;
+  } else {
+    BufSize = GET_RCV_BUFFSIZE (Tcb->Sk);
+  }
 
   Scale   = 0;
   while ((Scale < TCP_OPTION_MAX_WS) && ((UINT32) (TCP_OPTION_MAX_WIN << Scale) < BufSize)) {
@@ -165,6 +173,27 @@ TcpSynBuildOption (
     TcpPutUint32 (Data, TCP_OPTION_WS_FAST | TcpComputeScale (Tcb));
   }
 
+  //
+  // Build SACK permitted option, under the same
+  // rule as the window scale option.
+  //
+  if (!TCP_FLG_ON (Tcb->CtrlFlag, TCP_CTRL_NO_SACK) &&
+      (!TCP_FLG_ON (TCPSEG_NETBUF (Nbuf)->Flag, TCP_FLG_ACK) ||
+        TCP_FLG_ON (Tcb->CtrlFlag, TCP_CTRL_RCVD_SACK))
+      ) {
+
+    Data = NetbufAllocSpace (
+             Nbuf,
+             TCP_OPTION_SACK_PERM_ALIGNED_LEN,
+             NET_BUF_HEAD
+             );
+
+    ASSERT (Data != NULL);
+
+    Len += TCP_OPTION_SACK_PERM_ALIGNED_LEN;
+    TcpPutUint32 (Data, TCP_OPTION_SACK_PERM_FAST);
+  }
+
   //
   // Build the MSS option.
   //
@@ -177,6 +206,115 @@ TcpSynBuildOption (
   return Len;
 }
 
+/**
+  Build the SACK option from the out-of-order segments in the reassemble queue.
+  The block that contains the latest segment received is reported first as
+  RFC2018 requires, the others follow in sequence order as long as they fit.
+
+  @param[in]  Tcb     Pointer to the TCP_CB of this TCP instance.
+  @param[in]  Nbuf    Pointer to the buffer to store the options.
+  @param[in]  OptLen  The length of the options already built in Nbuf.
+
+  @return             The length of the SACK option, 0 if no option is built.
+
+**/
+UINT16
+TcpBuildSackOption (
+  IN TCP_CB  *Tcb,
+  IN NET_BUF *Nbuf,
+  IN UINT16  OptLen
+  )
+{
+  TCP_SACK_BLOCK  Block[TCP_OPTION_MAX_SACK_BLOCK + 1];
+  LIST_ENTRY      *Entry;
+  TCP_SEG         *Seg;
+  TCP_SEQNO       Left;
+  TCP_SEQNO       Right;
+  BOOLEAN         Latest;
+  UINT8           MaxCount;
+  UINT8           Count;
+  UINT8           Index;
+  UINT8           *Data;
+
+  ASSERT (OptLen + TCP_OPTION_SACK_ALIGNED_LEN + TCP_OPTION_SACK_BLOCK_LEN <= TCP_OPTION_MAX_LEN);
+
+  MaxCount = (UINT8) MIN (
+                       (TCP_OPTION_MAX_LEN - OptLen - TCP_OPTION_SACK_ALIGNED_LEN) / TCP_OPTION_SACK_BLOCK_LEN,
+                       TCP_OPTION_MAX_SACK_BLOCK
+                       );
+
+  //
+  // Block[0] is reserved for the block of the latest segment,
+  // the others are collected after it.
+  //
+  Latest = FALSE;
+  Count  = 1;
+  Entry  = Tcb->RcvQue.ForwardLink;
+
+  while (Entry != &Tcb->RcvQue) {
+    Seg   = TCPSEG_NETBUF (NET_LIST_USER_STRUCT (Entry, NET_BUF, List));
+    Left  = Seg->Seq;
+    Right = Seg->End;
+
+    //
+    // Merge the contiguous segments into one block.
+    //
+    for (Entry = Entry->ForwardLink; Entry != &Tcb->RcvQue; Entry = Entry->ForwardLink) {
+      Seg = TCPSEG_NETBUF (NET_LIST_USER_STRUCT (Entry, NET_BUF, List));
+
+      if (Seg->Seq != Right) {
+        break;
+      }
+
+      Right = Seg->End;
+    }
+
+    if (TCP_SEQ_LEQ (Left, Tcb->RcvNxt)) {
+      continue;
+    }
+
+    if (!Latest && TCP_SEQ_LEQ (Left, Tcb->SackLatest) && TCP_SEQ_LT (Tcb->SackLatest, Right)) {
+
+      Block[0].Left  = Left;
+      Block[0].Right = Right;
+      Latest         = TRUE;
+    } else if (Count <= MaxCount) {
+
+      Block[Count].Left  = Left;
+      Block[Count].Right = Right;
+      Count++;
+    }
+  }
+
+  if (!Latest) {
+    Count--;
+    CopyMem (&Block[0], &Block[1], Count * sizeof (TCP_SACK_BLOCK));
+  } else {
+    Count = MIN (Count, MaxCount);
+  }
+
+  if (Count == 0) {
+    return 0;
+  }
+
+  Data = NetbufAllocSpace (
+           Nbuf,
+           TCP_OPTION_SACK_ALIGNED_LEN + Count * TCP_OPTION_SACK_BLOCK_LEN,
+           NET_BUF_HEAD
+           );
+
+  ASSERT (Data != NULL);
+
+  TcpPutUint32 (Data, TCP_OPTION_SACK_FAST | (2 + Count * TCP_OPTION_SACK_BLOCK_LEN));
+
+  for (Index = 0; Index < Count; Index++) {
+    TcpPutUint32 (Data + 4 + Index * TCP_OPTION_SACK_BLOCK_LEN, Block[Index].Left);
+    TcpPutUint32 (Data + 8 + Index * TCP_OPTION_SACK_BLOCK_LEN, Block[Index].Right);
+  }
+
+  return (UINT16) (TCP_OPTION_SACK_ALIGNED_LEN + Count * TCP_OPTION_SACK_BLOCK_LEN);
+}
+
 /**
   Build the TCP option in synchronized states.
 
@@ -194,9 +332,11 @@ TcpBuildOption (
 {
   UINT8   *Data;
   UINT16  Len;
+  UINT32  DataLen;
 
   ASSERT ((Tcb != NULL) && (Nbuf != NULL) && (Nbuf->Tcp == NULL));
-  Len = 0;
+  Len     = 0;
+  DataLen = Nbuf->TotalSize;
 
   //
   // Build the Timestamp option.
@@ -219,6 +359,21 @@ TcpBuildOption (
     TcpPutUint32 (Data + 8, Tcb->TsRecent);
   }
 
+  //
+  // Build the SACK option to report the out-of-order data
+  // in the reassemble queue. It is only added to segments
+  // without data, so it never makes a full sized segment
+  // exceed the MSS.
+  //
+  if (TCP_FLG_ON (Tcb->CtrlFlag, TCP_CTRL_RCVD_SACK) &&
+      !TCP_FLG_ON (TCPSEG_NETBUF (Nbuf)->Flag, TCP_FLG_RST) &&
+      (DataLen == 0) &&
+      !IsListEmpty (&Tcb->RcvQue)
+      ) {
+
+    Len = (UINT16) (Len + TcpBuildSackOption (Tcb, Nbuf, Len));
+  }
+
   return Len;
 }
 
@@ -244,6 +399,7 @@ TcpParseOption (
   UINT8 Cur;
   UINT8 Type;
   UINT8 Len;
+  UINT8 Index;
 
   ASSERT ((Tcp != NULL) && (Option != NULL));
 
@@ -319,6 +475,42 @@ TcpParseOption (
       Cur += TCP_OPTION_TS_LEN;
       break;
 
+    case TCP_OPTION_SACK_PERM:
+      Len = Head[Cur + 1];
+
+      if ((Len != TCP_OPTION_SACK_PERM_LEN) || (TotalLen - Cur < TCP_OPTION_SACK_PERM_LEN)) {
+
+        return -1;
+      }
+
+      TCP_SET_FLG (Option->Flag, TCP_OPTION_RCVD_SACK_PERM);
+
+      Cur += TCP_OPTION_SACK_PERM_LEN;
+      break;
+
+    case TCP_OPTION_SACK:
+      Len = Head[Cur + 1];
+
+      if ((Len < 2 + TCP_OPTION_SACK_BLOCK_LEN) ||
+          ((Len - 2) % TCP_OPTION_SACK_BLOCK_LEN != 0) ||
+          (TotalLen - Cur < Len)
+          ) {
+
+        return -1;
+      }
+
+      Option->SackCount = (UINT8) MIN ((Len - 2) / TCP_OPTION_SACK_BLOCK_LEN, TCP_OPTION_MAX_SACK_BLOCK);
+
+      for (Index = 0; Index < Option->SackCount; Index++) {
+        Option->Sack[Index].Left  = TcpGetUint32 (&Head[Cur + 2 + Index * TCP_OPTION_SACK_BLOCK_LEN]);
+        Option->Sack[Index].Right = TcpGetUint32 (&Head[Cur + 6 + Index * TCP_OPTION_SACK_BLOCK_LEN]);
+      }
+
+      TCP_SET_FLG (Option->Flag, TCP_OPTION_RCVD_SACK);
+
+      Cur = (UINT8) (Cur + Len);
+      break;
+
     case TCP_OPTION_NOP:
       Cur++;
       break;
@@ -1,7 +1,7 @@
 /** @file
   TCP output process routines.
 
-  Copyright (c) 2009 - 2016, Intel Corporation. All rights reserved.<BR>
+  Copyright (c) 2009 - 2017, Intel Corporation. All rights reserved.<BR>
 
   This program and the accompanying materials
   are licensed and made available under the terms and conditions of the BSD License
@@ -708,6 +708,70 @@ OnError:
   return -1;
 }
 
+/**
+  Retransmit the next hole reported by the peer with SACK during fast
+  recovery. A hole is a segment on the SndQue that isn't selectively
+  acknowledged while a later one is, and that isn't retransmitted yet
+  in this fast recovery.
+
+  @param[in, out]  Tcb     Pointer to the TCP_CB of this TCP instance.
+
+  @retval 1       A hole was retransmitted.
+  @retval 0       No hole is left to retransmit.
+  @retval -1      Error condition occurred.
+
+**/
+INTN
+TcpSackRetransmit (
+  IN OUT TCP_CB *Tcb
+  )
+{
+  LIST_ENTRY  *Entry;
+  TCP_SEG     *Seg;
+  TCP_SEG     *Hole;
+
+  Hole = NULL;
+
+  NET_LIST_FOR_EACH (Entry, &Tcb->SndQue) {
+    Seg = TCPSEG_NETBUF (NET_LIST_USER_STRUCT (Entry, NET_BUF, List));
+
+    if (Seg->Sacked) {
+      if (Hole != NULL) {
+        break;
+      }
+
+      continue;
+    }
+
+    if ((Hole == NULL) && TCP_SEQ_GT (Seg->Seq, Tcb->SackRexmit)) {
+      Hole = Seg;
+    }
+  }
+
+  //
+  // No segment above the hole is SACKed, it may
+  // still be in flight.
+  //
+  if ((Hole == NULL) || (Entry == &Tcb->SndQue)) {
+    return 0;
+  }
+
+  DEBUG (
+    (EFI_D_NET,
+    "TcpSackRetransmit: retransmit the hole at %d for TCB %p\n",
+    Hole->Seq,
+    Tcb)
+    );
+
+  Tcb->SackRexmit = Hole->Seq;
+
+  if (TcpRetransmit (Tcb, Hole->Seq) != 0) {
+    return -1;
+  }
+
+  return 1;
+}
+
 /**
   Verify that all the segments in SndQue are in good shape.
 
@@ -1,7 +1,7 @@
 /** @file
   TCP protocol header file.
 
-  Copyright (c) 2009 - 2012, Intel Corporation. All rights reserved.<BR>
+  Copyright (c) 2009 - 2017, Intel Corporation. All rights reserved.<BR>
 
   This program and the accompanying materials
   are licensed and made available under the terms and conditions of the BSD License
@@ -78,6 +78,9 @@
 #define TCP_CTRL_TIMER_ON        0x1000 ///< At least one of the timer is on.
 #define TCP_CTRL_RTT_ON          0x2000 ///< The RTT measurement is on.
 #define TCP_CTRL_ACK_NOW         0x4000 ///< Send the ACK now, don't delay.
+#define TCP_CTRL_NO_SACK         0x8000 ///< Disable SACK option.
+#define TCP_CTRL_RCVD_SACK       0x10000 ///< Received a SACK permitted option in syn.
+#define TCP_CTRL_RCV_AUTOTUNE    0x20000 ///< The receive buffer grows with the throughput.
 
 //
 // Timer related values
@@ -117,7 +120,7 @@
 //
 // Value ranges for some control option
 //
-#define TCP_RCV_BUF_SIZE         (2 * 1024 * 1024)
+#define TCP_RCV_BUF_SIZE         (2 * 1024 * 1024)  ///< Also the limit of an autotuned receive buffer
 #define TCP_RCV_BUF_SIZE_MIN     (8 * 1024)
 #define TCP_SND_BUF_SIZE         (2 * 1024 * 1024)
 #define TCP_SND_BUF_SIZE_MIN     (8 * 1024)
@@ -221,6 +224,7 @@ typedef struct _TCP_SEG {
   TCP_SEQNO End;  ///< The sequence of the last byte + 1, include SYN/FIN. End-Seq = SEG.LEN.
   TCP_SEQNO Ack;  ///< ACK field in the segment.
   UINT8     Flag; ///< TCP header flags.
+  BOOLEAN   Sacked; ///< The segment on SndQue is selectively acknowledged by the peer.
   UINT16    Urg;  ///< Valid if URG flag is set.
   UINT32    Wnd;  ///< TCP window size field.
 } TCP_SEG;
@@ -315,6 +319,17 @@ struct _TCP_CONTROL_BLOCK {
   UINT8             LossTimes;    ///< Number of retxmit timeouts in a row.
   TCP_SEQNO         LossRecover;  ///< Recover point for retxmit.
 
+  //
+  // RFC2018 selective acknowledgment.
+  //
+  TCP_SEQNO         SackRexmit;   ///< The last hole retransmitted in fast recovery.
+  TCP_SEQNO         SackLatest;   ///< Seq of the latest out-of-order segment received.
+
+  //
+  // Receive buffer autotuning.
+  //
+  TCP_SEQNO         RcvAutoSeq;   ///< RcvNxt when the receive buffer was last grown.
+
   //
   // configuration parameters, for EFI_TCP4_PROTOCOL specification
   //
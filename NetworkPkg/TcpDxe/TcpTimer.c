@@ -1,7 +1,7 @@
 /** @file
   TCP timer related functions.
 
-  Copyright (c) 2009 - 2010, Intel Corporation. All rights reserved.<BR>
+  Copyright (c) 2009 - 2017, Intel Corporation. All rights reserved.<BR>
 
   This program and the accompanying materials
   are licensed and made available under the terms and conditions of the BSD License
@@ -190,7 +190,8 @@ TcpRexmitTimeout (
   IN OUT TCP_CB *Tcb
   )
 {
-  UINT32  FlightSize;
+  UINT32      FlightSize;
+  LIST_ENTRY  *Entry;
 
   DEBUG (
     (EFI_D_WARN,
@@ -198,6 +199,15 @@ TcpRexmitTimeout (
     Tcb)
     );
 
+  //
+  // The peer may have discarded the data it selectively
+  // acknowledged, forget the SACK information as RFC2018
+  // requires after a retransmission timeout.
+  //
+  NET_LIST_FOR_EACH (Entry, &Tcb->SndQue) {
+    TCPSEG_NETBUF (NET_LIST_USER_STRUCT (Entry, NET_BUF, List))->Sacked = FALSE;
+  }
+
   //
   // Set the congestion window. FlightSize is the
   // amount of data that has been sent but not
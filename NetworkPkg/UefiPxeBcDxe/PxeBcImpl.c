@@ -1,7 +1,7 @@
 /** @file
   This implementation of EFI_PXE_BASE_CODE_PROTOCOL and EFI_LOAD_FILE_PROTOCOL.
 
-  Copyright (c) 2007 - 2016, Intel Corporation. All rights reserved.<BR>
+  Copyright (c) 2007 - 2017, Intel Corporation. All rights reserved.<BR>
 
   This program and the accompanying materials
   are licensed and made available under the terms and conditions of the BSD License
@@ -225,6 +225,12 @@ EfiPxeBcStart (
     Private->BlockSize   = (UINTN) PcdGet64 (PcdTftpBlockSize);
   }
 
+  //
+  // Get the TFTP window size to request for downloads, 0 disables the option.
+  // RFC 7440 allows at most 65535 blocks per window.
+  //
+  Private->WindowSize = (UINTN) MIN (PcdGet64 (PcdTftpWindowSize), MAX_UINT16);
+
   //
   // Create event for UdpRead/UdpWrite timeout since they are both blocking API.
   //
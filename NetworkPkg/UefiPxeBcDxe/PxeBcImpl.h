@@ -2,7 +2,7 @@
   This EFI_PXE_BASE_CODE_PROTOCOL and EFI_LOAD_FILE_PROTOCOL.
   interfaces declaration.
 
-  Copyright (c) 2007 - 2016, Intel Corporation. All rights reserved.<BR>
+  Copyright (c) 2007 - 2017, Intel Corporation. All rights reserved.<BR>
 
   This program and the accompanying materials
   are licensed and made available under the terms and conditions of the BSD License
@@ -180,6 +180,7 @@ struct _PXEBC_PRIVATE_DATA {
   UINT8                                     *BootFileName;
   UINTN                                     BootFileSize;
   UINTN                                     BlockSize;
+  UINTN                                     WindowSize;
 
   PXEBC_DHCP_PACKET_CACHE                   ProxyOffer;
   PXEBC_DHCP_PACKET_CACHE                   DhcpAck;
@@ -3,7 +3,7 @@
   Generic type and macro definitions corresponding to the virtio-0.9.5
   specification.
 
-  Copyright (C) 2012-2016, Red Hat, Inc.
+  Copyright (C) 2012-2017, Red Hat, Inc.
   Portion of Copyright (C) 2013, ARM Ltd.
 
   This program and the accompanying materials are licensed and made available
@@ -136,7 +136,7 @@ typedef struct {
 //
 #define VRING_DESC_F_NEXT     BIT0 // more descriptors in this request
 #define VRING_DESC_F_WRITE    BIT1 // buffer to be written *by the host*
-#define VRING_DESC_F_INDIRECT BIT2 // unused
+#define VRING_DESC_F_INDIRECT BIT2 // buffer is a table of descriptors
 
 #pragma pack(1)
 typedef struct {
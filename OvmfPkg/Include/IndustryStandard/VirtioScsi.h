@@ -77,6 +77,14 @@ typedef struct {
 } VIRTIO_SCSI_RESP;
 #pragma pack()
 
+//
+// task attributes (VIRTIO_SCSI_REQ.TaskAttr)
+//
+#define VIRTIO_SCSI_S_SIMPLE  0
+#define VIRTIO_SCSI_S_ORDERED 1
+#define VIRTIO_SCSI_S_HEAD    2
+#define VIRTIO_SCSI_S_ACA     3
+
 //
 // selector of first virtio queue usable for request transfer
 //
@@ -2,7 +2,7 @@
 
   Declarations of utility functions used by virtio device drivers.
 
-  Copyright (C) 2012-2016, Red Hat, Inc.
+  Copyright (C) 2012-2017, Red Hat, Inc.
 
   This program and the accompanying materials are licensed and made available
   under the terms and conditions of the BSD License which accompanies this
@@ -111,10 +111,9 @@ VirtioPrepare (
   This function implements the following section from virtio-0.9.5:
   - 2.4.1.1 Placing Buffers into the Descriptor Table
 
-  Free space is taken as granted, since the individual drivers support only
-  synchronous requests and host side status is processed in lock-step with
-  request submission. It is the calling driver's responsibility to verify the
-  ring size in advance.
+  Free space is taken as granted. Drivers that process requests in lock-step
+  with their submission verify the ring size in advance; VIRTIO_REQUEST_QUEUE
+  reserves a fixed slot of descriptors for each request in flight.
 
   The caller is responsible for initializing *Indices with VirtioPrepare()
   first.
@@ -129,8 +128,10 @@ VirtioPrepare (
 
   @param[in] Flags           A bitmask of VRING_DESC_F_* flags. The caller
                              computes this mask dependent on further buffers to
-                             append and transfer direction.
-                             VRING_DESC_F_INDIRECT is unsupported. The
+                             append and transfer direction. With
+                             VRING_DESC_F_INDIRECT, the buffer is a table of
+                             descriptors, which may itself be built by passing
+                             a ring-like view of it as Ring. The
                              VRING_DESC.Next field is always set, but the host
                              only interprets it dependent on VRING_DESC_F_NEXT.
 
@@ -190,6 +191,319 @@ VirtioFlush (
   );
 
 
+/**
+
+  Make the descriptor chain just built available to the host, without
+  notifying the host and without waiting for it to process the chain.
+
+  This function, together with VirtioGetUsed(), allows a driver to keep
+  several descriptor chains in flight on the same ring. The caller is
+  responsible for notifying the host with VirtIo->SetQueueNotify() after it
+  has made one or more descriptor chains available.
+
+  @param[in,out] Ring         The virtio ring with descriptors to submit.
+
+  @param[in]     HeadDescIdx  Identifies the head descriptor of the descriptor
+                              chain.
+
+**/
+VOID
+EFIAPI
+VirtioMakeAvailable (
+  IN OUT VRING  *Ring,
+  IN     UINT16 HeadDescIdx
+  );
+
+
+/**
+
+  Retrieve the next descriptor chain that the host has processed, if any,
+  without waiting.
+
+  @param[in]     Ring         The virtio ring to check.
+
+  @param[in,out] LastUsedIdx  On input, the number of used elements that the
+                              caller has already retrieved from the Used Ring
+                              (modulo 0x10000). On output, incremented by one
+                              if a used element has been retrieved.
+
+  @param[out]    HeadDescIdx  On success, the index of the head descriptor of
+                              the descriptor chain that the host processed.
+
+  @param[out]    UsedLen      On success, the total number of bytes that the
+                              host wrote to the buffers linked by the
+                              descriptor chain. May be NULL.
+
+  @retval EFI_SUCCESS    A used element has been retrieved.
+
+  @retval EFI_NOT_READY  The host has not processed any further descriptor
+                         chains.
+
+**/
+EFI_STATUS
+EFIAPI
+VirtioGetUsed (
+  IN     VRING  *Ring,
+  IN OUT UINT16 *LastUsedIdx,
+  OUT    UINT16 *HeadDescIdx,
+  OUT    UINT32 *UsedLen      OPTIONAL
+  );
+
+
+//
+// A request that a VIRTIO_REQUEST_QUEUE keeps in flight. Drivers embed it in
+// their own request structure.
+//
+typedef struct {
+  LIST_ENTRY          Link;         // VIRTIO_REQUEST_QUEUE.PendingRequests
+  volatile VRING_DESC *IndirectDesc; // MaxDescPerRequest entries
+  BOOLEAN             Barrier;      // submit when nothing else is in flight
+  BOOLEAN             Done;
+  EFI_STATUS          Status;       // valid once Done is set
+} VIRTIO_REQUEST;
+
+/**
+
+  Append the descriptors of a request to a descriptor table, with
+  VirtioAppendDesc().
+
+  @param[in]     Request  The request to format.
+
+  @param[in,out] Ring     The descriptor table to fill in. Either the virtio
+                          ring of the device, or a ring-like view of
+                          Request->IndirectDesc.
+
+  @param[in,out] Indices  Tracks the descriptors appended to Ring.
+
+**/
+typedef
+VOID
+(EFIAPI *VIRTIO_APPEND_REQUEST_DESCS) (
+  IN     VIRTIO_REQUEST *Request,
+  IN OUT VRING          *Ring,
+  IN OUT DESC_INDICES   *Indices
+  );
+
+/**
+
+  Report the completion of a request to the driver, at TPL_NOTIFY.
+
+  Request->Status is EFI_SUCCESS if the host has processed the request,
+  EFI_TIMEOUT if the request has been given up by VirtioRequestQueueExecute(),
+  and EFI_DEVICE_ERROR if the request has been failed without the host
+  processing it. The function may release a non-blocking request.
+
+  @param[in] Request  The completed request.
+
+**/
+typedef
+VOID
+(EFIAPI *VIRTIO_COMPLETE_REQUEST) (
+  IN VIRTIO_REQUEST *Request
+  );
+
+typedef struct _VIRTIO_REQUEST_QUEUE VIRTIO_REQUEST_QUEUE;
+
+/**
+
+  Write the guest-tuneables of the device's configuration space, at
+  TPL_NOTIFY, while the request queue reinitializes the device. This is the
+  part of step 5 of the virtio-0.9.5, 2.2.1 Device Initialization Sequence
+  that is specific to the device type.
+
+  @param[in] Queue  The request queue that reinitializes its device.
+
+  @retval EFI_SUCCESS  The device is configured.
+
+  @return              Error codes from VirtIo->WriteDevice().
+
+**/
+typedef
+EFI_STATUS
+(EFIAPI *VIRTIO_CONFIGURE_DEVICE) (
+  IN VIRTIO_REQUEST_QUEUE *Queue
+  );
+
+//
+// Keeps several requests in flight on one virtqueue. The ring is carved into
+// RequestSlots fixed-size slots of DescPerRequest descriptors each, so that
+// free descriptors need not be tracked individually. With indirect
+// descriptors, a request takes a single ring descriptor that points to
+// VIRTIO_REQUEST.IndirectDesc.
+//
+// The device never raises interrupts; a periodic timer retrieves completed
+// requests, and blocking requests poll the used ring themselves.
+//
+// The host can't be told to drop a single request. When a blocking request
+// times out while in flight, the device is reset, the other requests in
+// flight fail with EFI_DEVICE_ERROR, and the device is reinitialized with the
+// features and the ring it was set up with, so that the pending and later
+// requests are processed. If the host can't be notified, the device can't be
+// reinitialized, or the queue times out while draining, the device is reset
+// and every outstanding and later request fails with EFI_DEVICE_ERROR.
+//
+struct _VIRTIO_REQUEST_QUEUE {
+  VIRTIO_DEVICE_PROTOCOL      *VirtIo;
+  VRING                       *Ring;
+  UINT16                      QueueIndex;
+  UINT64                      Features;
+  UINT16                      DescPerRequest;
+  UINT16                      RequestSlots;
+  VIRTIO_REQUEST              **InFlight;       // RequestSlots elements
+  UINT16                      InFlightCount;
+  UINT16                      NextSlot;
+  UINT16                      LastUsedIdx;
+  BOOLEAN                     IndirectDesc;
+  UINT16                      MaxDescPerRequest;
+  BOOLEAN                     Failed;
+  LIST_ENTRY                  PendingRequests;
+  VIRTIO_APPEND_REQUEST_DESCS AppendRequestDescs;
+  VIRTIO_COMPLETE_REQUEST     CompleteRequest;
+  VIRTIO_CONFIGURE_DEVICE     ConfigureDevice;
+  EFI_EVENT                   PollTimer;
+};
+
+
+/**
+
+  Set up a request queue on a virtio ring that has been configured with
+  VirtioRingInit(), and start polling it.
+
+  @param[out] Queue               The request queue to initialize.
+
+  @param[in]  VirtIo              The virtio device that owns the ring.
+
+  @param[in]  QueueIndex          The index of the virtqueue, for
+                                  VirtIo->SetQueueNotify().
+
+  @param[in]  Ring                The virtio ring of the virtqueue.
+
+  @param[in]  Features            The feature bits that the driver reports to
+                                  the device, including VIRTIO_F_VERSION_1 for
+                                  a virtio-1.0 device. The device is
+                                  reinitialized with them after a timeout.
+
+  @param[in]  IndirectDesc        TRUE if VIRTIO_F_RING_INDIRECT_DESC has been
+                                  negotiated with the host.
+
+  @param[in]  MaxDescPerRequest   The largest number of descriptors that
+                                  AppendRequestDescs() appends for a request.
+                                  It must not exceed the size of Ring.
+
+  @param[in]  AppendRequestDescs  Formats the descriptors of a request.
+
+  @param[in]  CompleteRequest     Reports the completion of a request.
+
+  @param[in]  ConfigureDevice     Writes the guest-tuneables of the device when
+                                  it is reinitialized after a timeout. NULL if
+                                  the driver sets none.
+
+  @retval EFI_SUCCESS           The request queue is ready.
+
+  @return                       Error codes from AllocateZeroPool(),
+                                gBS->CreateEvent() and gBS->SetTimer().
+
+**/
+EFI_STATUS
+EFIAPI
+VirtioRequestQueueInit (
+  OUT VIRTIO_REQUEST_QUEUE        *Queue,
+  IN  VIRTIO_DEVICE_PROTOCOL      *VirtIo,
+  IN  UINT16                      QueueIndex,
+  IN  VRING                       *Ring,
+  IN  UINT64                      Features,
+  IN  BOOLEAN                     IndirectDesc,
+  IN  UINT16                      MaxDescPerRequest,
+  IN  VIRTIO_APPEND_REQUEST_DESCS AppendRequestDescs,
+  IN  VIRTIO_COMPLETE_REQUEST     CompleteRequest,
+  IN  VIRTIO_CONFIGURE_DEVICE     ConfigureDevice     OPTIONAL
+  );
+
+
+/**
+
+  Stop polling a request queue and release its resources. No request may be
+  outstanding; see VirtioRequestQueueDrain().
+
+  @param[in,out] Queue  The request queue to tear down.
+
+**/
+VOID
+EFIAPI
+VirtioRequestQueueUninit (
+  IN OUT VIRTIO_REQUEST_QUEUE *Queue
+  );
+
+
+/**
+
+  Queue a request, and submit it to the host if there is room on the ring.
+  Queue->CompleteRequest() is called when the request completes.
+
+  @param[in,out] Queue    The request queue.
+
+  @param[in]     Request  The request to submit.
+
+**/
+VOID
+EFIAPI
+VirtioRequestQueueSubmit (
+  IN OUT VIRTIO_REQUEST_QUEUE *Queue,
+  IN     VIRTIO_REQUEST       *Request
+  );
+
+
+/**
+
+  Submit a request and poll the used ring until the request completes.
+
+  @param[in,out] Queue    The request queue.
+
+  @param[in]     Request  The request to submit.
+
+  @param[in]     Timeout  The time to wait for the request in 100 ns units, or
+                          0 to wait indefinitely.
+
+  @retval EFI_TIMEOUT  The host has not processed the request in time. The
+                       request has been failed. If it was in flight, the
+                       device has been reset and reinitialized, and the other
+                       requests in flight have been failed.
+
+  @return              Request->Status.
+
+**/
+EFI_STATUS
+EFIAPI
+VirtioRequestQueueExecute (
+  IN OUT VIRTIO_REQUEST_QUEUE *Queue,
+  IN     VIRTIO_REQUEST       *Request,
+  IN     UINT64               Timeout
+  );
+
+
+/**
+
+  Wait until all requests of the queue have completed.
+
+  @param[in,out] Queue    The request queue.
+
+  @param[in]     Timeout  The time to wait in 100 ns units.
+
+  @retval EFI_SUCCESS  All requests have been processed by the host.
+
+  @retval EFI_TIMEOUT  The host has not processed the requests in time. The
+                       device has been reset, and the requests have been
+                       failed.
+
+**/
+EFI_STATUS
+EFIAPI
+VirtioRequestQueueDrain (
+  IN OUT VIRTIO_REQUEST_QUEUE *Queue,
+  IN     UINT64               Timeout
+  );
+
+
 /**
 
   Report the feature bits to the VirtIo 1.0 device that the VirtIo 1.0 driver
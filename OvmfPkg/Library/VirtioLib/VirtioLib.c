@@ -2,7 +2,7 @@
 
   Utility functions used by virtio device drivers.
 
-  Copyright (C) 2012-2016, Red Hat, Inc.
+  Copyright (C) 2012-2017, Red Hat, Inc.
   Portion of Copyright (C) 2013, ARM Ltd.
 
   This program and the accompanying materials are licensed and made available
@@ -23,6 +23,12 @@
 
 #include <Library/VirtioLib.h>
 
+//
+// Period of the timer that retrieves completed requests from the used ring,
+// in 100 ns units.
+//
+#define VIRTIO_REQUEST_QUEUE_POLL_PERIOD 10000
+
 
 /**
 
@@ -341,6 +347,829 @@ VirtioFlush (
 }
 
 
+/**
+
+  Make the descriptor chain just built available to the host, without
+  notifying the host and without waiting for it to process the chain.
+
+  This function, together with VirtioGetUsed(), allows a driver to keep
+  several descriptor chains in flight on the same ring. The caller is
+  responsible for notifying the host with VirtIo->SetQueueNotify() after it
+  has made one or more descriptor chains available.
+
+  @param[in,out] Ring         The virtio ring with descriptors to submit.
+
+  @param[in]     HeadDescIdx  Identifies the head descriptor of the descriptor
+                              chain.
+
+**/
+VOID
+EFIAPI
+VirtioMakeAvailable (
+  IN OUT VRING  *Ring,
+  IN     UINT16 HeadDescIdx
+  )
+{
+  UINT16 NextAvailIdx;
+
+  //
+  // virtio-0.9.5, 2.4.1.2 Updating the Available Ring
+  //
+  NextAvailIdx = *Ring->Avail.Idx;
+  Ring->Avail.Ring[NextAvailIdx++ % Ring->QueueSize] =
+    HeadDescIdx % Ring->QueueSize;
+
+  //
+  // virtio-0.9.5, 2.4.1.3 Updating the Index Field
+  //
+  MemoryFence();
+  *Ring->Avail.Idx = NextAvailIdx;
+  MemoryFence();
+}
+
+
+/**
+
+  Retrieve the next descriptor chain that the host has processed, if any,
+  without waiting.
+
+  @param[in]     Ring         The virtio ring to check.
+
+  @param[in,out] LastUsedIdx  On input, the number of used elements that the
+                              caller has already retrieved from the Used Ring
+                              (modulo 0x10000). On output, incremented by one
+                              if a used element has been retrieved.
+
+  @param[out]    HeadDescIdx  On success, the index of the head descriptor of
+                              the descriptor chain that the host processed.
+
+  @param[out]    UsedLen      On success, the total number of bytes that the
+                              host wrote to the buffers linked by the
+                              descriptor chain. May be NULL.
+
+  @retval EFI_SUCCESS    A used element has been retrieved.
+
+  @retval EFI_NOT_READY  The host has not processed any further descriptor
+                         chains.
+
+**/
+EFI_STATUS
+EFIAPI
+VirtioGetUsed (
+  IN     VRING  *Ring,
+  IN OUT UINT16 *LastUsedIdx,
+  OUT    UINT16 *HeadDescIdx,
+  OUT    UINT32 *UsedLen      OPTIONAL
+  )
+{
+  volatile CONST VRING_USED_ELEM *UsedElem;
+
+  //
+  // virtio-0.9.5, 2.4.2 Receiving Used Buffers From the Device
+  //
+  MemoryFence();
+  if (*Ring->Used.Idx == *LastUsedIdx) {
+    return EFI_NOT_READY;
+  }
+  MemoryFence();
+
+  UsedElem = &Ring->Used.UsedElem[*LastUsedIdx % Ring->QueueSize];
+  *HeadDescIdx = (UINT16)UsedElem->Id;
+  if (UsedLen != NULL) {
+    *UsedLen = UsedElem->Len;
+  }
+  ++*LastUsedIdx;
+  return EFI_SUCCESS;
+}
+
+
+/**
+
+  Fail every request of a queue without waiting for the host.
+
+  The device is reset first, so that the host no longer accesses the ring and
+  the buffers of the requests in flight. Requests submitted later fail
+  immediately.
+
+  The caller is responsible for running at TPL_NOTIFY.
+
+  @param[in,out] Queue  The request queue to fail.
+
+**/
+STATIC
+VOID
+FailRequests (
+  IN OUT VIRTIO_REQUEST_QUEUE *Queue
+  )
+{
+  UINT16         Slot;
+  VIRTIO_REQUEST *Request;
+
+  if (!Queue->Failed) {
+    Queue->VirtIo->SetDeviceStatus (Queue->VirtIo, 0);
+    Queue->Failed = TRUE;
+  }
+
+  for (Slot = 0; Slot < Queue->RequestSlots; ++Slot) {
+    Request = Queue->InFlight[Slot];
+    if (Request != NULL) {
+      Queue->InFlight[Slot] = NULL;
+      Queue->InFlightCount--;
+
+      Request->Status = EFI_DEVICE_ERROR;
+      Request->Done   = TRUE;
+      Queue->CompleteRequest (Request);
+    }
+  }
+
+  while (!IsListEmpty (&Queue->PendingRequests)) {
+    Request = BASE_CR (GetFirstNode (&Queue->PendingRequests), VIRTIO_REQUEST,
+                Link);
+    RemoveEntryList (&Request->Link);
+
+    Request->Status = EFI_DEVICE_ERROR;
+    Request->Done   = TRUE;
+    Queue->CompleteRequest (Request);
+  }
+}
+
+
+/**
+
+  Move as many requests as possible from Queue->PendingRequests to the virtio
+  ring, and notify the host once about all of them.
+
+  The caller is responsible for running at TPL_NOTIFY.
+
+  @param[in,out] Queue  The request queue whose pending requests should be
+                        submitted.
+
+**/
+STATIC
+VOID
+SubmitPendingRequests (
+  IN OUT VIRTIO_REQUEST_QUEUE *Queue
+  )
+{
+  BOOLEAN        Submitted;
+  VIRTIO_REQUEST *Request;
+  UINT16         Slot;
+  DESC_INDICES   Indices;
+  VRING          IndirectTable;
+  DESC_INDICES   IndirectIndices;
+  EFI_STATUS     Status;
+
+  Submitted = FALSE;
+  while (!IsListEmpty (&Queue->PendingRequests) &&
+         Queue->InFlightCount < Queue->RequestSlots) {
+    Request = BASE_CR (GetFirstNode (&Queue->PendingRequests), VIRTIO_REQUEST,
+                Link);
+
+    //
+    // Keep a barrier request (and everything queued after it) back until all
+    // earlier requests are done.
+    //
+    if (Request->Barrier && Queue->InFlightCount > 0) {
+      break;
+    }
+
+    while (Queue->InFlight[Queue->NextSlot] != NULL) {
+      Queue->NextSlot = (UINT16) ((Queue->NextSlot + 1) % Queue->RequestSlots);
+    }
+    Slot = Queue->NextSlot;
+    Queue->NextSlot = (UINT16) ((Slot + 1) % Queue->RequestSlots);
+
+    Indices.HeadDescIdx = (UINT16) (Slot * Queue->DescPerRequest);
+    Indices.NextDescIdx = Indices.HeadDescIdx;
+
+    if (Queue->IndirectDesc) {
+      //
+      // VirtioAppendDesc() only accesses Desc and QueueSize of the ring.
+      //
+      IndirectTable.Desc          = Request->IndirectDesc;
+      IndirectTable.QueueSize     = Queue->MaxDescPerRequest;
+      IndirectIndices.HeadDescIdx = 0;
+      IndirectIndices.NextDescIdx = 0;
+      Queue->AppendRequestDescs (Request, &IndirectTable, &IndirectIndices);
+
+      VirtioAppendDesc (Queue->Ring, (UINTN) Request->IndirectDesc,
+        (UINT32) (IndirectIndices.NextDescIdx * sizeof (VRING_DESC)),
+        VRING_DESC_F_INDIRECT, &Indices);
+    } else {
+      Queue->AppendRequestDescs (Request, Queue->Ring, &Indices);
+    }
+
+    RemoveEntryList (&Request->Link);
+    Queue->InFlight[Slot] = Request;
+    Queue->InFlightCount++;
+
+    VirtioMakeAvailable (Queue->Ring, Indices.HeadDescIdx);
+    Submitted = TRUE;
+  }
+
+  if (Submitted) {
+    //
+    // virtio-0.9.5, 2.4.1.4 Notifying the Device. If the host can't be
+    // notified, we can't tell whether it will ever process the ring.
+    //
+    Status = Queue->VirtIo->SetQueueNotify (Queue->VirtIo, Queue->QueueIndex);
+    if (EFI_ERROR (Status)) {
+      DEBUG ((DEBUG_ERROR, "%a: SetQueueNotify(): %r\n", __FUNCTION__,
+        Status));
+      FailRequests (Queue);
+    }
+  }
+}
+
+
+/**
+
+  Complete all requests that the host has processed since the last call, then
+  submit as many pending requests as the freed ring slots allow.
+
+  The caller is responsible for running at TPL_NOTIFY.
+
+  @param[in,out] Queue  The request queue to process.
+
+**/
+STATIC
+VOID
+ProcessUsedRequests (
+  IN OUT VIRTIO_REQUEST_QUEUE *Queue
+  )
+{
+  UINT16         HeadDescIdx;
+  UINT16         Slot;
+  VIRTIO_REQUEST *Request;
+
+  if (Queue->Failed) {
+    return;
+  }
+
+  while (VirtioGetUsed (Queue->Ring, &Queue->LastUsedIdx, &HeadDescIdx,
+           NULL) == EFI_SUCCESS) {
+    Slot = HeadDescIdx / Queue->DescPerRequest;
+    if (Slot >= Queue->RequestSlots || Queue->InFlight[Slot] == NULL) {
+      ASSERT (FALSE);
+      continue;
+    }
+
+    Request = Queue->InFlight[Slot];
+    Queue->InFlight[Slot] = NULL;
+    Queue->InFlightCount--;
+
+    Request->Status = EFI_SUCCESS;
+    Request->Done   = TRUE;
+    Queue->CompleteRequest (Request);
+  }
+
+  SubmitPendingRequests (Queue);
+}
+
+
+/**
+
+  Timer notification function that completes the requests the host has
+  processed.
+
+  @param[in] Event    Event whose notification function is being invoked.
+
+  @param[in] Context  Pointer to the VIRTIO_REQUEST_QUEUE structure.
+
+**/
+STATIC
+VOID
+EFIAPI
+PollRequestQueue (
+  IN  EFI_EVENT Event,
+  IN  VOID      *Context
+  )
+{
+  ProcessUsedRequests (Context);
+}
+
+
+/**
+
+  Bring a device that has been reset back to VSTAT_DRIVER_OK, with the
+  features and the ring that the request queue has been set up with. This
+  repeats virtio-0.9.5, 2.2.1 Device Initialization Sequence like the driver
+  did, except for the parts that don't change: the device is not probed
+  again, and the ring is emptied rather than reallocated.
+
+  The caller is responsible for running at TPL_NOTIFY, and for having failed
+  the requests that were in flight.
+
+  @param[in,out] Queue  The request queue whose device should be
+                        reinitialized.
+
+  @retval EFI_SUCCESS  The device processes the ring again.
+
+  @return              Error codes from the VIRTIO_DEVICE_PROTOCOL member
+                       functions, Virtio10WriteFeatures() and
+                       Queue->ConfigureDevice().
+
+**/
+STATIC
+EFI_STATUS
+ReinitDevice (
+  IN OUT VIRTIO_REQUEST_QUEUE *Queue
+  )
+{
+  VIRTIO_DEVICE_PROTOCOL *VirtIo;
+  UINT8                  NextDevStat;
+  EFI_STATUS             Status;
+
+  VirtIo = Queue->VirtIo;
+
+  SetMem (Queue->Ring->Base, EFI_PAGES_TO_SIZE (Queue->Ring->NumPages), 0x00);
+  *Queue->Ring->Avail.Flags = (UINT16) VRING_AVAIL_F_NO_INTERRUPT;
+  Queue->NextSlot    = 0;
+  Queue->LastUsedIdx = 0;
+
+  NextDevStat = VSTAT_ACK;     // step 2 -- acknowledge device presence
+  Status = VirtIo->SetDeviceStatus (VirtIo, NextDevStat);
+  if (EFI_ERROR (Status)) {
+    return Status;
+  }
+
+  NextDevStat |= VSTAT_DRIVER; // step 3 -- we know how to drive it
+  Status = VirtIo->SetDeviceStatus (VirtIo, NextDevStat);
+  if (EFI_ERROR (Status)) {
+    return Status;
+  }
+
+  Status = VirtIo->SetPageSize (VirtIo, EFI_PAGE_SIZE);
+  if (EFI_ERROR (Status)) {
+    return Status;
+  }
+
+  if (VirtIo->Revision >= VIRTIO_SPEC_REVISION (1, 0, 0)) {
+    Status = Virtio10WriteFeatures (VirtIo, Queue->Features, &NextDevStat);
+    if (EFI_ERROR (Status)) {
+      return Status;
+    }
+  }
+
+  //
+  // step 4 -- report the ring again
+  //
+  Status = VirtIo->SetQueueSel (VirtIo, Queue->QueueIndex);
+  if (EFI_ERROR (Status)) {
+    return Status;
+  }
+  Status = VirtIo->SetQueueNum (VirtIo, Queue->Ring->QueueSize);
+  if (EFI_ERROR (Status)) {
+    return Status;
+  }
+  Status = VirtIo->SetQueueAlign (VirtIo, EFI_PAGE_SIZE);
+  if (EFI_ERROR (Status)) {
+    return Status;
+  }
+  Status = VirtIo->SetQueueAddress (VirtIo, Queue->Ring);
+  if (EFI_ERROR (Status)) {
+    return Status;
+  }
+
+  //
+  // step 5 -- report understood features and guest-tuneables
+  //
+  if (VirtIo->Revision < VIRTIO_SPEC_REVISION (1, 0, 0)) {
+    Status = VirtIo->SetGuestFeatures (VirtIo,
+                       Queue->Features & ~(UINT64)VIRTIO_F_VERSION_1);
+    if (EFI_ERROR (Status)) {
+      return Status;
+    }
+  }
+  if (Queue->ConfigureDevice != NULL) {
+    Status = Queue->ConfigureDevice (Queue);
+    if (EFI_ERROR (Status)) {
+      return Status;
+    }
+  }
+
+  //
+  // step 6 -- initialization complete
+  //
+  NextDevStat |= VSTAT_DRIVER_OK;
+  return VirtIo->SetDeviceStatus (VirtIo, NextDevStat);
+}
+
+
+/**
+
+  Give up a request that the host has not processed in time, and fail it
+  with EFI_TIMEOUT.
+
+  A pending request is simply removed from the queue. The host can't be told
+  to drop a request in flight, however: the device is reset, the other
+  requests in flight fail with EFI_DEVICE_ERROR, and the device is
+  reinitialized, so that the pending requests are submitted to it. If that
+  doesn't work, the queue fails like with FailRequests().
+
+  The caller is responsible for running at TPL_NOTIFY.
+
+  @param[in,out] Queue    The request queue.
+
+  @param[in]     Request  The request to give up.
+
+**/
+STATIC
+VOID
+AbandonRequest (
+  IN OUT VIRTIO_REQUEST_QUEUE *Queue,
+  IN     VIRTIO_REQUEST       *Request
+  )
+{
+  UINT16         Slot;
+  VIRTIO_REQUEST *InFlight;
+  EFI_STATUS     Status;
+
+  ASSERT (!Queue->Failed);
+
+  for (Slot = 0; Slot < Queue->RequestSlots; ++Slot) {
+    if (Queue->InFlight[Slot] == Request) {
+      break;
+    }
+  }
+
+  if (Slot == Queue->RequestSlots) {
+    RemoveEntryList (&Request->Link);
+
+    Request->Status = EFI_TIMEOUT;
+    Request->Done   = TRUE;
+    Queue->CompleteRequest (Request);
+    return;
+  }
+
+  Queue->VirtIo->SetDeviceStatus (Queue->VirtIo, 0);
+
+  for (Slot = 0; Slot < Queue->RequestSlots; ++Slot) {
+    InFlight = Queue->InFlight[Slot];
+    if (InFlight != NULL) {
+      Queue->InFlight[Slot] = NULL;
+      Queue->InFlightCount--;
+
+      InFlight->Status = (InFlight == Request) ? EFI_TIMEOUT : EFI_DEVICE_ERROR;
+      InFlight->Done   = TRUE;
+      Queue->CompleteRequest (InFlight);
+    }
+  }
+
+  Status = ReinitDevice (Queue);
+  if (EFI_ERROR (Status)) {
+    DEBUG ((DEBUG_ERROR, "%a: ReinitDevice(): %r\n", __FUNCTION__, Status));
+    FailRequests (Queue);
+    return;
+  }
+  SubmitPendingRequests (Queue);
+}
+
+
+/**
+
+  Poll the used ring until a request, or all requests of the queue, have
+  completed. Polling the used ring is just a memory read, so the completion
+  is retrieved as soon as the host produces it.
+
+  @param[in,out] Queue         The request queue.
+
+  @param[in]     Request       The request to wait for, or NULL to wait for
+                               all requests.
+
+  @param[in]     TimeoutEvent  A timer event that is signaled when the wait
+                               should be given up, or NULL to wait
+                               indefinitely.
+
+  @retval EFI_SUCCESS  The requests have completed.
+
+  @retval EFI_TIMEOUT  TimeoutEvent has been signaled first. Request has been
+                       given up with AbandonRequest(), or, without Request,
+                       all requests have been failed.
+
+**/
+STATIC
+EFI_STATUS
+WaitForRequests (
+  IN OUT VIRTIO_REQUEST_QUEUE *Queue,
+  IN     VIRTIO_REQUEST       *Request      OPTIONAL,
+  IN     EFI_EVENT            TimeoutEvent  OPTIONAL
+  )
+{
+  EFI_TPL    OldTpl;
+  BOOLEAN    Done;
+  EFI_STATUS Status;
+
+  Status = EFI_SUCCESS;
+  for (;;) {
+    OldTpl = gBS->RaiseTPL (TPL_NOTIFY);
+    ProcessUsedRequests (Queue);
+    if (Request != NULL) {
+      Done = Request->Done;
+    } else {
+      Done = (BOOLEAN) (Queue->InFlightCount == 0 &&
+                        IsListEmpty (&Queue->PendingRequests));
+    }
+    if (!Done && TimeoutEvent != NULL &&
+        !EFI_ERROR (gBS->CheckEvent (TimeoutEvent))) {
+      DEBUG ((DEBUG_ERROR, "%a: timeout\n", __FUNCTION__));
+      if (Request != NULL) {
+        AbandonRequest (Queue, Request);
+      } else {
+        FailRequests (Queue);
+      }
+      Status = EFI_TIMEOUT;
+      Done   = TRUE;
+    }
+    gBS->RestoreTPL (OldTpl);
+
+    if (Done) {
+      break;
+    }
+    CpuPause ();
+  }
+
+  return Status;
+}
+
+
+/**
+
+  Set up a request queue on a virtio ring that has been configured with
+  VirtioRingInit(), and start polling it.
+
+  @param[out] Queue               The request queue to initialize.
+
+  @param[in]  VirtIo              The virtio device that owns the ring.
+
+  @param[in]  QueueIndex          The index of the virtqueue, for
+                                  VirtIo->SetQueueNotify().
+
+  @param[in]  Ring                The virtio ring of the virtqueue.
+
+  @param[in]  Features            The feature bits that the driver reports to
+                                  the device, including VIRTIO_F_VERSION_1 for
+                                  a virtio-1.0 device. The device is
+                                  reinitialized with them after a timeout.
+
+  @param[in]  IndirectDesc        TRUE if VIRTIO_F_RING_INDIRECT_DESC has been
+                                  negotiated with the host.
+
+  @param[in]  MaxDescPerRequest   The largest number of descriptors that
+                                  AppendRequestDescs() appends for a request.
+                                  It must not exceed the size of Ring.
+
+  @param[in]  AppendRequestDescs  Formats the descriptors of a request.
+
+  @param[in]  CompleteRequest     Reports the completion of a request.
+
+  @param[in]  ConfigureDevice     Writes the guest-tuneables of the device when
+                                  it is reinitialized after a timeout. NULL if
+                                  the driver sets none.
+
+  @retval EFI_SUCCESS           The request queue is ready.
+
+  @return                       Error codes from AllocateZeroPool(),
+                                gBS->CreateEvent() and gBS->SetTimer().
+
+**/
+EFI_STATUS
+EFIAPI
+VirtioRequestQueueInit (
+  OUT VIRTIO_REQUEST_QUEUE        *Queue,
+  IN  VIRTIO_DEVICE_PROTOCOL      *VirtIo,
+  IN  UINT16                      QueueIndex,
+  IN  VRING                       *Ring,
+  IN  UINT64                      Features,
+  IN  BOOLEAN                     IndirectDesc,
+  IN  UINT16                      MaxDescPerRequest,
+  IN  VIRTIO_APPEND_REQUEST_DESCS AppendRequestDescs,
+  IN  VIRTIO_COMPLETE_REQUEST     CompleteRequest,
+  IN  VIRTIO_CONFIGURE_DEVICE     ConfigureDevice     OPTIONAL
+  )
+{
+  EFI_STATUS Status;
+
+  ASSERT (MaxDescPerRequest > 0);
+  ASSERT (MaxDescPerRequest <= Ring->QueueSize);
+
+  Queue->VirtIo             = VirtIo;
+  Queue->Ring               = Ring;
+  Queue->QueueIndex         = QueueIndex;
+  Queue->Features           = Features;
+  Queue->DescPerRequest     = IndirectDesc ? 1 : MaxDescPerRequest;
+  Queue->RequestSlots       = Ring->QueueSize / Queue->DescPerRequest;
+  Queue->InFlightCount      = 0;
+  Queue->NextSlot           = 0;
+  Queue->LastUsedIdx        = 0;
+  Queue->IndirectDesc       = IndirectDesc;
+  Queue->MaxDescPerRequest  = MaxDescPerRequest;
+  Queue->Failed             = FALSE;
+  Queue->AppendRequestDescs = AppendRequestDescs;
+  Queue->CompleteRequest    = CompleteRequest;
+  Queue->ConfigureDevice    = ConfigureDevice;
+  InitializeListHead (&Queue->PendingRequests);
+
+  //
+  // We never want the host to interrupt us; completions are polled.
+  //
+  *Ring->Avail.Flags = (UINT16) VRING_AVAIL_F_NO_INTERRUPT;
+
+  Queue->InFlight = AllocateZeroPool (
+                      Queue->RequestSlots * sizeof *Queue->InFlight);
+  if (Queue->InFlight == NULL) {
+    return EFI_OUT_OF_RESOURCES;
+  }
+
+  Status = gBS->CreateEvent (EVT_TIMER | EVT_NOTIFY_SIGNAL, TPL_NOTIFY,
+                  &PollRequestQueue, Queue, &Queue->PollTimer);
+  if (EFI_ERROR (Status)) {
+    goto FreeInFlight;
+  }
+
+  Status = gBS->SetTimer (Queue->PollTimer, TimerPeriodic,
+                  VIRTIO_REQUEST_QUEUE_POLL_PERIOD);
+  if (EFI_ERROR (Status)) {
+    goto ClosePollTimer;
+  }
+
+  return EFI_SUCCESS;
+
+ClosePollTimer:
+  gBS->CloseEvent (Queue->PollTimer);
+
+FreeInFlight:
+  FreePool (Queue->InFlight);
+  Queue->InFlight = NULL;
+
+  return Status;
+}
+
+
+/**
+
+  Stop polling a request queue and release its resources. No request may be
+  outstanding; see VirtioRequestQueueDrain().
+
+  @param[in,out] Queue  The request queue to tear down.
+
+**/
+VOID
+EFIAPI
+VirtioRequestQueueUninit (
+  IN OUT VIRTIO_REQUEST_QUEUE *Queue
+  )
+{
+  ASSERT (Queue->InFlightCount == 0);
+  ASSERT (IsListEmpty (&Queue->PendingRequests));
+
+  gBS->CloseEvent (Queue->PollTimer);
+  FreePool (Queue->InFlight);
+  Queue->InFlight = NULL;
+}
+
+
+/**
+
+  Queue a request, and submit it to the host if there is room on the ring.
+  Queue->CompleteRequest() is called when the request completes.
+
+  @param[in,out] Queue    The request queue.
+
+  @param[in]     Request  The request to submit.
+
+**/
+VOID
+EFIAPI
+VirtioRequestQueueSubmit (
+  IN OUT VIRTIO_REQUEST_QUEUE *Queue,
+  IN     VIRTIO_REQUEST       *Request
+  )
+{
+  EFI_TPL OldTpl;
+
+  ASSERT (!Queue->IndirectDesc || Request->IndirectDesc != NULL);
+
+  OldTpl = gBS->RaiseTPL (TPL_NOTIFY);
+  Request->Done   = FALSE;
+  Request->Status = EFI_NOT_READY;
+  InsertTailList (&Queue->PendingRequests, &Request->Link);
+  if (Queue->Failed) {
+    FailRequests (Queue);
+  } else {
+    SubmitPendingRequests (Queue);
+  }
+  gBS->RestoreTPL (OldTpl);
+}
+
+
+/**
+
+  Submit a request and poll the used ring until the request completes.
+
+  @param[in,out] Queue    The request queue.
+
+  @param[in]     Request  The request to submit.
+
+  @param[in]     Timeout  The time to wait for the request in 100 ns units, or
+                          0 to wait indefinitely.
+
+  @retval EFI_TIMEOUT  The host has not processed the request in time. The
+                       request has been failed. If it was in flight, the
+                       device has been reset and reinitialized, and the other
+                       requests in flight have been failed.
+
+  @return              Request->Status.
+
+**/
+EFI_STATUS
+EFIAPI
+VirtioRequestQueueExecute (
+  IN OUT VIRTIO_REQUEST_QUEUE *Queue,
+  IN     VIRTIO_REQUEST       *Request,
+  IN     UINT64               Timeout
+  )
+{
+  EFI_EVENT  TimeoutEvent;
+  EFI_STATUS Status;
+
+  TimeoutEvent = NULL;
+  if (Timeout > 0) {
+    Status = gBS->CreateEvent (EVT_TIMER, TPL_CALLBACK, NULL, NULL,
+                    &TimeoutEvent);
+    if (EFI_ERROR (Status)) {
+      return Status;
+    }
+    Status = gBS->SetTimer (TimeoutEvent, TimerRelative, Timeout);
+    if (EFI_ERROR (Status)) {
+      gBS->CloseEvent (TimeoutEvent);
+      return Status;
+    }
+  }
+
+  VirtioRequestQueueSubmit (Queue, Request);
+  Status = WaitForRequests (Queue, Request, TimeoutEvent);
+
+  if (TimeoutEvent != NULL) {
+    gBS->CloseEvent (TimeoutEvent);
+  }
+  return EFI_ERROR (Status) ? Status : Request->Status;
+}
+
+
+/**
+
+  Wait until all requests of the queue have completed.
+
+  @param[in,out] Queue    The request queue.
+
+  @param[in]     Timeout  The time to wait in 100 ns units.
+
+  @retval EFI_SUCCESS  All requests have been processed by the host.
+
+  @retval EFI_TIMEOUT  The host has not processed the requests in time. The
+                       device has been reset, and the requests have been
+                       failed.
+
+**/
+EFI_STATUS
+EFIAPI
+VirtioRequestQueueDrain (
+  IN OUT VIRTIO_REQUEST_QUEUE *Queue,
+  IN     UINT64               Timeout
+  )
+{
+  EFI_EVENT  TimeoutEvent;
+  EFI_STATUS Status;
+  EFI_TPL    OldTpl;
+
+  Status = gBS->CreateEvent (EVT_TIMER, TPL_CALLBACK, NULL, NULL,
+                  &TimeoutEvent);
+  if (!EFI_ERROR (Status)) {
+    Status = gBS->SetTimer (TimeoutEvent, TimerRelative, Timeout);
+    if (!EFI_ERROR (Status)) {
+      Status = WaitForRequests (Queue, NULL, TimeoutEvent);
+    }
+    gBS->CloseEvent (TimeoutEvent);
+  }
+
+  if (EFI_ERROR (Status) && Status != EFI_TIMEOUT) {
+    //
+    // Without a timer, don't wait at all.
+    //
+    OldTpl = gBS->RaiseTPL (TPL_NOTIFY);
+    ProcessUsedRequests (Queue);
+    Status = EFI_SUCCESS;
+    if (Queue->InFlightCount > 0 || !IsListEmpty (&Queue->PendingRequests)) {
+      FailRequests (Queue);
+      Status = EFI_TIMEOUT;
+    }
+    gBS->RestoreTPL (OldTpl);
+  }
+  return Status;
+}
+
+
 /**
 
   Report the feature bits to the VirtIo 1.0 device that the VirtIo 1.0 driver
@@ -1,17 +1,20 @@
 /** @file
 
-  This driver produces Block I/O Protocol instances for virtio-blk devices.
+  This driver produces Block I/O and Block I/O 2 Protocol instances for
+  virtio-blk devices.
 
   The implementation is basic:
 
   - No attach/detach (ie. removable media).
 
-  - Although the non-blocking interfaces of EFI_BLOCK_IO2_PROTOCOL could be a
-    good match for multiple in-flight virtio-blk requests, we stick to
-    synchronous requests and EFI_BLOCK_IO_PROTOCOL for now.
+  - Requests of both protocols share one virtio ring, which can hold as many
+    in-flight requests as it has descriptor slots for. The device never
+    raises interrupts; a periodic timer retrieves completed requests and
+    signals the EFI_BLOCK_IO2_TOKEN events, while blocking requests poll the
+    used ring themselves.
 
-  Copyright (C) 2012, Red Hat, Inc.
-  Copyright (c) 2012 - 2016, Intel Corporation. All rights reserved.<BR>
+  Copyright (C) 2012-2017, Red Hat, Inc.
+  Copyright (c) 2012 - 2017, Intel Corporation. All rights reserved.<BR>
 
   This program and the accompanying materials are licensed and made available
   under the terms and conditions of the BSD License which accompanies this
@@ -24,6 +27,7 @@
 **/
 
 #include <IndustryStandard/VirtioBlk.h>
+#include <Library/BaseLib.h>
 #include <Library/BaseMemoryLib.h>
 #include <Library/DebugLib.h>
 #include <Library/MemoryAllocationLib.h>
@@ -183,13 +187,108 @@ VerifyReadWriteRequest (
 
 /**
 
-  Format a read / write / flush request as three consecutive virtio
-  descriptors, push them to the host, and poll for the response.
+  Append the descriptors of a read / write / flush request to a descriptor
+  table: the virtio-blk header, the data buffer (for read/write only), and the
+  host status byte.
 
-  This is the main workhorse function. Two use cases are supported, read/write
-  and flush. The function may only be called after the request parameters have
-  been verified by
-  - specific checks in ReadBlocks() / WriteBlocks() / FlushBlocks(), and
+  @param[in]     Request  The request to format.
+
+  @param[in out] Ring     The descriptor table to fill in. Either the virtio
+                          ring of the device, or a ring-like view of
+                          Req->IndirectDesc.
+
+  @param[in out] Indices  Tracks the descriptors appended to Ring.
+
+**/
+
+STATIC
+VOID
+EFIAPI
+AppendRequestDescs (
+  IN     VIRTIO_REQUEST *Request,
+  IN OUT VRING          *Ring,
+  IN OUT DESC_INDICES   *Indices
+  )
+{
+  VBLK_REQ *Req;
+
+  Req = VBLK_REQ_FROM_VIRTIO_REQ (Request);
+
+  //
+  // virtio-blk header in first desc
+  //
+  VirtioAppendDesc (Ring, (UINTN) &Req->Header, sizeof Req->Header,
+    VRING_DESC_F_NEXT, Indices);
+
+  //
+  // data buffer for read/write in second desc
+  //
+  if (Req->BufferSize > 0) {
+    //
+    // From virtio-0.9.5, 2.3.2 Descriptor Table:
+    // "no descriptor chain may be more than 2^32 bytes long in total".
+    //
+    // The predicate is ensured by the call contract of InitializeRequest()
+    // (for flush), or VerifyReadWriteRequest() (for read/write). It also
+    // implies that converting BufferSize to UINT32 will not truncate it.
+    //
+    ASSERT (Req->BufferSize <= SIZE_1GB);
+
+    //
+    // VRING_DESC_F_WRITE is interpreted from the host's point of view.
+    //
+    VirtioAppendDesc (Ring, (UINTN) Req->Buffer, (UINT32) Req->BufferSize,
+      VRING_DESC_F_NEXT | (Req->RequestIsWrite ? 0 : VRING_DESC_F_WRITE),
+      Indices);
+  }
+
+  //
+  // host status in last (second or third) desc
+  //
+  VirtioAppendDesc (Ring, (UINTN) &Req->HostStatus, sizeof Req->HostStatus,
+    VRING_DESC_F_WRITE, Indices);
+}
+
+
+/**
+
+  Complete a request: signal the token of a non-blocking request and release
+  it. The outcome of a blocking request is checked by SynchronousRequest().
+
+  @param[in] Request  The request that has completed.
+
+**/
+
+STATIC
+VOID
+EFIAPI
+CompleteRequest (
+  IN VIRTIO_REQUEST *Request
+  )
+{
+  VBLK_REQ *Req;
+
+  Req = VBLK_REQ_FROM_VIRTIO_REQ (Request);
+  if (Req->Token == NULL) {
+    return;
+  }
+
+  Req->Token->TransactionStatus =
+    (Request->Status == EFI_SUCCESS && Req->HostStatus == VIRTIO_BLK_S_OK) ?
+    EFI_SUCCESS : EFI_DEVICE_ERROR;
+  gBS->SignalEvent (Req->Token->Event);
+  FreePool (Req);
+}
+
+
+/**
+
+  Prepare a read / write / flush request.
+
+  The function may only be called after the request parameters have been
+  verified by
+  - specific checks in the (Ex) ReadBlocks() / WriteBlocks() / FlushBlocks()
+    functions, and
   - VerifyReadWriteRequest() (for read/write only).
 
   Parameters handled commonly:
@@ -197,6 +296,11 @@ VerifyReadWriteRequest (
     @param[in] Dev             The virtio-blk device the request is targeted
                                at.
 
+    @param[in] Token           The token to signal when the request completes,
+                               or NULL for a blocking request.
+
+    @param[out] Req            The request to initialize.
+
   Flush request:
 
     @param[in] Lba             Must be zero.
@@ -222,34 +326,21 @@ VerifyReadWriteRequest (
     @param[in] RequestIsWrite  TRUE iff data transfer goes from guest to
                                device.
 
-  Return values are common to both use cases, and are appropriate to be
-  forwarded by the EFI_BLOCK_IO_PROTOCOL functions (ReadBlocks(),
-  WriteBlocks(), FlushBlocks()).
-
-
-  @retval EFI_SUCCESS          Transfer complete.
-
-  @retval EFI_DEVICE_ERROR     Failed to notify host side via VirtIo write, or
-                               unable to parse host response, or host response
-                               is not VIRTIO_BLK_S_OK.
-
 **/
 
 STATIC
-EFI_STATUS
-EFIAPI
-SynchronousRequest (
-  IN              VBLK_DEV *Dev,
-  IN              EFI_LBA  Lba,
-  IN              UINTN    BufferSize,
-  IN OUT volatile VOID     *Buffer,
-  IN              BOOLEAN  RequestIsWrite
+VOID
+InitializeRequest (
+  IN              VBLK_DEV            *Dev,
+  IN              EFI_LBA             Lba,
+  IN              UINTN               BufferSize,
+  IN OUT volatile VOID                *Buffer,
+  IN              BOOLEAN             RequestIsWrite,
+  IN              EFI_BLOCK_IO2_TOKEN *Token,
+  OUT             VBLK_REQ            *Req
   )
 {
-  UINT32                  BlockSize;
-  volatile VIRTIO_BLK_REQ Request;
-  volatile UINT8          HostStatus;
-  DESC_INDICES            Indices;
+  UINT32 BlockSize;
 
   BlockSize = Dev->BlockIoMedia.BlockSize;
 
@@ -264,73 +355,126 @@ SynchronousRequest (
   //
   ASSERT (BufferSize % BlockSize == 0);
 
+  Req->Signature      = VBLK_REQ_SIG;
+  Req->Token          = Token;
+  Req->BufferSize     = BufferSize;
+  Req->Buffer         = Buffer;
+  Req->RequestIsWrite = RequestIsWrite;
+
   //
   // Prepare virtio-blk request header, setting zero size for flush.
   // IO Priority is homogeneously 0.
   //
-  Request.Type   = RequestIsWrite ?
-                   (BufferSize == 0 ? VIRTIO_BLK_T_FLUSH : VIRTIO_BLK_T_OUT) :
-                   VIRTIO_BLK_T_IN;
-  Request.IoPrio = 0;
-  Request.Sector = MultU64x32(Lba, BlockSize / 512);
-
-  VirtioPrepare (&Dev->Ring, &Indices);
+  Req->Header.Type   = RequestIsWrite ?
+                       (BufferSize == 0 ? VIRTIO_BLK_T_FLUSH :
+                                          VIRTIO_BLK_T_OUT) :
+                       VIRTIO_BLK_T_IN;
+  Req->Header.IoPrio = 0;
+  Req->Header.Sector = MultU64x32(Lba, BlockSize / 512);
 
   //
-  // preset a host status for ourselves that we do not accept as success
+  // The host is only required to flush writes that it has completed. Keep a
+  // flush request back until all earlier requests are done.
   //
-  HostStatus = VIRTIO_BLK_S_IOERR;
+  Req->VirtioReq.IndirectDesc = Req->IndirectDesc;
+  Req->VirtioReq.Barrier      = (BOOLEAN) (Req->Header.Type ==
+                                           VIRTIO_BLK_T_FLUSH);
 
   //
-  // ensured by VirtioBlkInit() -- this predicate, in combination with the
-  // lock-step progress, ensures we don't have to track free descriptors.
+  // preset a host status for ourselves that we do not accept as success
   //
-  ASSERT (Dev->Ring.QueueSize >= 3);
+  Req->HostStatus = VIRTIO_BLK_S_IOERR;
+}
 
-  //
-  // virtio-blk header in first desc
-  //
-  VirtioAppendDesc (&Dev->Ring, (UINTN) &Request, sizeof Request,
-    VRING_DESC_F_NEXT, &Indices);
 
-  //
-  // data buffer for read/write in second desc
-  //
-  if (BufferSize > 0) {
-    //
-    // From virtio-0.9.5, 2.3.2 Descriptor Table:
-    // "no descriptor chain may be more than 2^32 bytes long in total".
-    //
-    // The predicate is ensured by the call contract above (for flush), or
-    // VerifyReadWriteRequest() (for read/write). It also implies that
-    // converting BufferSize to UINT32 will not truncate it.
-    //
-    ASSERT (BufferSize <= SIZE_1GB);
+/**
 
-    //
-    // VRING_DESC_F_WRITE is interpreted from the host's point of view.
-    //
-    VirtioAppendDesc (&Dev->Ring, (UINTN) Buffer, (UINT32) BufferSize,
-      VRING_DESC_F_NEXT | (RequestIsWrite ? 0 : VRING_DESC_F_WRITE),
-      &Indices);
-  }
+  Submit a read / write / flush request to the host and poll for its
+  completion.
 
-  //
-  // host status in last (second or third) desc
-  //
-  VirtioAppendDesc (&Dev->Ring, (UINTN) &HostStatus, sizeof HostStatus,
-    VRING_DESC_F_WRITE, &Indices);
+  This is the workhorse of EFI_BLOCK_IO_PROTOCOL, and of the blocking
+  requests of EFI_BLOCK_IO2_PROTOCOL. The request shares the virtio ring with
+  the non-blocking requests in flight. Parameter requirements are those of
+  InitializeRequest().
+
+  Return values are appropriate to be forwarded by the EFI_BLOCK_IO_PROTOCOL
+  functions (ReadBlocks(), WriteBlocks(), FlushBlocks()).
+
+
+  @retval EFI_SUCCESS          Transfer complete.
+
+  @retval EFI_DEVICE_ERROR     Host response is not VIRTIO_BLK_S_OK, or the
+                               host could not be notified, or it has not
+                               completed the request in VBLK_REQUEST_TIMEOUT.
+                               In the last case the device has been reset and
+                               reinitialized, so later requests still work.
+
+**/
+
+STATIC
+EFI_STATUS
+EFIAPI
+SynchronousRequest (
+  IN              VBLK_DEV *Dev,
+  IN              EFI_LBA  Lba,
+  IN              UINTN    BufferSize,
+  IN OUT volatile VOID     *Buffer,
+  IN              BOOLEAN  RequestIsWrite
+  )
+{
+  VBLK_REQ   Req;
+  EFI_STATUS Status;
+
+  InitializeRequest (Dev, Lba, BufferSize, Buffer, RequestIsWrite, NULL,
+    &Req);
 
   //
-  // virtio-blk's only virtqueue is #0, called "requestq" (see Appendix D).
+  // Don't wait for the poll timer; VirtioRequestQueueExecute() retrieves the
+  // completion as soon as the host produces it.
   //
-  if (VirtioFlush (Dev->VirtIo, 0, &Dev->Ring, &Indices,
-        NULL) == EFI_SUCCESS &&
-      HostStatus == VIRTIO_BLK_S_OK) {
-    return EFI_SUCCESS;
+  Status = VirtioRequestQueueExecute (&Dev->Queue, &Req.VirtioReq,
+             VBLK_REQUEST_TIMEOUT);
+  if (EFI_ERROR (Status) || Req.HostStatus != VIRTIO_BLK_S_OK) {
+    return EFI_DEVICE_ERROR;
   }
+  return EFI_SUCCESS;
+}
 
-  return EFI_DEVICE_ERROR;
+
+/**
+
+  Queue a non-blocking read / write / flush request for EFI_BLOCK_IO2_PROTOCOL.
+  Token->Event will be signaled from the poll timer once the host completes
+  the request. Parameter requirements are those of InitializeRequest().
+
+  @retval EFI_SUCCESS           The request has been queued.
+
+  @retval EFI_OUT_OF_RESOURCES  Memory allocation failed.
+
+**/
+
+STATIC
+EFI_STATUS
+AsynchronousRequest (
+  IN              VBLK_DEV            *Dev,
+  IN              EFI_LBA             Lba,
+  IN              UINTN               BufferSize,
+  IN OUT volatile VOID                *Buffer,
+  IN              BOOLEAN             RequestIsWrite,
+  IN              EFI_BLOCK_IO2_TOKEN *Token
+  )
+{
+  VBLK_REQ *Req;
+
+  Req = AllocatePool (sizeof *Req);
+  if (Req == NULL) {
+    return EFI_OUT_OF_RESOURCES;
+  }
+
+  InitializeRequest (Dev, Lba, BufferSize, Buffer, RequestIsWrite, Token,
+    Req);
+  VirtioRequestQueueSubmit (&Dev->Queue, &Req->VirtioReq);
+  return EFI_SUCCESS;
 }
 
 
@@ -483,6 +627,231 @@ VirtioBlkFlushBlocks (
 }
 
 
+//
+// UEFI Spec 2.6, 13.10 EFI Block I/O 2 Protocol
+//
+EFI_STATUS
+EFIAPI
+VirtioBlkResetEx (
+  IN EFI_BLOCK_IO2_PROTOCOL *This,
+  IN BOOLEAN                ExtendedVerification
+  )
+{
+  //
+  // If we managed to initialize and install the driver, then the device is
+  // working correctly.
+  //
+  return EFI_SUCCESS;
+}
+
+
+/**
+
+  Complete an EFI_BLOCK_IO2_PROTOCOL request that requires no host
+  interaction, such as one with zero BufferSize.
+
+  @param[in out] Token  The token of the request; may be NULL, or have a NULL
+                        Event, for a blocking request.
+
+  @retval EFI_SUCCESS  The request has been completed.
+
+**/
+
+STATIC
+EFI_STATUS
+CompleteTokenNow (
+  IN OUT EFI_BLOCK_IO2_TOKEN *Token
+  )
+{
+  if (Token != NULL && Token->Event != NULL) {
+    Token->TransactionStatus = EFI_SUCCESS;
+    gBS->SignalEvent (Token->Event);
+  }
+  return EFI_SUCCESS;
+}
+
+
+/**
+
+  Issue a verified EFI_BLOCK_IO2_PROTOCOL request as a blocking or as a
+  non-blocking request, depending on Token. Parameter requirements are those
+  of InitializeRequest().
+
+  @return  Return values of SynchronousRequest() or AsynchronousRequest().
+
+**/
+
+STATIC
+EFI_STATUS
+BlockIo2Request (
+  IN              VBLK_DEV            *Dev,
+  IN              EFI_LBA             Lba,
+  IN OUT          EFI_BLOCK_IO2_TOKEN *Token,
+  IN              UINTN               BufferSize,
+  IN OUT volatile VOID                *Buffer,
+  IN              BOOLEAN             RequestIsWrite
+  )
+{
+  if (Token == NULL || Token->Event == NULL) {
+    return SynchronousRequest (Dev, Lba, BufferSize, Buffer, RequestIsWrite);
+  }
+  return AsynchronousRequest (Dev, Lba, BufferSize, Buffer, RequestIsWrite,
+           Token);
+}
+
+
+/**
+
+  ReadBlocksEx() operation for virtio-blk.
+
+  See
+  - UEFI Spec 2.6, 13.10 EFI Block I/O 2 Protocol,
+    EFI_BLOCK_IO2_PROTOCOL.ReadBlocksEx().
+  - Driver Writer's Guide for UEFI 2.3.1 v1.01, 24.2.2. ReadBlocks() and
+    ReadBlocksEx() Implementation.
+
+  If Token is NULL or Token->Event is NULL, the request is blocking, exactly
+  like VirtioBlkReadBlocks(). Otherwise the request is queued on the virtio
+  ring, and Token->Event is signaled when the host completes it.
+
+**/
+
+EFI_STATUS
+EFIAPI
+VirtioBlkReadBlocksEx (
+  IN     EFI_BLOCK_IO2_PROTOCOL *This,
+  IN     UINT32                 MediaId,
+  IN     EFI_LBA                Lba,
+  IN OUT EFI_BLOCK_IO2_TOKEN    *Token,
+  IN     UINTN                  BufferSize,
+  OUT    VOID                   *Buffer
+  )
+{
+  VBLK_DEV   *Dev;
+  EFI_STATUS Status;
+
+  if (BufferSize == 0) {
+    return CompleteTokenNow (Token);
+  }
+
+  Dev = VIRTIO_BLK_FROM_BLOCK_IO2 (This);
+  Status = VerifyReadWriteRequest (
+             &Dev->BlockIoMedia,
+             Lba,
+             BufferSize,
+             FALSE               // RequestIsWrite
+             );
+  if (EFI_ERROR (Status)) {
+    return Status;
+  }
+
+  return BlockIo2Request (
+           Dev,
+           Lba,
+           Token,
+           BufferSize,
+           Buffer,
+           FALSE       // RequestIsWrite
+           );
+}
+
+
+/**
+
+  WriteBlocksEx() operation for virtio-blk.
+
+  See
+  - UEFI Spec 2.6, 13.10 EFI Block I/O 2 Protocol,
+    EFI_BLOCK_IO2_PROTOCOL.WriteBlocksEx().
+  - Driver Writer's Guide for UEFI 2.3.1 v1.01, 24.2.3 WriteBlocks() and
+    WriteBlockEx() Implementation.
+
+  If Token is NULL or Token->Event is NULL, the request is blocking, exactly
+  like VirtioBlkWriteBlocks(). Otherwise the request is queued on the virtio
+  ring, and Token->Event is signaled when the host completes it.
+
+**/
+
+EFI_STATUS
+EFIAPI
+VirtioBlkWriteBlocksEx (
+  IN     EFI_BLOCK_IO2_PROTOCOL *This,
+  IN     UINT32                 MediaId,
+  IN     EFI_LBA                Lba,
+  IN OUT EFI_BLOCK_IO2_TOKEN    *Token,
+  IN     UINTN                  BufferSize,
+  IN     VOID                   *Buffer
+  )
+{
+  VBLK_DEV   *Dev;
+  EFI_STATUS Status;
+
+  if (BufferSize == 0) {
+    return CompleteTokenNow (Token);
+  }
+
+  Dev = VIRTIO_BLK_FROM_BLOCK_IO2 (This);
+  Status = VerifyReadWriteRequest (
+             &Dev->BlockIoMedia,
+             Lba,
+             BufferSize,
+             TRUE                // RequestIsWrite
+             );
+  if (EFI_ERROR (Status)) {
+    return Status;
+  }
+
+  return BlockIo2Request (
+           Dev,
+           Lba,
+           Token,
+           BufferSize,
+           Buffer,
+           TRUE        // RequestIsWrite
+           );
+}
+
+
+/**
+
+  FlushBlocksEx() operation for virtio-blk.
+
+  See
+  - UEFI Spec 2.6, 13.10 EFI Block I/O 2 Protocol,
+    EFI_BLOCK_IO2_PROTOCOL.FlushBlocksEx().
+  - Driver Writer's Guide for UEFI 2.3.1 v1.01, 24.2.4 FlushBlocks() and
+    FlushBlocksEx() Implementation.
+
+  The flush is submitted to the host only after all requests queued before it
+  have completed.
+
+**/
+
+EFI_STATUS
+EFIAPI
+VirtioBlkFlushBlocksEx (
+  IN     EFI_BLOCK_IO2_PROTOCOL *This,
+  IN OUT EFI_BLOCK_IO2_TOKEN    *Token
+  )
+{
+  VBLK_DEV *Dev;
+
+  Dev = VIRTIO_BLK_FROM_BLOCK_IO2 (This);
+  if (!Dev->BlockIoMedia.WriteCaching) {
+    return CompleteTokenNow (Token);
+  }
+
+  return BlockIo2Request (
+           Dev,
+           0,     // Lba
+           Token,
+           0,     // BufferSize
+           NULL,  // Buffer
+           TRUE   // RequestIsWrite
+           );
+}
+
+
 /**
 
   Device probe function for this driver.
@@ -693,7 +1062,8 @@ VirtioBlkInit (
   }
 
   Features &= VIRTIO_BLK_F_BLK_SIZE | VIRTIO_BLK_F_TOPOLOGY | VIRTIO_BLK_F_RO |
-              VIRTIO_BLK_F_FLUSH | VIRTIO_F_VERSION_1;
+              VIRTIO_BLK_F_FLUSH | VIRTIO_F_VERSION_1 |
+              VIRTIO_F_RING_INDIRECT_DESC;
 
   //
   // In virtio-1.0, feature negotiation is expected to complete before queue
@@ -717,7 +1087,7 @@ VirtioBlkInit (
   if (EFI_ERROR (Status)) {
     goto Failed;
   }
-  if (QueueSize < 3) { // SynchronousRequest() uses at most three descriptors
+  if (QueueSize < 3) { // a request uses at most three descriptors
     Status = EFI_UNSUPPORTED;
     goto Failed;
   }
@@ -727,18 +1097,31 @@ VirtioBlkInit (
     goto Failed;
   }
 
+  //
+  // With indirect descriptors, each request occupies a single descriptor of
+  // the ring, which triples the number of requests we can keep in flight.
+  //
+  Status = VirtioRequestQueueInit (&Dev->Queue, Dev->VirtIo, 0, &Dev->Ring,
+             Features,
+             (BOOLEAN) ((Features & VIRTIO_F_RING_INDIRECT_DESC) != 0),
+             VBLK_MAX_DESC_PER_REQUEST,
+             AppendRequestDescs, CompleteRequest, NULL);
+  if (EFI_ERROR (Status)) {
+    goto ReleaseQueue;
+  }
+
   //
   // Additional steps for MMIO: align the queue appropriately, and set the
   // size. If anything fails from here on, we must release the ring resources.
   //
   Status = Dev->VirtIo->SetQueueNum (Dev->VirtIo, QueueSize);
   if (EFI_ERROR (Status)) {
-    goto ReleaseQueue;
+    goto UninitRequestQueue;
   }
 
   Status = Dev->VirtIo->SetQueueAlign (Dev->VirtIo, EFI_PAGE_SIZE);
   if (EFI_ERROR (Status)) {
-    goto ReleaseQueue;
+    goto UninitRequestQueue;
   }
 
   //
@@ -746,7 +1129,7 @@ VirtioBlkInit (
   //
   Status = Dev->VirtIo->SetQueueAddress (Dev->VirtIo, &Dev->Ring);
   if (EFI_ERROR (Status)) {
-    goto ReleaseQueue;
+    goto UninitRequestQueue;
   }
 
 
@@ -757,7 +1140,7 @@ VirtioBlkInit (
     Features &= ~(UINT64)VIRTIO_F_VERSION_1;
     Status = Dev->VirtIo->SetGuestFeatures (Dev->VirtIo, Features);
     if (EFI_ERROR (Status)) {
-      goto ReleaseQueue;
+      goto UninitRequestQueue;
     }
   }
 
@@ -767,7 +1150,7 @@ VirtioBlkInit (
   NextDevStat |= VSTAT_DRIVER_OK;
   Status = Dev->VirtIo->SetDeviceStatus (Dev->VirtIo, NextDevStat);
   if (EFI_ERROR (Status)) {
-    goto ReleaseQueue;
+    goto UninitRequestQueue;
   }
 
   //
@@ -791,6 +1174,12 @@ VirtioBlkInit (
   Dev->BlockIoMedia.LastBlock        = DivU64x32 (NumSectors,
                                          BlockSize / 512) - 1;
 
+  Dev->BlockIo2.Media                = &Dev->BlockIoMedia;
+  Dev->BlockIo2.Reset                = &VirtioBlkResetEx;
+  Dev->BlockIo2.ReadBlocksEx         = &VirtioBlkReadBlocksEx;
+  Dev->BlockIo2.WriteBlocksEx        = &VirtioBlkWriteBlocksEx;
+  Dev->BlockIo2.FlushBlocksEx        = &VirtioBlkFlushBlocksEx;
+
   DEBUG ((DEBUG_INFO, "%a: LbaSize=0x%x[B] NumBlocks=0x%Lx[Lba]\n",
     __FUNCTION__, Dev->BlockIoMedia.BlockSize,
     Dev->BlockIoMedia.LastBlock + 1));
@@ -810,6 +1199,9 @@ VirtioBlkInit (
   }
   return EFI_SUCCESS;
 
+UninitRequestQueue:
+  VirtioRequestQueueUninit (&Dev->Queue);
+
 ReleaseQueue:
   VirtioRingUninit (&Dev->Ring);
 
@@ -848,10 +1240,12 @@ VirtioBlkUninit (
   //
   Dev->VirtIo->SetDeviceStatus (Dev->VirtIo, 0);
 
+  VirtioRequestQueueUninit (&Dev->Queue);
   VirtioRingUninit (&Dev->Ring);
 
   SetMem (&Dev->BlockIo,      sizeof Dev->BlockIo,      0x00);
   SetMem (&Dev->BlockIoMedia, sizeof Dev->BlockIoMedia, 0x00);
+  SetMem (&Dev->BlockIo2,     sizeof Dev->BlockIo2,     0x00);
 }
 
 
@@ -953,12 +1347,14 @@ VirtioBlkDriverBindingStart (
   }
 
   //
-  // Setup complete, attempt to export the driver instance's BlockIo interface.
+  // Setup complete, attempt to export the driver instance's BlockIo and
+  // BlockIo2 interfaces.
   //
   Dev->Signature = VBLK_SIG;
-  Status = gBS->InstallProtocolInterface (&DeviceHandle,
-                  &gEfiBlockIoProtocolGuid, EFI_NATIVE_INTERFACE,
-                  &Dev->BlockIo);
+  Status = gBS->InstallMultipleProtocolInterfaces (&DeviceHandle,
+                  &gEfiBlockIoProtocolGuid, &Dev->BlockIo,
+                  &gEfiBlockIo2ProtocolGuid, &Dev->BlockIo2,
+                  NULL);
   if (EFI_ERROR (Status)) {
     goto CloseExitBoot;
   }
@@ -1035,12 +1431,21 @@ VirtioBlkDriverBindingStop (
   //
   // Handle Stop() requests for in-use driver instances gracefully.
   //
-  Status = gBS->UninstallProtocolInterface (DeviceHandle,
-                  &gEfiBlockIoProtocolGuid, &Dev->BlockIo);
+  Status = gBS->UninstallMultipleProtocolInterfaces (DeviceHandle,
+                  &gEfiBlockIoProtocolGuid, &Dev->BlockIo,
+                  &gEfiBlockIo2ProtocolGuid, &Dev->BlockIo2,
+                  NULL);
   if (EFI_ERROR (Status)) {
     return Status;
   }
 
+  //
+  // Let the host finish the requests that are still queued, so that their
+  // tokens get signaled and their buffers are no longer accessed. Requests
+  // that the host doesn't finish in time are failed.
+  //
+  VirtioRequestQueueDrain (&Dev->Queue, VBLK_REQUEST_TIMEOUT);
+
   gBS->CloseEvent (Dev->ExitBoot);
 
   VirtioBlkUninit (Dev);
@@ -1,9 +1,9 @@
 /** @file
 
   Internal definitions for the virtio-blk driver, which produces Block I/O
-  Protocol instances for virtio-blk devices.
+  and Block I/O 2 Protocol instances for virtio-blk devices.
 
-  Copyright (C) 2012, Red Hat, Inc.
+  Copyright (C) 2012-2017, Red Hat, Inc.
 
   This program and the accompanying materials are licensed and made available
   under the terms and conditions of the BSD License which accompanies this
@@ -19,10 +19,47 @@
 #define _VIRTIO_BLK_DXE_H_
 
 #include <Protocol/BlockIo.h>
+#include <Protocol/BlockIo2.h>
 #include <Protocol/ComponentName.h>
 #include <Protocol/DriverBinding.h>
 
 #include <IndustryStandard/Virtio.h>
+#include <IndustryStandard/VirtioBlk.h>
+#include <Library/VirtioLib.h>
+
+
+//
+// The time the host is given to complete a blocking request, or to finish
+// the outstanding requests when the driver stops. If a blocking request times
+// out, it fails alone, except for the other requests in flight, which are
+// lost when the device is reset and reinitialized. If draining times out, the
+// device is reset for good.
+//
+#define VBLK_REQUEST_TIMEOUT EFI_TIMER_PERIOD_SECONDS (30)
+
+//
+// A read, write or flush request. Blocking requests live on the stack of
+// SynchronousRequest(), non-blocking ones are allocated by
+// AsynchronousRequest() and freed when their token is signaled.
+//
+#define VBLK_REQ_SIG SIGNATURE_32 ('V', 'B', 'R', 'Q')
+
+#define VBLK_MAX_DESC_PER_REQUEST 3 // header, data, host status
+
+typedef struct {
+  UINT32                  Signature;
+  VIRTIO_REQUEST          VirtioReq;       // VBLK_DEV.Queue
+  EFI_BLOCK_IO2_TOKEN     *Token;          // NULL for blocking requests
+  UINTN                   BufferSize;
+  volatile VOID           *Buffer;
+  BOOLEAN                 RequestIsWrite;
+  volatile VIRTIO_BLK_REQ Header;
+  volatile UINT8          HostStatus;
+  volatile VRING_DESC     IndirectDesc[VBLK_MAX_DESC_PER_REQUEST];
+} VBLK_REQ;
+
+#define VBLK_REQ_FROM_VIRTIO_REQ(VirtioReqPointer) \
+        CR (VirtioReqPointer, VBLK_REQ, VirtioReq, VBLK_REQ_SIG)
 
 
 #define VBLK_SIG SIGNATURE_32 ('V', 'B', 'L', 'K')
@@ -41,11 +78,16 @@ typedef struct {
   VRING                  Ring;                 // VirtioRingInit      2
   EFI_BLOCK_IO_PROTOCOL  BlockIo;              // VirtioBlkInit       1
   EFI_BLOCK_IO_MEDIA     BlockIoMedia;         // VirtioBlkInit       1
+  EFI_BLOCK_IO2_PROTOCOL BlockIo2;             // VirtioBlkInit       1
+  VIRTIO_REQUEST_QUEUE   Queue;                // VirtioBlkInit       1
 } VBLK_DEV;
 
 #define VIRTIO_BLK_FROM_BLOCK_IO(BlockIoPointer) \
         CR (BlockIoPointer, VBLK_DEV, BlockIo, VBLK_SIG)
 
+#define VIRTIO_BLK_FROM_BLOCK_IO2(BlockIo2Pointer) \
+        CR (BlockIo2Pointer, VBLK_DEV, BlockIo2, VBLK_SIG)
+
 
 /**
 
@@ -258,6 +300,96 @@ VirtioBlkFlushBlocks (
   );
 
 
+//
+// UEFI Spec 2.6, 13.10 EFI Block I/O 2 Protocol
+//
+EFI_STATUS
+EFIAPI
+VirtioBlkResetEx (
+  IN EFI_BLOCK_IO2_PROTOCOL *This,
+  IN BOOLEAN                ExtendedVerification
+  );
+
+
+/**
+
+  ReadBlocksEx() operation for virtio-blk.
+
+  See
+  - UEFI Spec 2.6, 13.10 EFI Block I/O 2 Protocol,
+    EFI_BLOCK_IO2_PROTOCOL.ReadBlocksEx().
+  - Driver Writer's Guide for UEFI 2.3.1 v1.01, 24.2.2. ReadBlocks() and
+    ReadBlocksEx() Implementation.
+
+  If Token is NULL or Token->Event is NULL, the request is blocking, exactly
+  like VirtioBlkReadBlocks(). Otherwise the request is queued on the virtio
+  ring, and Token->Event is signaled when the host completes it.
+
+**/
+
+EFI_STATUS
+EFIAPI
+VirtioBlkReadBlocksEx (
+  IN     EFI_BLOCK_IO2_PROTOCOL *This,
+  IN     UINT32                 MediaId,
+  IN     EFI_LBA                Lba,
+  IN OUT EFI_BLOCK_IO2_TOKEN    *Token,
+  IN     UINTN                  BufferSize,
+  OUT    VOID                   *Buffer
+  );
+
+
+/**
+
+  WriteBlocksEx() operation for virtio-blk.
+
+  See
+  - UEFI Spec 2.6, 13.10 EFI Block I/O 2 Protocol,
+    EFI_BLOCK_IO2_PROTOCOL.WriteBlocksEx().
+  - Driver Writer's Guide for UEFI 2.3.1 v1.01, 24.2.3 WriteBlocks() and
+    WriteBlockEx() Implementation.
+
+  If Token is NULL or Token->Event is NULL, the request is blocking, exactly
+  like VirtioBlkWriteBlocks(). Otherwise the request is queued on the virtio
+  ring, and Token->Event is signaled when the host completes it.
+
+**/
+
+EFI_STATUS
+EFIAPI
+VirtioBlkWriteBlocksEx (
+  IN     EFI_BLOCK_IO2_PROTOCOL *This,
+  IN     UINT32                 MediaId,
+  IN     EFI_LBA                Lba,
+  IN OUT EFI_BLOCK_IO2_TOKEN    *Token,
+  IN     UINTN                  BufferSize,
+  IN     VOID                   *Buffer
+  );
+
+
+/**
+
+  FlushBlocksEx() operation for virtio-blk.
+
+  See
+  - UEFI Spec 2.6, 13.10 EFI Block I/O 2 Protocol,
+    EFI_BLOCK_IO2_PROTOCOL.FlushBlocksEx().
+  - Driver Writer's Guide for UEFI 2.3.1 v1.01, 24.2.4 FlushBlocks() and
+    FlushBlocksEx() Implementation.
+
+  The flush is submitted to the host only after all requests queued before it
+  have completed.
+
+**/
+
+EFI_STATUS
+EFIAPI
+VirtioBlkFlushBlocksEx (
+  IN     EFI_BLOCK_IO2_PROTOCOL *This,
+  IN OUT EFI_BLOCK_IO2_TOKEN    *Token
+  );
+
+
 //
 // The purpose of the following scaffolding (EFI_COMPONENT_NAME_PROTOCOL and
 // EFI_COMPONENT_NAME2_PROTOCOL implementation) is to format the driver's name
@@ -3,7 +3,7 @@
   Implementation of the SNP.GetStatus() function and its private helpers if
   any.
 
-  Copyright (C) 2013, Red Hat, Inc.
+  Copyright (C) 2013-2017, Red Hat, Inc.
   Copyright (c) 2006 - 2014, Intel Corporation. All rights reserved.<BR>
 
   This program and the accompanying materials are licensed and made available
@@ -85,9 +85,12 @@ VirtioNetGetStatus (
   }
 
   //
-  // update link status
+  // Update link status. Reading the config space costs a VM exit, so skip it
+  // when the caller only wants to recycle transmit buffers, which MNP does
+  // after every transmitted packet.
   //
-  if (Dev->Snm.MediaPresentSupported) {
+  if (Dev->Snm.MediaPresentSupported &&
+      (InterruptStatus != NULL || TxBuf == NULL)) {
     UINT16 LinkStatus;
 
     Status = VIRTIO_CFG_READ (Dev, LinkStatus, &LinkStatus);
@@ -106,6 +109,36 @@ VirtioNetGetStatus (
   TxCurUsed = *Dev->TxRing.Used.Idx;
   MemoryFence ();
 
+  //
+  // Retrieve all transmit completions in one go. Their descriptor chains
+  // become free for VirtioNetTransmit() immediately, while the buffer
+  // addresses wait in TxDoneBuf until they are reported to the caller.
+  //
+  while (Dev->TxLastUsed != TxCurUsed) {
+    UINT16 UsedElemIdx;
+    UINT32 DescIdx;
+
+    ASSERT (Dev->TxCurPending > 0);
+    ASSERT (Dev->TxCurPending <= Dev->TxMaxPending);
+    ASSERT (Dev->TxCurPending + Dev->TxDoneCount <= Dev->TxMaxPending);
+
+    UsedElemIdx = Dev->TxLastUsed++ % Dev->TxRing.QueueSize;
+    DescIdx = Dev->TxRing.Used.UsedElem[UsedElemIdx].Id;
+    ASSERT (DescIdx < (UINT32) (2 * Dev->TxMaxPending - 1));
+
+    //
+    // remember the buffer address that the caller enqueued
+    //
+    Dev->TxDoneBuf[(Dev->TxDoneHead + Dev->TxDoneCount++) %
+                   Dev->TxMaxPending] =
+      (VOID *)(UINTN) Dev->TxRing.Desc[DescIdx + 1].Addr;
+
+    //
+    // now this descriptor can be used again to enqueue a transmit buffer
+    //
+    Dev->TxFreeStack[--Dev->TxCurPending] = (UINT16) DescIdx;
+  }
+
   if (InterruptStatus != NULL) {
     //
     // report the receive interrupt if there is data available for reception,
@@ -115,40 +148,22 @@ VirtioNetGetStatus (
     if (Dev->RxLastUsed != RxCurUsed) {
       *InterruptStatus |= EFI_SIMPLE_NETWORK_RECEIVE_INTERRUPT;
     }
-    if (Dev->TxLastUsed != TxCurUsed) {
-      ASSERT (Dev->TxCurPending > 0);
+    if (Dev->TxDoneCount > 0) {
       *InterruptStatus |= EFI_SIMPLE_NETWORK_TRANSMIT_INTERRUPT;
     }
   }
 
   if (TxBuf != NULL) {
-    if (Dev->TxLastUsed == TxCurUsed) {
+    if (Dev->TxDoneCount == 0) {
       *TxBuf = NULL;
     }
     else {
-      UINT16 UsedElemIdx;
-      UINT32 DescIdx;
-
-      //
-      // fetch the first descriptor among those that the hypervisor reports
-      // completed
-      //
-      ASSERT (Dev->TxCurPending > 0);
-      ASSERT (Dev->TxCurPending <= Dev->TxMaxPending);
-
-      UsedElemIdx = Dev->TxLastUsed++ % Dev->TxRing.QueueSize;
-      DescIdx = Dev->TxRing.Used.UsedElem[UsedElemIdx].Id;
-      ASSERT (DescIdx < (UINT32) (2 * Dev->TxMaxPending - 1));
-
-      //
-      // report buffer address to caller that has been enqueued by caller
-      //
-      *TxBuf = (VOID *)(UINTN) Dev->TxRing.Desc[DescIdx + 1].Addr;
-
       //
-      // now this descriptor can be used again to enqueue a transmit buffer
+      // report the oldest transmitted buffer to the caller
       //
-      Dev->TxFreeStack[--Dev->TxCurPending] = (UINT16) DescIdx;
+      *TxBuf = Dev->TxDoneBuf[Dev->TxDoneHead];
+      Dev->TxDoneHead = (UINT16) ((Dev->TxDoneHead + 1) % Dev->TxMaxPending);
+      --Dev->TxDoneCount;
     }
   }
 
@@ -3,7 +3,7 @@
   Implementation of the SNP.Initialize() function and its private helpers if
   any.
 
-  Copyright (C) 2013, Red Hat, Inc.
+  Copyright (C) 2013-2017, Red Hat, Inc.
   Copyright (c) 2006 - 2010, Intel Corporation. All rights reserved.<BR>
 
   This program and the accompanying materials are licensed and made available
@@ -121,13 +121,16 @@ ReleaseQueue:
   - tracking of heads of free descriptor chains from the above,
   - one common virtio-net request header (never modified by the host) for all
     pending TX packets,
+  - a queue of transmitted buffers that VirtioNetGetStatus() has retrieved
+    from the host, but not yet reported to the caller,
   - select polling over TX interrupt.
 
   @param[in,out] Dev       The VNET_DEV driver instance about to enter the
                            EfiSimpleNetworkInitialized state.
 
   @retval EFI_OUT_OF_RESOURCES  Failed to allocate the stack to track the heads
-                                of free descriptor chains.
+                                of free descriptor chains, or the queue of
+                                transmitted buffers.
   @retval EFI_SUCCESS           TX setup successful.
 */
 
@@ -150,11 +153,21 @@ VirtioNetInitTx (
     return EFI_OUT_OF_RESOURCES;
   }
 
+  Dev->TxDoneHead  = 0;
+  Dev->TxDoneCount = 0;
+  Dev->TxDoneBuf   = AllocatePool (Dev->TxMaxPending *
+                       sizeof *Dev->TxDoneBuf);
+  if (Dev->TxDoneBuf == NULL) {
+    FreePool (Dev->TxFreeStack);
+    return EFI_OUT_OF_RESOURCES;
+  }
+
   //
   // In VirtIo 1.0, the NumBuffers field is mandatory. In 0.9.5, it depends on
-  // VIRTIO_NET_F_MRG_RXBUF, which we never negotiate.
+  // VIRTIO_NET_F_MRG_RXBUF.
   //
-  TxSharedReqSize = (Dev->VirtIo->Revision < VIRTIO_SPEC_REVISION (1, 0, 0)) ?
+  TxSharedReqSize = (Dev->VirtIo->Revision < VIRTIO_SPEC_REVISION (1, 0, 0) &&
+                     !Dev->MergeableRxBufs) ?
                     sizeof Dev->TxSharedReq.V0_9_5 :
                     sizeof Dev->TxSharedReq;
 
@@ -220,6 +233,10 @@ VirtioNetInitTx (
   - fully populate the RX queue with a static pattern of virtio descriptor
     chains.
 
+  If the device accepts the virtio-net request header and the packet data in
+  the same buffer (VirtIo 1.0, or VIRTIO_NET_F_MRG_RXBUF), then each RX packet
+  takes a single descriptor, and twice as many packets fit in the RX queue.
+
   @param[in,out] Dev       The VNET_DEV driver instance about to enter the
                            EfiSimpleNetworkInitialized state.
 
@@ -246,31 +263,42 @@ VirtioNetInitRx (
 
   //
   // In VirtIo 1.0, the NumBuffers field is mandatory. In 0.9.5, it depends on
-  // VIRTIO_NET_F_MRG_RXBUF, which we never negotiate.
+  // VIRTIO_NET_F_MRG_RXBUF.
   //
-  VirtioNetReqSize = (Dev->VirtIo->Revision < VIRTIO_SPEC_REVISION (1, 0, 0)) ?
+  VirtioNetReqSize = (Dev->VirtIo->Revision < VIRTIO_SPEC_REVISION (1, 0, 0) &&
+                      !Dev->MergeableRxBufs) ?
                      sizeof (VIRTIO_NET_REQ) :
                      sizeof (VIRTIO_1_0_NET_REQ);
 
   //
-  // For each incoming packet we must supply two descriptors:
-  // - the recipient for the virtio-net request header, plus
-  // - the recipient for the network data (which consists of Ethernet header
-  //   and Ethernet payload).
+  // For each incoming packet we must supply room for:
+  // - the virtio-net request header, plus
+  // - the network data (which consists of Ethernet header and Ethernet
+  //   payload).
+  //
+  // A virtio-0.9.5 device without VIRTIO_NET_F_MRG_RXBUF expects these in two
+  // separate descriptors. Otherwise one descriptor covers both, and a packet
+  // larger than the buffer could be spread over several buffers (see
+  // VirtioNetReceive()).
   //
   RxBufSize = VirtioNetReqSize +
               (Dev->Snm.MediaHeaderSize + Dev->Snm.MaxPacketSize);
+  Dev->RxDescPerPkt = (Dev->VirtIo->Revision < VIRTIO_SPEC_REVISION (1, 0, 0) &&
+                       !Dev->MergeableRxBufs) ? 2 : 1;
 
   //
-  // Limit the number of pending RX packets if the queue is big. The division
-  // by two is due to the above "two descriptors per packet" trait.
+  // Limit the number of pending RX packets if the queue is big.
   //
-  RxAlwaysPending = (UINT16) MIN (Dev->RxRing.QueueSize / 2, VNET_MAX_PENDING);
+  RxAlwaysPending = (UINT16) MIN (Dev->RxRing.QueueSize / Dev->RxDescPerPkt,
+                               VNET_MAX_PENDING);
 
   Dev->RxBuf = AllocatePool (RxAlwaysPending * RxBufSize);
   if (Dev->RxBuf == NULL) {
     return EFI_OUT_OF_RESOURCES;
   }
+  Dev->RxBufSize    = RxBufSize;
+  Dev->RxHdrSize    = VirtioNetReqSize;
+  Dev->RxMaxPending = RxAlwaysPending;
 
   //
   // virtio-0.9.5, 2.4.2 Receiving Used Buffers From the Device
@@ -287,8 +315,8 @@ VirtioNetInitRx (
   *Dev->RxRing.Avail.Flags = (UINT16) VRING_AVAIL_F_NO_INTERRUPT;
 
   //
-  // now set up a separate, two-part descriptor chain for each RX packet, and
-  // link each chain into (from) the available ring as well
+  // now set up a separate, one- or two-part descriptor chain for each RX
+  // packet, and link each chain into (from) the available ring as well
   //
   DescIdx = 0;
   RxPtr = Dev->RxBuf;
@@ -302,6 +330,14 @@ VirtioNetInitRx (
     //
     // virtio-0.9.5, 2.4.1.1 Placing Buffers into the Descriptor Table
     //
+    if (Dev->RxDescPerPkt == 1) {
+      Dev->RxRing.Desc[DescIdx].Addr  = (UINTN) RxPtr;
+      Dev->RxRing.Desc[DescIdx].Len   = (UINT32) RxBufSize;
+      Dev->RxRing.Desc[DescIdx].Flags = VRING_DESC_F_WRITE;
+      RxPtr += Dev->RxRing.Desc[DescIdx++].Len;
+      continue;
+    }
+
     Dev->RxRing.Desc[DescIdx].Addr  = (UINTN) RxPtr;
     Dev->RxRing.Desc[DescIdx].Len   = (UINT32) VirtioNetReqSize;
     Dev->RxRing.Desc[DescIdx].Flags = VRING_DESC_F_WRITE | VRING_DESC_F_NEXT;
@@ -439,7 +475,9 @@ VirtioNetInitialize (
   ASSERT (Dev->Snm.MediaPresentSupported ==
     !!(Features & VIRTIO_NET_F_STATUS));
 
-  Features &= VIRTIO_NET_F_MAC | VIRTIO_NET_F_STATUS | VIRTIO_F_VERSION_1;
+  Features &= VIRTIO_NET_F_MAC | VIRTIO_NET_F_STATUS | VIRTIO_F_VERSION_1 |
+              VIRTIO_NET_F_MRG_RXBUF;
+  Dev->MergeableRxBufs = (BOOLEAN) ((Features & VIRTIO_NET_F_MRG_RXBUF) != 0);
 
   //
   // In virtio-1.0, feature negotiation is expected to complete before queue
@@ -2,7 +2,7 @@
 
   Implementation of the SNP.Receive() function and its private helpers if any.
 
-  Copyright (C) 2013, Red Hat, Inc.
+  Copyright (C) 2013-2017, Red Hat, Inc.
   Copyright (c) 2006 - 2013, Intel Corporation. All rights reserved.<BR>
 
   This program and the accompanying materials are licensed and made available
@@ -78,9 +78,14 @@ VirtioNetReceive (
   UINT16     UsedElemIdx;
   UINT32     DescIdx;
   UINT32     RxLen;
+  UINT32     FirstLen;
   UINTN      OrigBufferSize;
   UINT8      *RxPtr;
+  UINT8      *CopyPtr;
+  UINT16     NumBuffers;
+  UINT16     BufIdx;
   UINT16     AvailIdx;
+  UINT16     OldAvailIdx;
   EFI_STATUS NotifyStatus;
 
   if (This == NULL || BufferSize == NULL || Buffer == NULL) {
@@ -115,16 +120,40 @@ VirtioNetReceive (
   UsedElemIdx = Dev->RxLastUsed % Dev->RxRing.QueueSize;
   DescIdx = Dev->RxRing.Used.UsedElem[UsedElemIdx].Id;
   RxLen   = Dev->RxRing.Used.UsedElem[UsedElemIdx].Len;
+  RxPtr   = VIRTIO_NET_RX_BUF (Dev, DescIdx);
 
   //
   // the virtio-net request header must be complete; we skip it
   //
-  ASSERT (RxLen >= Dev->RxRing.Desc[DescIdx].Len);
-  RxLen -= Dev->RxRing.Desc[DescIdx].Len;
+  ASSERT (RxLen >= Dev->RxHdrSize);
+  RxLen -= (UINT32) Dev->RxHdrSize;
   //
   // the host must not have filled in more data than requested
   //
-  ASSERT (RxLen <= Dev->RxRing.Desc[DescIdx + 1].Len);
+  ASSERT (RxLen <= Dev->RxBufSize - Dev->RxHdrSize);
+  FirstLen = RxLen;
+
+  //
+  // With VIRTIO_NET_F_MRG_RXBUF, the host may spread a packet over several
+  // consecutive used elements; only the first buffer starts with the header.
+  //
+  NumBuffers = 1;
+  if (Dev->MergeableRxBufs) {
+    NumBuffers = ((volatile VIRTIO_1_0_NET_REQ *) RxPtr)->NumBuffers;
+    if (NumBuffers == 0 || NumBuffers > Dev->RxMaxPending) {
+      NumBuffers = 1;
+      Status = EFI_DEVICE_ERROR;
+      goto RecycleDesc; // drop malformed packet
+    }
+    if ((UINT16) (RxCurUsed - Dev->RxLastUsed) < NumBuffers) {
+      Status = EFI_NOT_READY;
+      goto Exit; // wait for the rest of the packet
+    }
+    for (BufIdx = 1; BufIdx < NumBuffers; ++BufIdx) {
+      UsedElemIdx = (UINT16) (Dev->RxLastUsed + BufIdx) % Dev->RxRing.QueueSize;
+      RxLen += Dev->RxRing.Used.UsedElem[UsedElemIdx].Len;
+    }
+  }
 
   OrigBufferSize = *BufferSize;
   *BufferSize = RxLen;
@@ -143,9 +172,22 @@ VirtioNetReceive (
     *HeaderSize = Dev->Snm.MediaHeaderSize;
   }
 
-  RxPtr = (UINT8 *)(UINTN) Dev->RxRing.Desc[DescIdx + 1].Addr;
-  CopyMem (Buffer, RxPtr, RxLen);
+  CopyMem (Buffer, RxPtr + Dev->RxHdrSize, FirstLen);
+  CopyPtr = (UINT8 *) Buffer + FirstLen;
+  for (BufIdx = 1; BufIdx < NumBuffers; ++BufIdx) {
+    UsedElemIdx = (UINT16) (Dev->RxLastUsed + BufIdx) % Dev->RxRing.QueueSize;
+    CopyMem (
+      CopyPtr,
+      VIRTIO_NET_RX_BUF (Dev, Dev->RxRing.Used.UsedElem[UsedElemIdx].Id),
+      Dev->RxRing.Used.UsedElem[UsedElemIdx].Len
+      );
+    CopyPtr += Dev->RxRing.Used.UsedElem[UsedElemIdx].Len;
+  }
 
+  //
+  // parse the media header from the caller's copy, which is contiguous
+  //
+  RxPtr = Buffer;
   if (DestAddr != NULL) {
     CopyMem (DestAddr, RxPtr, SIZE_OF_VNET (Mac));
   }
@@ -164,19 +206,34 @@ VirtioNetReceive (
   Status = EFI_SUCCESS;
 
 RecycleDesc:
-  ++Dev->RxLastUsed;
-
   //
   // virtio-0.9.5, 2.4.1 Supplying Buffers to The Device
   //
   AvailIdx = *Dev->RxRing.Avail.Idx;
-  Dev->RxRing.Avail.Ring[AvailIdx++ % Dev->RxRing.QueueSize] =
-    (UINT16) DescIdx;
+  OldAvailIdx = AvailIdx;
+  for (BufIdx = 0; BufIdx < NumBuffers; ++BufIdx) {
+    UsedElemIdx = Dev->RxLastUsed++ % Dev->RxRing.QueueSize;
+    Dev->RxRing.Avail.Ring[AvailIdx++ % Dev->RxRing.QueueSize] =
+      (UINT16) Dev->RxRing.Used.UsedElem[UsedElemIdx].Id;
+  }
 
   MemoryFence ();
   *Dev->RxRing.Avail.Idx = AvailIdx;
 
+  //
+  // Notifying the host costs a VM exit per packet. The host needs the
+  // notification only if it may have run out of RX buffers: as long as it
+  // still owned at least half of them when we published the recycled ones
+  // above, it will find those without being notified. It can also ask us to
+  // stop notifying it.
+  //
   MemoryFence ();
+  if ((*Dev->RxRing.Used.Flags & VRING_USED_F_NO_NOTIFY) != 0 ||
+      (UINT16) (OldAvailIdx - *Dev->RxRing.Used.Idx) >=
+      Dev->RxMaxPending / 2) {
+    goto Exit;
+  }
+
   NotifyStatus = Dev->VirtIo->SetQueueNotify (Dev->VirtIo, VIRTIO_NET_Q_RX);
   if (!EFI_ERROR (Status)) { // earlier error takes precedence
     Status = NotifyStatus;
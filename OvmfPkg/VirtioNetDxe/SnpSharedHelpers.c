@@ -2,7 +2,7 @@
 
   Helper functions used by at least two Simple Network Protocol methods.
 
-  Copyright (C) 2013, Red Hat, Inc.
+  Copyright (C) 2013-2017, Red Hat, Inc.
 
   This program and the accompanying materials are licensed and made available
   under the terms and conditions of the BSD License which accompanies this
@@ -49,5 +49,6 @@ VirtioNetShutdownTx (
   IN OUT VNET_DEV *Dev
   )
 {
+  FreePool (Dev->TxDoneBuf);
   FreePool (Dev->TxFreeStack);
 }
@@ -2,7 +2,7 @@
 
   Implementation of the SNP.Transmit() function and its private helpers if any.
 
-  Copyright (C) 2013, Red Hat, Inc.
+  Copyright (C) 2013-2017, Red Hat, Inc.
   Copyright (c) 2006 - 2013, Intel Corporation. All rights reserved.<BR>
 
   This program and the accompanying materials are licensed and made available
@@ -106,10 +106,12 @@ VirtioNetTransmit (
   }
 
   //
-  // check if we have room for transmission
+  // Check if we have room for transmission. Transmitted buffers that
+  // VirtioNetGetStatus() has not reported yet count as well, so that its
+  // queue of recycled buffers never overflows.
   //
-  ASSERT (Dev->TxCurPending <= Dev->TxMaxPending);
-  if (Dev->TxCurPending == Dev->TxMaxPending) {
+  ASSERT (Dev->TxCurPending + Dev->TxDoneCount <= Dev->TxMaxPending);
+  if (Dev->TxCurPending + Dev->TxDoneCount == Dev->TxMaxPending) {
     Status = EFI_NOT_READY;
     goto Exit;
   }
@@ -160,7 +162,15 @@ VirtioNetTransmit (
   MemoryFence ();
   *Dev->TxRing.Avail.Idx = AvailIdx;
 
+  //
+  // virtio-0.9.5, 2.4.1.4 Notifying the Device -- skip the notification (and
+  // the VM exit it costs) if the host is processing the queue anyway
+  //
   MemoryFence ();
+  if ((*Dev->TxRing.Used.Flags & VRING_USED_F_NO_NOTIFY) != 0) {
+    Status = EFI_SUCCESS;
+    goto Exit;
+  }
   Status = Dev->VirtIo->SetQueueNotify (Dev->VirtIo, VIRTIO_NET_Q_TX);
 
 Exit:
@@ -3,7 +3,7 @@
   Internal definitions for the virtio-net driver, which produces Simple Network
   Protocol instances for virtio-net devices.
 
-  Copyright (C) 2013, Red Hat, Inc.
+  Copyright (C) 2013-2017, Red Hat, Inc.
 
   This program and the accompanying materials are licensed and made available
   under the terms and conditions of the BSD License which accompanies this
@@ -31,7 +31,7 @@
 //
 // maximum number of pending packets, separately for each direction
 //
-#define VNET_MAX_PENDING 64
+#define VNET_MAX_PENDING 256
 
 //
 // State diagram:
@@ -80,9 +80,14 @@ typedef struct {
   EFI_EVENT                   ExitBoot;          // VirtioNetSnpPopulate
   EFI_DEVICE_PATH_PROTOCOL    *MacDevicePath;    // VirtioNetDriverBindingStart
   EFI_HANDLE                  MacHandle;         // VirtioNetDriverBindingStart
+  BOOLEAN                     MergeableRxBufs;   // VirtioNetInitialize
 
   VRING                       RxRing;            // VirtioNetInitRing
   UINT8                       *RxBuf;            // VirtioNetInitRx
+  UINTN                       RxBufSize;         // VirtioNetInitRx
+  UINTN                       RxHdrSize;         // VirtioNetInitRx
+  UINT16                      RxDescPerPkt;      // VirtioNetInitRx
+  UINT16                      RxMaxPending;      // VirtioNetInitRx
   UINT16                      RxLastUsed;        // VirtioNetInitRx
 
   VRING                       TxRing;            // VirtioNetInitRing
@@ -91,6 +96,9 @@ typedef struct {
   UINT16                      *TxFreeStack;      // VirtioNetInitTx
   VIRTIO_1_0_NET_REQ          TxSharedReq;       // VirtioNetInitTx
   UINT16                      TxLastUsed;        // VirtioNetInitTx
+  VOID                        **TxDoneBuf;       // VirtioNetInitTx
+  UINT16                      TxDoneHead;        // VirtioNetInitTx
+  UINT16                      TxDoneCount;       // VirtioNetInitTx
 } VNET_DEV;
 
 
@@ -107,6 +115,14 @@ typedef struct {
 #define VIRTIO_NET_FROM_SNP(SnpPointer) \
         CR (SnpPointer, VNET_DEV, Snp, VNET_SIG)
 
+//
+// The slice of the Receive Destination Area that the RX descriptor chain with
+// head descriptor DescIdx points to. The virtio-net request header is at the
+// start of the slice, packet data follows it.
+//
+#define VIRTIO_NET_RX_BUF(Dev, DescIdx) \
+        ((Dev)->RxBuf + ((DescIdx) / (Dev)->RxDescPerPkt) * (Dev)->RxBufSize)
+
 #define VIRTIO_CFG_WRITE(Dev, Field, Value)  ((Dev)->VirtIo->WriteDevice (  \
                                                 (Dev)->VirtIo,              \
                                                 OFFSET_OF_VNET (Field),     \
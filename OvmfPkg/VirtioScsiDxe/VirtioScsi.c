@@ -7,16 +7,22 @@
 
   - No hotplug / hot-unplug.
 
-  - Although EFI_EXT_SCSI_PASS_THRU_PROTOCOL.PassThru() could be a good match
-    for multiple in-flight virtio-scsi requests, we stick to synchronous
-    requests for now.
-
-  - Timeouts are not supported for EFI_EXT_SCSI_PASS_THRU_PROTOCOL.PassThru().
+  - EFI_EXT_SCSI_PASS_THRU_PROTOCOL.PassThru() supports non-blocking
+    requests. Blocking and non-blocking requests share the request queue as
+    simple (tagged) SCSI tasks, with as many in flight as the queue has
+    descriptor slots for. The device never raises interrupts; a periodic timer
+    retrieves completed non-blocking requests and signals their events.
+
+  - EFI_EXT_SCSI_PASS_THRU_PROTOCOL.PassThru() honors the timeout of blocking
+    requests. A request that times out fails alone with EFI_TIMEOUT; if the
+    host has already taken it, the device is reset and reinitialized, and the
+    other requests in flight fail with EFI_DEVICE_ERROR. The timeout of a
+    non-blocking request only extends how long DriverBindingStop() waits.
 
   - Only one channel is supported. (At the time of this writing, host-side
     virtio-scsi supports a single channel too.)
 
-  - Only one request queue is used (for the one synchronous request).
+  - Only one request queue is used.
 
   - The ResetChannel() and ResetTargetLun() functions of
     EFI_EXT_SCSI_PASS_THRU_PROTOCOL are not supported (which is allowed by the
@@ -25,8 +31,8 @@
     however require client code for the control queue, which is deemed
     unreasonable for now.
 
-  Copyright (C) 2012, Red Hat, Inc.
-  Copyright (c) 2012 - 2014, Intel Corporation. All rights reserved.<BR>
+  Copyright (C) 2012-2017, Red Hat, Inc.
+  Copyright (c) 2012 - 2017, Intel Corporation. All rights reserved.<BR>
 
   This program and the accompanying materials are licensed and made available
   under the terms and conditions of the BSD License which accompanies this
@@ -39,6 +45,7 @@
 **/
 
 #include <IndustryStandard/VirtioScsi.h>
+#include <Library/BaseLib.h>
 #include <Library/BaseMemoryLib.h>
 #include <Library/DebugLib.h>
 #include <Library/MemoryAllocationLib.h>
@@ -387,6 +394,178 @@ ParseResponse (
 }
 
 
+/**
+
+  Report that the host adapter could not transfer a request, because the
+  virtio-scsi device failed or the request timed out.
+
+  @param[in out] Packet  The Extended SCSI Pass Thru Protocol packet that has
+                         been translated to a virtio-scsi request with
+                         PopulateRequest(). On output no data is reported
+                         transferred.
+
+  @param[in] Status      EFI_TIMEOUT if the request timed out, otherwise the
+                         error the request failed with.
+
+
+  @retval EFI_TIMEOUT       The request timed out.
+
+  @retval EFI_DEVICE_ERROR  The request failed otherwise.
+
+**/
+STATIC
+EFI_STATUS
+ReportHostAdapterError (
+  IN OUT EFI_EXT_SCSI_PASS_THRU_SCSI_REQUEST_PACKET *Packet,
+  IN     EFI_STATUS                                 Status
+  )
+{
+  Packet->InTransferLength  = 0;
+  Packet->OutTransferLength = 0;
+  Packet->TargetStatus      = EFI_EXT_SCSI_STATUS_TARGET_GOOD;
+  Packet->SenseDataLength   = 0;
+
+  if (Status == EFI_TIMEOUT) {
+    Packet->HostAdapterStatus = EFI_EXT_SCSI_STATUS_HOST_ADAPTER_TIMEOUT;
+    return EFI_TIMEOUT;
+  }
+
+  Packet->HostAdapterStatus = EFI_EXT_SCSI_STATUS_HOST_ADAPTER_OTHER;
+  return EFI_DEVICE_ERROR;
+}
+
+
+/**
+
+  Append the descriptors of a virtio-scsi request to a descriptor table: the
+  request header, "dataout" (if any), the response, and "datain" (if any).
+
+  @param[in]     Request  The request to format.
+
+  @param[in out] Ring     The descriptor table to fill in. Either the virtio
+                          ring of the device, or a ring-like view of
+                          Req->IndirectDesc.
+
+  @param[in out] Indices  Tracks the descriptors appended to Ring.
+
+**/
+STATIC
+VOID
+EFIAPI
+AppendRequestDescs (
+  IN     VIRTIO_REQUEST *Request,
+  IN OUT VRING          *Ring,
+  IN OUT DESC_INDICES   *Indices
+  )
+{
+  VSCSI_REQ                                  *Req;
+  EFI_EXT_SCSI_PASS_THRU_SCSI_REQUEST_PACKET *Packet;
+
+  Req    = VSCSI_REQ_FROM_VIRTIO_REQ (Request);
+  Packet = Req->Packet;
+
+  //
+  // enqueue Request
+  //
+  VirtioAppendDesc (Ring, (UINTN) &Req->Request, sizeof Req->Request,
+    VRING_DESC_F_NEXT, Indices);
+
+  //
+  // enqueue "dataout" if any
+  //
+  if (Packet->OutTransferLength > 0) {
+    VirtioAppendDesc (Ring, (UINTN) Packet->OutDataBuffer,
+      Packet->OutTransferLength, VRING_DESC_F_NEXT, Indices);
+  }
+
+  //
+  // enqueue Response, to be written by the host
+  //
+  VirtioAppendDesc (Ring, (UINTN) &Req->Response, sizeof Req->Response,
+    VRING_DESC_F_WRITE | (Packet->InTransferLength > 0 ?
+                          VRING_DESC_F_NEXT : 0),
+    Indices);
+
+  //
+  // enqueue "datain" if any, to be written by the host
+  //
+  if (Packet->InTransferLength > 0) {
+    VirtioAppendDesc (Ring, (UINTN) Packet->InDataBuffer,
+      Packet->InTransferLength, VRING_DESC_F_WRITE, Indices);
+  }
+}
+
+
+/**
+
+  Complete a non-blocking request: parse its response, signal its event and
+  release it. The response of a blocking request is parsed by
+  VirtioScsiPassThru().
+
+  @param[in] Request  The request that has completed.
+
+**/
+STATIC
+VOID
+EFIAPI
+CompleteRequest (
+  IN VIRTIO_REQUEST *Request
+  )
+{
+  VSCSI_REQ *Req;
+
+  Req = VSCSI_REQ_FROM_VIRTIO_REQ (Request);
+  if (Req->Event == NULL) {
+    return;
+  }
+
+  if (EFI_ERROR (Request->Status)) {
+    ReportHostAdapterError (Req->Packet, Request->Status);
+  } else {
+    ParseResponse (Req->Packet, &Req->Response);
+  }
+  gBS->SignalEvent (Req->Event);
+  FreePool (Req);
+}
+
+
+/**
+
+  Write the guest-tuneables of the virtio-scsi device, during
+  VirtioScsiInit(), and when the request queue reinitializes the device after
+  a timeout.
+
+  @param[in] Queue  The request queue of the device.
+
+  @retval EFI_SUCCESS  The device is configured.
+
+  @return              Error codes from VIRTIO_CFG_WRITE().
+
+**/
+STATIC
+EFI_STATUS
+EFIAPI
+ConfigureDevice (
+  IN VIRTIO_REQUEST_QUEUE *Queue
+  )
+{
+  VSCSI_DEV  *Dev;
+  EFI_STATUS Status;
+
+  Dev = VIRTIO_SCSI_FROM_QUEUE (Queue);
+
+  //
+  // We expect these maximum sizes from the host. Since they are
+  // guest-negotiable, ask for them rather than just checking them.
+  //
+  Status = VIRTIO_CFG_WRITE (Dev, CdbSize, VIRTIO_SCSI_CDB_SIZE);
+  if (EFI_ERROR (Status)) {
+    return Status;
+  }
+  return VIRTIO_CFG_WRITE (Dev, SenseSize, VIRTIO_SCSI_SENSE_SIZE);
+}
+
+
 //
 // The next seven functions implement EFI_EXT_SCSI_PASS_THRU_PROTOCOL
 // for the virtio-scsi HBA. Refer to UEFI Spec 2.3.1 + Errata C, sections
@@ -404,82 +583,80 @@ VirtioScsiPassThru (
   IN     EFI_EVENT                                  Event   OPTIONAL
   )
 {
-  VSCSI_DEV                 *Dev;
-  UINT16                    TargetValue;
-  EFI_STATUS                Status;
-  volatile VIRTIO_SCSI_REQ  Request;
-  volatile VIRTIO_SCSI_RESP Response;
-  DESC_INDICES              Indices;
-
-  ZeroMem ((VOID*) &Request, sizeof (Request));
-  ZeroMem ((VOID*) &Response, sizeof (Response));
+  VSCSI_DEV  *Dev;
+  UINT16     TargetValue;
+  EFI_STATUS Status;
+  VSCSI_REQ  BlockingReq;
+  VSCSI_REQ  *Req;
+  EFI_TPL    OldTpl;
 
   Dev = VIRTIO_SCSI_FROM_PASS_THRU (This);
   CopyMem (&TargetValue, Target, sizeof TargetValue);
 
-  Status = PopulateRequest (Dev, TargetValue, Lun, Packet, &Request);
+  //
+  // A non-blocking request must outlive this call.
+  //
+  if (Event == NULL) {
+    Req = &BlockingReq;
+  } else {
+    Req = AllocatePool (sizeof *Req);
+    if (Req == NULL) {
+      return EFI_OUT_OF_RESOURCES;
+    }
+  }
+  ZeroMem ((VOID*) Req, sizeof *Req);
+
+  Status = PopulateRequest (Dev, TargetValue, Lun, Packet, &Req->Request);
   if (EFI_ERROR (Status)) {
+    if (Event != NULL) {
+      FreePool (Req);
+    }
     return Status;
   }
 
-  VirtioPrepare (&Dev->Ring, &Indices);
+  Req->Signature              = VSCSI_REQ_SIG;
+  Req->VirtioReq.IndirectDesc = Req->IndirectDesc;
+  Req->Packet                 = Packet;
+  Req->Event                  = Event;
 
   //
   // preset a host status for ourselves that we do not accept as success
   //
-  Response.Response = VIRTIO_SCSI_S_FAILURE;
+  Req->Response.Response = VIRTIO_SCSI_S_FAILURE;
 
   //
-  // ensured by VirtioScsiInit() -- this predicate, in combination with the
-  // lock-step progress, ensures we don't have to track free descriptors.
+  // ensured by VirtioScsiInit() -- a request uses at most four descriptors
   //
   ASSERT (Dev->Ring.QueueSize >= 4);
 
   //
-  // enqueue Request
-  //
-  VirtioAppendDesc (&Dev->Ring, (UINTN) &Request, sizeof Request,
-    VRING_DESC_F_NEXT, &Indices);
-
-  //
-  // enqueue "dataout" if any
+  // Tag the request as a simple SCSI task. DriverBindingStop() waits for the
+  // non-blocking requests as long as the longest of their timeouts.
   //
-  if (Packet->OutTransferLength > 0) {
-    VirtioAppendDesc (&Dev->Ring, (UINTN) Packet->OutDataBuffer,
-      Packet->OutTransferLength, VRING_DESC_F_NEXT, &Indices);
+  OldTpl = gBS->RaiseTPL (TPL_NOTIFY);
+  Req->Request.Id       = Dev->NextTag++;
+  Req->Request.TaskAttr = VIRTIO_SCSI_S_SIMPLE;
+  if (Event != NULL && Packet->Timeout > Dev->DrainTimeout) {
+    Dev->DrainTimeout = Packet->Timeout;
   }
+  gBS->RestoreTPL (OldTpl);
 
-  //
-  // enqueue Response, to be written by the host
-  //
-  VirtioAppendDesc (&Dev->Ring, (UINTN) &Response, sizeof Response,
-    VRING_DESC_F_WRITE | (Packet->InTransferLength > 0 ?
-                          VRING_DESC_F_NEXT : 0),
-    &Indices);
-
-  //
-  // enqueue "datain" if any, to be written by the host
-  //
-  if (Packet->InTransferLength > 0) {
-    VirtioAppendDesc (&Dev->Ring, (UINTN) Packet->InDataBuffer,
-      Packet->InTransferLength, VRING_DESC_F_WRITE, &Indices);
+  if (Event != NULL) {
+    VirtioRequestQueueSubmit (&Dev->Queue, &Req->VirtioReq);
+    return EFI_SUCCESS;
   }
 
-  // If kicking the host fails, we must fake a host adapter error.
-  // EFI_NOT_READY would save us the effort, but it would also suggest that the
-  // caller retry.
   //
-  if (VirtioFlush (Dev->VirtIo, VIRTIO_SCSI_REQUEST_QUEUE, &Dev->Ring,
-        &Indices, NULL) != EFI_SUCCESS) {
-    Packet->InTransferLength  = 0;
-    Packet->OutTransferLength = 0;
-    Packet->HostAdapterStatus = EFI_EXT_SCSI_STATUS_HOST_ADAPTER_OTHER;
-    Packet->TargetStatus      = EFI_EXT_SCSI_STATUS_TARGET_GOOD;
-    Packet->SenseDataLength   = 0;
-    return EFI_DEVICE_ERROR;
+  // Don't wait for the poll timer; VirtioRequestQueueExecute() retrieves the
+  // completion as soon as the host produces it.
+  //
+  Status = VirtioRequestQueueExecute (&Dev->Queue, &BlockingReq.VirtioReq,
+             Packet->Timeout);
+  if (EFI_ERROR (Status)) {
+    return ReportHostAdapterError (Packet, Status);
   }
 
-  return ParseResponse (Packet, &Response);
+  return ParseResponse (Packet, &BlockingReq.Response);
 }
 
 
@@ -800,7 +977,8 @@ VirtioScsiInit (
     goto Failed;
   }
 
-  Features &= VIRTIO_SCSI_F_INOUT | VIRTIO_F_VERSION_1;
+  Features &= VIRTIO_SCSI_F_INOUT | VIRTIO_F_VERSION_1 |
+              VIRTIO_F_RING_INDIRECT_DESC;
 
   //
   // In virtio-1.0, feature negotiation is expected to complete before queue
@@ -825,7 +1003,7 @@ VirtioScsiInit (
     goto Failed;
   }
   //
-  // VirtioScsiPassThru() uses at most four descriptors
+  // VirtioScsiPassThru() uses at most four descriptors per request
   //
   if (QueueSize < 4) {
     Status = EFI_UNSUPPORTED;
@@ -837,18 +1015,33 @@ VirtioScsiInit (
     goto Failed;
   }
 
+  //
+  // With indirect descriptors, each request occupies a single descriptor of
+  // the ring.
+  //
+  Dev->NextTag      = 0;
+  Dev->DrainTimeout = VSCSI_DRAIN_TIMEOUT;
+  Status = VirtioRequestQueueInit (&Dev->Queue, Dev->VirtIo,
+             VIRTIO_SCSI_REQUEST_QUEUE, &Dev->Ring, Features,
+             (BOOLEAN) ((Features & VIRTIO_F_RING_INDIRECT_DESC) != 0),
+             VSCSI_MAX_DESC_PER_REQUEST, AppendRequestDescs, CompleteRequest,
+             ConfigureDevice);
+  if (EFI_ERROR (Status)) {
+    goto ReleaseQueue;
+  }
+
   //
   // Additional steps for MMIO: align the queue appropriately, and set the
   // size. If anything fails from here on, we must release the ring resources.
   //
   Status = Dev->VirtIo->SetQueueNum (Dev->VirtIo, QueueSize);
   if (EFI_ERROR (Status)) {
-    goto ReleaseQueue;
+    goto UninitRequestQueue;
   }
 
   Status = Dev->VirtIo->SetQueueAlign (Dev->VirtIo, EFI_PAGE_SIZE);
   if (EFI_ERROR (Status)) {
-    goto ReleaseQueue;
+    goto UninitRequestQueue;
   }
 
   //
@@ -856,7 +1049,7 @@ VirtioScsiInit (
   //
   Status = Dev->VirtIo->SetQueueAddress (Dev->VirtIo, &Dev->Ring);
   if (EFI_ERROR (Status)) {
-    goto ReleaseQueue;
+    goto UninitRequestQueue;
   }
 
   //
@@ -866,21 +1059,13 @@ VirtioScsiInit (
     Features &= ~(UINT64)VIRTIO_F_VERSION_1;
     Status = Dev->VirtIo->SetGuestFeatures (Dev->VirtIo, Features);
     if (EFI_ERROR (Status)) {
-      goto ReleaseQueue;
+      goto UninitRequestQueue;
     }
   }
 
-  //
-  // We expect these maximum sizes from the host. Since they are
-  // guest-negotiable, ask for them rather than just checking them.
-  //
-  Status = VIRTIO_CFG_WRITE (Dev, CdbSize, VIRTIO_SCSI_CDB_SIZE);
+  Status = ConfigureDevice (&Dev->Queue);
   if (EFI_ERROR (Status)) {
-    goto ReleaseQueue;
-  }
-  Status = VIRTIO_CFG_WRITE (Dev, SenseSize, VIRTIO_SCSI_SENSE_SIZE);
-  if (EFI_ERROR (Status)) {
-    goto ReleaseQueue;
+    goto UninitRequestQueue;
   }
 
   //
@@ -889,7 +1074,7 @@ VirtioScsiInit (
   NextDevStat |= VSTAT_DRIVER_OK;
   Status = Dev->VirtIo->SetDeviceStatus (Dev->VirtIo, NextDevStat);
   if (EFI_ERROR (Status)) {
-    goto ReleaseQueue;
+    goto UninitRequestQueue;
   }
 
   //
@@ -913,10 +1098,11 @@ VirtioScsiInit (
   //
   // Set both physical and logical attributes for non-RAID SCSI channel. See
   // Driver Writer's Guide for UEFI 2.3.1 v1.01, 20.1.5 Implementing Extended
-  // SCSI Pass Thru Protocol.
+  // SCSI Pass Thru Protocol. Non-blocking requests are supported.
   //
   Dev->PassThruMode.Attributes = EFI_EXT_SCSI_PASS_THRU_ATTRIBUTES_PHYSICAL |
-                                 EFI_EXT_SCSI_PASS_THRU_ATTRIBUTES_LOGICAL;
+                                 EFI_EXT_SCSI_PASS_THRU_ATTRIBUTES_LOGICAL |
+                                 EFI_EXT_SCSI_PASS_THRU_ATTRIBUTES_NONBLOCKIO;
 
   //
   // no restriction on transfer buffer alignment
@@ -925,6 +1111,9 @@ VirtioScsiInit (
 
   return EFI_SUCCESS;
 
+UninitRequestQueue:
+  VirtioRequestQueueUninit (&Dev->Queue);
+
 ReleaseQueue:
   VirtioRingUninit (&Dev->Ring);
 
@@ -964,6 +1153,7 @@ VirtioScsiUninit (
   Dev->MaxLun         = 0;
   Dev->MaxSectors     = 0;
 
+  VirtioRequestQueueUninit (&Dev->Queue);
   VirtioRingUninit (&Dev->Ring);
 
   SetMem (&Dev->PassThru,     sizeof Dev->PassThru,     0x00);
@@ -1160,6 +1350,13 @@ VirtioScsiDriverBindingStop (
     return Status;
   }
 
+  //
+  // Let the host finish the requests that are still queued, so that their
+  // events get signaled and their buffers are no longer accessed. Requests
+  // that the host doesn't finish in time are failed.
+  //
+  VirtioRequestQueueDrain (&Dev->Queue, Dev->DrainTimeout);
+
   gBS->CloseEvent (Dev->ExitBoot);
 
   VirtioScsiUninit (Dev);
@@ -3,7 +3,7 @@
   Internal definitions for the virtio-scsi driver, which produces Extended SCSI
   Pass Thru Protocol instances for virtio-scsi devices.
 
-  Copyright (C) 2012, Red Hat, Inc.
+  Copyright (C) 2012-2017, Red Hat, Inc.
 
   This program and the accompanying materials are licensed and made available
   under the terms and conditions of the BSD License which accompanies this
@@ -23,6 +23,8 @@
 #include <Protocol/ScsiPassThruExt.h>
 
 #include <IndustryStandard/Virtio.h>
+#include <IndustryStandard/VirtioScsi.h>
+#include <Library/VirtioLib.h>
 
 
 //
@@ -40,6 +42,35 @@
 #endif
 
 
+//
+// The shortest time that DriverBindingStop() gives the host to finish the
+// outstanding requests, before the device is reset.
+//
+#define VSCSI_DRAIN_TIMEOUT EFI_TIMER_PERIOD_SECONDS (30)
+
+//
+// A SCSI command in flight. Blocking requests live on the stack of
+// VirtioScsiPassThru(), non-blocking ones are allocated by it and freed when
+// their event is signaled.
+//
+#define VSCSI_REQ_SIG SIGNATURE_32 ('V', 'S', 'R', 'Q')
+
+#define VSCSI_MAX_DESC_PER_REQUEST 4 // request, dataout, response, datain
+
+typedef struct {
+  UINT32                                     Signature;
+  VIRTIO_REQUEST                             VirtioReq; // VSCSI_DEV.Queue
+  EFI_EXT_SCSI_PASS_THRU_SCSI_REQUEST_PACKET *Packet;
+  EFI_EVENT                                  Event;     // NULL if blocking
+  volatile VIRTIO_SCSI_REQ                   Request;
+  volatile VIRTIO_SCSI_RESP                  Response;
+  volatile VRING_DESC                        IndirectDesc[VSCSI_MAX_DESC_PER_REQUEST];
+} VSCSI_REQ;
+
+#define VSCSI_REQ_FROM_VIRTIO_REQ(VirtioReqPointer) \
+        CR (VirtioReqPointer, VSCSI_REQ, VirtioReq, VSCSI_REQ_SIG)
+
+
 #define VSCSI_SIG SIGNATURE_32 ('V', 'S', 'C', 'S')
 
 typedef struct {
@@ -60,11 +91,20 @@ typedef struct {
   VRING                           Ring;           // VirtioRingInit      2
   EFI_EXT_SCSI_PASS_THRU_PROTOCOL PassThru;       // VirtioScsiInit      1
   EFI_EXT_SCSI_PASS_THRU_MODE     PassThruMode;   // VirtioScsiInit      1
+  VIRTIO_REQUEST_QUEUE            Queue;          // VirtioScsiInit      1
+  UINT64                          NextTag;        // VirtioScsiInit      1
+  UINT64                          DrainTimeout;   // VirtioScsiInit      1
 } VSCSI_DEV;
 
 #define VIRTIO_SCSI_FROM_PASS_THRU(PassThruPointer) \
         CR (PassThruPointer, VSCSI_DEV, PassThru, VSCSI_SIG)
 
+//
+// Also used by VirtioScsiInit(), before the signature is set.
+//
+#define VIRTIO_SCSI_FROM_QUEUE(QueuePointer) \
+        BASE_CR (QueuePointer, VSCSI_DEV, Queue)
+
 
 //
 // Probe, start and stop functions of this driver, called by the DXE core for